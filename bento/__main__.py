@@ -14,6 +14,7 @@ import re
 from .box import Box
 from .argstuff import ArgumentParser
 from .glue.error_glue import ErrorGlue
+from .glue.profile_glue import ProfileGlue
 
 COMMANDS = co.OrderedDict()
 def command(cls):
@@ -173,6 +174,134 @@ class BuildCommand:
                 outputwrite(child)
         outputwrite(box)
 
+@command
+class BenchCommand:
+    """
+    Build and run a set of benchmarks on the host, measuring call
+    latency, init time, and printf throughput for each runtime/loader/init.
+    Results are written as JSON.
+    """
+    __argname__ = "bench"
+    __arghelp__ = __doc__
+    @classmethod
+    def __argparse__(cls, parser):
+        from . import bench
+        parser.add_argument('-r', '--runtime', action='append',
+            choices=bench.RUNTIMES,
+            help="Box runtime to benchmark, may be repeated. Defaults to "
+                "%s." % ', '.join(bench.RUNTIMES))
+        parser.add_argument('-l', '--loader', action='append',
+            choices=bench.LOADERS,
+            help="Box loader to benchmark, may be repeated. Defaults to "
+                "noop.")
+        parser.add_argument('-i', '--init', action='append',
+            choices=bench.INITS,
+            help="Box init mode to benchmark, may be repeated. Defaults to "
+                "lazy.")
+        parser.add_argument('--glz',
+            help="Path to the glz command-line tool, needed for the glz "
+                "loader. Defaults to glz.")
+        parser.add_argument('-J', '--outer-longjmp', action='store_true',
+            help="Only set up longjmp recovery at the outermost entry "
+                "into each box.")
+        parser.add_argument('-B', '--write-buffer', type=int,
+            help="Buffer the box's printf output in a buffer of this many "
+                "bytes, flushed on newlines. Defaults to unbuffered.")
+        parser.add_argument('-n', '--iterations', type=int,
+            help="Number of iterations for each measurement. Defaults to "
+                "10000.")
+        parser.add_argument('-j', '--jobs', type=int,
+            help="Number of parallel jobs for make.")
+        parser.add_argument('-o', '--output',
+            help="File to write JSON results to. Defaults to stdout.")
+        parser.add_argument('-k', '--keep',
+            help="Build in this directory and keep the results, useful "
+                "for debugging.")
+    def __init__(self, runtime=None, loader=None, init=None,
+            glz=None, outer_longjmp=False, write_buffer=None,
+            iterations=None, jobs=None, output=None, keep=None):
+        import json
+        from . import bench
+        results = bench.bench(
+            runtimes=runtime or bench.RUNTIMES,
+            loaders=loader or ['noop'],
+            inits=init or ['lazy'],
+            outer_longjmp=outer_longjmp,
+            write_buffer=write_buffer or 0,
+            iterations=iterations or 10000,
+            keep=keep,
+            jobs=jobs,
+            glz=os.path.abspath(glz) if glz and os.path.dirname(glz)
+                else glz or 'glz')
+
+        if output:
+            with open(output, 'w') as f:
+                json.dump(results, f, indent=4)
+                f.write('\n')
+        else:
+            json.dump(results, sys.stdout, indent=4)
+            sys.stdout.write('\n')
+
+        if any('error' in config for config in results['configs']):
+            sys.exit(1)
+
+@command
+class ProfileCommand:
+    """
+    Print a report of the calls between boxes, given the output of
+    __box_profile_dump from a box built with output.c.profile.
+    """
+    __argname__ = "profile"
+    __arghelp__ = __doc__
+    @classmethod
+    def __argparse__(cls, parser):
+        parser.add_argument('dump', nargs='?',
+            help="File containing the output of __box_profile_dump, any "
+                "other output is ignored. Defaults to stdin.")
+        box_argparse(cls, parser)
+    def __init__(self, dump=None, **args):
+        box = Box.scan(**args)
+        box.box()
+        box.link()
+        links = ProfileGlue.profilelinks(box)
+
+        # only the last dump counts
+        unit = 'cycles'
+        counters = {}
+        with open(dump) if dump else sys.stdin as f:
+            for line in f:
+                fields = line.split()
+                if not fields or fields[0] != '__box_profile':
+                    continue
+                if len(fields) == 3:
+                    if int(fields[1], 16) != len(links):
+                        print('Found %d counters, but box %s has %d links, '
+                            'is this the same configuration?' % (
+                                int(fields[1], 16), box.name, len(links)))
+                        sys.exit(1)
+                    unit = fields[2]
+                elif len(fields) == 4:
+                    i, calls, cycles = (int(field, 16)
+                        for field in fields[1:])
+                    counters[links[i]] = (calls, cycles)
+
+        if not counters:
+            print('No profile found')
+            sys.exit(1)
+
+        total = sum(cycles for _, cycles in counters.values())
+        print('%-40s %10s %12s %10s %6s' % (
+            'link', 'calls', unit, '%s/call' % unit, '%'))
+        for (caller, callee, name), (calls, cycles) in sorted(
+                counters.items(), key=lambda x: (-x[1][1], -x[1][0])):
+            link = '%s -> %s.%s' % (caller, callee, name)
+            if len(link) > 40:
+                print(link)
+                link = ''
+            print('%-40s %10d %12d %10d %5.1f%%' % (
+                link, calls, cycles, cycles // calls if calls else 0,
+                100*cycles / total if total else 0))
+
 @command
 class OptionsCommand:
     """
@@ -0,0 +1,489 @@
+#
+# Cross-runtime benchmark suite
+#
+# Generates the same set of workloads for each requested runtime/loader,
+# builds and runs them on the host, and collects the results as JSON.
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import os
+import re
+import shutil
+import struct
+import subprocess
+import tempfile
+import time
+from .box import Box
+
+# runtimes we know how to run locally, the sys is always host-sys
+RUNTIMES = ['host', 'host-mprotect']
+LOADERS = ['noop', 'glz', 'bd', 'fs']
+INITS = ['lazy', 'trampoline', 'manual']
+ARRAY_SIZES = [16, 256, 4096]
+
+RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2003ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+export.__box_write = 'fn(i32, const u8[size], usize size) -> errsize'
+export.bench_reenter = 'fn() -> err'
+%(sys_recipe)s
+import.bench_empty = 'fn() -> err'
+import.bench_sum = 'fn(const u8[size] buffer, usize size) -> u32'
+import.bench_printf = 'fn(u32 n) -> err'
+import.bench_nested = 'fn(u32 n) -> err'
+import.bench_queued = 'queued fn(u32 n) -> void'
+
+[box.box1]
+runtime.runtime = '%(runtime)s'
+runtime.%(runtime_)s.outer_longjmp = %(outer_longjmp)s
+loader.loader = '%(loader)s'
+init = '%(init)s'
+%(box_recipe)s
+stack = 0x1000
+heap = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c.path = 'bb.c'
+output.c.write_buffer = %(write_buffer)d
+output.mk = 'Makefile'
+
+export.bench_empty = 'fn() -> err'
+export.bench_sum = 'fn(const u8[size] buffer, usize size) -> u32'
+export.bench_printf = 'fn(u32 n) -> err'
+export.bench_nested = 'fn(u32 n) -> err'
+export.bench_queued = 'queued fn(u32 n) -> void'
+
+import.bench_reenter = 'fn() -> err'
+"""
+
+SYS_MAIN = """
+/*
+ * Bento-linker benchmark, generated by bento bench
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bb.h"
+
+static uint64_t timer_getns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+}
+
+// printf output from the box is counted and discarded while measuring
+static bool discard = false;
+static uint64_t discarded = 0;
+
+ssize_t __box_write(int32_t fd, const void *buffer, size_t size) {
+    if (discard) {
+        discarded += size;
+        return size;
+    }
+    return write(fd, buffer, size);
+}
+
+static void report(const char *name, double value) {
+    char buf[128];
+    int size = snprintf(buf, sizeof(buf), "bench %%s %%.3f\\n", name, value);
+    write(1, buf, size);
+}
+
+static void check(int err) {
+    if (err < 0) {
+        char buf[64];
+        int size = snprintf(buf, sizeof(buf), "error %%d\\n", err);
+        write(1, buf, size);
+        exit(1);
+    }
+}
+
+%(sys_main)s
+// called from inside box1, calls back into box1
+int bench_reenter(void) {
+    return bench_empty();
+}
+
+static uint8_t array[%(max_size)d];
+
+int main(int argc, char **argv) {
+    uint32_t n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    uint64_t start;
+
+    // init time, clobber so every init starts from scratch
+    uint64_t init = 0;
+    for (uint32_t i = 0; i < n/10+1; i++) {
+        check(__box_box1_clobber());
+        start = timer_getns();
+        check(__box_box1_init());
+        init += timer_getns() - start;
+    }
+    report("init_ns", (double)init / (n/10+1));
+
+    // empty call, warm up once to avoid measuring lazy init
+    check(__box_box1_init());
+    check(bench_empty());
+    start = timer_getns();
+    for (uint32_t i = 0; i < n; i++) {
+        bench_empty();
+    }
+    uint64_t ns = timer_getns() - start;
+    report("empty_call_ns", (double)ns / n);
+    report("empty_calls_per_s", (double)n*1.0e9 / ns);
+
+    // queued calls, these only enter the box when the queue fills up
+    // or is drained
+    check(__box_box1_drain());
+    start = timer_getns();
+    for (uint32_t i = 0; i < n; i++) {
+        bench_queued(i);
+    }
+    check(__box_box1_drain());
+    ns = timer_getns() - start;
+    report("queued_call_ns", (double)ns / n);
+    report("queued_calls_per_s", (double)n*1.0e9 / ns);
+
+    // nested calls, box -> sys -> box
+    start = timer_getns();
+    check(bench_nested(n));
+    report("nested_call_ns", (double)(timer_getns() - start) / n);
+
+    // calls with array arguments
+    for (size_t i = 0; i < sizeof(array); i++) {
+        array[i] = i;
+    }
+    const size_t sizes[] = {%(sizes)s};
+    for (size_t j = 0; j < sizeof(sizes)/sizeof(sizes[0]); j++) {
+        volatile uint32_t sum = 0;
+        start = timer_getns();
+        for (uint32_t i = 0; i < n; i++) {
+            sum += bench_sum(array, sizes[j]);
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "array_call_%%zu_ns", sizes[j]);
+        report(name, (double)(timer_getns() - start) / n);
+    }
+
+    // printf throughput
+    discard = true;
+    discarded = 0;
+    start = timer_getns();
+    int err = bench_printf(n);
+    ns = timer_getns() - start;
+    discard = false;
+    check(err);
+    report("printf_bytes", (double)discarded);
+    report("printf_bytes_per_s", (double)discarded*1.0e9 / ns);
+    return 0;
+}
+"""
+
+BOX_MAIN = """
+/*
+ * Bento-linker benchmark, generated by bento bench
+ */
+
+#include "bb.h"
+#include <stdio.h>
+
+int bench_empty(void) {
+    return 0;
+}
+
+uint32_t bench_sum(const void *buffer, size_t size) {
+    const uint8_t *buffer_ = buffer;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += buffer_[i];
+    }
+    return sum;
+}
+
+int bench_nested(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        int err = bench_reenter();
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+static volatile uint32_t queued_sum = 0;
+void bench_queued(uint32_t n) {
+    queued_sum += n;
+}
+
+int bench_printf(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        printf("box1 says hello %%u times!\\n", i);
+    }
+    return 0;
+}
+"""
+
+# what each loader needs, the box's memories, any hooks the sys provides,
+# and the sys side of these hooks. The bd and fs loaders load box1 from an
+# image written after the build, see image
+LOADER_BOX_RECIPES = {
+    'noop': """
+memory.flash = 'rxp 0x4000'
+memory.ram = 'rw 0x4000'
+""",
+    'glz': """
+loader.glz.glz = '%(glz)s'
+memory.flash = 'rp 0x4000'
+memory.ram = 'rwx 0x8000'
+""",
+    'bd': """
+loader.bd.region = '0x00000000-0x000fffff'
+loader.bd.block_size = 512
+memory.text = 'rwx 0x4000'
+memory.ram = 'rw 0x4000'
+""",
+    'fs': """
+loader.fs.path = 'box1.img'
+memory.text = 'rwx 0x4000'
+memory.ram = 'rw 0x4000'
+""",
+}
+
+LOADER_SYS_RECIPES = {
+    'bd': """
+export.__box_box1_bdread = 'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'
+""",
+    'fs': """
+export.__box_box1_open = 'fn(mut i32 *fd, const i8 *path, u32 flags) -> err'
+export.__box_box1_close = 'fn(i32 fd) -> err'
+export.__box_box1_read = 'fn(i32 fd, mut u8 *buffer, usize size) -> errsize'
+export.__box_box1_seek = 'fn(i32 fd, usize off, u32 whence) -> errsize'
+""",
+}
+
+LOADER_SYS_MAINS = {
+    'bd': """
+// simulated block device, backed by box1.img read into memory
+static uint8_t image[0x10000];
+static size_t image_size;
+
+__attribute__((constructor))
+static void image_load(void) {
+    FILE *f = fopen("box1.img", "rb");
+    if (!f) {
+        return;
+    }
+    image_size = fread(image, 1, sizeof(image), f);
+    fclose(f);
+}
+
+int __box_box1_bdread(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    size_t addr = (size_t)block*512 + off;
+    if (addr + size > image_size) {
+        return -EINVAL;
+    }
+
+    memcpy(buffer, &image[addr], size);
+    return 0;
+}
+""",
+    'fs': """
+// filesystem hooks, box1.img is on the host's filesystem
+int __box_box1_open(int32_t *fd, const char *path, uint32_t flags) {
+    int res = open(path, O_RDONLY);
+    if (res < 0) {
+        return -ENOENT;
+    }
+
+    *fd = res;
+    return 0;
+}
+
+int __box_box1_close(int32_t fd) {
+    return close(fd) < 0 ? -EIO : 0;
+}
+
+ssize_t __box_box1_read(int32_t fd, void *buffer, size_t size) {
+    ssize_t res = read(fd, buffer, size);
+    return res < 0 ? -EIO : res;
+}
+
+ssize_t __box_box1_seek(int32_t fd, size_t off, uint32_t whence) {
+    off_t res = lseek(fd, off, whence);
+    return res < 0 ? -EIO : res;
+}
+""",
+}
+
+def segments(path):
+    """
+    Yield (addr, data) for each loadable segment in an ELF64 file.
+    """
+    with open(path, 'rb') as f:
+        elf = f.read()
+    phoff, = struct.unpack_from('<Q', elf, 0x20)
+    phentsize, phnum = struct.unpack_from('<HH', elf, 0x36)
+    for i in range(phnum):
+        type_, _, off, addr, _, filesz, _, _ = struct.unpack_from(
+            '<IIQQQQQQ', elf, phoff + i*phentsize)
+        if type_ == 1 and filesz:
+            yield addr, elf[off:off+filesz]
+
+def image(box, elf, block_size=512):
+    """
+    Build the image the bd and fs loaders load, a count of the box's
+    memories followed by their sizes and contents.
+    """
+    memories = [memory for memory in box.memoryslices if 'w' in memory.mode]
+    datas = {memory.name: bytearray(memory.size) for memory in memories}
+    for addr, data in segments(elf):
+        for memory in memories:
+            if addr >= memory.addr and addr < memory.addr + memory.size:
+                off = addr - memory.addr
+                datas[memory.name][off:off+len(data)] = data
+
+    image = bytearray()
+    image += struct.pack('<I', len(memories))
+    for memory in memories:
+        image += struct.pack('<I', memory.size)
+    for memory in memories:
+        image += datas[memory.name]
+    # reads may be buffered up to the end of a block
+    image += bytes(-len(image) % block_size)
+    return image
+
+def generate(path, runtime, loader, init, outer_longjmp=False,
+        write_buffer=0, glz='glz'):
+    """
+    Generate and write out a benchmark project into path, returning the
+    sys box.
+    """
+    os.makedirs(os.path.join(path, 'box1'), exist_ok=True)
+    with open(os.path.join(path, 'recipe.toml'), 'w') as f:
+        f.write(RECIPE.lstrip() % dict(
+            runtime=runtime,
+            runtime_=runtime.replace('-', '_'),
+            outer_longjmp='true' if outer_longjmp else 'false',
+            write_buffer=write_buffer,
+            loader=loader,
+            init=init,
+            sys_recipe=LOADER_SYS_RECIPES.get(loader, ''),
+            box_recipe=LOADER_BOX_RECIPES[loader].strip() % dict(
+                glz=glz)))
+    with open(os.path.join(path, 'main.c'), 'w') as f:
+        f.write(SYS_MAIN.lstrip() % dict(
+            sys_main=LOADER_SYS_MAINS.get(loader, ''),
+            max_size=max(ARRAY_SIZES),
+            sizes=', '.join('%d' % size for size in ARRAY_SIZES)))
+    with open(os.path.join(path, 'box1', 'main.c'), 'w') as f:
+        f.write(BOX_MAIN.lstrip() % dict())
+
+    box = Box.scan(path=path)
+    box.box()
+    box.link()
+    box.build()
+
+    def outputwrite(box):
+        for output in box.outputs:
+            with open(output.path, 'w') as outf:
+                outf.write(output.getvalue())
+        for child in box.boxes:
+            outputwrite(child)
+    outputwrite(box)
+    return box
+
+def run(path, runtime, loader, init, outer_longjmp=False,
+        write_buffer=0, iterations=10000, jobs=None, glz='glz'):
+    """
+    Build and run a single benchmark configuration, returning a dict
+    of results. Failures are recorded rather than raised so one broken
+    configuration doesn't hide the others.
+    """
+    result = dict(runtime=runtime, loader=loader, init=init,
+        outer_longjmp=outer_longjmp, write_buffer=write_buffer)
+    try:
+        box = generate(path, runtime, loader, init, outer_longjmp,
+            write_buffer, glz)
+    except Exception as e:
+        result['error'] = 'generate: %s' % e
+        return result
+
+    start = time.time()
+    proc = subprocess.run(['make', '-C', path, '-j%d' % (jobs or 1)],
+        stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+        universal_newlines=True)
+    result['build_s'] = round(time.time() - start, 3)
+    if proc.returncode != 0:
+        result['error'] = 'build: %s' % proc.stdout.strip()[-2000:]
+        return result
+
+    if loader in LOADER_SYS_MAINS:
+        box1 = next(child for child in box.boxes if child.name == 'box1')
+        with open(os.path.join(path, 'box1.img'), 'wb') as f:
+            f.write(image(box1, os.path.join(path, 'box1', 'box1.elf')))
+
+    proc = subprocess.run([os.path.join(path, 'sys.elf'), str(iterations)],
+        cwd=path,
+        stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+        universal_newlines=True)
+    results = {}
+    for line in proc.stdout.splitlines():
+        m = re.match(r'^bench (\w+) ([\d.]+)$', line)
+        if m:
+            results[m.group(1)] = float(m.group(2))
+    result['results'] = results
+    if proc.returncode != 0:
+        result['error'] = 'run: exited with %d: %s' % (
+            proc.returncode, proc.stdout.strip()[-2000:])
+    return result
+
+def bench(runtimes=RUNTIMES, loaders=['noop'], inits=['lazy'],
+        outer_longjmp=False, write_buffer=0, iterations=10000, keep=None,
+        jobs=None, glz='glz'):
+    """
+    Run the benchmark suite for each runtime/loader/init combination.
+    """
+    try:
+        commit = subprocess.check_output(
+            ['git', 'rev-parse', 'HEAD'],
+            cwd=os.path.dirname(__file__),
+            stderr=subprocess.DEVNULL,
+            universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        commit = None
+
+    results = []
+    dir = keep or tempfile.mkdtemp(prefix='bento-bench-')
+    try:
+        for runtime in runtimes:
+            for loader in loaders:
+                for init in inits:
+                    path = os.path.join(dir, '%s-%s-%s' % (
+                        runtime, loader, init))
+                    results.append(run(path, runtime, loader, init,
+                        outer_longjmp=outer_longjmp,
+                        write_buffer=write_buffer,
+                        iterations=iterations, jobs=jobs, glz=glz))
+    finally:
+        if not keep:
+            shutil.rmtree(dir)
+
+    return dict(
+        commit=commit,
+        time=time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime()),
+        iterations=iterations,
+        configs=results)
@@ -112,6 +112,29 @@ class Section:
         self.memory = memory
         return memory
 
+class Heap(Section):
+    """
+    Description of the heap section. In addition to the section's
+    size and placement, the heap may select the allocator used when
+    the box's stdlib lacks one.
+    """
+    __argname__ = "heap"
+    @classmethod
+    def __argparse__(cls, parser, name=None, help=None):
+        super().__argparse__(parser, name=name, help=help)
+        parser.add_argument("--allocator", choices=['linear', 'tlsf'],
+            help="Allocator to use when the heap is provided by bento, "
+                "currently only for wasm boxes. The linear allocator is "
+                "the smallest, but malloc scans every block. The tlsf "
+                "allocator keeps free blocks in segregated size classes "
+                "for constant-time malloc/free and can realloc in place. "
+                "Can be one of the following: {%(choices)s}. "
+                "Defaults to linear.")
+
+    def __init__(self, name, allocator=None, **kwargs):
+        super().__init__(name, **kwargs)
+        self.allocator = allocator or 'linear'
+
 class Region:
     """
     Region of addresses to use for REGION.
@@ -203,7 +226,7 @@ class Region:
                         nslices.append((addr, region.addr - addr))
                     if addr+size > region.addr+region.size:
                         nslices.append((region.addr+region.size,
-                            addr+size - region.addr+region.size))
+                            addr+size - (region.addr+region.size)))
             slices = nslices
 
         return [Region(addr=addr, size=size) for addr, size in slices]
@@ -356,6 +379,65 @@ class Memory(Region):
                 origmemory=self.origmemory)
             for region in super().__sub__(regions)]
 
+class Shared(Memory):
+    """
+    Description of a shared memory region named SHARED. The region is
+    allocated from this box's memory and mapped into each of the listed
+    child boxes, where it is split into a number of buffers that can be
+    passed between boxes by handle without copying.
+    """
+    __argname__ = "shared"
+    __arghelp__ = __doc__
+    @classmethod
+    def __argparse__(cls, parser, **kwargs):
+        super().__argparse__(parser, **kwargs)
+        parser.add_argument("--boxes", type=list,
+            help="List of child boxes the region is shared with. Defaults "
+                "to all child boxes.")
+        parser.add_argument("--buffers", type=int,
+            help="Number of buffers to split the region into. Defaults "
+                "to 1.")
+
+    # owner of free buffers
+    FREE = 0
+
+    def __init__(self, name, boxes=None, buffers=None, owner=None,
+            **kwargs):
+        super().__init__(name, **kwargs)
+        self.boxes = boxes
+        self.buffers = buffers if buffers is not None else 1
+        self.owner = owner
+        assert self.buffers > 0 and self.buffers < 255, (
+            "Invalid number of buffers in shared memory `%s`" % self.name)
+
+    def owners(self):
+        """
+        List of possible owners, indexed by their encoding-1.
+        """
+        return [self.owner] + list(self.boxes)
+
+    def ownerof(self, box):
+        """
+        Encoding of a box as an owner in the owner table.
+        """
+        return self.owners().index(getattr(box, 'name', box)) + 1
+
+    def tablesize(self):
+        """
+        Size of the owner table at the start of the region, one byte
+        per buffer, padded to keep buffers aligned.
+        """
+        return (self.buffers + 7) & ~7
+
+    def buffersize(self):
+        size = ((self.size - self.tablesize()) // self.buffers) & ~7
+        assert size > 0, ("Shared memory `%s` too small for %d buffers" % (
+            self.name, self.buffers))
+        return size
+
+    def bufferaddr(self):
+        return self.addr + self.tablesize()
+
 class Arg:
     """
     Type of function argument or return value.
@@ -542,9 +624,10 @@ class Fn:
         namepattern = r'[a-zA-Z_][a-zA-Z_0-9]*'
         argpattern = (r'(?:(?:%(name)s|[:\*\[\]0-9])\s*)+'
             % dict(name=namepattern))
-        # functions with and without parens around args/rets
+        # functions with and without parens around args/rets, optionally
+        # marked as queued
         fnpattern = (r'\s*'.join([
-            r'fn',
+            r'(queued\s+)?fn',
             r'(?:',
                 r'\(',
                 r'((?:%(arg)s', r'(?:', r',', r'%(arg)s', r')*)?)',
@@ -572,10 +655,11 @@ class Fn:
             raise ValueError("Invalid import/export type %r" % s)
 
         noreturn = False
+        queued = bool(m.group(1))
         args = [arg.strip() for arg in
-            (m.group(1) or m.group(2) or '').split(',')]
+            (m.group(2) or m.group(3) or '').split(',')]
         rets = [ret.strip() for ret in
-            (m.group(3) or m.group(4) or '').split(',')]
+            (m.group(4) or m.group(5) or '').split(',')]
         if rets == ['noreturn']:
             noreturn = True
             rets = []
@@ -591,7 +675,17 @@ class Fn:
             e.args = (e.args[0]+'\nWhile parsing %r' % s, *e.args[1:])
             raise
 
-        return args, rets, noreturn
+        # queued functions are called later, so can't return anything
+        # or reference the caller's memory
+        if queued:
+            if rets or noreturn:
+                raise ValueError("Queued functions must return void %r" % s)
+            if any(Arg.parsetype(arg)[3] or Arg.parsetype(arg)[4]
+                    for arg in args):
+                raise ValueError("Queued functions can't take pointers "
+                    "or arrays %r" % s)
+
+        return args, rets, noreturn, queued
 
     def __init__(self, name, type=None, source=None, scope=None,
             alias=None, doc=None, with_=None, weak=False,
@@ -601,7 +695,7 @@ class Fn:
             name, type = None, name
         with_ = with_ or kwargs.get('with', {})
 
-        args, rets, noreturn = self.parsetype(type)
+        args, rets, noreturn, queued = self.parsetype(type)
 
         args = [Arg(arg) for arg in args]
         rets = [Arg(ret) for ret in rets]
@@ -654,6 +748,7 @@ class Fn:
         self.args = args
         self.rets = rets
         self._noreturn = noreturn
+        self._queued = queued
 
         self.alias = alias or self.name
         self.doc = doc
@@ -663,7 +758,8 @@ class Fn:
         self.source = source
 
     def __str__(self, prebound=False, postbound=False):
-        return 'fn(%s) -> %s' % (
+        return '%sfn(%s) -> %s' % (
+            'queued ' if self.isqueued() else '',
             ', '.join(map(str,
                 self.postboundargs
                 if postbound else
@@ -756,7 +852,13 @@ class Fn:
     def isfalible(self):
         return any(ret.iserr() for ret in self.rets)
 
+    def isqueued(self):
+        return self._queued
+
     def iscompatible(self, other):
+        if self.isqueued() != other.isqueued():
+            return False
+
         anames = {arg.name: i for i, arg in enumerate(self.args) if arg.name}
         bnames = {arg.name: i for i, arg in enumerate(other.args) if arg.name}
         for a, b in zip(
@@ -907,10 +1009,13 @@ class Box:
         for Loader in LOADERS.values():
             loaderparser.add_nestedparser(Loader)
 
-        parser.add_argument('--init', choices=['lazy', 'manual'],
+        parser.add_argument('--init', choices=['lazy', 'trampoline', 'manual'],
             help='Select when the box will be initialized. \'lazy\' init will '
                 'initialize the box on the first box call, at the cost of some '
-                'overhead on every call. \'manual\' leaves it up to the user '
+                'overhead on every call. \'trampoline\' init also initializes '
+                'the box on the first box call, but routes calls through a '
+                'table in RAM that is patched during init, avoiding the '
+                'overhead after init. \'manual\' leaves it up to the user '
                 'to call __box_<name>_init() manually. Must be one of: '
                 '{%(choices)s}. Defaults to lazy.')
         parser.add_argument('--idempotent', type=bool,
@@ -918,11 +1023,27 @@ class Box:
                 'indicates if it is ok to lose state between box calls. '
                 'Idempotent boxes can share RAM with a performance penalty. '
                 'Defaults to false.')
+        parser.add_argument('--skip_reload', type=bool,
+            help='Let init skip reloading an idempotent box if it was only '
+                'clobbered by a roommate that never loaded over its memory, '
+                'such as a roommate that shares other resources. Aborts, '
+                'faults, and explicit calls to clobber always reload the '
+                'box. Defaults to false.')
+        parser.add_argument('--reload_crc', type=bool,
+            help='With skip_reload, also check a CRC of the box\'s RAM, '
+                'taken when the box is clobbered, before skipping the '
+                'reload. Defaults to false.')
         parser.add_argument('--roommates', type=list,
             help='List of explicit roommates to clobber if we need to '
                 'initialize this box. Normally roommates are automatically '
                 'determined by overlapping memory regions, but can be explicit '
                 'added if non-memory resources are shared.')
+        parser.add_argument('--queue', type=int,
+            help='Number of records in the queue used for queued exports. '
+                'Calls to queued exports are written into the queue without '
+                'entering the box, and run the next time the box is called '
+                'or __box_<name>_drain() is called. Must be a power of 2. '
+                'Defaults to 32.')
 
         from .outputs import OUTPUTS
         outputparser = parser.add_nestedparser('--output')
@@ -930,8 +1051,9 @@ class Box:
             outputparser.add_nestedparser(Output)
 
         parser.add_set(Memory)
+        parser.add_set(Shared)
         parser.add_nestedparser('--stack', Section)
-        parser.add_nestedparser('--heap', Section)
+        parser.add_nestedparser('--heap', Heap)
         parser.add_nestedparser('--text', Section)
         parser.add_nestedparser('--data', Section)
         parser.add_nestedparser('--bss', Section)
@@ -943,10 +1065,11 @@ class Box:
 
     def __init__(self, name=None, parent=None, path=None, recipe=None,
             runtime=None, loader=None,
-            init=None, idempotent=None, roommates=None,
+            init=None, idempotent=None, skip_reload=None, reload_crc=None,
+            roommates=None, queue=None,
             output=None, debug=None, lto=None,
             srcs=None, incs=None, define={},
-            memory=None, stack=None, heap=None,
+            memory=None, shared=None, stack=None, heap=None,
             text=None, data=None, bss=None,
             import_={}, export={}, box={}, **kwargs):
         import_ = import_ or kwargs.get('import', {})
@@ -970,8 +1093,20 @@ class Box:
         self.init = (init if init is not None else 'lazy')
         self.idempotent = (
             idempotent if idempotent is not None else False)
+        self.skip_reload = (
+            skip_reload if skip_reload is not None else False)
+        assert not self.skip_reload or self.idempotent, (
+            "Box `%s` can only skip reloads if it is idempotent" % self.name)
+        self.reload_crc = (
+            reload_crc if reload_crc is not None else False)
+        assert not self.reload_crc or self.skip_reload, (
+            "Box `%s` can only check a CRC if it can skip reloads, see "
+            "skip_reload" % self.name)
         self.explicit_roommates = roommates if roommates is not None else []
         self.roommates = []
+        self.queue = queue if queue is not None else 32
+        assert self.queue > 0 and self.queue & (self.queue-1) == 0, (
+            "Queue size for box `%s` must be a power of 2" % self.name)
 
         from .outputs import OUTPUTS
         self.outputs = sorted(
@@ -991,8 +1126,14 @@ class Box:
             for name, memargs in memory.items())
         self.memoryslices = self.memories
 
+        # shared memory we own, and shared memory we've been given
+        self.shared = sorted(
+            Shared(name, owner=self.name, **sharedargs.__dict__)
+            for name, sharedargs in (shared or {}).items())
+        self.sharedmemories = []
+
         self.stack = Section('stack', **stack.__dict__)
-        self.heap = Section('heap', **heap.__dict__)
+        self.heap = Heap('heap', **heap.__dict__)
         self.text = Section('text', **text.__dict__)
         self.data = Section('data', **data.__dict__)
         self.bss = Section('bss', **bss.__dict__)
@@ -1287,6 +1428,26 @@ class Box:
                             "there is no box `%s`?" % (
                             child.name, roommate, roommate))
 
+            # reserve shared memory with explicit addresses, this stays in
+            # our memory but is mapped into each of the boxes it is shared
+            # with, the rest of the shared memory is allocated after our
+            # children, otherwise it breaks the alignment of their memories
+            for shared in self.shared:
+                if shared.addr is not None:
+                    self.memoryslices = list(it.chain.from_iterable(
+                        slice - shared for slice in self.memoryslices))
+
+                if shared.boxes is None:
+                    shared.boxes = [child.name for child in self.boxes]
+                for name in shared.boxes:
+                    child = next(
+                        (child for child in self.boxes if child.name == name),
+                        None)
+                    assert child is not None, (
+                        "Shared memory `%s` shared with box `%s`, but "
+                        "there is no box `%s`?" % (shared.name, name, name))
+                    child.sharedmemories.append(shared)
+
             # create memory slices for children
             for child in self.boxes:
                 for memory in child.memories:
@@ -1295,6 +1456,7 @@ class Box:
                             mode=memory.mode,
                             size=memory.size,
                             align=memory.align,
+                            memory=child.loader.parentmemory(memory),
                             reverse=True)
                         assert slice is not None, (
                             "Not enough memory found that satisfies "
@@ -1340,6 +1502,28 @@ class Box:
                 # sort again in case new addresses changed order
                 child.memories = sorted(child.memories)
 
+            # allocate remaining shared memory
+            for shared in self.shared:
+                if shared.addr is None:
+                    slice = self.consume(
+                        mode=shared.mode,
+                        size=shared.size,
+                        align=shared.align,
+                        reverse=True)
+                    assert slice is not None, (
+                        "Not enough memory found for shared memory "
+                        "mode=%s size=%d:\n"
+                        "%s" % (
+                        ''.join(shared.mode), shared.size or 0,
+                        '\n'.join("memory.%s = %s in %s" % (
+                            memory.name, memory, self.name)
+                            for memory in self.memoryslices)))
+                    shared.addr = slice.addr
+                    shared._addr = slice._addr
+
+                    self.memoryslices = list(it.chain.from_iterable(
+                        slice - shared for slice in self.memoryslices))
+
             # make slice names unique
             namecount = {}
             for slice in self.memoryslices:
@@ -1479,6 +1663,18 @@ class Box:
                     if import_.islinkable(export, scope, self):
                         targets.append(export)
 
+            # if our runtime can call sibling boxes directly, we can also
+            # link to their exports, note weak exports may still be
+            # deduplicated by the sibling
+            if not targets and self.parent:
+                for sibling in self.parent.boxes:
+                    if (sibling is not self and
+                            self.runtime.islinkable(self, sibling)):
+                        for export in sibling.exports:
+                            if (not export.weak and
+                                    import_.islinkable(export, sibling, self)):
+                                targets.append(export)
+
             assert targets or import_.weak, (
                 "No export found for `%s`:\n%s" % (
                     import_.name,
@@ -1570,11 +1766,21 @@ class Box:
                     continue
                 for output in relative.outputs:
                     key = (self.runtime.__argname__, level, output.name)
+                    loaderkey = ('loader', self.loader.__argname__,
+                        level, output.name)
                     if key not in relative._build_prologues:
                         with output.pushattrs(**{level: relative.name}):
                             getattr(self.runtime, 'build%s_%s_prologue' % (
                                 suffix, output.name))(output, relative)
                         relative._build_prologues.add(key)
+                        relative._build_prologues.add(loaderkey)
+                    elif loaderkey not in relative._build_prologues:
+                        # the runtime's prologue already ran for a box
+                        # with a different loader
+                        with output.pushattrs(**{level: relative.name}):
+                            getattr(self.loader, 'build%s_%s_prologue' % (
+                                suffix, output.name))(output, relative)
+                        relative._build_prologues.add(loaderkey)
                 key = (self.runtime.__argname__, level)
                 if key not in relative._build_prologues:
                     getattr(self.runtime, 'build%s_prologue' % (
@@ -11,12 +11,12 @@ C_HOOKS = """
 %(visibility)s
 __attribute__((noreturn))
 void __wrap_abort(void) {
-    __box_abort(-1);
+    %(abort)s(-1);
 }
 
 %(visibility)s
 void __wrap_exit(int code) {
-    __box_abort(code > 0 ? -code : code);
+    %(abort)s(code > 0 ? -code : code);
 }
 """
 
@@ -26,12 +26,12 @@ __attribute__((noreturn))
 void __assert_func(const char *file, int line,
         const char *func, const char *expr) {
     printf("%%s:%%d: assertion \\"%%s\\" failed\\n", file, line, expr);
-    __box_abort(-1);
+    %(abort)s(-1);
 }
 
 __attribute__((noreturn))
 void _exit(int code) {
-    __box_abort(code > 0 ? -code : code);
+    %(abort)s(code > 0 ? -code : code);
 }
 #endif
 """
@@ -41,7 +41,7 @@ __attribute__((noreturn))
 void __assert_fail(const char *m,
         const char *file, int32_t line, const char *func) {
     printf("assert failed: %%s\\n", m);
-    __box_abort(-1);
+    %(abort)s(-1);
 }
 """
 
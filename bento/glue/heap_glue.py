@@ -76,8 +76,8 @@ void *__wrap_malloc(size_t size) {
             }
 
             // mark as used
-            ptr[0]        = psize | 0x80000000;
-            ptr[size+2-1] = psize | 0x80000000;
+            ptr[0]         = psize | 0x80000000;
+            ptr[psize+2-1] = psize | 0x80000000;
 
             return ptr+1;
         }
@@ -127,12 +127,11 @@ void *__wrap_calloc(size_t size) {
 }
 
 void *__wrap_realloc(void *pptr, size_t size) {
-    ssize_t psize = pptr ? ((ssize_t*)pptr)[-1] : 0;
+    size_t psize = pptr ? 4*(((ssize_t*)pptr)[-1] & 0x7fffffff) : 0;
 
     void *nptr = __wrap_malloc(size);
     if (nptr) {
-        // yes this copies extra, we don't really care
-        memmove(nptr, pptr, psize);
+        memmove(nptr, pptr, psize < size ? psize : size);
 
         __wrap_free(pptr);
     }
@@ -141,6 +140,243 @@ void *__wrap_realloc(void *pptr, size_t size) {
 }
 """
 
+# segregated-fit heap, TLSF-style
+#
+# free blocks are kept in doubly-linked lists indexed by a two-level
+# size class, with a bitmap per level to find the first non-empty list,
+# so malloc/free are constant-time regardless of the number of blocks
+#
+# blocks use the same boundary tags as the linear heap, size in words
+# with the top bit marking used blocks, free blocks store next/prev
+# links as word offsets from __heap_start in their first two words
+TLSF_HEAP = """
+#define __HEAP_SL_BITS  2
+#define __HEAP_FL_COUNT %(heap_fl_count)d
+
+ssize_t *__heap_start = NULL;
+ssize_t *__heap_end;
+static uint32_t __heap_fl_bitmap;
+static uint8_t __heap_sl_bitmap[__HEAP_FL_COUNT];
+static ssize_t __heap_free[__HEAP_FL_COUNT][1 << __HEAP_SL_BITS];
+
+static inline void __heap_mapping(ssize_t size,
+        uint_fast8_t *fl, uint_fast8_t *sl) {
+    uint_fast8_t log2 = 31 - __builtin_clz((uint32_t)size);
+    if (log2 < __HEAP_SL_BITS) {
+        *fl = 0;
+        *sl = size;
+    } else {
+        *fl = log2 - __HEAP_SL_BITS + 1;
+        *sl = (size >> (log2 - __HEAP_SL_BITS)) ^ (1 << __HEAP_SL_BITS);
+    }
+}
+
+static inline void __heap_check(ssize_t *block) {
+    // make sure heap isn't corrupted
+    if (block[0] != block[(block[0] & 0x7fffffff)+2-1]) {
+        __box_abort(-EFAULT);
+    }
+}
+
+static inline void __heap_mark(ssize_t *block, ssize_t size, bool used) {
+    block[0]        = size | (used ? 0x80000000 : 0);
+    block[size+2-1] = size | (used ? 0x80000000 : 0);
+}
+
+static void __heap_insert(ssize_t *block) {
+    uint_fast8_t fl, sl;
+    __heap_mapping(block[0], &fl, &sl);
+
+    ssize_t off = block - __heap_start;
+    ssize_t next = __heap_free[fl][sl];
+    block[1] = next;
+    block[2] = -1;
+    if (next >= 0) {
+        __heap_start[next+2] = off;
+    }
+
+    __heap_free[fl][sl] = off;
+    __heap_fl_bitmap |= 1 << fl;
+    __heap_sl_bitmap[fl] |= 1 << sl;
+}
+
+static void __heap_remove(ssize_t *block) {
+    uint_fast8_t fl, sl;
+    __heap_mapping(block[0], &fl, &sl);
+
+    ssize_t next = block[1];
+    ssize_t prev = block[2];
+    if (next >= 0) {
+        __heap_start[next+2] = prev;
+    }
+
+    if (prev >= 0) {
+        __heap_start[prev+1] = next;
+    } else {
+        __heap_free[fl][sl] = next;
+        if (next < 0) {
+            __heap_sl_bitmap[fl] &= ~(1 << sl);
+            if (!__heap_sl_bitmap[fl]) {
+                __heap_fl_bitmap &= ~(1 << fl);
+            }
+        }
+    }
+}
+
+// coalesce a block with any free neighbors and return it to the free lists
+static void __heap_release(ssize_t *block) {
+    ssize_t size = block[0] & 0x7fffffff;
+    ssize_t *next = &block[size+2];
+
+    if (block > __heap_start && block[-1] >= 0) {
+        ssize_t *prev = block - (block[-1]+2);
+        __heap_remove(prev);
+        size += prev[0] + 2;
+        block = prev;
+    }
+
+    if (next < __heap_end && next[0] >= 0) {
+        __heap_remove(next);
+        size += next[0] + 2;
+    }
+
+    __heap_mark(block, size, false);
+    __heap_insert(block);
+}
+
+// trim a used block to size, releasing the tail if it can hold a block
+static void __heap_split(ssize_t *block, ssize_t size) {
+    ssize_t psize = block[0] & 0x7fffffff;
+    if (psize >= size+2+2) {
+        __heap_mark(block, size, true);
+        __heap_mark(&block[size+2], psize - (size+2), true);
+        __heap_release(&block[size+2]);
+    } else {
+        __heap_mark(block, psize, true);
+    }
+}
+
+static void __heap_init(void) {
+    __heap_end = (ssize_t*)(__builtin_wasm_memory_size(0)*64*1024);
+    __heap_start = __heap_end - %(heap_size)d/4;
+
+    for (int i = 0; i < __HEAP_FL_COUNT; i++) {
+        for (int j = 0; j < (1 << __HEAP_SL_BITS); j++) {
+            __heap_free[i][j] = -1;
+        }
+    }
+
+    __heap_mark(__heap_start, %(heap_size)d/4 - 2, false);
+    __heap_insert(__heap_start);
+}
+
+void *__wrap_malloc(size_t size) {
+    if (!__heap_start) {
+        __heap_init();
+    }
+
+    if (size > %(heap_size)d) {
+        return NULL;
+    }
+
+    // we need at least two words for the free-list links
+    ssize_t wsize = (size+3) / 4;
+    wsize = wsize < 2 ? 2 : wsize;
+
+    // round up to the next size class, any block in that class fits
+    ssize_t rsize = wsize;
+    uint_fast8_t log2 = 31 - __builtin_clz((uint32_t)wsize);
+    if (log2 >= __HEAP_SL_BITS) {
+        rsize += (1 << (log2 - __HEAP_SL_BITS)) - 1;
+    }
+
+    uint_fast8_t fl, sl;
+    __heap_mapping(rsize, &fl, &sl);
+    if (fl >= __HEAP_FL_COUNT) {
+        return NULL;
+    }
+
+    // find first non-empty list of this class or larger
+    uint32_t slmap = __heap_sl_bitmap[fl] & (~0u << sl);
+    if (!slmap) {
+        uint32_t flmap = __heap_fl_bitmap & (~0u << (fl+1));
+        if (!flmap) {
+            return NULL;
+        }
+
+        fl = __builtin_ctz(flmap);
+        slmap = __heap_sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(slmap);
+
+    ssize_t *block = &__heap_start[__heap_free[fl][sl]];
+    __heap_check(block);
+    __heap_remove(block);
+    __heap_split(block, wsize);
+    return block+1;
+}
+
+void __wrap_free(void *pptr) {
+    if (!pptr) {
+        return;
+    }
+
+    ssize_t *block = (ssize_t*)pptr - 1;
+    __heap_check(block);
+    if (block[0] >= 0) {
+        // double free
+        __box_abort(-EFAULT);
+    }
+
+    __heap_release(block);
+}
+
+void *__wrap_calloc(size_t size) {
+    uint8_t *ptr = __wrap_malloc(size);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void *__wrap_realloc(void *pptr, size_t size) {
+    if (!pptr) {
+        return __wrap_malloc(size);
+    }
+
+    if (size > %(heap_size)d) {
+        return NULL;
+    }
+
+    ssize_t *block = (ssize_t*)pptr - 1;
+    __heap_check(block);
+    ssize_t psize = block[0] & 0x7fffffff;
+    ssize_t wsize = (size+3) / 4;
+    wsize = wsize < 2 ? 2 : wsize;
+
+    // can we grow into the next block?
+    ssize_t *next = &block[psize+2];
+    if (wsize > psize && next < __heap_end && next[0] >= 0 &&
+            psize + next[0] + 2 >= wsize) {
+        __heap_remove(next);
+        psize += next[0] + 2;
+        __heap_mark(block, psize, true);
+    }
+
+    // shrink or grow in place
+    if (wsize <= psize) {
+        __heap_split(block, wsize);
+        return pptr;
+    }
+
+    void *nptr = __wrap_malloc(size);
+    if (nptr) {
+        memcpy(nptr, pptr, 4*psize);
+        __wrap_free(pptr);
+    }
+
+    return nptr;
+}
+"""
+
 
 class HeapGlue(glue.Glue):
     """
@@ -156,8 +392,15 @@ class HeapGlue(glue.Glue):
     def build_wasm_c(self, output, box):
         super().build_wasm_c(output, box)
         if not output.no_stdlib_hooks:
-            output.decls.append(REPLACE_ME_HEAP,
-                heap_size=box.heap.size)
+            if box.heap.allocator == 'tlsf':
+                # first-level classes needed to cover the largest block
+                output.decls.append(TLSF_HEAP,
+                    heap_size=box.heap.size,
+                    heap_fl_count=max(1,
+                        max(box.heap.size//4 - 2, 0).bit_length() - 2 + 1))
+            else:
+                output.decls.append(REPLACE_ME_HEAP,
+                    heap_size=box.heap.size)
 
     def build_mk(self, output, box):
         super().build_mk(output, box)
@@ -0,0 +1,232 @@
+#
+# Profiling glue, counts calls and time spent in calls between boxes
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from .. import glue
+
+C_PROFILE = """
+struct __box_profile_counter {
+    uint32_t calls;
+    uint64_t cycles;
+};
+
+struct __box_profile_counter __box_profile[%(count)d];
+"""
+
+C_DWT_CLOCK = """
+#define __BOX_DEMCR      (*(volatile uint32_t*)0xe000edfc)
+#define __BOX_DWT_CTRL   (*(volatile uint32_t*)0xe0001000)
+#define __BOX_DWT_CYCCNT (*(volatile uint32_t*)0xe0001004)
+#define __BOX_DWT_LAR    (*(volatile uint32_t*)0xe0001fb0)
+
+// runs with the sys's constructors, and again in __box_profile_dump in
+// case the sys doesn't run constructors
+__attribute__((constructor))
+static void __box_profile_enable(void) {
+    if (!(__BOX_DWT_CTRL & 0x1)) {
+        __BOX_DEMCR |= 0x01000000;
+        // some cores, such as the Cortex-M7, ignore writes to the DWT
+        // until it's unlocked
+        __BOX_DWT_LAR = 0xc5acce55;
+        __BOX_DWT_CYCCNT = 0;
+        __BOX_DWT_CTRL |= 0x1;
+    }
+}
+
+static inline uint32_t __box_profile_now(void) {
+    return __BOX_DWT_CYCCNT;
+}
+"""
+
+C_PROFILE_RECORD = """
+static inline uint32_t __box_profile_start(int i) {
+    __box_profile[i].calls += 1;
+    return __box_profile_now();
+}
+
+static inline void __box_profile_stop(int i, uint32_t start) {
+    // the clock may wrap, but differences are still correct
+    __box_profile[i].cycles += (uint32_t)(__box_profile_now() - start);
+}
+"""
+
+C_PROFILE_DUMP = """
+static char *__box_profile_hex(char *p, uint64_t x) {
+    int size = 1;
+    while (size < 16 && (x >> (4*size))) {
+        size += 1;
+    }
+
+    for (int i = size-1; i >= 0; i--) {
+        uint32_t digit = (x >> (4*i)) & 0xf;
+        *p++ = ((digit >= 10) ? ('a'-10) : '0') + digit;
+    }
+
+    return p;
+}
+
+int __box_profile_dump(void) {
+    __box_profile_enable();
+
+    static const char header[] = "__box_profile %(count)x %(unit)s\\n";
+    ssize_t res = __box_write(1, header, sizeof(header)-1);
+    if (res < 0) {
+        return res;
+    }
+
+    for (uint32_t i = 0; i < %(count)d; i++) {
+        char line[64];
+        char *p = line;
+        memcpy(p, "__box_profile ", 14);
+        p += 14;
+        p = __box_profile_hex(p, i);
+        *p++ = ' ';
+        p = __box_profile_hex(p, __box_profile[i].calls);
+        *p++ = ' ';
+        p = __box_profile_hex(p, __box_profile[i].cycles);
+        *p++ = '\\n';
+
+        res = __box_write(1, line, p - line);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    return 0;
+}
+"""
+
+class ProfileGlue(glue.Glue):
+    """
+    Helper layer for profiling calls between a box and its children,
+    enabled with output.c.profile.
+    """
+    # unit of __box_profile_now, overridable
+    _profile_unit = 'cycles'
+
+    @staticmethod
+    def profilelinks(box):
+        """
+        Get the links profiled in box, in the order of its counters.
+        Returns a list of (caller, callee, name), where name is the
+        import for calls into children, and the export for calls out
+        of children.
+        """
+        links = []
+        for child in box.boxes:
+            for import_ in box.imports:
+                if import_.link and import_.link.export.box == child:
+                    link = (box.name, child.name, import_.name)
+                    if link not in links:
+                        links.append(link)
+            for import_ in child.imports:
+                if import_.link and import_.link.export.box == box:
+                    link = (child.name, box.name, import_.link.export.name)
+                    if link not in links:
+                        links.append(link)
+        return links
+
+    def _profiles(self, box):
+        """
+        Is box profiling calls to and from its children?
+        """
+        return ('c' in box.outputs and
+            box.outputs[box.outputs.index('c')].profile)
+
+    def _profiled(self, parent, box, fn, export=False):
+        """
+        Get the counter for calls through fn, or None if not profiled.
+        Calls are from parent to box, unless export is set, in which
+        case fn is one of the parent's exports called by box.
+        """
+        if not self._profiles(parent):
+            return None
+
+        link = ((box.name, parent.name, fn.name) if export else
+            (parent.name, box.name, fn.name))
+        links = ProfileGlue.profilelinks(parent)
+        return links.index(link) if link in links else None
+
+    def _build_parent_profile(self, output, i, fn, name, target,
+            attrs=[]):
+        """
+        Build a wrapper named name that counts calls through fn in
+        counter i, and times them, calling target.
+        """
+        out = output.decls.append(
+            fn=output.repr_fn(fn, name=name, attrs=attrs),
+            target=target,
+            i=i,
+            args=', '.join(fn.argnames()),
+            start=fn.uniquename('start'))
+        out.printf('%(fn)s {')
+        with out.indent():
+            if fn.isnoreturn():
+                # we can only count these
+                out.printf('__box_profile[%(i)d].calls += 1;')
+                out.printf('%(target)s(%(args)s);')
+            else:
+                out.printf('uint32_t %(start)s = '
+                    '__box_profile_start(%(i)d);')
+                out.printf('%(return_)s%(target)s(%(args)s);',
+                    return_='%s = ' % output.repr_arg(
+                            fn.rets[0], fn.retname())
+                        if fn.rets else '')
+                out.printf('__box_profile_stop(%(i)d, %(start)s);')
+                if fn.rets:
+                    out.printf('return %(ret)s;', ret=fn.retname())
+        out.printf('}')
+
+    def _build_parent_profile_exports(self, output, parent, box, exports):
+        """
+        Build wrappers for profiling calls from box into the parent's
+        exports. Returns a dict mapping export names to the functions
+        box should call instead.
+        """
+        targets = {}
+        for export in exports:
+            i = self._profiled(parent, box, export, export=True)
+            if i is None or export.name in targets:
+                continue
+            self._build_parent_profile(output, i, export.prebound(),
+                '__box_%%(box)s_profile_%s' % export.alias,
+                export.alias,
+                attrs=['static'])
+            targets[export.name] = (
+                '__box_%%(box)s_profile_%s' % export.alias)
+        return targets
+
+    # overridable
+    def _build_profile_clock(self, output, box):
+        output.decls.append(C_DWT_CLOCK)
+
+    def build_h_prologue(self, output, box):
+        super().build_h_prologue(output, box)
+        if box.boxes and self._profiles(box):
+            output.decls.append('//// profiling ////')
+            output.decls.append('int __box_profile_dump(void);',
+                doc='Write out the call counts and times of calls between '
+                    'boxes through __box_write, see bento profile.')
+
+    def build_c_prologue(self, output, box):
+        super().build_c_prologue(output, box)
+        if box.boxes and output.profile:
+            output.decls.append('//// profiling ////')
+            output.decls.append(C_PROFILE,
+                count=max(len(ProfileGlue.profilelinks(box)), 1),
+                doc='counters for calls to and from boxes, indexed by '
+                    'link, see bento profile')
+            self._build_profile_clock(output, box)
+            output.decls.append(C_PROFILE_RECORD)
+
+    def build_c(self, output, box):
+        super().build_c(output, box)
+        if box.boxes and output.profile:
+            output.includes.append('<string.h>')
+            output.decls.append('//// __box_profile_dump glue ////')
+            output.decls.append(C_PROFILE_DUMP,
+                count=len(ProfileGlue.profilelinks(box)),
+                unit=self._profile_unit)
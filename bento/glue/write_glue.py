@@ -40,6 +40,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -86,11 +87,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -174,7 +174,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -233,10 +233,87 @@ ssize_t __box_cbprintf(
     }
 }
 
+"""
+
+C_PRINTF_WRITE = """
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
+}
+"""
+
+C_PRINTF_BUFFERED_WRITE = """
+// output buffer, printf and _write output is collected here and only
+// passed to __box_write on newline, when full, or on flush
+static uint8_t __box_write_buffer[%(write_buffer)d];
+static size_t __box_write_buffer_size = 0;
+static int32_t __box_write_buffer_fd = 1;
+
+static ssize_t __box_write_buffer_flush(void) {
+    size_t size = __box_write_buffer_size;
+    __box_write_buffer_size = 0;
+    if (size > 0) {
+        ssize_t res = __box_write(__box_write_buffer_fd,
+                __box_write_buffer, size);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    return 0;
+}
+
+static ssize_t __box_write_buffered(int32_t fd,
+        const void *buf, size_t size) {
+    if (fd != __box_write_buffer_fd) {
+        ssize_t res = __box_write_buffer_flush();
+        if (res < 0) {
+            return res;
+        }
+        __box_write_buffer_fd = fd;
+    }
+
+    const uint8_t *p = buf;
+    size_t psize = size;
+    while (psize > 0) {
+        size_t delta = sizeof(__box_write_buffer) - __box_write_buffer_size;
+        if (delta > psize) {
+            delta = psize;
+        }
+
+        const uint8_t *nl = memchr(p, '\\n', delta);
+        if (nl) {
+            delta = nl+1 - p;
+        }
+
+        memcpy(&__box_write_buffer[__box_write_buffer_size], p, delta);
+        __box_write_buffer_size += delta;
+        p += delta;
+        psize -= delta;
+
+        if (nl || __box_write_buffer_size == sizeof(__box_write_buffer)) {
+            ssize_t res = __box_write_buffer_flush();
+            if (res < 0) {
+                return res;
+            }
+        }
+    }
+
+    return size;
+}
+
+static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
+    return __box_write_buffered((int32_t)(intptr_t)ctx, buf, size);
 }
 
+%(visibility)s
+__attribute__((noreturn))
+void __box_buffered_abort(int err) {
+    __box_write_buffer_flush();
+    __box_abort(err);
+}
+"""
+
+C_PRINTF_WRAPPERS = """
 %(visibility)s
 ssize_t __wrap_vprintf(const char *format, va_list args) {
     return __box_cbprintf(__box_vprintf_write, (void*)1, format, args);
@@ -254,7 +331,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 %(visibility)s
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 %(visibility)s
@@ -275,10 +353,22 @@ int __wrap_fflush(FILE *f) {
 }
 """
 
+C_BUFFERED_HOOKS = """
+%(visibility)s
+int __wrap_fflush(FILE *f) {
+    int32_t fd = (f == stdout) ? 1 : 2;
+    ssize_t res = __box_write_buffer_flush();
+    if (res < 0) {
+        return res;
+    }
+    return __box_flush(fd);
+}
+"""
+
 GCC_HOOKS = """
 #if defined(__GNUC__)
 int _write(int handle, const char *buffer, int size) {
-    return __box_write(handle, (const uint8_t*)buffer, size);
+    return %(write)s(handle, (const uint8_t*)buffer, size);
 }
 #endif
 """
@@ -287,7 +377,7 @@ WASM_HOOKS = """
 ssize_t __wrap_writev(int fd, const struct iovec *iov, int count) {
     size_t sum = 0;
     for (int i = 0; i < count; i++) {
-        ssize_t res = __box_write(fd, iov[i].iov_base, iov[i].iov_len);
+        ssize_t res = %(write)s(fd, iov[i].iov_base, iov[i].iov_len);
         if (res < 0) {
             return res;
         }
@@ -417,21 +507,42 @@ class WriteGlue(glue.Glue):
             fn=output.repr_fn(self.__flush_hook),
             doc=self.__flush_hook.doc)
 
+    def __build_buffered_prologue(self, output, buffered):
+        if (buffered and buffered.printf_impl == 'minimal'
+                and buffered.write_buffer):
+            output.decls.append('__attribute__((noreturn))\n'
+                'void __box_buffered_abort(int err);',
+                doc='Flushes any buffered output before calling '
+                    '__box_abort.')
+            return True
+        return False
+
     def build_h_prologue(self, output, box):
         super().build_h_prologue(output, box)
         self.__build_common_prologue(output, box)
+        # make sure aborts from the box flush its output buffer
+        if self.__build_buffered_prologue(output,
+                box.outputs[box.outputs.index('c')]
+                if 'c' in box.outputs else None):
+            output.decls.append('#define __box_abort __box_buffered_abort')
 
     def build_c_prologue(self, output, box):
         super().build_c_prologue(output, box)
         self.__build_common_prologue(output, box)
+        self.__build_buffered_prologue(output, output)
 
     def build_wasm_h_prologue(self, output, box):
         super().build_wasm_h_prologue(output, box)
         self.__build_common_prologue(output, box)
+        if self.__build_buffered_prologue(output,
+                box.outputs[box.outputs.index('wasm_c')]
+                if 'wasm_c' in box.outputs else None):
+            output.decls.append('#define __box_abort __box_buffered_abort')
 
     def build_wasm_c_prologue(self, output, box):
         super().build_wasm_c_prologue(output, box)
         self.__build_common_prologue(output, box)
+        self.__build_buffered_prologue(output, output)
 
     def __build_common_c(self, output, box):
         output.decls.append('//// __box_write glue ////')
@@ -469,14 +580,32 @@ class WriteGlue(glue.Glue):
                     alias=self.__flush_hook.link.export.alias)
             out.printf('}')
 
+        buffered = output.printf_impl == 'minimal' and output.write_buffer
         if output.printf_impl == 'minimal':
             output.includes.append('<stdarg.h>')
             output.includes.append('<string.h>')
             out = output.decls.append()
             out.printf(C_MINIMAL_PRINTF)
+            if buffered:
+                output.decls.append(C_PRINTF_BUFFERED_WRITE,
+                    write_buffer=output.write_buffer)
+            else:
+                output.decls.append(C_PRINTF_WRITE)
+            output.decls.append(C_PRINTF_WRAPPERS)
 
         if not output.no_stdlib_hooks:
-            output.decls.append(C_HOOKS)
+            if buffered:
+                output.decls.append(C_BUFFERED_HOOKS)
+            else:
+                output.decls.append(C_HOOKS)
+
+    def __write_impl(self, output):
+        # with a buffer, writes from the stdlib share it with printf so
+        # output stays in order
+        if output.printf_impl == 'minimal' and output.write_buffer:
+            return '__box_write_buffered'
+        else:
+            return '__box_write'
 
     def build_c(self, output, box):
         super().build_c(output, box)
@@ -486,7 +615,8 @@ class WriteGlue(glue.Glue):
             self.__build_common_c(output, box)
 
             if not output.no_stdlib_hooks:
-                output.decls.append(GCC_HOOKS)
+                output.decls.append(GCC_HOOKS,
+                    write=self.__write_impl(output))
 
     def build_wasm_c(self, output, box):
         super().build_wasm_c(output, box)
@@ -496,7 +626,8 @@ class WriteGlue(glue.Glue):
             self.__build_common_c(output, box)
 
             if not output.no_stdlib_hooks:
-                output.decls.append(WASM_HOOKS)
+                output.decls.append(WASM_HOOKS,
+                    write=self.__write_impl(output))
 
     def build_mk(self, output, box):
         super().build_mk(output, box)
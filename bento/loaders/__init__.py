@@ -7,6 +7,7 @@
 
 import collections as co
 import itertools as it
+import shlex
 from ..glue import Inherit
 
 LOADERS = co.OrderedDict()
@@ -15,6 +16,24 @@ def loader(cls):
     LOADERS[cls.__argname__] = cls
     return cls
 
+def glzmode(glz_flags):
+    """
+    Find the GLZ mode, compact or fast, selected by a list of GLZ flags.
+    Loaders need to know this to pick a matching decoder.
+    """
+    mode = 'compact'
+    args = shlex.split(' '.join(glz_flags))
+    for i, arg in enumerate(args):
+        if arg in {'-m', '--mode'} and i+1 < len(args):
+            mode = args[i+1]
+        elif arg.startswith('--mode='):
+            mode = arg[len('--mode='):]
+        elif arg.startswith('-m') and len(arg) > 2:
+            mode = arg[2:]
+    assert mode in {'compact', 'fast'}, (
+        "unknown GLZ mode %r in %r" % (mode, glz_flags))
+    return mode
+
 from ..outputs import OUTPUTS
 class Loader(Inherit(
         ['%s%s%s%s' % (op, level, output, order)
@@ -46,6 +65,13 @@ class Loader(Inherit(
         """
         return constraints
 
+    def parentmemory(self, memory):
+        """
+        Allow loaders to choose which of the parent's memories a box's
+        memory is allocated from. None lets the parent pick.
+        """
+        return None
+
     def box(self, box):
         super().box(box)
         box.text.alloc(box, 'rxp')
@@ -58,3 +84,4 @@ from .noop import NoOpLoader
 from .glz import GLZLoader
 from .bd import BDLoader
 from .fs import FSLoader
+from .xip import XIPLoader
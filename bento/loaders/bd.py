@@ -40,25 +40,65 @@ BOX_GLZ_DECODE = """
 typedef uint32_t glz_size_t;
 typedef uint32_t glz_off_t;
 
-int __box_glz_bddecode(uint8_t k,
+// read a single bit, only calling read when we cross into a new byte
+static inline int __box_glz_bdbit(
         int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
-        void *ctx,
-        glz_off_t off,
-        uint8_t *output, glz_size_t size) {
+        void *ctx, glz_off_t off, uint8_t *x, glz_off_t *xoff) {
+    if (off/8 != *xoff) {
+        int err = read(ctx, off/8, x, 1);
+        if (err) {
+            return err;
+        }
+        *xoff = off/8;
+    }
+    return 1 & (*x >> (7-off%%8));
+}
+
+// decoder state, saved between symbols so decoding can be resumed
+struct __box_glz_bdstate {
+    uint8_t k;
+    glz_off_t off;
+    glz_size_t size;
+    glz_off_t poff;
+    glz_size_t psize;
+    uint8_t *output;
+};
+
+// decode at most limit bytes, returning -EAGAIN if there is more to
+// decode, note the symbol table is read through its own ctx, this lets
+// the caller buffer table lookups separately from the bitstream
+int __box_glz_bdstep(struct __box_glz_bdstate *state,
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, void *table_ctx,
+        glz_size_t limit) {
+    uint8_t k = state->k;
+    glz_off_t off = state->off;
+    glz_size_t size = state->size;
     // glz "stack"
-    glz_off_t poff = 0;
-    glz_size_t psize = 0;
-    uint8_t x[2];
+    glz_off_t poff = state->poff;
+    glz_size_t psize = state->psize;
+    uint8_t *output = state->output;
+    uint8_t x;
+    glz_off_t xoff = -1;
 
     while (size > 0) {
+        if (limit == 0) {
+            state->off = off;
+            state->size = size;
+            state->poff = poff;
+            state->psize = psize;
+            state->output = output;
+            return -EAGAIN;
+        }
+
         // decode rice code
         uint_fast16_t rice = 0;
         while (true) {
-            int err = read(ctx, off/8, x, 1);
-            if (err) {
-                return err;
+            int bit = __box_glz_bdbit(read, ctx, off, &x, &xoff);
+            if (bit < 0) {
+                return bit;
             }
-            if (!(1 & (x[0] >> (7-off%%8)))) {
+            if (!bit) {
                 off += 1;
                 break;
             }
@@ -66,38 +106,40 @@ int __box_glz_bddecode(uint8_t k,
             off += 1;
         }
         for (glz_off_t i = 0; i < k; i++) {
-            int err = read(ctx, off/8, x, 1);
-            if (err) {
-                return err;
+            int bit = __box_glz_bdbit(read, ctx, off, &x, &xoff);
+            if (bit < 0) {
+                return bit;
             }
-            rice = (rice << 1) | (1 & (x[0] >> (7-off%%8)));
+            rice = (rice << 1) | bit;
             off += 1;
         }
 
         // map through table
-        int err = read(ctx, (9*rice)/8, x, 2);
+        uint8_t y[2];
+        int err = read(table_ctx, (9*rice)/8, y, 2);
         if (err) {
             return err;
         }
         rice = 0x1ff & (
-            (x[0] << 8) |
-            (x[1] << 0)) >> (7-(9*rice)%%8);
+            (y[0] << 8) |
+            (y[1] << 0)) >> (7-(9*rice)%%8);
 
         // indirect reference or literal?
         if (rice < 0x100) {
             *output++ = rice;
             size -= 1;
+            limit -= 1;
         } else {
             glz_size_t nsize = (rice & 0xff) + 2;
             glz_off_t noff = 0;
             while (true) {
                 glz_off_t n = 0;
                 for (glz_off_t i = 0; i < GLZ_M+1; i++) {
-                    int err = read(ctx, off/8, x, 1);
-                    if (err) {
-                        return err;
+                    int bit = __box_glz_bdbit(read, ctx, off, &x, &xoff);
+                    if (bit < 0) {
+                        return bit;
                     }
-                    n = (n << 1) | (1 & (x[0] >> (7-off%%8)));
+                    n = (n << 1) | bit;
                     off += 1;
                 }
 
@@ -128,15 +170,170 @@ int __box_glz_bddecode(uint8_t k,
         }
     }
 
+    state->size = 0;
+    return 0;
+}
+
+int __box_glz_bddecode(uint8_t k,
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, void *table_ctx,
+        glz_off_t off,
+        uint8_t *output, glz_size_t size) {
+    struct __box_glz_bdstate state = {k, off, size, 0, 0, output};
+    return __box_glz_bdstep(&state, read, ctx, table_ctx, -1);
+}
+"""
+
+# fast mode variant, blobs compressed with glz -m fast have no table and
+# only byte-aligned symbols, so literal runs are read straight into the
+# output
+BOX_GLZ_DECODE_FAST = """
+// GLZ constants
+typedef uint32_t glz_size_t;
+typedef uint32_t glz_off_t;
+
+// read a single byte
+static inline int __box_glz_bdbyte(
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, glz_off_t off) {
+    uint8_t x;
+    int err = read(ctx, off, &x, 1);
+    if (err) {
+        return err;
+    }
+    return x;
+}
+
+// decoder state, saved between symbols so decoding can be resumed
+struct __box_glz_bdstate {
+    uint8_t k;
+    glz_off_t off;
+    glz_size_t size;
+    glz_off_t poff;
+    glz_size_t psize;
+    uint8_t *output;
+};
+
+// decode roughly limit bytes, returning -EAGAIN if there is more to
+// decode, we only stop between symbols, so a literal run may overshoot
+// limit, fast mode has no table so table_ctx is unused
+int __box_glz_bdstep(struct __box_glz_bdstate *state,
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, void *table_ctx,
+        glz_size_t limit) {
+    (void)table_ctx;
+    // offsets are in bits, but every symbol is byte-aligned, left is
+    // the number of literals left in the current run
+    glz_off_t off = state->off/8;
+    glz_size_t size = state->size;
+    glz_size_t left = 0;
+    // glz "stack"
+    glz_off_t poff = state->poff/8;
+    glz_size_t psize = state->psize;
+    uint8_t *output = state->output;
+
+    while (size > 0) {
+        if (limit == 0 && left == 0) {
+            state->off = 8*off;
+            state->size = size;
+            state->poff = 8*poff;
+            state->psize = psize;
+            state->output = output;
+            return -EAGAIN;
+        }
+
+        if (left) {
+            // read as much of the literal run as we need
+            glz_size_t n = left < size ? left : size;
+            int err = read(ctx, off, output, n);
+            if (err) {
+                return err;
+            }
+            output += n;
+            off += n;
+            left -= n;
+            size -= n;
+            limit -= n < limit ? n : limit;
+        } else {
+            // decode symbol
+            int x = __box_glz_bdbyte(read, ctx, off);
+            if (x < 0) {
+                return x;
+            }
+            off += 1;
+
+            // literal run or reference?
+            if (!(x & 0x80)) {
+                left = x + 1;
+            } else {
+                glz_size_t nsize = (x & 0x7f) + 2;
+                x = __box_glz_bdbyte(read, ctx, off);
+                if (x < 0) {
+                    return x;
+                }
+                glz_size_t nleft = x + 1;
+                off += 1;
+
+                glz_off_t noff = 0;
+                for (uint_fast8_t shift = 0;; shift += 7) {
+                    if (shift > 28) {
+                        return -EINVAL;
+                    }
+                    x = __box_glz_bdbyte(read, ctx, off);
+                    if (x < 0) {
+                        return x;
+                    }
+                    noff |= (glz_off_t)(x & 0x7f) << shift;
+                    off += 1;
+                    if (!(x & 0x80)) {
+                        break;
+                    }
+                }
+
+                // tail recurse?
+                if (nsize >= size) {
+                    off = off + noff;
+                    left = nleft;
+                } else {
+                    poff = off;
+                    psize = size - nsize;
+                    off = off + noff;
+                    left = nleft;
+                    size = nsize;
+                }
+            }
+        }
+
+        if (size == 0) {
+            // references only start between symbols, so we never return
+            // into a run
+            off = poff;
+            size = psize;
+            left = 0;
+            poff = 0;
+            psize = 0;
+        }
+    }
+
+    state->size = 0;
     return 0;
 }
+
+int __box_glz_bddecode(uint8_t k,
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, void *table_ctx,
+        glz_off_t off,
+        uint8_t *output, glz_size_t size) {
+    struct __box_glz_bdstate state = {k, off, size, 0, 0, output};
+    return __box_glz_bdstep(&state, read, ctx, table_ctx, -1);
+}
 """
 
 BOX_LOAD = """
 #define BOX_%(BOX)s_BLOCK_SIZE %(block_size)d
 #define BOX_%(BOX)s_READ_SIZE %(read_size)d
 
-int __box_%(box)s_load(void) {
+int %(load)s(void) {
     extern uint8_t __box_%(box)s_%(memory)s_start;
     extern uint8_t __box_%(box)s_%(memory)s_end;
 
@@ -169,67 +366,110 @@ int __box_%(box)s_load(void) {
 }
 """
 
-BOX_LOAD_DECODE = """
+BOX_WINDOW = """
 #define BOX_%(BOX)s_BLOCK_SIZE %(block_size)d
 #define BOX_%(BOX)s_BUFFER_SIZE %(buffer_size)d
 #define BOX_%(BOX)s_READ_SIZE %(read_size)d
 
-// bdread with buffer_size buffering, translation, and bounds checking
-uint32_t __box_%(box)s_buffer_block;
-uint32_t __box_%(box)s_buffer_off;
-uint8_t __box_%(box)s_buffer[BOX_%(BOX)s_BUFFER_SIZE];
+// bdread with read-ahead buffering, translation, and bounds checking,
+// hits/misses count reads served from the buffer vs reads that needed
+// the block device, these are useful for sizing the buffers
+struct __box_%(box)s_window {
+    uint32_t off;
+    uint32_t buffer_block;
+    uint32_t buffer_off;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t buffer_size;
+    uint8_t *buffer;
+};
+
 static int __box_%(box)s_buffer_read(void *ctx,
         uint32_t addr, void *buffer, size_t size) {
-    uint32_t off = (uint32_t)ctx;
-    addr = addr + off;
-    if (addr + size > %(size)d) {
+    struct __box_%(box)s_window *window = ctx;
+    addr = addr + window->off;
+    if (addr + size > %(end)d) {
         return -EINVAL;
     }
 
     uint32_t block = addr / BOX_%(BOX)s_BLOCK_SIZE;
-    off = addr - (block * BOX_%(BOX)s_BLOCK_SIZE);
+    uint32_t off = addr - (block * BOX_%(BOX)s_BLOCK_SIZE);
+    uint32_t misses = window->misses;
 
     while (size > 0) {
-        if (block == __box_%(box)s_buffer_block &&
-                off >= __box_%(box)s_buffer_off &&
-                off < __box_%(box)s_buffer_off + BOX_%(BOX)s_BUFFER_SIZE) {
+        if (block == window->buffer_block &&
+                off >= window->buffer_off &&
+                off < window->buffer_off + window->buffer_size) {
             size_t delta = __box_bd_min(
-                BOX_%(BOX)s_BUFFER_SIZE-(off-__box_%(box)s_buffer_off),
+                window->buffer_size-(off-window->buffer_off),
                 size);
             memcpy(buffer,
-                    &__box_%(box)s_buffer[off - __box_%(box)s_buffer_off],
+                    &window->buffer[off - window->buffer_off],
                     delta);
+            buffer = (uint8_t*)buffer + delta;
             off += delta;
             size -= delta;
+            if (off >= BOX_%(BOX)s_BLOCK_SIZE) {
+                block += 1;
+                off -= BOX_%(BOX)s_BLOCK_SIZE;
+            }
             continue;
         }
 
         // load buffer, first condition can't fail
         uint32_t nblock = block;
-        uint32_t noff = __box_bd_aligndown(off, BOX_%(BOX)s_BUFFER_SIZE);
+        uint32_t noff = __box_bd_aligndown(off, window->buffer_size);
         int err = %(alias)s(nblock, noff,
-                __box_%(box)s_buffer,
-                BOX_%(BOX)s_BUFFER_SIZE);
+                window->buffer,
+                window->buffer_size);
         if (err) {
             return err;
         }
-        __box_%(box)s_buffer_block = nblock;
-        __box_%(box)s_buffer_off = noff;
+        window->buffer_block = nblock;
+        window->buffer_off = noff;
+        window->misses += 1;
     }
 
+    if (window->misses == misses) {
+        window->hits += 1;
+    }
     return 0;
 }
 
+uint8_t __box_%(box)s_buffer[BOX_%(BOX)s_BUFFER_SIZE];
+struct __box_%(box)s_window __box_%(box)s_window = {
+    .buffer_size = BOX_%(BOX)s_BUFFER_SIZE,
+    .buffer = __box_%(box)s_buffer,
+};
+"""
+
+# the bitstream and symbol table get separate windows, otherwise
+# table lookups would evict the bitstream on every symbol
+BOX_TABLE_WINDOW = """
+#define BOX_%(BOX)s_TABLE_BUFFER_SIZE %(table_buffer_size)d
+
+uint8_t __box_%(box)s_table_buffer[BOX_%(BOX)s_TABLE_BUFFER_SIZE];
+struct __box_%(box)s_window __box_%(box)s_table_window = {
+    .buffer_size = BOX_%(BOX)s_TABLE_BUFFER_SIZE,
+    .buffer = __box_%(box)s_table_buffer,
+};
+"""
+
+BOX_LOAD_DECODE = """
 // add checks for input size
-int __box_%(box)s_load(void) {
+int %(load)s(void) {
     extern uint8_t __box_%(box)s_%(memory)s_start;
     extern uint8_t __box_%(box)s_%(memory)s_end;
-    // init buffer
-    __box_%(box)s_buffer_block = -1;
+    // init buffers
+    __box_%(box)s_window.off = 0;
+    __box_%(box)s_window.buffer_block = -1;
+    __box_%(box)s_table_window.off = %(addr)d + 8;
+    __box_%(box)s_table_window.buffer_block = -1;
 
     // load metadata
     uint32_t x[2];
-    int err = __box_%(box)s_buffer_read(NULL, %(addr)d, x, sizeof(x));
+    int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+            %(addr)d, x, sizeof(x));
     if (err) {
         return err;
     }
@@ -247,8 +487,11 @@ int __box_%(box)s_load(void) {
     }
 
     // decompress region
+    __box_%(box)s_window.off = %(addr)d + 8;
     return __box_glz_bddecode(k,
-            __box_%(box)s_buffer_read, (void*)(%(addr)d + 8),
+            __box_%(box)s_buffer_read,
+            &__box_%(box)s_window,
+            &__box_%(box)s_table_window,
             off,
             &__box_%(box)s_%(memory)s_start,
             size);
@@ -256,211 +499,510 @@ int __box_%(box)s_load(void) {
 """
 
 # a little bit more complex when multiple regions are involved
-BOX_LOAD_MULTI = """
-#define BOX_%(BOX)s_BLOCK_SIZE %(block_size)d
-#define BOX_%(BOX)s_BUFFER_SIZE %(buffer_size)d
-#define BOX_%(BOX)s_READ_SIZE %(read_size)d
+BOX_LOAD_MULTI = """int %(load)s(void) {
+    // init buffer
+    __box_%(box)s_window.off = 0;
+    __box_%(box)s_window.buffer_block = -1;
 
-// bdread with buffer_size buffering, translation, and bounds checking
-uint32_t __box_%(box)s_buffer_block;
-uint32_t __box_%(box)s_buffer_off;
-uint8_t __box_%(box)s_buffer[BOX_%(BOX)s_BUFFER_SIZE];
-static int __box_%(box)s_buffer_read(void *ctx,
-        uint32_t addr, void *buffer, size_t size) {
-    uint32_t off = (uint32_t)ctx;
-    addr = addr + off;
-    if (addr + size > %(size)d) {
-        return -EINVAL;
+    // load metadata?
+    uint32_t count;
+    int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+            %(addr)d, &count, sizeof(count));
+    if (err) {
+        return err;
     }
 
-    uint32_t block = addr / BOX_%(BOX)s_BLOCK_SIZE;
-    uint32_t off = addr - (block * BOX_%(BOX)s_BLOCK_SIZE);
+    if (count != %(n)d) {
+        return -ENOEXEC;
+    }
 
-    while (size > 0) {
-        if (block == __box_%(box)s_buffer_block &&
-                off >= __box_%(box)s_buffer_off &&
-                off < __box_%(box)s_buffer_off + BOX_%(BOX)s_BUFFER_SIZE) {
-            size_t delta = __box_bd_min(
-                BOX_%(BOX)s_BUFFER_SIZE-(off-__box_%(box)s_buffer_off),
-                size);
-            memcpy(buffer,
-                    &__box_%(box)s_buffer[off - __box_%(box)s_buffer_off],
-                    delta);
-            off += delta;
-            size -= delta;
-            continue;
+    uint32_t off = (1+%(n)d)*sizeof(uint32_t);
+    for (uint32_t i = 0; i < %(n)d; i++) {
+        // load metadata again
+        uint32_t size;
+        int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+                %(addr)d+(1+i)*sizeof(uint32_t),
+                &size, sizeof(size));
+        if (err) {
+            return err;
         }
 
-        // load buffer, first condition can't fail
-        uint32_t nblock = block;
-        uint32_t noff = __box_bd_aligndown(off, BOX_%(BOX)s_BUFFER_SIZE);
-        int err = %(alias)s(nblock, noff,
-                __box_%(box)s_buffer,
-                BOX_%(BOX)s_BUFFER_SIZE);
+        if (size > __box_%(box)s_loadregions[i][1]
+                - __box_%(box)s_loadregions[i][0]) {
+            // can't allow overwrites now can we
+            return -ENOEXEC;
+        }
+
+        // load region
+        err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+                %(addr)d+off,
+                __box_%(box)s_loadregions[i][0], size);
         if (err) {
             return err;
         }
-        __box_%(box)s_buffer_block = nblock;
-        __box_%(box)s_buffer_off = noff;
+
+        off += size;
     }
 
     return 0;
 }
+"""
 
-int __box_%(box)s_load(void) {
-    // init buffer
-    __box_%(box)s_buffer_block = -1;
+BOX_LOAD_DECODE_MULTI = """
+int %(load)s(void) {
+    // init buffers
+    __box_%(box)s_window.off = 0;
+    __box_%(box)s_window.buffer_block = -1;
+    __box_%(box)s_table_window.off = %(addr)d
+            + (1+2*%(n)d)*sizeof(uint32_t);
+    __box_%(box)s_table_window.buffer_block = -1;
 
-    // load metadata?
-    uint32_t count;
-    int err = __box_%(box)s_buffer_read(NULL, %(addr)d,
-            &count, sizeof(count));
+    // load metadata
+    uint32_t x;
+    int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+            %(addr)d, &x, sizeof(x));
     if (err) {
         return err;
     }
 
+    uint8_t k = 0xf & (x >> 24);
+    uint32_t count = 0x00ffffff & x;
     if (count != %(n)d) {
         return -ENOEXEC;
     }
 
-    uint32_t off = (1+%(n)d)*sizeof(uint32_t);
     for (uint32_t i = 0; i < %(n)d; i++) {
         // load metadata again
-        uint32_t size;
-        int err = __box_%(box)s_buffer_read(
-                NULL, %(addr)d+(1+i)*sizeof(uint32_t),
-                &size, sizeof(size));
+        uint32_t y[2];
+        __box_%(box)s_window.off = 0;
+        int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+                %(addr)d+(1+2*i)*sizeof(uint32_t),
+                y, sizeof(y));
         if (err) {
             return err;
         }
 
+        uint32_t off = y[0];
+        uint32_t size = y[1];
         if (size > __box_%(box)s_loadregions[i][1]
                 - __box_%(box)s_loadregions[i][0]) {
             // can't allow overwrites now can we
             return -ENOEXEC;
         }
 
-        // load region
-        err = __box_%(box)s_buffer_read(NULL, off,
-                __box_%(box)s_loadregions[i][0], size);
+        // decompress region
+        __box_%(box)s_window.off = %(addr)d
+                + (1+2*%(n)d)*sizeof(uint32_t);
+        err = __box_glz_bddecode(k,
+                __box_%(box)s_buffer_read,
+                &__box_%(box)s_window,
+                &__box_%(box)s_table_window,
+                off,
+                __box_%(box)s_loadregions[i][0],
+                size);
         if (err) {
             return err;
         }
-
-        off += size;
     }
 
     return 0;
 }
 """
 
-BOX_LOAD_DECODE_MULTI = """
-#define BOX_%(BOX)s_BLOCK_SIZE %(block_size)d
-#define BOX_%(BOX)s_BUFFER_SIZE %(buffer_size)d
-#define BOX_%(BOX)s_READ_SIZE %(read_size)d
+# loading in steps for __box_<box>_prefetch, this always uses the
+# general multi-region layout
+BOX_LOADSTATE = """
+#define BOX_%(BOX)s_PREFETCH_SIZE %(prefetch_size)d
+
+// background loading state, pending is set while an asynchronous read
+// is in flight, and err is the result of the last asynchronous read
+struct __box_%(box)s_loadstate {
+    uint32_t region;
+    uint32_t addr;
+    uint8_t *dest;
+    uint32_t size;
+    volatile bool pending;
+    volatile int err;
+} __box_%(box)s_loadstate;
+"""
 
-// bdread with buffer_size buffering, translation, and bounds checking
-uint32_t __box_%(box)s_buffer_block;
-uint32_t __box_%(box)s_buffer_off;
-uint8_t __box_%(box)s_buffer[BOX_%(BOX)s_BUFFER_SIZE];
-static int __box_%(box)s_buffer_read(void *ctx,
-        uint32_t addr, void *buffer, size_t size) {
-    uint32_t off = (uint32_t)ctx;
-    addr = addr + off;
-    if (addr + size > %(size)d) {
-        return -EINVAL;
+BOX_LOADSTATE_DECODE = """
+#define BOX_%(BOX)s_PREFETCH_SIZE %(prefetch_size)d
+
+// background loading state
+struct __box_%(box)s_loadstate {
+    uint32_t region;
+    struct __box_glz_bdstate glz;
+} __box_%(box)s_loadstate;
+"""
+
+BOX_BDREAD_DONE = """
+void __box_%(box)s_bdread_done(int err) {
+    __box_%(box)s_loadstate.err = err;
+    __box_%(box)s_loadstate.pending = false;
+}
+"""
+
+BOX_LOADSTEP = """
+int __box_%(box)s_loadstart(void) {
+    // init buffer
+    __box_%(box)s_window.off = 0;
+    __box_%(box)s_window.buffer_block = -1;
+
+    // load metadata
+    uint32_t count;
+    int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+            %(addr)d, &count, sizeof(count));
+    if (err) {
+        return err;
     }
 
-    uint32_t block = addr / BOX_%(BOX)s_BLOCK_SIZE;
-    off = addr - (block * BOX_%(BOX)s_BLOCK_SIZE);
+    if (count != %(n)d) {
+        return -ENOEXEC;
+    }
 
-    while (size > 0) {
-        if (block == __box_%(box)s_buffer_block &&
-                off >= __box_%(box)s_buffer_off &&
-                off < __box_%(box)s_buffer_off + BOX_%(BOX)s_BUFFER_SIZE) {
-            size_t delta = __box_bd_min(
-                BOX_%(BOX)s_BUFFER_SIZE-(off-__box_%(box)s_buffer_off),
-                size);
-            memcpy(buffer,
-                    &__box_%(box)s_buffer[off - __box_%(box)s_buffer_off],
-                    delta);
-            off += delta;
-            size -= delta;
-            continue;
+    __box_%(box)s_loadstate.region = 0;
+    __box_%(box)s_loadstate.addr = %(addr)d + (1+%(n)d)*sizeof(uint32_t);
+    __box_%(box)s_loadstate.size = 0;
+    __box_%(box)s_loadstate.err = 0;
+    return 0;
+}
+
+int __box_%(box)s_loadstep(void) {
+    struct __box_%(box)s_loadstate *state = &__box_%(box)s_loadstate;
+    if (state->pending) {
+        return -EAGAIN;
+    }
+
+    if (state->err) {
+        return state->err;
+    }
+
+    while (state->size == 0) {
+        if (state->region == %(n)d) {
+            return 0;
         }
 
-        // load buffer, first condition can't fail
-        uint32_t nblock = block;
-        uint32_t noff = __box_bd_aligndown(off, BOX_%(BOX)s_BUFFER_SIZE);
-        int err = %(alias)s(nblock, noff,
-                __box_%(box)s_buffer,
-                BOX_%(BOX)s_BUFFER_SIZE);
+        // load metadata for the next region
+        uint32_t i = state->region;
+        uint32_t size;
+        int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+                %(addr)d+(1+i)*sizeof(uint32_t),
+                &size, sizeof(size));
+        if (err) {
+            return err;
+        }
+
+        if (size > __box_%(box)s_loadregions[i][1]
+                - __box_%(box)s_loadregions[i][0]) {
+            // can't allow overwrites now can we
+            return -ENOEXEC;
+        }
+
+        state->region += 1;
+        state->dest = __box_%(box)s_loadregions[i][0];
+        state->size = size;
+    }
+
+    uint32_t size;
+    if (state->addr %% BOX_%(BOX)s_READ_SIZE != 0
+            || state->size < BOX_%(BOX)s_READ_SIZE) {
+        // unaligned edges of a region go through our buffer
+        size = __box_bd_min(state->size,
+                BOX_%(BOX)s_READ_SIZE
+                    - state->addr %% BOX_%(BOX)s_READ_SIZE);
+        int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+                state->addr, state->dest, size);
         if (err) {
             return err;
         }
-        __box_%(box)s_buffer_block = nblock;
-        __box_%(box)s_buffer_off = noff;
+    } else {
+        // read directly into the box's memory, up to the end of the block
+        uint32_t block = state->addr / BOX_%(BOX)s_BLOCK_SIZE;
+        uint32_t off = state->addr - (block * BOX_%(BOX)s_BLOCK_SIZE);
+        size = __box_bd_min(
+                __box_bd_min(BOX_%(BOX)s_PREFETCH_SIZE,
+                    BOX_%(BOX)s_BLOCK_SIZE - off),
+                __box_bd_aligndown(state->size, BOX_%(BOX)s_READ_SIZE));
+%(read)s
     }
 
-    return 0;
+    state->addr += size;
+    state->dest += size;
+    state->size -= size;
+    return -EAGAIN;
 }
+"""
 
-int __box_%(box)s_load(void) {
-    // init buffer
-    __box_%(box)s_buffer_block = -1;
+BOX_LOADSTEP_READ = """\
+        int err = %(alias)s(block, off, state->dest, size);
+        if (err) {
+            return err;
+        }"""
+
+BOX_LOADSTEP_READ_ASYNC = """\
+        state->pending = true;
+        int err = %(bdread_async)s(block, off, state->dest, size);
+        if (err) {
+            state->pending = false;
+            return err;
+        }"""
+
+BOX_LOADSTEP_DECODE = """
+int __box_%(box)s_loadstart(void) {
+    // init buffers
+    __box_%(box)s_window.off = 0;
+    __box_%(box)s_window.buffer_block = -1;
+    __box_%(box)s_table_window.off = %(addr)d
+            + (1+2*%(n)d)*sizeof(uint32_t);
+    __box_%(box)s_table_window.buffer_block = -1;
 
     // load metadata
-    uint32_t x[2];
-    int err = __box_%(box)_buffer_read(NULL, %(addr)d, x, sizeof(x));
+    uint32_t x;
+    int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+            %(addr)d, &x, sizeof(x));
     if (err) {
         return err;
     }
 
-    uint8_t k = 0xf & (x[0] >> 24);
-    uint32_t off = 0x00ffffff & x[0];
-    uint32_t count = x[1];
+    uint8_t k = 0xf & (x >> 24);
+    uint32_t count = 0x00ffffff & x;
     if (count != %(n)d) {
         return -ENOEXEC;
     }
 
-    for (uint32_t i = 0; i < %(n)d; i++) {
-        // load metadata again
-        int err = __box_%(box)s_buffer_read(
-                NULL, %(addr)d+(1+i)*2*sizeof(uint32_t),
-                x, sizeof(x));
+    __box_%(box)s_loadstate.region = 0;
+    __box_%(box)s_loadstate.glz.k = k;
+    __box_%(box)s_loadstate.glz.size = 0;
+    return 0;
+}
+
+// decompression is done in steps of roughly PREFETCH_SIZE bytes, reads
+// from the block device are synchronous
+int __box_%(box)s_loadstep(void) {
+    struct __box_%(box)s_loadstate *state = &__box_%(box)s_loadstate;
+    while (state->glz.size == 0) {
+        if (state->region == %(n)d) {
+            return 0;
+        }
+
+        // load metadata for the next region
+        uint32_t i = state->region;
+        uint32_t y[2];
+        __box_%(box)s_window.off = 0;
+        int err = __box_%(box)s_buffer_read(&__box_%(box)s_window,
+                %(addr)d+(1+2*i)*sizeof(uint32_t),
+                y, sizeof(y));
         if (err) {
             return err;
         }
 
-        uint32_t off = x[0];
-        uint32_t size = x[1];
+        uint32_t off = y[0];
+        uint32_t size = y[1];
         if (size > __box_%(box)s_loadregions[i][1]
                 - __box_%(box)s_loadregions[i][0]) {
             // can't allow overwrites now can we
             return -ENOEXEC;
         }
 
-        // load region
-        err = __box_%(box)s_buffer_read(NULL, off,
-                __box_%(box)s_loadregions[i][0], size);
+        state->region += 1;
+        state->glz.off = off;
+        state->glz.size = size;
+        state->glz.poff = 0;
+        state->glz.psize = 0;
+        state->glz.output = __box_%(box)s_loadregions[i][0];
+    }
+
+    // decompress part of the region
+    __box_%(box)s_window.off = %(addr)d
+            + (1+2*%(n)d)*sizeof(uint32_t);
+    int err = __box_glz_bdstep(&state->glz,
+            __box_%(box)s_buffer_read,
+            &__box_%(box)s_window,
+            &__box_%(box)s_table_window,
+            BOX_%(BOX)s_PREFETCH_SIZE);
+    if (err) {
+        return err;
+    }
+
+    return (state->region == %(n)d) ? 0 : -EAGAIN;
+}
+"""
+
+BOX_LOAD_STEPS = """
+int __box_%(box)s_load(void) {
+    int err = __box_%(box)s_loadstart();
+    if (err) {
+        return err;
+    }
+
+    do {
+        err = __box_%(box)s_loadstep();
+    } while (err == -EAGAIN);
+    return err;
+}
+"""
+
+BOX_PAGING_COMMON = """
+// page flags for demand paging
+#define __BOX_BD_PAGE_RESIDENT   0x1
+#define __BOX_BD_PAGE_REFERENCED 0x2
+
+// prot bits passed to __box_<box>_pageprotect
+#define __BOX_BD_PROT_R 0x4
+#define __BOX_BD_PROT_W 0x2
+#define __BOX_BD_PROT_X 0x1
+
+struct __box_bd_pagedmemory {
+    uintptr_t addr;
+    uint32_t size;
+    uint32_t page;
+    uint32_t prot;
+};
+"""
+
+BOX_PAGING = """
+#define BOX_%(BOX)s_BLOCK_SIZE %(block_size)d
+#define BOX_%(BOX)s_PAGE_SIZE %(page_size)d
+#define BOX_%(BOX)s_PAGES %(pages)d
+#define BOX_%(BOX)s_FRAMES %(frames)d
+
+// paging state, faults count every fault including the soft faults used
+// to track references, reads count faults that needed the block device,
+// these are useful for sizing the page cache
+struct __box_%(box)s_paging {
+    uint32_t resident;
+    uint32_t hand;
+    uint32_t faults;
+    uint32_t reads;
+    uint32_t evictions;
+    uint8_t flags[BOX_%(BOX)s_PAGES];
+} __box_%(box)s_paging;
+
+static uint8_t *__box_%(box)s_pageaddr(uint32_t i,
+        const struct __box_bd_pagedmemory **memory) {
+    for (uint32_t j = 0; j < %(n)d; j++) {
+        const struct __box_bd_pagedmemory *m = &__box_%(box)s_pagedmemories[j];
+        if (i >= m->page && i < m->page + m->size/BOX_%(BOX)s_PAGE_SIZE) {
+            *memory = m;
+            return (uint8_t*)m->addr + (i - m->page)*BOX_%(BOX)s_PAGE_SIZE;
+        }
+    }
+
+    return NULL;
+}
+
+// pages are stored in order at the start of our region, a page may
+// span multiple blocks
+static int __box_%(box)s_pageread(uint32_t i, uint8_t *page) {
+    uint32_t addr = %(addr)d + i*BOX_%(BOX)s_PAGE_SIZE;
+    uint32_t size = BOX_%(BOX)s_PAGE_SIZE;
+    while (size > 0) {
+        uint32_t block = addr / BOX_%(BOX)s_BLOCK_SIZE;
+        uint32_t off = addr - (block * BOX_%(BOX)s_BLOCK_SIZE);
+        uint32_t delta = __box_bd_min(BOX_%(BOX)s_BLOCK_SIZE - off, size);
+        int err = %(alias)s(block, off, page, delta);
         if (err) {
             return err;
         }
 
-        // decompress region
-        err = __box_glz_bddecode(k,
-                __box_%(box)s_buffer_read,
-                (void*)(%(addr)d + (1+%(n)d)*2*sizeof(uint32_t)),
-                off,
-                __box_%(box)s_loadregions[i][0],
-                size);
+        addr += delta;
+        page += delta;
+        size -= delta;
+    }
+
+    return 0;
+}
+
+int __box_%(box)s_pagefault(uintptr_t addr) {
+    const struct __box_bd_pagedmemory *memory = NULL;
+    for (uint32_t j = 0; j < %(n)d; j++) {
+        const struct __box_bd_pagedmemory *m = &__box_%(box)s_pagedmemories[j];
+        if (addr >= m->addr && addr - m->addr < m->size) {
+            memory = m;
+            break;
+        }
+    }
+
+    if (!memory) {
+        // not one of our pages
+        return -EFAULT;
+    }
+
+    uint32_t i = memory->page + (addr - memory->addr)/BOX_%(BOX)s_PAGE_SIZE;
+    uint8_t *page = (uint8_t*)memory->addr
+            + (i - memory->page)*BOX_%(BOX)s_PAGE_SIZE;
+    __box_%(box)s_paging.faults += 1;
+
+    // resident pages are only protected to track references
+    if (__box_%(box)s_paging.flags[i] & __BOX_BD_PAGE_RESIDENT) {
+        __box_%(box)s_paging.flags[i] |= __BOX_BD_PAGE_REFERENCED;
+        return %(pageprotect)s(page, BOX_%(BOX)s_PAGE_SIZE, memory->prot);
+    }
+
+    // find a frame with clock replacement, referenced pages get a
+    // second chance, but are protected so we notice the next reference
+    while (__box_%(box)s_paging.resident >= BOX_%(BOX)s_FRAMES) {
+        uint32_t j = __box_%(box)s_paging.hand;
+        __box_%(box)s_paging.hand = (j + 1) %% BOX_%(BOX)s_PAGES;
+        uint8_t flags = __box_%(box)s_paging.flags[j];
+        if (!(flags & __BOX_BD_PAGE_RESIDENT)) {
+            continue;
+        }
+
+        const struct __box_bd_pagedmemory *m;
+        uint8_t *victim = __box_%(box)s_pageaddr(j, &m);
+        int err = %(pageprotect)s(victim, BOX_%(BOX)s_PAGE_SIZE, 0);
         if (err) {
             return err;
         }
+
+        if (flags & __BOX_BD_PAGE_REFERENCED) {
+            __box_%(box)s_paging.flags[j] &= ~__BOX_BD_PAGE_REFERENCED;
+        } else {
+            __box_%(box)s_paging.flags[j] = 0;
+            __box_%(box)s_paging.resident -= 1;
+            __box_%(box)s_paging.evictions += 1;
+        }
+    }
+
+    // page in
+    int err = %(pageprotect)s(page, BOX_%(BOX)s_PAGE_SIZE,
+            __BOX_BD_PROT_R | __BOX_BD_PROT_W);
+    if (err) {
+        return err;
+    }
+
+    err = __box_%(box)s_pageread(i, page);
+    if (err) {
+        return err;
+    }
+    __box_%(box)s_paging.reads += 1;
+
+    err = %(pageprotect)s(page, BOX_%(BOX)s_PAGE_SIZE, memory->prot);
+    if (err) {
+        return err;
     }
 
+    __box_%(box)s_paging.flags[i] =
+            __BOX_BD_PAGE_RESIDENT | __BOX_BD_PAGE_REFERENCED;
+    __box_%(box)s_paging.resident += 1;
     return 0;
 }
+
+int __box_%(box)s_load(void) {
+    // start with every page unmapped, these are brought in on demand
+    memset(&__box_%(box)s_paging, 0, sizeof(__box_%(box)s_paging));
+    for (uint32_t j = 0; j < %(n)d; j++) {
+        const struct __box_bd_pagedmemory *m = &__box_%(box)s_pagedmemories[j];
+        int err = %(pageprotect)s((uint8_t*)m->addr, m->size, 0);
+        if (err) {
+            return err;
+        }
+    }
+
+    return %(loadimage)s;
+}
 """
 
 @loaders.loader
@@ -482,7 +1024,13 @@ class BDLoader(loaders.Loader):
                 'be a multiple of this size. Defaults to 1 byte.')
         parser.add_argument('--buffer_size', type=int,
             help='Buffer size to use for reading from the block device. '
+                'When decompressing, the GLZ bitstream and symbol table '
+                'each get a read-ahead buffer of this size. '
                 'Defaults to max(read_size, 16).')
+        parser.add_argument('--table_buffer_size', type=int,
+            help='Buffer size to use for GLZ symbol table lookups. The '
+                'table is at most 576 bytes, so a buffer this large avoids '
+                'repeated reads. Defaults to buffer_size.')
         parser.add_argument('--block_size', type=int,
             help='Block size on the block device in bytes.')
         parser.add_argument('--glz',
@@ -490,11 +1038,37 @@ class BDLoader(loaders.Loader):
                 'decompressing the box when loaded. By default no compression '
                 'is used.')
         parser.add_argument('--glz_flags', type=list,
-            help='Add custom GLZ flags.')
+            help='Add custom GLZ flags. Passing -m fast selects the fast '
+                'GLZ mode, which compresses worse but decompresses faster, '
+                'and replaces the decoder with a matching one. The mode '
+                'must be the same for all boxes in the parent.')
+        parser.add_argument('--page_size', type=int,
+            help='Optional page size in bytes. If provided, memories that '
+                'are not writable are demand paged from the block device '
+                'instead of loaded up front, using the '
+                '__box_<box>_pageprotect hook to catch accesses. Paged '
+                'memories are stored uncompressed at the start of the '
+                'region.')
+        parser.add_argument('--pages', type=int,
+            help='Number of pages that can be resident at once when '
+                'paging, evicted with clock replacement. Defaults to all '
+                'pages.')
+        parser.add_argument('--prefetch', type=bool,
+            help='Load the box in steps, so loading can be started in the '
+                'background with __box_<box>_prefetch and driven by '
+                '__box_<box>_load_poll while other boxes run. If '
+                '__box_<box>_bdread_async is provided, reads overlap with '
+                'execution. Prefetched images always use the multi-region '
+                'layout.')
+        parser.add_argument('--prefetch_size', type=int,
+            help='Number of bytes to read, or decompress, in each step of '
+                'a background load. Defaults to block_size.')
 
     def __init__(self, region=None,
-            read_size=None, buffer_size=None, block_size=None,
-            glz=None, glz_flags=None):
+            read_size=None, buffer_size=None, table_buffer_size=None,
+            block_size=None, glz=None, glz_flags=None,
+            page_size=None, pages=None,
+            prefetch=None, prefetch_size=None):
         super().__init__()
         self._region = Region(**region.__dict__)
         assert self._region, ("No block device region specified? "
@@ -503,17 +1077,43 @@ class BDLoader(loaders.Loader):
         self._buffer_size = buffer_size or max(self._read_size, 16)
         assert self._buffer_size % self._read_size == 0, (
             "buffer_size not aligned to read_size?")
+        self._table_buffer_size = table_buffer_size or self._buffer_size
+        assert self._table_buffer_size % self._read_size == 0, (
+            "table_buffer_size not aligned to read_size?")
         self._block_size = block_size
         assert self._block_size, ("No block size specified? "
             "Need --loader.bd.block_size=<block_size>.")
         assert self._block_size % self._buffer_size == 0, (
             "block_size not aligned to buffer_size?")
+        assert self._block_size % self._table_buffer_size == 0, (
+            "block_size not aligned to table_buffer_size?")
         self._glz = glz
         self._glz_flags = glz_flags or []
+        self._mode = loaders.glzmode(self._glz_flags)
+        self._page_size = page_size
+        assert not self._page_size or (
+            self._page_size % self._read_size == 0), (
+            "page_size not aligned to read_size?")
+        self._pages = pages
+        assert not self._pages or self._pages >= 2, (
+            "Need at least 2 pages, an access may span pages.")
+        self._prefetch = prefetch or False
+        assert not (self._prefetch and self._page_size), (
+            "Can't prefetch paged boxes, pages are already loaded on "
+            "demand.")
+        self._prefetch_size = prefetch_size or self._block_size
+        assert self._prefetch_size % self._read_size == 0, (
+            "prefetch_size not aligned to read_size?")
 
     def constraints(self, constraints):
         constraints['mode'].discard('p')
-        constraints['mode'].add('w')
+        # when paging, read-only memories are paged in instead
+        if not self._page_size:
+            constraints['mode'].add('w')
+
+    def _pagedmemories(self, box):
+        return [memory for memory in box.memories
+            if 'w' not in memory.mode]
 
     def box_parent(self, parent, box):
         super().box_parent(parent, box)
@@ -528,8 +1128,55 @@ class BDLoader(loaders.Loader):
             doc="Read from block device using a block number and offset. "
                 "Must be in multiples of the read_size.")
 
+        if self._prefetch:
+            self._loadstart_plug = parent.addexport(
+                '__box_%s_loadstart' % box.name, 'fn() -> err',
+                scope=parent.name, source=self.__argname__, weak=True)
+            self._loadstep_plug = parent.addexport(
+                '__box_%s_loadstep' % box.name, 'fn() -> err',
+                scope=parent.name, source=self.__argname__, weak=True)
+            if not self._glz:
+                # optional hook for overlapping reads with execution
+                self._bdread_async_hook = parent.addimport(
+                    '__box_%s_bdread_async' % box.name,
+                    'fn(u32 block, u32 off, mut u8 *buffer, usize size) '
+                        '-> err',
+                    scope=parent.name, source=self.__argname__, weak=True,
+                    doc="Start a read from block device and return "
+                        "immediately. __box_<box>_bdread_done must be "
+                        "called with the result when the read completes, "
+                        "this may be called from an interrupt. Must be in "
+                        "multiples of the read_size.")
+                self._bdread_done_plug = parent.addexport(
+                    '__box_%s_bdread_done' % box.name, 'fn(err err) -> void',
+                    scope=parent.name, source=self.__argname__, weak=True)
+
+        if self._page_size:
+            assert box.runtime.pageprotects(box), ("Box `%s` uses "
+                "loader.bd.page_size, but paging requires a runtime that "
+                "provides __box_<box>_pageprotect, which runtime `%s` "
+                "does not" % (box.name, box.runtime.name))
+            self._pagefault_plug = parent.addexport(
+                '__box_%s_pagefault' % box.name, 'fn(usize addr) -> err',
+                scope=parent.name, source=self.__argname__, weak=True)
+            # need a way to catch accesses to unloaded pages
+            self._pageprotect_hook = parent.addimport(
+                '__box_%s_pageprotect' % box.name,
+                'fn(mut u8 *page, usize size, u32 prot) -> err',
+                scope=parent.name, source=self.__argname__,
+                doc="Change the protection of a range of pages. Prot is a "
+                    "mask of r=4, w=2, x=1. Accesses to pages without "
+                    "the needed protection must call "
+                    "__box_<box>_pagefault with the faulting address.")
+
     def box(self, box):
         super().box(box)
+        if self._page_size:
+            for memory in self._pagedmemories(box):
+                assert (memory.addr % self._page_size == 0 and
+                    memory.size % self._page_size == 0), (
+                    "Memory %s in box %s is not aligned to the page "
+                    "size %#x" % (memory.name, box.name, self._page_size))
         # we also take care data implicitly
         box.addexport('__box_data_init', 'fn() -> void',
             scope=box.name, source=self.__argname__, weak=True)
@@ -579,8 +1226,8 @@ class BDLoader(loaders.Loader):
                 # all implicit sections. Needed to get rid of program
                 # segments which create warnings later.
                 out.writef(' \\\n-I binary')
-                out.writef(' \\\n-O elf32-littlearm')
-                out.writef(' \\\n-B arm')
+                out.writef(' \\\n-O %(bfd_target)s')
+                out.writef(' \\\n-B %(bfd_arch)s')
                 out.writef(' \\\n--strip-all')
                 out.writef(' \\\n--remove-section=*')
                 out.printf(')')
@@ -590,10 +1237,21 @@ class BDLoader(loaders.Loader):
 
         output.decls.append(BOX_COMMON)
 
-        if any(child.loader._glz
+        modes = {child.loader._mode
+            for child in parent.boxes
+            if child.loader == self and child.loader._glz}
+        assert len(modes) <= 1, ("boxes in %s mix GLZ modes %s, but share "
+            "a decoder" % (parent.name, ', '.join(sorted(modes))))
+        if modes == {'fast'}:
+            output.decls.append(BOX_GLZ_DECODE_FAST)
+        elif modes:
+            output.decls.append(BOX_GLZ_DECODE)
+
+        if any(child.loader._page_size
                 for child in parent.boxes
                 if child.loader == self):
-            output.decls.append(BOX_GLZ_DECODE)
+            output.includes.append('<string.h>')
+            output.decls.append(BOX_PAGING_COMMON)
 
     def build_parent_c(self, output, parent, box):
         super().build_parent_c(output, parent, box)
@@ -612,28 +1270,46 @@ class BDLoader(loaders.Loader):
                     name = 'box.%s.%s' % (child.name, memory.name)
                     loadmemories.append((name, memory, [name]))
 
+        # paged memories are stored in page order at the start of the
+        # region, followed by the image of everything else
+        pagedmemories = (self._pagedmemories(box)
+            if self._page_size else [])
+        pagedsize = sum(memory.size for memory in pagedmemories)
+        assert not self._region.size or pagedsize < self._region.size, (
+            "Paged memories in box %s don't fit in region %s" % (
+                box.name, self._region))
+        addr = self._region.addr + pagedsize
+
         output.decls.append('//// %(box)s loading ////')
         with output.pushattrs(
                 alias=self._bdread_hook.link.export.alias,
-                addr=self._region.addr,
-                size=self._region.size,
-                block=self._region.addr // self._block_size,
-                off=self._region.addr - (
-                    (self._region.addr // self._block_size) * self._block_size),
+                load='__box_%s_loadimage' % box.name
+                    if self._page_size else
+                    '__box_%s_load' % box.name,
+                addr=addr,
+                end=self._region.addr + self._region.size,
+                block=addr // self._block_size,
+                off=addr - ((addr // self._block_size) * self._block_size),
                 block_size=self._block_size,
                 buffer_size=self._buffer_size,
+                table_buffer_size=self._table_buffer_size,
                 read_size=self._read_size):
 
-            if len(loadmemories) == 1:
+            if (len(loadmemories) == 1
+                    and not self._page_size and not self._prefetch):
                 # if we only have one memory region (common), we can use
-                # slightly less metadata
+                # slightly less metadata, paged and prefetched images
+                # always use the general layout, since the memory may not
+                # start with its size, and we can't read it in steps
                 if not self._glz:
                     output.decls.append(BOX_LOAD,
                         memory=loadmemories[0][0])
                 else:
+                    output.decls.append(BOX_WINDOW)
+                    output.decls.append(BOX_TABLE_WINDOW)
                     output.decls.append(BOX_LOAD_DECODE,
                         memory=loadmemories[0][0])
-            else:
+            elif loadmemories:
                 # otherwise, dynamically generate a loader that can handle
                 # all the memory regions
                 out = output.decls.append()
@@ -649,13 +1325,70 @@ class BDLoader(loaders.Loader):
                         with out.pushattrs(memory=memory):
                             out.printf('{'
                                 '&__box_%(box)s_%(memory)s_start, '
-                                '&__box_%(box)s_%(memory)s_end}')
+                                '&__box_%(box)s_%(memory)s_end},')
                 out.printf('};')
 
-                if not self._glz:
+                output.decls.append(BOX_WINDOW)
+                if self._prefetch and not self._glz:
+                    output.decls.append(BOX_LOADSTATE,
+                        prefetch_size=self._prefetch_size)
+                    if self._bdread_async_hook.link:
+                        output.decls.append(BOX_BDREAD_DONE)
+                        output.decls.append(BOX_LOADSTEP,
+                            read=BOX_LOADSTEP_READ_ASYNC,
+                            bdread_async=self._bdread_async_hook.link
+                                .export.alias,
+                            n=len(loadmemories))
+                    else:
+                        output.decls.append(BOX_LOADSTEP,
+                            read=BOX_LOADSTEP_READ,
+                            n=len(loadmemories))
+                    output.decls.append(BOX_LOAD_STEPS)
+                elif self._prefetch:
+                    output.decls.append(BOX_TABLE_WINDOW)
+                    output.decls.append(BOX_LOADSTATE_DECODE,
+                        prefetch_size=self._prefetch_size)
+                    output.decls.append(BOX_LOADSTEP_DECODE,
+                        n=len(loadmemories))
+                    output.decls.append(BOX_LOAD_STEPS)
+                elif not self._glz:
                     out = output.decls.append(BOX_LOAD_MULTI,
                         n=len(loadmemories))
                 else:
+                    output.decls.append(BOX_TABLE_WINDOW)
                     out = output.decls.append(BOX_LOAD_DECODE_MULTI,
                         n=len(loadmemories))
 
+            if self._page_size:
+                out = output.decls.append(n=len(pagedmemories))
+                out.printf('const struct __box_bd_pagedmemory '
+                    '__box_%(box)s_pagedmemories[%(n)d] = {')
+                with out.indent():
+                    page = 0
+                    for memory in pagedmemories:
+                        out.printf('{%(addr)#010x, %(size)#010x, %(page)d, '
+                            '%(prot)s},',
+                            addr=memory.addr,
+                            size=memory.size,
+                            page=page,
+                            prot=' | '.join(prot
+                                for mode, prot in [
+                                    ('r', '__BOX_BD_PROT_R'),
+                                    ('w', '__BOX_BD_PROT_W'),
+                                    ('x', '__BOX_BD_PROT_X')]
+                                if mode in memory.mode) or '0')
+                        page += memory.size // self._page_size
+                out.printf('};')
+
+                output.decls.append('%(fn)s;',
+                    fn=output.repr_fn(self._pageprotect_hook,
+                        name=self._pageprotect_hook.link.export.alias))
+                output.decls.append(BOX_PAGING,
+                    pageprotect=self._pageprotect_hook.link.export.alias,
+                    addr=self._region.addr,
+                    n=len(pagedmemories),
+                    page_size=self._page_size,
+                    pages=page,
+                    frames=min(self._pages or page, page),
+                    loadimage='__box_%s_loadimage()' % box.name
+                        if loadmemories else '0')
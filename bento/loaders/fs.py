@@ -40,25 +40,42 @@ BOX_GLZ_DECODE = """
 typedef uint32_t glz_size_t;
 typedef uint32_t glz_off_t;
 
+// read a single bit, only calling read when we cross into a new byte
+static inline int __box_glz_fsbit(
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, glz_off_t off, uint8_t *x, glz_off_t *xoff) {
+    if (off/8 != *xoff) {
+        int err = read(ctx, off/8, x, 1);
+        if (err) {
+            return err;
+        }
+        *xoff = off/8;
+    }
+    return 1 & (*x >> (7-off%%8));
+}
+
+// note the symbol table is read through its own ctx, this lets the
+// caller buffer table lookups separately from the bitstream
 int __box_glz_fsdecode(uint8_t k,
         int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
-        void *ctx,
+        void *ctx, void *table_ctx,
         glz_off_t off,
         uint8_t *output, glz_size_t size) {
     // glz "stack"
     glz_off_t poff = 0;
     glz_size_t psize = 0;
-    uint8_t x[2];
+    uint8_t x;
+    glz_off_t xoff = -1;
 
     while (size > 0) {
         // decode rice code
         uint_fast16_t rice = 0;
         while (true) {
-            int err = read(ctx, off/8, x, 1);
-            if (err) {
-                return err;
+            int bit = __box_glz_fsbit(read, ctx, off, &x, &xoff);
+            if (bit < 0) {
+                return bit;
             }
-            if (!(1 & (x[0] >> (7-off%%8)))) {
+            if (!bit) {
                 off += 1;
                 break;
             }
@@ -66,22 +83,23 @@ int __box_glz_fsdecode(uint8_t k,
             off += 1;
         }
         for (glz_off_t i = 0; i < k; i++) {
-            int err = read(ctx, off/8, x, 1);
-            if (err) {
-                return err;
+            int bit = __box_glz_fsbit(read, ctx, off, &x, &xoff);
+            if (bit < 0) {
+                return bit;
             }
-            rice = (rice << 1) | (1 & (x[0] >> (7-off%%8)));
+            rice = (rice << 1) | bit;
             off += 1;
         }
 
         // map through table
-        int err = read(ctx, (9*rice)/8, x, 2);
+        uint8_t y[2];
+        int err = read(table_ctx, (9*rice)/8, y, 2);
         if (err) {
             return err;
         }
         rice = 0x1ff & (
-            (x[0] << 8) |
-            (x[1] << 0)) >> (7-(9*rice)%%8);
+            (y[0] << 8) |
+            (y[1] << 0)) >> (7-(9*rice)%%8);
 
         // indirect reference or literal?
         if (rice < 0x100) {
@@ -93,11 +111,11 @@ int __box_glz_fsdecode(uint8_t k,
             while (true) {
                 glz_off_t n = 0;
                 for (glz_off_t i = 0; i < GLZ_M+1; i++) {
-                    int err = read(ctx, off/8, x, 1);
-                    if (err) {
-                        return err;
+                    int bit = __box_glz_fsbit(read, ctx, off, &x, &xoff);
+                    if (bit < 0) {
+                        return bit;
                     }
-                    n = (n << 1) | (1 & (x[0] >> (7-off%%8)));
+                    n = (n << 1) | bit;
                     off += 1;
                 }
 
@@ -132,6 +150,120 @@ int __box_glz_fsdecode(uint8_t k,
 }
 """
 
+# fast mode variant, blobs compressed with glz -m fast have no table and
+# only byte-aligned symbols, so literal runs are read straight into the
+# output
+BOX_GLZ_DECODE_FAST = """
+// GLZ constants
+typedef uint32_t glz_size_t;
+typedef uint32_t glz_off_t;
+
+// read a single byte
+static inline int __box_glz_fsbyte(
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, glz_off_t off) {
+    uint8_t x;
+    int err = read(ctx, off, &x, 1);
+    if (err) {
+        return err;
+    }
+    return x;
+}
+
+// fast mode has no table, so table_ctx is unused
+int __box_glz_fsdecode(uint8_t k,
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, void *table_ctx,
+        glz_off_t off,
+        uint8_t *output, glz_size_t size) {
+    (void)k;
+    (void)table_ctx;
+    // glz "stack"
+    glz_off_t poff = 0;
+    glz_size_t psize = 0;
+
+    // offsets are in bits, but every symbol is byte-aligned, left is
+    // the number of literals left in the current run
+    off /= 8;
+    glz_size_t left = 0;
+
+    while (size > 0) {
+        if (left) {
+            // read as much of the literal run as we need
+            glz_size_t n = left < size ? left : size;
+            int err = read(ctx, off, output, n);
+            if (err) {
+                return err;
+            }
+            output += n;
+            off += n;
+            left -= n;
+            size -= n;
+        } else {
+            // decode symbol
+            int x = __box_glz_fsbyte(read, ctx, off);
+            if (x < 0) {
+                return x;
+            }
+            off += 1;
+
+            // literal run or reference?
+            if (!(x & 0x80)) {
+                left = x + 1;
+            } else {
+                glz_size_t nsize = (x & 0x7f) + 2;
+                x = __box_glz_fsbyte(read, ctx, off);
+                if (x < 0) {
+                    return x;
+                }
+                glz_size_t nleft = x + 1;
+                off += 1;
+
+                glz_off_t noff = 0;
+                for (uint_fast8_t shift = 0;; shift += 7) {
+                    if (shift > 28) {
+                        return -EINVAL;
+                    }
+                    x = __box_glz_fsbyte(read, ctx, off);
+                    if (x < 0) {
+                        return x;
+                    }
+                    noff |= (glz_off_t)(x & 0x7f) << shift;
+                    off += 1;
+                    if (!(x & 0x80)) {
+                        break;
+                    }
+                }
+
+                // tail recurse?
+                if (nsize >= size) {
+                    off = off + noff;
+                    left = nleft;
+                } else {
+                    poff = off;
+                    psize = size - nsize;
+                    off = off + noff;
+                    left = nleft;
+                    size = nsize;
+                }
+            }
+        }
+
+        if (size == 0) {
+            // references only start between symbols, so we never return
+            // into a run
+            off = poff;
+            size = psize;
+            left = 0;
+            poff = 0;
+            psize = 0;
+        }
+    }
+
+    return 0;
+}
+"""
+
 BOX_LOAD = """
 int __box_%(box)s_load(void) {
     extern uint8_t __box_%(box)s_%(memory)s_start;
@@ -180,32 +312,89 @@ int __box_%(box)s_load(void) {
 }
 """
 
-BOX_LOAD_DECODE = """
-struct __box_%(box)s_seekread {
+BOX_WINDOW = """
+#define BOX_%(BOX)s_BUFFER_SIZE %(buffer_size)d
+
+// seek+read with read-ahead buffering and translation, hits/misses count
+// reads served from the buffer vs reads that needed the filesystem,
+// these are useful for sizing the buffers
+struct __box_%(box)s_window {
     int32_t fd;
     uint32_t off;
+    uint32_t buffer_off;
+    uint32_t buffer_valid;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t buffer_size;
+    uint8_t *buffer;
 };
 
-static int __box_%(box)s_seekread(void *ctx,
+static int __box_%(box)s_buffer_read(void *ctx,
         uint32_t addr, void *buffer, size_t size) {
-    struct __box_%(box)s_seekread *s = ctx;
-    addr += s->off;
-    ssize_t res = %(seek_alias)s(s->fd, addr, 0);
-    if (res < 0) {
-        return res;
-    }
+    struct __box_%(box)s_window *window = ctx;
+    addr += window->off;
+    uint32_t misses = window->misses;
 
-    res = %(read_alias)s(s->fd, buffer, size);
-    if (res < size) {
+    while (size > 0) {
+        if (addr >= window->buffer_off &&
+                addr < window->buffer_off + window->buffer_valid) {
+            size_t delta = __box_bd_min(
+                window->buffer_valid-(addr-window->buffer_off),
+                size);
+            memcpy(buffer,
+                    &window->buffer[addr - window->buffer_off],
+                    delta);
+            buffer = (uint8_t*)buffer + delta;
+            addr += delta;
+            size -= delta;
+            continue;
+        }
+
+        // load buffer, note this may be short at the end of the file
+        uint32_t noff = __box_bd_aligndown(addr, window->buffer_size);
+        ssize_t res = %(seek_alias)s(window->fd, noff, 0);
         if (res < 0) {
             return res;
         }
-        return -EINVAL;
+
+        res = %(read_alias)s(window->fd,
+                window->buffer,
+                window->buffer_size);
+        if (res < 0) {
+            return res;
+        }
+        if (noff + res <= addr) {
+            return -EINVAL;
+        }
+        window->buffer_off = noff;
+        window->buffer_valid = res;
+        window->misses += 1;
     }
 
+    if (window->misses == misses) {
+        window->hits += 1;
+    }
     return 0;
 }
 
+uint8_t __box_%(box)s_buffer[BOX_%(BOX)s_BUFFER_SIZE];
+struct __box_%(box)s_window __box_%(box)s_window = {
+    .buffer_size = BOX_%(BOX)s_BUFFER_SIZE,
+    .buffer = __box_%(box)s_buffer,
+};
+
+// the bitstream and symbol table get separate windows, otherwise
+// table lookups would evict the bitstream on every symbol
+#define BOX_%(BOX)s_TABLE_BUFFER_SIZE %(table_buffer_size)d
+
+uint8_t __box_%(box)s_table_buffer[BOX_%(BOX)s_TABLE_BUFFER_SIZE];
+struct __box_%(box)s_window __box_%(box)s_table_window = {
+    .buffer_size = BOX_%(BOX)s_TABLE_BUFFER_SIZE,
+    .buffer = __box_%(box)s_table_buffer,
+};
+"""
+
+BOX_LOAD_DECODE = """
 // add checks for input size
 int __box_%(box)s_load(void) {
     extern uint8_t __box_%(box)s_%(memory)s_start;
@@ -237,10 +426,19 @@ int __box_%(box)s_load(void) {
         return -ENOEXEC;
     }
 
+    // init buffers
+    __box_%(box)s_window.fd = fd;
+    __box_%(box)s_window.off = 8;
+    __box_%(box)s_window.buffer_valid = 0;
+    __box_%(box)s_table_window.fd = fd;
+    __box_%(box)s_table_window.off = 8;
+    __box_%(box)s_table_window.buffer_valid = 0;
+
     // decompress region
     err = __box_glz_fsdecode(k,
-            __box_%(box)s_seekread,
-            &(struct __box_%(box)s_seekread){fd, 8},
+            __box_%(box)s_buffer_read,
+            &__box_%(box)s_window,
+            &__box_%(box)s_table_window,
             off,
             &__box_%(box)s_%(memory)s_start,
             size);
@@ -329,31 +527,6 @@ int __box_%(box)s_load(void) {
 """
 
 BOX_LOAD_DECODE_MULTI = """
-struct __box_%(box)s_seekread {
-    int32_t fd;
-    uint32_t off;
-};
-
-static int __box_%(box)s_seekread(void *ctx,
-        uint32_t addr, void *buffer, size_t size) {
-    struct __box_%(box)s_seekread *s = ctx;
-    addr += s->off;
-    ssize_t res = %(seek_alias)s(s->fd, addr, 0);
-    if (res < 0) {
-        return res;
-    }
-
-    res = %(read_alias)s(s->fd, buffer, size);
-    if (res < size) {
-        if (res < 0) {
-            return res;
-        }
-        return -EINVAL;
-    }
-
-    return 0;
-}
-
 int __box_%(box)s_load(void) {
     // open file
     int32_t fd;
@@ -363,7 +536,7 @@ int __box_%(box)s_load(void) {
     }
 
     // load metadata
-    uint32_t x[2];
+    uint32_t x;
     ssize_t res = %(read_alias)s(fd, &x, sizeof(x));
     if (res < sizeof(x)) {
         if (res < 0) {
@@ -372,29 +545,37 @@ int __box_%(box)s_load(void) {
         return -ENOEXEC;
     }
 
-    uint8_t k = 0xf & (x[0] >> 24);
-    uint32_t off = 0x00ffffff & x[0];
-    uint32_t count = x[1];
+    uint8_t k = 0xf & (x >> 24);
+    uint32_t count = 0x00ffffff & x;
     if (count != %(n)d) {
         return -ENOEXEC;
     }
 
+    // init buffers
+    __box_%(box)s_window.fd = fd;
+    __box_%(box)s_window.off = (1+2*%(n)d)*sizeof(uint32_t);
+    __box_%(box)s_window.buffer_valid = 0;
+    __box_%(box)s_table_window.fd = fd;
+    __box_%(box)s_table_window.off = (1+2*%(n)d)*sizeof(uint32_t);
+    __box_%(box)s_table_window.buffer_valid = 0;
+
     for (uint32_t i = 0; i < %(n)d; i++) {
         // load metadata again
-        res = %(seek_alias)s(fd, (1+i)*2*sizeof(uint32_t), 0);
+        uint32_t y[2];
+        res = %(seek_alias)s(fd, (1+2*i)*sizeof(uint32_t), 0);
         if (res < 0) {
             return res;
         }
-        res = %(read_alias)s(fd, x, sizeof(x));
-        if (res < sizeof(x)) {
+        res = %(read_alias)s(fd, y, sizeof(y));
+        if (res < sizeof(y)) {
             if (res < 0) {
                 return res;
             }
             return -ENOEXEC;
         }
 
-        uint32_t off = x[0];
-        uint32_t size = x[1];
+        uint32_t off = y[0];
+        uint32_t size = y[1];
         if (size > __box_%(box)s_loadregions[i][1]
                 - __box_%(box)s_loadregions[i][0]) {
             // can't allow overwrites now can we
@@ -403,9 +584,9 @@ int __box_%(box)s_load(void) {
 
         // decompress region
         err = __box_glz_fsdecode(k,
-                __box_%(box)s_seekread,
-                &(struct __box_%(box)s_seekread){fd,
-                    (1+%(n)d)*2*sizeof(uint32_t)},
+                __box_%(box)s_buffer_read,
+                &__box_%(box)s_window,
+                &__box_%(box)s_table_window,
                 off,
                 __box_%(box)s_loadregions[i][0],
                 size);
@@ -442,15 +623,30 @@ class FSLoader(loaders.Loader):
                 'decompressing the box when loaded. By default no compression '
                 'is used.')
         parser.add_argument('--glz_flags', type=list,
-            help='Add custom GLZ flags.')
-
-    def __init__(self, path=None, glz=None, glz_flags=None):
+            help='Add custom GLZ flags. Passing -m fast selects the fast '
+                'GLZ mode, which compresses worse but decompresses faster, '
+                'and replaces the decoder with a matching one. The mode '
+                'must be the same for all boxes in the parent.')
+        parser.add_argument('--buffer_size', type=int,
+            help='Buffer size to use for reading from the filesystem when '
+                'decompressing. The GLZ bitstream and symbol table each get '
+                'a read-ahead buffer of this size. Defaults to 16.')
+        parser.add_argument('--table_buffer_size', type=int,
+            help='Buffer size to use for GLZ symbol table lookups. The '
+                'table is at most 576 bytes, so a buffer this large avoids '
+                'repeated reads. Defaults to buffer_size.')
+
+    def __init__(self, path=None, glz=None, glz_flags=None,
+            buffer_size=None, table_buffer_size=None):
         super().__init__()
         self._path = path
         assert self._path is not None, ("No path specified? "
             "Need --loader.fs.path=<path>.")
+        self._buffer_size = buffer_size or 16
+        self._table_buffer_size = table_buffer_size or self._buffer_size
         self._glz = glz
         self._glz_flags = glz_flags or []
+        self._mode = loaders.glzmode(self._glz_flags)
 
     def constraints(self, constraints):
         constraints['mode'].discard('p')
@@ -535,8 +731,8 @@ class FSLoader(loaders.Loader):
                 # all implicit sections. Needed to get rid of program
                 # segments which create warnings later.
                 out.writef(' \\\n-I binary')
-                out.writef(' \\\n-O elf32-littlearm')
-                out.writef(' \\\n-B arm')
+                out.writef(' \\\n-O %(bfd_target)s')
+                out.writef(' \\\n-B %(bfd_arch)s')
                 out.writef(' \\\n--strip-all')
                 out.writef(' \\\n--remove-section=*')
                 out.printf(')')
@@ -546,9 +742,14 @@ class FSLoader(loaders.Loader):
 
         output.decls.append(BOX_COMMON)
 
-        if any(child.loader._glz
-                for child in parent.boxes
-                if child.loader == self):
+        modes = {child.loader._mode
+            for child in parent.boxes
+            if child.loader == self and child.loader._glz}
+        assert len(modes) <= 1, ("boxes in %s mix GLZ modes %s, but share "
+            "a decoder" % (parent.name, ', '.join(sorted(modes))))
+        if modes == {'fast'}:
+            output.decls.append(BOX_GLZ_DECODE_FAST)
+        elif modes:
             output.decls.append(BOX_GLZ_DECODE)
 
     def build_parent_c(self, output, parent, box):
@@ -574,7 +775,9 @@ class FSLoader(loaders.Loader):
                 open_alias=self._open_hook.link.export.alias,
                 close_alias=self._close_hook.link.export.alias,
                 read_alias=self._read_hook.link.export.alias,
-                seek_alias=self._seek_hook.link.export.alias):
+                seek_alias=self._seek_hook.link.export.alias,
+                buffer_size=self._buffer_size,
+                table_buffer_size=self._table_buffer_size):
 
             if len(loadmemories) == 1:
                 # if we only have one memory region (common), we can use
@@ -583,6 +786,7 @@ class FSLoader(loaders.Loader):
                     output.decls.append(BOX_LOAD,
                         memory=loadmemories[0][0])
                 else:
+                    output.decls.append(BOX_WINDOW)
                     output.decls.append(BOX_LOAD_DECODE,
                         memory=loadmemories[0][0])
             else:
@@ -601,13 +805,14 @@ class FSLoader(loaders.Loader):
                         with out.pushattrs(memory=memory):
                             out.printf('{'
                                 '&__box_%(box)s_%(memory)s_start, '
-                                '&__box_%(box)s_%(memory)s_end}')
+                                '&__box_%(box)s_%(memory)s_end},')
                 out.printf('};')
 
                 if not self._glz:
                     out = output.decls.append(BOX_LOAD_MULTI,
                         n=len(loadmemories))
                 else:
+                    output.decls.append(BOX_WINDOW)
                     out = output.decls.append(BOX_LOAD_DECODE_MULTI,
                         n=len(loadmemories))
 
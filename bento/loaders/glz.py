@@ -7,6 +7,7 @@
 # SPDX-License-Identifier: BSD-3-Clause
 #
 
+import os
 from .. import loaders
 from ..box import Section
 
@@ -19,46 +20,80 @@ BOX_GLZ_DECODE = """
 typedef uint32_t glz_size_t;
 typedef uint32_t glz_off_t;
 
-int __box_glz_decode(uint8_t k,
+// dictionary shared by multiple blobs, the bits of a blob compressed
+// against a dictionary continue into the dictionary's bits, and the
+// blob uses the dictionary's table
+struct __box_glz_dict {
+    const uint8_t *table;
+    glz_size_t table_size;
+    const uint8_t *blob;
+    glz_size_t blob_size;
+};
+
+// read the bit at off, or -1 if off is past the end of the blob
+static inline int __box_glz_bit(const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off) {
+    if (off/8 >= blob_size) {
+        if (!dict || off/8 - blob_size >= dict->blob_size) {
+            return -1;
+        }
+        blob = dict->blob;
+        off -= 8*blob_size;
+    }
+    return 1 & (blob[off/8] >> (7-off%%8));
+}
+
+// decompress size bytes at off, after skipping skip bytes
+int __box_glz_decode(uint8_t k, const struct __box_glz_dict *dict,
         const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
-        uint8_t *output, glz_size_t size) {
+        glz_size_t skip, uint8_t *output, glz_size_t size) {
     // glz "stack"
     glz_off_t poff = 0;
     glz_size_t psize = 0;
+    size += skip;
+
+    // the table is in the dictionary if we have one
+    const uint8_t *table = dict ? dict->table : blob;
+    glz_size_t table_size = dict ? dict->table_size : blob_size;
 
     while (size > 0) {
         // decode rice code
         uint_fast16_t rice = 0;
         while (true) {
-            if (off/8 >= blob_size) {
+            int bit = __box_glz_bit(dict, blob, blob_size, off);
+            if (bit < 0) {
                 return -EINVAL;
             }
-            if (!(1 & (blob[off/8] >> (7-off%%8)))) {
-                off += 1;
+            off += 1;
+            if (!bit) {
                 break;
             }
             rice += 1;
-            off += 1;
         }
         for (glz_off_t i = 0; i < k; i++) {
-            if (off/8 >= blob_size) {
+            int bit = __box_glz_bit(dict, blob, blob_size, off);
+            if (bit < 0) {
                 return -EINVAL;
             }
-            rice = (rice << 1) | (1 & (blob[off/8] >> (7-off%%8)));
+            rice = (rice << 1) | bit;
             off += 1;
         }
 
         // map through table
-        if ((9*rice)/8+1 >= blob_size) {
+        if ((9*rice)/8+1 >= table_size) {
             return -EINVAL;
         }
         rice = 0x1ff & (
-            (blob[(9*rice)/8+0] << 8) |
-            (blob[(9*rice)/8+1] << 0)) >> (7-(9*rice)%%8);
+            (table[(9*rice)/8+0] << 8) |
+            (table[(9*rice)/8+1] << 0)) >> (7-(9*rice)%%8);
 
         // indirect reference or literal?
         if (rice < 0x100) {
-            *output++ = rice;
+            if (skip) {
+                skip -= 1;
+            } else {
+                *output++ = rice;
+            }
             size -= 1;
         } else {
             glz_size_t nsize = (rice & 0xff) + 2;
@@ -66,10 +101,11 @@ int __box_glz_decode(uint8_t k,
             while (true) {
                 glz_off_t n = 0;
                 for (glz_off_t i = 0; i < GLZ_M+1; i++) {
-                    if (off/8 >= blob_size) {
+                    int bit = __box_glz_bit(dict, blob, blob_size, off);
+                    if (bit < 0) {
                         return -EINVAL;
                     }
-                    n = (n << 1) | (1 & (blob[off/8] >> (7-off%%8)));
+                    n = (n << 1) | bit;
                     off += 1;
                 }
 
@@ -80,8 +116,12 @@ int __box_glz_decode(uint8_t k,
             }
             noff -= 1;
 
+            // skip whole references without decompressing them, or
             // tail recurse?
-            if (nsize >= size) {
+            if (nsize <= skip && nsize < size) {
+                skip -= nsize;
+                size -= nsize;
+            } else if (nsize >= size) {
                 off = off + noff;
                 size = size;
             } else {
@@ -104,6 +144,328 @@ int __box_glz_decode(uint8_t k,
 }
 """
 
+# word-at-a-time variant, this keeps a 32-bit bit buffer so the rice
+# prefix can be counted with clz and fixed-width fields are a single
+# shift+mask, bounds are only checked when the buffer is refilled
+BOX_GLZ_DECODE_WORD = """
+// GLZ constants
+#ifndef GLZ_M
+#define GLZ_M 4
+#endif
+typedef uint32_t glz_size_t;
+typedef uint32_t glz_off_t;
+
+// dictionary shared by multiple blobs, the bits of a blob compressed
+// against a dictionary continue into the dictionary's bits, and the
+// blob uses the dictionary's table
+struct __box_glz_dict {
+    const uint8_t *table;
+    glz_size_t table_size;
+    const uint8_t *blob;
+    glz_size_t blob_size;
+};
+
+// load the next bits in the blob into the msbs of a word, this returns
+// the number of valid bits, which is only < 25 near the end of the blob
+static inline uint32_t __box_glz_refill(const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
+        uint_fast8_t *avail) {
+    glz_size_t i = off/8;
+    if (dict && i >= blob_size) {
+        // past the end of the blob, continue into the dictionary
+        i -= blob_size;
+        blob = dict->blob;
+        blob_size = dict->blob_size;
+        dict = NULL;
+    }
+
+    uint32_t buf;
+    if (i+4 <= blob_size) {
+        buf = ((uint32_t)blob[i+0] << 24) |
+              ((uint32_t)blob[i+1] << 16) |
+              ((uint32_t)blob[i+2] <<  8) |
+              ((uint32_t)blob[i+3] <<  0);
+        *avail = 32 - off%%8;
+    } else if (i < blob_size) {
+        buf = 0;
+        *avail = 0;
+        for (glz_size_t j = 0; j < 4; j++) {
+            uint8_t byte = 0;
+            if (i+j < blob_size) {
+                byte = blob[i+j];
+                *avail += 8;
+            } else if (dict && i+j-blob_size < dict->blob_size) {
+                byte = dict->blob[i+j-blob_size];
+                *avail += 8;
+            }
+            buf = (buf << 8) | byte;
+        }
+        *avail -= off%%8;
+    } else {
+        buf = 0;
+        *avail = 0;
+    }
+    return buf << (off%%8);
+}
+
+// decompress size bytes at off, after skipping skip bytes
+int __box_glz_decode(uint8_t k, const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
+        glz_size_t skip, uint8_t *output, glz_size_t size) {
+    // glz "stack"
+    glz_off_t poff = 0;
+    glz_size_t psize = 0;
+    size += skip;
+
+    // the table is in the dictionary if we have one
+    const uint8_t *table = dict ? dict->table : blob;
+    glz_size_t table_size = dict ? dict->table_size : blob_size;
+
+    // bit buffer, the next bit is always the msb
+    uint_fast8_t avail;
+    uint32_t buf = __box_glz_refill(dict, blob, blob_size, off, &avail);
+
+    while (size > 0) {
+        // decode rice code, counting the unary prefix with clz
+        uint_fast16_t rice = 0;
+        while (true) {
+            uint_fast8_t ones = ~buf ? __builtin_clz(~buf) : 32;
+            if (ones < avail) {
+                rice += ones;
+                off += ones+1;
+                buf = (buf << ones) << 1;
+                avail -= ones+1;
+                break;
+            }
+
+            // prefix runs past our buffer
+            rice += avail;
+            off += avail;
+            buf = __box_glz_refill(dict, blob, blob_size, off, &avail);
+            if (!avail) {
+                return -EINVAL;
+            }
+        }
+        if (avail < k) {
+            buf = __box_glz_refill(dict, blob, blob_size, off, &avail);
+            if (avail < k) {
+                return -EINVAL;
+            }
+        }
+        if (k) {
+            rice = (rice << k) | (buf >> (32-k));
+            off += k;
+            buf <<= k;
+            avail -= k;
+        }
+
+        // map through table
+        if ((9*rice)/8+1 >= table_size) {
+            return -EINVAL;
+        }
+        rice = 0x1ff & (
+            (table[(9*rice)/8+0] << 8) |
+            (table[(9*rice)/8+1] << 0)) >> (7-(9*rice)%%8);
+
+        // indirect reference or literal?
+        if (rice < 0x100) {
+            if (skip) {
+                skip -= 1;
+            } else {
+                *output++ = rice;
+            }
+            size -= 1;
+        } else {
+            glz_size_t nsize = (rice & 0xff) + 2;
+            glz_off_t noff = 0;
+            while (true) {
+                if (avail < GLZ_M+1) {
+                    buf = __box_glz_refill(dict, blob, blob_size, off, &avail);
+                    if (avail < GLZ_M+1) {
+                        return -EINVAL;
+                    }
+                }
+                glz_off_t n = buf >> (32-(GLZ_M+1));
+                off += GLZ_M+1;
+                buf <<= GLZ_M+1;
+                avail -= GLZ_M+1;
+
+                noff = (noff << GLZ_M) + 1 + (n & ((1 << GLZ_M)-1));
+                if (n < (1 << GLZ_M)) {
+                    break;
+                }
+            }
+            noff -= 1;
+
+            // skip whole references without decompressing them, or
+            // tail recurse?
+            if (nsize <= skip && nsize < size) {
+                skip -= nsize;
+                size -= nsize;
+            } else {
+                if (nsize >= size) {
+                    off = off + noff;
+                    size = size;
+                } else {
+                    poff = off;
+                    psize = size - nsize;
+                    off = off + noff;
+                    size = nsize;
+                }
+                buf = __box_glz_refill(dict, blob, blob_size, off, &avail);
+            }
+        }
+
+        if (size == 0) {
+            off = poff;
+            size = psize;
+            poff = 0;
+            psize = 0;
+            buf = __box_glz_refill(dict, blob, blob_size, off, &avail);
+        }
+    }
+
+    return 0;
+}
+"""
+
+# fast mode variant, blobs compressed with glz -m fast have no table and
+# only byte-aligned symbols, so literal runs can be copied with memcpy
+BOX_GLZ_DECODE_FAST = """
+// GLZ constants
+typedef uint32_t glz_size_t;
+typedef uint32_t glz_off_t;
+
+// dictionary shared by multiple blobs, the bytes of a blob compressed
+// against a dictionary continue into the dictionary's bytes, fast mode
+// doesn't use the table
+struct __box_glz_dict {
+    const uint8_t *table;
+    glz_size_t table_size;
+    const uint8_t *blob;
+    glz_size_t blob_size;
+};
+
+// find n bytes at byte i, or NULL if they are past the end of the blob
+static inline const uint8_t *__box_glz_bytes(
+        const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size,
+        glz_off_t i, glz_size_t n) {
+    if (i >= blob_size) {
+        if (!dict) {
+            return NULL;
+        }
+        i -= blob_size;
+        blob = dict->blob;
+        blob_size = dict->blob_size;
+    }
+    if (i >= blob_size || n > blob_size - i) {
+        return NULL;
+    }
+    return &blob[i];
+}
+
+// decompress size bytes at off, after skipping skip bytes
+int __box_glz_decode(uint8_t k, const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
+        glz_size_t skip, uint8_t *output, glz_size_t size) {
+    (void)k;
+    // glz "stack"
+    glz_off_t poff = 0;
+    glz_size_t psize = 0;
+    size += skip;
+
+    // offsets are in bits, but every symbol is byte-aligned, left is
+    // the number of literals left in the current run
+    off /= 8;
+    glz_size_t left = 0;
+
+    while (size > 0) {
+        if (left) {
+            // copy as much of the literal run as we need
+            glz_size_t n = left < size ? left : size;
+            const uint8_t *lits = __box_glz_bytes(
+                    dict, blob, blob_size, off, n);
+            if (!lits) {
+                return -EINVAL;
+            }
+            if (skip >= n) {
+                skip -= n;
+            } else {
+                memcpy(output, &lits[skip], n-skip);
+                output += n-skip;
+                skip = 0;
+            }
+            off += n;
+            left -= n;
+            size -= n;
+        } else {
+            // decode symbol
+            const uint8_t *p = __box_glz_bytes(
+                    dict, blob, blob_size, off, 1);
+            if (!p) {
+                return -EINVAL;
+            }
+            off += 1;
+
+            // literal run or reference?
+            if (!(*p & 0x80)) {
+                left = *p + 1;
+            } else {
+                glz_size_t nsize = (*p & 0x7f) + 2;
+                p = __box_glz_bytes(dict, blob, blob_size, off, 1);
+                if (!p) {
+                    return -EINVAL;
+                }
+                glz_size_t nleft = *p + 1;
+                off += 1;
+
+                glz_off_t noff = 0;
+                for (uint_fast8_t shift = 0;; shift += 7) {
+                    p = __box_glz_bytes(dict, blob, blob_size, off, 1);
+                    if (!p || shift > 28) {
+                        return -EINVAL;
+                    }
+                    noff |= (glz_off_t)(*p & 0x7f) << shift;
+                    off += 1;
+                    if (!(*p & 0x80)) {
+                        break;
+                    }
+                }
+
+                // skip whole references without decompressing them, or
+                // tail recurse?
+                if (nsize <= skip && nsize < size) {
+                    skip -= nsize;
+                    size -= nsize;
+                } else if (nsize >= size) {
+                    off = off + noff;
+                    left = nleft;
+                } else {
+                    poff = off;
+                    psize = size - nsize;
+                    off = off + noff;
+                    left = nleft;
+                    size = nsize;
+                }
+            }
+        }
+
+        if (size == 0) {
+            // references only start between symbols, so we never return
+            // into a run
+            off = poff;
+            size = psize;
+            left = 0;
+            poff = 0;
+            psize = 0;
+        }
+    }
+
+    return 0;
+}
+"""
+
 BOX_DECODE = """
 int __box_%(box)s_load(void) {
     extern const uint32_t __box_%(box)s_blob_start[];
@@ -123,11 +485,11 @@ int __box_%(box)s_load(void) {
     }
 
     // decompress
-    return __box_glz_decode(k,
+    return __box_glz_decode(k, NULL,
             (const uint8_t*)&__box_%(box)s_blob_start[2],
             &__box_%(box)s_blob_end
                 - (const uint8_t*)&__box_%(box)s_blob_start[2],
-            off,
+            off, 0,
             &__box_%(box)s_%(memory)s_start, 
             size);
 }
@@ -157,11 +519,134 @@ int __box_%(box)s_load(void) {
         }
 
         // decompress region
-        int err = __box_glz_decode(k,
+        int err = __box_glz_decode(k, NULL,
                 (const uint8_t*)&__box_%(box)s_blob_start[1+2*%(n)d],
                 &__box_%(box)s_blob_end
                     - (const uint8_t*)&__box_%(box)s_blob_start[1+2*%(n)d],
-                off,
+                off, 0,
+                __box_%(box)s_loadregions[i][0],
+                size);
+        if (err) {
+            return err;
+        }
+    }
+
+    return 0;
+}
+"""
+
+# the shared dictionary is linked into the parent as is, so it may only
+# be byte-aligned
+BOX_GLZ_DICT = """
+extern const uint8_t __box_glzdict_start[];
+extern const uint8_t __box_glzdict_end[];
+
+static int __box_glzdict(struct __box_glz_dict *dict) {
+    // load metadata, the dictionary's bits start on the byte after
+    // its table
+    const uint8_t *meta = __box_glzdict_start;
+    glz_size_t size = __box_glzdict_end - __box_glzdict_start;
+    if (size < 8) {
+        return -ENOEXEC;
+    }
+    uint32_t x = ((uint32_t)meta[0] <<  0) |
+                 ((uint32_t)meta[1] <<  8) |
+                 ((uint32_t)meta[2] << 16) |
+                 ((uint32_t)meta[3] << 24);
+    glz_size_t table_size = ((0x00ffffff & x) + 8-1) / 8;
+    if (8 + table_size > size) {
+        return -ENOEXEC;
+    }
+
+    dict->table = &__box_glzdict_start[8];
+    dict->table_size = table_size;
+    dict->blob = &__box_glzdict_start[8 + table_size];
+    dict->blob_size = size - (8 + table_size);
+    return 0;
+}
+"""
+
+# compressed against the shared dictionary, we need to know exactly
+# where our blob ends since this is where the dictionary's bits start
+BOX_DECODE_DICT = """
+int __box_%(box)s_load(void) {
+    extern const uint32_t __box_%(box)s_blob_start[];
+    extern const uint8_t __box_%(box)s_blob_end;
+    extern uint8_t __box_%(box)s_%(memory)s_start;
+    extern uint8_t __box_%(box)s_%(memory)s_end;
+
+    // load metadata
+    uint32_t x = __box_%(box)s_blob_start[0];
+    uint8_t k = 0xf & (x >> 24);
+    uint32_t off = 0x00ffffff & x;
+    uint32_t size = __box_%(box)s_blob_start[1];
+    if (size > &__box_%(box)s_%(memory)s_end
+            - &__box_%(box)s_%(memory)s_start) {
+        // can't allow overwrites now can we
+        return -ENOEXEC;
+    }
+
+    uint32_t blob_size = __box_%(box)s_blob_start[2];
+    if (blob_size > &__box_%(box)s_blob_end
+            - (const uint8_t*)&__box_%(box)s_blob_start[3]) {
+        return -ENOEXEC;
+    }
+
+    struct __box_glz_dict dict;
+    int err = __box_glzdict(&dict);
+    if (err) {
+        return err;
+    }
+
+    // decompress
+    return __box_glz_decode(k, &dict,
+            (const uint8_t*)&__box_%(box)s_blob_start[3],
+            blob_size,
+            off, 0,
+            &__box_%(box)s_%(memory)s_start, 
+            size);
+}
+"""
+
+BOX_DECODE_MULTI_DICT = """
+int __box_%(box)s_load(void) {
+    extern const uint32_t __box_%(box)s_blob_start[];
+    extern const uint8_t __box_%(box)s_blob_end;
+
+    // load metadata
+    uint32_t x = __box_%(box)s_blob_start[0];
+    uint8_t k = 0xf & (x >> 24);
+    uint32_t count = 0x00ffffff & x;
+    if (count != %(n)d) {
+        return -ENOEXEC;
+    }
+
+    uint32_t blob_size = __box_%(box)s_blob_start[1+2*%(n)d];
+    if (blob_size > &__box_%(box)s_blob_end
+            - (const uint8_t*)&__box_%(box)s_blob_start[2+2*%(n)d]) {
+        return -ENOEXEC;
+    }
+
+    struct __box_glz_dict dict;
+    int err = __box_glzdict(&dict);
+    if (err) {
+        return err;
+    }
+
+    for (uint32_t i = 0; i < %(n)d; i++) {
+        uint32_t off = __box_%(box)s_blob_start[1+2*i+0];
+        uint32_t size = __box_%(box)s_blob_start[1+2*i+1];
+        if (size > __box_%(box)s_loadregions[i][1]
+                - __box_%(box)s_loadregions[i][0]) {
+            // can't allow overwrites now can we
+            return -ENOEXEC;
+        }
+
+        // decompress region
+        err = __box_glz_decode(k, &dict,
+                (const uint8_t*)&__box_%(box)s_blob_start[2+2*%(n)d],
+                blob_size,
+                off, 0,
                 __box_%(box)s_loadregions[i][0],
                 size);
         if (err) {
@@ -173,6 +658,130 @@ int __box_%(box)s_load(void) {
 }
 """
 
+# with read-only assets, the blob is compressed with a checkpoint every
+# interval bytes so the assets can be decompressed a slice at a time,
+# the checkpoints follow the other metadata
+BOX_GLZ_SEEK = """
+struct __box_glz_seekable {
+    uint8_t k;
+    const uint32_t *index;
+    glz_size_t interval;
+    const uint32_t *checkpoints;
+    const struct __box_glz_dict *dict;
+    struct __box_glz_dict dictdata;
+    const uint8_t *blob;
+    glz_size_t blob_size;
+};
+
+static int __box_glz_seekable(struct __box_glz_seekable *s,
+        const uint32_t *start, const uint8_t *end,
+        uint32_t count, bool dict) {
+    // load metadata
+    const uint32_t *meta = start;
+    uint32_t x = *meta++;
+    s->k = 0xf & (x >> 24);
+    if ((0x00ffffff & x) != count) {
+        return -ENOEXEC;
+    }
+    s->index = meta;
+    meta += 2*count;
+
+    glz_size_t blob_size = 0;
+    if (dict) {
+        blob_size = *meta++;
+    }
+
+    s->interval = *meta++;
+    uint32_t checkpoints = *meta++;
+    s->checkpoints = meta;
+    meta += checkpoints;
+    if (s->interval == 0 || (const uint8_t*)meta > end) {
+        return -ENOEXEC;
+    }
+
+    s->dict = NULL;
+    s->blob = (const uint8_t*)meta;
+    s->blob_size = end - (const uint8_t*)meta;
+    if (dict) {
+        if (blob_size > s->blob_size) {
+            return -ENOEXEC;
+        }
+        s->blob_size = blob_size;
+    }
+
+    return 0;
+}
+
+// decompress size bytes at off in the i'th input, starting at the
+// closest checkpoint
+static int __box_glz_seekread(const struct __box_glz_seekable *s,
+        uint32_t i, glz_size_t off, uint8_t *output, glz_size_t size) {
+    glz_size_t len = s->index[2*i+1];
+    if (off > len || size > len - off) {
+        return -EINVAL;
+    }
+    if (size == 0) {
+        return 0;
+    }
+
+    // each input has a checkpoint for every interval after the first
+    const uint32_t *checkpoints = s->checkpoints;
+    for (uint32_t j = 0; j < i; j++) {
+        glz_size_t len = s->index[2*j+1];
+        checkpoints += len ? (len-1) / s->interval : 0;
+    }
+
+    glz_size_t c = off / s->interval;
+    return __box_glz_decode(s->k, s->dict, s->blob, s->blob_size,
+            c ? checkpoints[c-1] : s->index[2*i+0],
+            off %% s->interval,
+            output, size);
+}
+"""
+
+BOX_DECODE_SEEK = """
+int __box_%(box)s_load(void) {
+    struct __box_glz_seekable s;
+    int err = __box_%(box)s_seekable(&s);
+    if (err) {
+        return err;
+    }
+
+    for (uint32_t i = 0; i < %(n)d; i++) {
+        uint32_t size = s.index[2*i+1];
+        if (size > __box_%(box)s_loadregions[i][1]
+                - __box_%(box)s_loadregions[i][0]) {
+            // can't allow overwrites now can we
+            return -ENOEXEC;
+        }
+
+        // decompress region
+        err = __box_glz_seekread(&s, i, 0,
+                __box_%(box)s_loadregions[i][0],
+                size);
+        if (err) {
+            return err;
+        }
+    }
+
+    return 0;
+}
+"""
+
+# the assets are the last input
+BOX_READ_COMPRESSED = """
+int __box_%(box)s_read_compressed(uint32_t off,
+        uint8_t *buffer, size_t size) {
+    struct __box_glz_seekable s;
+    int err = __box_%(box)s_seekable(&s);
+    if (err) {
+        return err;
+    }
+
+    return __box_glz_seekread(&s, %(n)d, off, buffer, size);
+}
+"""
+
 @loaders.loader
 class GLZLoader(loaders.Loader):
     """
@@ -188,13 +797,44 @@ class GLZLoader(loaders.Loader):
         parser.add_argument('--glz',
             help='Override the GLZ path for the makefile.')
         parser.add_argument('--glz_flags', type=list,
-            help='Add custom GLZ flags.')
+            help='Add custom GLZ flags. Passing -m fast selects the fast '
+                'GLZ mode, which compresses worse but decompresses faster, '
+                'and replaces the decoder with a matching one. The mode '
+                'must be the same for all boxes in the parent.')
+        parser.add_argument('--decoder', choices=['bit', 'word'],
+            help='Select the GLZ decoder. The bit decoder is the smallest, '
+                'while the word decoder reads the blob a word at a time '
+                'for faster loading at a small code cost. The decoder is '
+                'shared by all boxes in the parent. Can be one of the '
+                'following: {%(choices)s}. Defaults to bit.')
+        parser.add_argument('--dict', type=bool,
+            help='Compress against a dictionary shared by all boxes in the '
+                'parent that enable this. The dictionary is trained from the '
+                'images of these boxes and stored once in the parent, which '
+                'pays off when the boxes share code or data. Defaults to '
+                'false.')
+        parser.add_argument('--assets', type=bool,
+            help='Keep read-only assets compressed in the blob instead of '
+                'loading them with the box. Assets are placed in the .assets '
+                'section, and read with __box_<box>_read_compressed, using '
+                'the asset\'s address as the offset. Defaults to false.')
+        parser.add_argument('--seek', type=int,
+            help='Interval in bytes between the checkpoints of the blob, '
+                'reading assets only needs to decompress from the closest '
+                'checkpoint. Smaller intervals read faster but compress '
+                'worse. Defaults to 256.')
 
-    def __init__(self, blob=None, glz=None, glz_flags=None):
+    def __init__(self, blob=None, glz=None, glz_flags=None, decoder=None,
+            dict=None, assets=None, seek=None):
         super().__init__()
         self._blob = Section('blob', **blob.__dict__)
         self._glz = glz or 'glz'
         self._glz_flags = glz_flags or []
+        self._mode = loaders.glzmode(self._glz_flags)
+        self._decoder = decoder or 'bit'
+        self._dict = dict or False
+        self._assets = assets or False
+        self._seek = seek or 256
 
     def constraints(self, constraints):
         if 'c' in constraints['mode']:
@@ -212,6 +852,16 @@ class GLZLoader(loaders.Loader):
         box.addexport('__box_data_init', 'fn() -> void',
             scope=box.name, source=self.__argname__, weak=True)
 
+        if self._assets:
+            self._read_compressed_hook = box.addimport(
+                '__box_%s_read_compressed' % box.name,
+                'fn(u32 off, mut u8[size] buffer, usize size) -> err',
+                scope=box.getparent().name, source=self.__argname__,
+                doc="Read size bytes at off from the box's compressed "
+                    "assets. Assets are placed in the .assets section, "
+                    "which starts at address 0, so an asset's address is "
+                    "its offset.")
+
     def build_ld(self, output, box):
         if not output.no_sections:
             out = output.sections.append(
@@ -226,6 +876,19 @@ class GLZLoader(loaders.Loader):
             out.printf('. = ALIGN(%(align)d);')
             out.printf('__blob_end = .;')
 
+            if self._assets:
+                # assets are never loaded, so they don't need to be in
+                # a memory, they just need to keep their offsets
+                out = output.sections.append(
+                    section='.assets',
+                    memory=None)
+                out.printf('%(section)s 0 (INFO) : {')
+                with out.pushindent():
+                    out.printf('__assets_start = .;')
+                    out.printf('KEEP(*(.assets*))')
+                    out.printf('__assets_end = .;')
+                out.printf('}')
+
         super().build_ld(output, box)
 
     def build_parent_ld(self, output, sys, box):
@@ -250,11 +913,22 @@ class GLZLoader(loaders.Loader):
         out = output.decls.append()
         out.printf('override GLZFLAGS += -q')
         out.printf('override GLZFLAGS += -n')
+        if self._assets:
+            out.printf('override GLZFLAGS += --seek %(seek)d',
+                seek=self._seek)
         if self._glz_flags:
             out.printf('# user provided')
         for flag in self._glz_flags:
             out.printf('override GLZFLAGS += %s' % flag)
 
+        if self._dict:
+            out = output.decls.append()
+            out.printf('%(name)-16s ?= %(path)s',
+                name='GLZDICT',
+                path=os.path.join(
+                    os.path.relpath(box.getparent().path, box.path),
+                    'glzdict.glz'))
+
     def build_mk(self, output, box):
         super().build_mk(output, box)
 
@@ -282,8 +956,8 @@ class GLZLoader(loaders.Loader):
                 # all implicit sections. Needed to get rid of program
                 # segments which create warnings later.
                 out.writef(' \\\n-I binary')
-                out.writef(' \\\n-O elf32-littlearm')
-                out.writef(' \\\n-B arm')
+                out.writef(' \\\n-O %(bfd_target)s')
+                out.writef(' \\\n-B %(bfd_arch)s')
                 out.writef(' \\\n--strip-all')
                 out.writef(' \\\n--remove-section=*')
                 with out.pushattrs(
@@ -299,14 +973,41 @@ class GLZLoader(loaders.Loader):
                         'contents,alloc,load,readonly,data')
                 out.printf(')')
 
-        out.printf('%%.box.glz: %(memory_boxes)s',
-            memory_boxes=' '.join(
-                '%.box.'+name for name, _, _ in loadmemories))
-        with out.indent():
-            if len(loadmemories) == 1:
-                out.printf('$(GLZ) encode $(GLZFLAGS) $^ -o $@')
-            else:
-                out.printf('$(GLZ) encode -I $(GLZFLAGS) $^ -o $@')
+        # assets are compressed after the loadable memory regions
+        images = ['%.box.'+name for name, _, _ in loadmemories]
+        if self._assets:
+            images.append('%.box.assets')
+
+        if self._dict:
+            # the shared dictionary is built by our parent
+            out.printf('%%.box.glz: %(images)s $(GLZDICT)',
+                images=' '.join(images))
+            with out.indent():
+                out.printf('$(strip $(GLZ) encode %(index)s$(GLZFLAGS) '
+                    '--dict $(GLZDICT) \\\n'
+                    '    $(filter-out $(GLZDICT),$^) -o $@)',
+                    index='-I ' if len(images) > 1 else '')
+        else:
+            out.printf('%%.box.glz: %(images)s',
+                images=' '.join(images))
+            with out.indent():
+                if len(images) == 1:
+                    out.printf('$(GLZ) encode $(GLZFLAGS) $^ -o $@')
+                else:
+                    out.printf('$(GLZ) encode -I $(GLZFLAGS) $^ -o $@')
+
+        if self._assets:
+            out = output.rules.append()
+            out.printf('%%.box.assets: %%.elf')
+            with out.indent():
+                out.writef('$(strip $(OBJCOPY) $< $@')
+                with out.indent():
+                    # assets aren't allocated, so objcopy needs some
+                    # convincing to output them
+                    out.writef(' \\\n--only-section .assets')
+                    out.writef(' \\\n--set-section-flags '
+                        '.assets=contents,alloc,load,readonly,data')
+                    out.printf(' \\\n-O binary)\n')
 
         for name, _, sections in loadmemories:
             out = output.rules.append()
@@ -324,14 +1025,147 @@ class GLZLoader(loaders.Loader):
         self._load_plug = parent.addexport(
             '__box_%s_load' % box.name, 'fn() -> err',
             scope=parent.name, source=self.__argname__, weak=True)
+        if self._assets:
+            self._read_compressed_plug = parent.addexport(
+                '__box_%s_read_compressed' % box.name,
+                'fn(u32 off, mut u8[size] buffer, usize size) -> err',
+                scope=box.name, source=self.__argname__)
+
+    def build_parent_mk(self, output, parent, box):
+        super().build_parent_mk(output, parent, box)
+
+        if 'ld' not in parent.outputs:
+            # without a linker script we need to provide the blob's
+            # symbols explicitly
+            out = output.decls.append(memory=self._blob.memory.name)
+            out.printf('override LDFLAGS += '
+                '-Wl,--defsym=__box_%(box)s_blob_start='
+                '__box_%(box)s_%(memory)s_start')
+            out.printf('override LDFLAGS += '
+                '-Wl,--defsym=__box_%(box)s_blob_end='
+                '__box_%(box)s_%(memory)s_end')
+
+        if not self._dict:
+            return
+
+        # the shared dictionary is trained from the images of all boxes
+        # that use it, which means we need to build these images before
+        # we can finish building any of the boxes
+        dictboxes = [child for child in parent.boxes
+            if child.loader.__argname__ == self.__argname__
+                and child.loader._dict]
+        if box == dictboxes[0]:
+            glz = self._glz
+            if os.path.dirname(glz) and not os.path.isabs(glz):
+                glz = os.path.relpath(os.path.join(box.path, glz),
+                    parent.path)
+
+            out = output.decls.append(doc='shared GLZ dictionary')
+            out.printf('%(name)-16s ?= %(path)s', name='GLZ', path=glz)
+            out.printf('override GLZDICTFLAGS += -q')
+            out.printf('override GLZDICTFLAGS += -n')
+            if self._glz_flags:
+                out.printf('# user provided')
+            for flag in self._glz_flags:
+                out.printf('override GLZDICTFLAGS += %s' % flag)
+            out.printf('override LDFLAGS += glzdict.o')
+
+            out = output.rules.append(
+                doc="the shared dictionary is linked into our rodata")
+            out.printf('$(TARGET): glzdict.o')
+            out.printf('glzdict.o: glzdict.glz')
+            with out.indent():
+                out.writef('$(strip $(OBJCOPY) $< $@')
+                with out.indent():
+                    out.writef(' \\\n-I binary')
+                    out.writef(' \\\n-O %(bfd_target)s')
+                    out.writef(' \\\n-B %(bfd_arch)s')
+                    out.writef(' \\\n--rename-section .data=.rodata.glzdict,'
+                        'contents,alloc,load,readonly,data')
+                    out.writef(' \\\n--redefine-sym '
+                        '_binary_glzdict_glz_start=__box_glzdict_start')
+                    out.writef(' \\\n--redefine-sym '
+                        '_binary_glzdict_glz_end=__box_glzdict_end')
+                    out.writef(' \\\n--strip-symbol '
+                        '_binary_glzdict_glz_size')
+                    out.printf(')')
+            out.printf('glzdict.glz: $(GLZDICTIMAGES)')
+            with out.indent():
+                out.printf('$(GLZ) dict $(GLZDICTFLAGS) $^ -o $@')
+
+            out = output.rules.append(phony=True)
+            out.printf('clean-glzdict:')
+            with out.indent():
+                out.printf('rm -f glzdict.glz glzdict.o')
+            out.printf('clean: clean-glzdict')
+
+        path = os.path.relpath(box.path, parent.path)
+        images = []
+        for memory in box.memoryslices:
+            if 'w' in memory.mode:
+                images.append('%s.box.%s' % (box.name, memory.name))
+
+        out = output.decls.append(path=path)
+        for image in images:
+            out.printf('GLZDICTIMAGES += %(path)s/%(image)s', image=image)
+
+        # the box depends on the dictionary, the dictionary depends on
+        # the box's images
+        out = output.rules.append(path=path)
+        out.printf('%(path)s/%(box)s.box: glzdict.glz')
+        for image in images:
+            with out.pushattrs(image=image):
+                out.printf('.PHONY: $(shell '
+                    'make -s -C %(path)s %(image)s -q || '
+                    'echo %(path)s/%(image)s)')
+                out.printf('%(path)s/%(image)s:')
+                with out.indent():
+                    out.printf('$(MAKE) --no-print-directory -C %(path)s '
+                        '%(image)s')
+
+    def build_h(self, output, box):
+        super().build_h(output, box)
+        if self._assets:
+            output.decls.append('%(fn)s;',
+                fn=output.repr_fn(self._read_compressed_hook),
+                doc=self._read_compressed_hook.doc)
+
+    def build_parent_h(self, output, parent, box):
+        super().build_parent_h(output, parent, box)
+        if self._assets:
+            output.decls.append('%(fn)s;',
+                fn=output.repr_fn(self._read_compressed_plug),
+                doc="Read size bytes at off from box %(box)s's compressed "
+                    "assets.")
 
     def build_parent_c_prologue(self, output, parent):
         super().build_parent_c_prologue(output, parent)
-        output.decls.append(BOX_GLZ_DECODE)
+        modes = {child.loader._mode for child in parent.boxes
+            if child.loader.__argname__ == self.__argname__}
+        assert len(modes) == 1, ("boxes in %s mix GLZ modes %s, but share "
+            "a decoder" % (parent.name, ', '.join(sorted(modes))))
+        if self._mode == 'fast':
+            output.decls.append(BOX_GLZ_DECODE_FAST)
+        elif self._decoder == 'word':
+            output.decls.append(BOX_GLZ_DECODE_WORD)
+        else:
+            output.decls.append(BOX_GLZ_DECODE)
+
+        if any(child.loader.__argname__ == self.__argname__
+                and child.loader._dict
+                for child in parent.boxes):
+            output.decls.append('//// shared GLZ dictionary ////')
+            output.decls.append(BOX_GLZ_DICT)
+
+        if any(child.loader.__argname__ == self.__argname__
+                and child.loader._assets
+                for child in parent.boxes):
+            output.decls.append('//// seekable GLZ blobs ////')
+            output.decls.append(BOX_GLZ_SEEK)
 
     def build_parent_c(self, output, parent, box):
         super().build_parent_c(output, parent, box)
-        if not self._load_plug.links:
+        if not self._load_plug.links and not self._assets:
             # if someone else provides load we can just skip this
             return
 
@@ -348,10 +1182,44 @@ class GLZLoader(loaders.Loader):
 
         output.decls.append('//// %(box)s loading ////')
 
-        if len(loadmemories) == 1:
+        if self._assets:
+            # assets are the last input in the blob, and need to find
+            # the closest checkpoint
+            out = output.decls.append(
+                count=len(loadmemories)+1,
+                dict='true' if self._dict else 'false')
+            out.printf('static int __box_%(box)s_seekable('
+                'struct __box_glz_seekable *s) {')
+            with out.indent():
+                out.printf('extern const uint32_t '
+                    '__box_%(box)s_blob_start[];')
+                out.printf('extern const uint8_t __box_%(box)s_blob_end;')
+                out.printf('int err = __box_glz_seekable(s,')
+                out.printf('        __box_%(box)s_blob_start, '
+                    '&__box_%(box)s_blob_end,')
+                out.printf('        %(count)d, %(dict)s);')
+                if self._dict:
+                    out.printf('if (err) {')
+                    with out.indent():
+                        out.printf('return err;')
+                    out.printf('}')
+                    out.printf()
+                    out.printf('s->dict = &s->dictdata;')
+                    out.printf('return __box_glzdict(&s->dictdata);')
+                else:
+                    out.printf('return err;')
+            out.printf('}')
+
+            output.decls.append(BOX_READ_COMPRESSED, n=len(loadmemories))
+            if not self._load_plug.links:
+                return
+
+        if len(loadmemories) == 1 and not self._assets:
             # if we only have one memory region (common), we can use
             # slightly less metadata
-            output.decls.append(BOX_DECODE, memory=loadmemories[0][0])
+            output.decls.append(
+                BOX_DECODE_DICT if self._dict else BOX_DECODE,
+                memory=loadmemories[0][0])
         else:
             # otherwise, dynamically generate a loader that can handle
             # all the memory regions
@@ -368,8 +1236,14 @@ class GLZLoader(loaders.Loader):
                     with out.pushattrs(memory=memory):
                         out.printf('{'
                             '&__box_%(box)s_%(memory)s_start, '
-                            '&__box_%(box)s_%(memory)s_end}')
+                            '&__box_%(box)s_%(memory)s_end},')
             out.printf('};')
 
-            out = output.decls.append(BOX_DECODE_MULTI, n=len(loadmemories))
-
+            if self._assets:
+                out = output.decls.append(BOX_DECODE_SEEK,
+                    n=len(loadmemories))
+            else:
+                out = output.decls.append(
+                    BOX_DECODE_MULTI_DICT if self._dict
+                        else BOX_DECODE_MULTI,
+                    n=len(loadmemories))
@@ -57,8 +57,8 @@ class NoOpLoader(loaders.Loader):
                 # all implicit sections. Needed to get rid of program
                 # segments which create warnings later.
                 out.writef(' \\\n-I binary')
-                out.writef(' \\\n-O elf32-littlearm')
-                out.writef(' \\\n-B arm')
+                out.writef(' \\\n-O %(bfd_target)s')
+                out.writef(' \\\n-B %(bfd_arch)s')
                 out.writef(' \\\n--strip-all')
                 out.writef(' \\\n--remove-section=*')
                 for i, (name, memory, _) in enumerate(loadmemories):
@@ -0,0 +1,248 @@
+#
+# Execute-in-place loader for memory-mapped flash
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+from .. import loaders
+from ..box import Section
+
+BOX_XIP_COMMON = """
+#define __BOX_XIP_MAGIC 0x70697862
+
+struct __box_xip_header {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t hash;
+};
+
+__attribute__((unused))
+static inline uint32_t __box_xip_cksumbyte(uint32_t crc, uint8_t byte) {
+    crc ^= (uint32_t)byte << 24;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+    }
+    return crc;
+}
+
+// same CRC as POSIX cksum, so images can be hashed with standard tools
+__attribute__((unused))
+static uint32_t __box_xip_cksum(const uint8_t *buffer, uint32_t size) {
+    uint32_t crc = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        crc = __box_xip_cksumbyte(crc, buffer[i]);
+    }
+
+    // cksum also hashes the size, least significant byte first
+    for (uint32_t n = size; n; n >>= 8) {
+        crc = __box_xip_cksumbyte(crc, n & 0xff);
+    }
+
+    return ~crc;
+}
+"""
+
+@loaders.loader
+class XIPLoader(loaders.Loader):
+    """
+    A loader that executes boxes in place from memory-mapped flash, such
+    as external QSPI flash. Only the box's data and bss are copied into
+    RAM.
+    """
+    __argname__ = "xip"
+    __arghelp__ = __doc__
+    @classmethod
+    def __argparse__(cls, parser, **kwargs):
+        parser.add_argument('--memory',
+            help='Name of the memory in the parent that maps the external '
+                'flash. Memories in the box that are not writable are '
+                'allocated here. By default the parent picks the best '
+                'fitting memory.')
+        parser.add_argument('--hash', type=bool,
+            help='Verify the hash in the image\'s header before running '
+                'the box. The hash is a CRC compatible with POSIX cksum, '
+                'filled in by the makefile after linking. Defaults to '
+                'only checking the header\'s magic and size.')
+
+    def __init__(self, memory=None, hash=None):
+        super().__init__()
+        self._memory = memory
+        self._hash = hash or False
+
+    def parentmemory(self, memory):
+        if 'w' not in memory.mode:
+            return self._memory
+        else:
+            return None
+
+    def box_parent(self, parent, box):
+        super().box_parent(parent, box)
+        if self._memory:
+            xipmemory = next(
+                (memory for memory in parent.memories
+                    if memory.name == self._memory),
+                None)
+            assert xipmemory is not None, (
+                "Box `%s` executes in place from memory `%s`, but there "
+                "is no memory `%s` in `%s`?" % (
+                box.name, self._memory, self._memory, parent.name))
+            for memory in box.memories:
+                if 'w' not in memory.mode:
+                    assert memory in xipmemory, (
+                        "Memory %s in box %s is not in the xip memory %s" % (
+                        memory.name, box.name, self._memory))
+
+        self._load_plug = parent.addexport(
+            '__box_%s_load' % box.name, 'fn() -> err',
+            scope=parent.name, source=self.__argname__, weak=True)
+
+    def box(self, box):
+        super().box(box)
+        # the header goes at the end of the text's memory, so the start
+        # of the memory stays where runtimes expect their jumptables
+        self._image = next(memory for memory in box.memoryslices
+            if memory.name == box.text.memory.name)
+        self._header = Section('xipheader', size=12,
+            memory=self._image.name)
+        self._header.alloc(box, 'rxp', reverse=True)
+
+    def build_ld(self, output, box):
+        super().build_ld(output, box)
+
+        if not output.no_sections:
+            out = output.sections.append(
+                section='.xipheader',
+                memory=self._header.memory.name,
+                addr=self._header.memory.addr)
+            out.printf('__xipheader = %(addr)#010x;')
+            out.printf('%(section)s __xipheader : {')
+            with out.pushindent():
+                out.printf('LONG(0x70697862)')
+                out.printf('LONG(__data_init_end - ORIGIN(%(MEMORY)s))')
+                out.printf('LONG(0) /* hash, filled in after linking */')
+            out.printf('} > %(MEMORY)s')
+            out.printf()
+            out.printf('ASSERT(__data_init_end <= __xipheader,')
+            out.printf('    "Not enough memory in %(MEMORY)s '
+                'for xip header")')
+
+    def build_mk(self, output, box):
+        # create boxing rule, to be invoked if embedding an elf is needed
+        data_init = None
+        if any(section.name == 'data'
+                for memory in box.memoryslices
+                for section in memory.sections):
+            data_init = box.consume('rp', 0)
+
+        loadmemories = []
+        for memory in box.memoryslices:
+            if 'p' in memory.mode:
+                loadmemories.append((memory.name, memory,
+                    [section.name for section in memory.sections]))
+
+        out = output.rules.append(
+            doc="a .box is a .elf containing a single section for "
+                "each loadable memory region")
+        out.printf('%%.box: %%.elf %(memory_boxes)s',
+            memory_boxes=' '.join(
+                '%.box.'+name for name, _, _ in loadmemories))
+        with out.indent():
+            out.writef('$(strip $(OBJCOPY) $< $@')
+            with out.indent():
+                # objcopy won't let us create an empty elf, but we can
+                # fake it by treating the input as binary and striping
+                # all implicit sections. Needed to get rid of program
+                # segments which create warnings later.
+                out.writef(' \\\n-I binary')
+                out.writef(' \\\n-O %(bfd_target)s')
+                out.writef(' \\\n-B %(bfd_arch)s')
+                out.writef(' \\\n--strip-all')
+                out.writef(' \\\n--remove-section=*')
+                for i, (name, memory, _) in enumerate(loadmemories):
+                    with out.pushattrs(
+                            memory=name,
+                            addr=memory.addr,
+                            n=2+i):
+                        out.writef(' \\\n--add-section '
+                            '.box.%(box)s.%(memory)s=$(word %(n)d,$^)')
+                        out.writef(' \\\n--change-section-address '
+                            '.box.%(box)s.%(memory)s=%(addr)#.8x')
+                        out.writef(' \\\n--set-section-flags '
+                            '.box.%(box)s.%(memory)s='
+                            'contents,alloc,load,readonly,data')
+                out.printf(')')
+
+        for name, memory, sections in loadmemories:
+            out = output.rules.append()
+            out.printf('%%.box.%(memory)s: %%.elf', memory=name)
+            with out.indent():
+                out.writef('$(strip $(OBJCOPY) $< $@')
+                with out.indent():
+                    for section in sections:
+                        out.writef(' \\\n--only-section .%(section)s',
+                            section=section)
+                        # workaround to get the data_init section in the
+                        # right place
+                        if section == 'text' and data_init is not None:
+                            out.writef(' \\\n--only-section .data')
+                    out.printf(' \\\n-O binary)')
+
+                if name == self._header.memory.name:
+                    # hash the image with cksum and patch the hash into
+                    # the header, little-endian
+                    off = self._header.memory.addr - memory.addr
+                    with out.pushattrs(size_off=off+4, hash_off=off+8):
+                        out.printf('size=$$(od -An -tu4 -j %(size_off)d '
+                            '-N4 $@) && \\')
+                        out.printf('hash=$$(head -c $$size $@ '
+                            '| cksum | cut -d" " -f1) && \\')
+                        out.printf('printf "$$(printf \'\\\\%%03o\' '
+                            '$$((hash & 0xff)) '
+                            '$$((hash >> 8 & 0xff)) \\')
+                        out.printf('    $$((hash >> 16 & 0xff)) '
+                            '$$((hash >> 24 & 0xff)))" \\')
+                        out.printf('    | dd of=$@ bs=1 seek=%(hash_off)d '
+                            'conv=notrunc 2>/dev/null')
+                out.printf()
+
+        super().build_mk(output, box)
+
+    def build_parent_c_prologue(self, output, parent):
+        super().build_parent_c_prologue(output, parent)
+        output.decls.append(BOX_XIP_COMMON)
+
+    def build_parent_c(self, output, parent, box):
+        super().build_parent_c(output, parent, box)
+        if not self._load_plug.links:
+            # if someone else provides load we can just skip this
+            return
+
+        output.decls.append('//// %(box)s loading ////')
+        out = output.decls.append(
+            header=self._header.memory.addr,
+            addr=self._image.addr,
+            size=self._header.memory.addr - self._image.addr)
+        out.printf("static int __box_%(box)s_load(void) {")
+        with out.indent():
+            out.printf('// nothing to copy, but make sure the image is '
+                'intact before')
+            out.printf('// executing it in place')
+            out.printf('const struct __box_xip_header *header =')
+            out.printf('        (const struct __box_xip_header*)'
+                '%(header)#010x;')
+            out.printf('if (header->magic != __BOX_XIP_MAGIC ||')
+            out.printf('        header->size > %(size)#x) {')
+            with out.indent():
+                out.printf('return -ENOEXEC;')
+            out.printf('}')
+            if self._hash:
+                out.printf()
+                out.printf('if (__box_xip_cksum((const uint8_t*)%(addr)#010x, '
+                    'header->size)')
+                out.printf('        != header->hash) {')
+                with out.indent():
+                    out.printf('return -EILSEQ;')
+                out.printf('}')
+            out.printf()
+            out.printf('return 0;')
+        out.printf('}')
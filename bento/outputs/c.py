@@ -128,6 +128,79 @@ class HOutput(outputs.Output):
                 self.decls.append(
                     'void __box_%(box)s_pop(size_t size);',
                     doc='Deallocate size bytes on the box\'s data stack.')
+                if subbox.runtime.prefetches(subbox):
+                    self.decls.append(
+                        'int __box_%(box)s_prefetch(void);',
+                        doc='Start loading box %(box)s in the background. '
+                            'Clobbers any boxes sharing its memory.')
+                    self.decls.append(
+                        'int __box_%(box)s_load_poll(void);',
+                        doc='Make progress on loading box %(box)s in the '
+                            'background. Returns -EAGAIN until the box is '
+                            'loaded, call when idle or when a read '
+                            'completes. Init finishes any remaining work.')
+                if any(export.isqueued() for export in subbox.exports):
+                    self.decls.append(
+                        'int __box_%(box)s_drain(void);',
+                        doc='Run any queued calls waiting in box %(box)s. '
+                            'Queued calls also run before the next normal '
+                            'call into the box.')
+
+        # queued exports are run by __box_drain
+        if any(export.isqueued() for export in box.exports):
+            self.decls.append('//// queue hooks ////')
+            self.decls.append('int __box_drain(void);',
+                doc='Run any queued calls waiting in our queue.')
+
+        # shared memory, either ours or given to us
+        shared = box.shared + box.sharedmemories
+        if shared:
+            self.decls.append('//// shared memory ////')
+        for region in shared:
+            with self.pushattrs(
+                    shared=region.name,
+                    SHARED=region.name.upper()):
+                out = self.decls.append(
+                    doc='Shared memory %(shared)s, split into %(count)d '
+                        'buffers of %(size)d bytes. Each buffer is owned by '
+                        'at most one box at a time.',
+                    count=region.buffers,
+                    size=region.buffersize())
+                out.printf('#define __BOX_SHARED_%(SHARED)s_COUNT %(count)d')
+                out.printf('#define __BOX_SHARED_%(SHARED)s_SIZE %(size)d')
+                out.printf('#define __BOX_SHARED_%(SHARED)s_FREE %(free)d',
+                    free=region.FREE)
+                for owner in region.owners():
+                    out.printf('#define __BOX_SHARED_%(SHARED)s_%(OWNER)s '
+                        '%(i)d',
+                        OWNER=owner.upper(),
+                        i=region.ownerof(owner))
+                self.decls.append(
+                    'int __box_shared_%(shared)s_alloc(void);',
+                    doc='Allocate a free buffer in %(shared)s, returning a '
+                        'handle owned by the caller, or a negative error '
+                        'code if no buffers are free.')
+                self.decls.append(
+                    'void *__box_shared_%(shared)s_buffer(int handle);',
+                    doc='Get the address of a buffer in %(shared)s. Returns '
+                        'NULL if the buffer is not owned by the caller.')
+                self.decls.append(
+                    'int __box_shared_%(shared)s_give(int handle, '
+                    'int owner);',
+                    doc='Transfer ownership of a buffer in %(shared)s to '
+                        'another box, one of __BOX_SHARED_%(SHARED)s_<BOX>. '
+                        'The caller must own the buffer.')
+                self.decls.append(
+                    'int __box_shared_%(shared)s_free(int handle);',
+                    doc='Release a buffer in %(shared)s. The caller must '
+                        'own the buffer.')
+                if region.owner == box.name:
+                    self.decls.append(
+                        'int __box_shared_%(shared)s_reclaim(int owner);',
+                        doc='Release all buffers in %(shared)s owned by a '
+                            'box, useful if the box aborts while owning '
+                            'buffers. Returns the number of buffers '
+                            'released.')
 
     def getvalue(self):
         self.seek(0)
@@ -178,11 +251,160 @@ class COutput(HOutput):
                 'If this isn\'t wanted, --printf=std provides the printf found '
                 'in the stdlib. Can be one of the following: {%(choices)s}. '
                 'Defaults to minimal.')
+        parser.add_argument('--write_buffer', type=int,
+            help='Size of an optional output buffer in bytes, placed in '
+                'the box\'s RAM. When provided, the minimal printf collects '
+                'output here and only calls __box_write on newline, when '
+                'the buffer is full, on fflush, or before the box aborts. '
+                'Writes from the stdlib go through the same buffer. '
+                'Defaults to unbuffered.')
+        parser.add_argument('--profile', type=bool,
+            help='Count calls to and from child boxes, and the cycles spent '
+                'in them, in a table of counters in the box\'s RAM. Uses '
+                'the DWT cycle counter, or clock_gettime on the host. '
+                '__box_profile_dump writes out the counters, which bento '
+                'profile can turn into a report.')
 
-    def __init__(self, path, no_stdlib_hooks=None, printf=None):
+    def __init__(self, path, no_stdlib_hooks=None, printf=None,
+            write_buffer=None, profile=None):
         super().__init__(path)
         self.no_stdlib_hooks = no_stdlib_hooks or False
         self.printf_impl = printf if printf is not None else 'minimal'
+        self.write_buffer = write_buffer or 0
+        self.profile = profile or False
+
+    def box(self, box):
+        super().box(box)
+        # with buffered output, the stdlib hooks abort through a wrapper
+        # that flushes the buffer first, see write_glue
+        self.pushattrs(abort='__box_buffered_abort'
+            if self.printf_impl == 'minimal' and self.write_buffer else
+            '__box_abort')
+
+    def build(self, box):
+        # ownership of shared buffers is tracked in a table at the start
+        # of the shared memory, so passing buffers doesn't need a box call
+        for region in box.shared + box.sharedmemories:
+            with self.pushattrs(
+                    shared=region.name,
+                    SHARED=region.name.upper(),
+                    owners=region.addr,
+                    buffers=region.bufferaddr(),
+                    selfowner=region.ownerof(box),
+                    last=len(region.owners())):
+                self.decls.append('//// %(shared)s shared memory ////')
+                out = self.decls.append()
+                out.printf('#define __BOX_SHARED_%(SHARED)s_OWNERS '
+                    '((uint8_t*)%(owners)#010x)')
+                out.printf('#define __BOX_SHARED_%(SHARED)s_BUFFERS '
+                    '((uint8_t*)%(buffers)#010x)')
+                out.printf('#define __BOX_SHARED_%(SHARED)s_SELF '
+                    '%(selfowner)d')
+
+                out = self.decls.append()
+                out.printf('int __box_shared_%(shared)s_alloc(void) {')
+                with out.indent():
+                    out.printf('for (int i = 0; '
+                        'i < __BOX_SHARED_%(SHARED)s_COUNT; i++) {')
+                    with out.indent():
+                        out.printf('uint8_t free = '
+                            '__BOX_SHARED_%(SHARED)s_FREE;')
+                        out.printf('if (__atomic_compare_exchange_n(')
+                        out.printf('        '
+                            '&__BOX_SHARED_%(SHARED)s_OWNERS[i], &free,')
+                        out.printf('        '
+                            '__BOX_SHARED_%(SHARED)s_SELF, false,')
+                        out.printf('        '
+                            '__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {')
+                        with out.indent():
+                            out.printf('return i;')
+                        out.printf('}')
+                    out.printf('}')
+                    out.printf()
+                    out.printf('return -ENOMEM;')
+                out.printf('}')
+
+                out = self.decls.append()
+                out.printf('void *__box_shared_%(shared)s_buffer('
+                    'int handle) {')
+                with out.indent():
+                    out.printf('if (handle < 0 || '
+                        'handle >= __BOX_SHARED_%(SHARED)s_COUNT ||')
+                    out.printf('        __atomic_load_n('
+                        '&__BOX_SHARED_%(SHARED)s_OWNERS[handle],')
+                    out.printf('            __ATOMIC_ACQUIRE) '
+                        '!= __BOX_SHARED_%(SHARED)s_SELF) {')
+                    with out.indent():
+                        out.printf('return NULL;')
+                    out.printf('}')
+                    out.printf()
+                    out.printf('return __BOX_SHARED_%(SHARED)s_BUFFERS '
+                        '+ handle*__BOX_SHARED_%(SHARED)s_SIZE;')
+                out.printf('}')
+
+                for name, args, owner, check in [
+                        ('give', 'int handle, int owner', 'owner',
+                            'owner <= __BOX_SHARED_%(SHARED)s_FREE || '
+                            'owner > %(last)d'),
+                        ('free', 'int handle',
+                            '__BOX_SHARED_%(SHARED)s_FREE', None)]:
+                    out = self.decls.append(
+                        name=name, args=args, owner=owner)
+                    out.printf('int __box_shared_%(shared)s_%(name)s('
+                        '%(args)s) {')
+                    with out.indent():
+                        out.printf('if (handle < 0 || '
+                            'handle >= __BOX_SHARED_%(SHARED)s_COUNT) {')
+                        with out.indent():
+                            out.printf('return -EBADF;')
+                        out.printf('}')
+                        if check:
+                            out.printf('if (%(check)s) {', check=check)
+                            with out.indent():
+                                out.printf('return -EINVAL;')
+                            out.printf('}')
+                        out.printf()
+                        out.printf('uint8_t self = '
+                            '__BOX_SHARED_%(SHARED)s_SELF;')
+                        out.printf('if (!__atomic_compare_exchange_n(')
+                        out.printf('        '
+                            '&__BOX_SHARED_%(SHARED)s_OWNERS[handle], '
+                            '&self,')
+                        out.printf('        %(owner)s, false,')
+                        out.printf('        '
+                            '__ATOMIC_RELEASE, __ATOMIC_RELAXED)) {')
+                        with out.indent():
+                            out.printf('return -EACCES;')
+                        out.printf('}')
+                        out.printf()
+                        out.printf('return 0;')
+                    out.printf('}')
+
+                if region.owner == box.name:
+                    out = self.decls.append()
+                    out.printf('int __box_shared_%(shared)s_reclaim('
+                        'int owner) {')
+                    with out.indent():
+                        out.printf('int count = 0;')
+                        out.printf('for (int i = 0; '
+                            'i < __BOX_SHARED_%(SHARED)s_COUNT; i++) {')
+                        with out.indent():
+                            out.printf('uint8_t owner_ = owner;')
+                            out.printf('if (__atomic_compare_exchange_n(')
+                            out.printf('        '
+                                '&__BOX_SHARED_%(SHARED)s_OWNERS[i], '
+                                '&owner_,')
+                            out.printf('        '
+                                '__BOX_SHARED_%(SHARED)s_FREE, false,')
+                            out.printf('        '
+                                '__ATOMIC_RELEASE, __ATOMIC_RELAXED)) {')
+                            with out.indent():
+                                out.printf('count += 1;')
+                            out.printf('}')
+                        out.printf('}')
+                        out.printf()
+                        out.printf('return count;')
+                    out.printf('}')
 
     def getvalue(self):
         self.seek(0)
@@ -199,9 +199,12 @@ class LdOutput(outputs.Output):
         out.printf()
         out.printf('__data_init_end = '
             'LOADADDR(%(section)s) + SIZEOF(%(section)s);')
-        out.printf('ASSERT(__data_init_end <= '
-            'ORIGIN(%(INITMEMORY)s) + LENGTH(%(INITMEMORY)s),')
-        out.printf('    "Not enough memory in %(INITMEMORY)s for data init")')
+        # data is loaded in place if someone else takes care of init
+        if not box.runtime.data_init_hook.link:
+            out.printf('ASSERT(__data_init_end <= '
+                'ORIGIN(%(INITMEMORY)s) + LENGTH(%(INITMEMORY)s),')
+            out.printf('    "Not enough memory in %(INITMEMORY)s '
+                'for data init")')
 
         out = self.sections.append(
             section='.bss',
@@ -273,14 +276,14 @@ class LdOutput(outputs.Output):
             sections = self.sections
             i = 0
             for memory in sorted(self.memories, key=lambda m: m['addr']):
-                if any(section['memory'] == memory['memory']
+                if any(section.get('memory') == memory['memory']
                         for section in sections):
                     with self.pushattrs(indent=4, memory=memory['memory']):
                         self.printf('/* %(MEMORY)s sections */')
                         self.printf('. = ORIGIN(%(MEMORY)s);')
                 nsections = []
                 for section in sections:
-                    if section['memory'] == memory['memory']:
+                    if section.get('memory') == memory['memory']:
                         if 'doc' in section:
                             for line in textwrap.wrap(
                                     section['doc'], width=78-10):
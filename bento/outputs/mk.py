@@ -25,14 +25,24 @@ FPUS = co.defaultdict(
 
 ISAS = co.defaultdict(
     lambda: 'thumb',
+    **{
+        'host': '',
+    }
 )
 
+# note the host uses the native toolchain, without a triple
 GCC_TRIPLES = co.defaultdict(
-    lambda: 'arm-none-eabi'
+    lambda: 'arm-none-eabi',
+    **{
+        'host': '',
+    }
 )
 
 LLVM_TRIPLES = co.defaultdict(
-    lambda: 'thumbv7em-v7m-none-gnueabi'
+    lambda: 'thumbv7em-v7m-none-gnueabi',
+    **{
+        'host': 'x86_64-unknown-linux-gnu',
+    }
 )
 
 WAMRC_TRIPLES = co.defaultdict(
@@ -43,10 +53,27 @@ RUST_TRIPLES = co.defaultdict(
     lambda: 'thumbv7em-none-eabi',
     **{
         'cortex-m33': 'thumbv8m.main-none-eabi',
+        'host': 'x86_64-unknown-linux-gnu',
         'wasm': 'wasm32-unknown-unknown',
     }
 )
 
+# objcopy's names for the object format/architecture, needed when
+# wrapping raw images in elfs
+BFD_TARGETS = co.defaultdict(
+    lambda: 'elf32-littlearm',
+    **{
+        'host': 'elf64-x86-64',
+    }
+)
+
+BFD_ARCHS = co.defaultdict(
+    lambda: 'arm',
+    **{
+        'host': 'i386:x86-64',
+    }
+)
+
 @outputs.output
 class MkOutput(outputs.Output):
     """
@@ -98,7 +125,9 @@ class MkOutput(outputs.Output):
             help='Override the baud rate (115200) for the makefile.')
 
         parser.add_argument('--cpu',
-            help='CPU to provide to build system. Defaults to cortex-m4.')
+            help='CPU to provide to build system. Defaults to cortex-m4. '
+                'The special CPU "host" targets the native toolchain, '
+                'for use with the host runtimes.')
         parser.add_argument('--fpu',
             help='FPU to provide to build system. Default based on CPU.')
         parser.add_argument('--isa',
@@ -250,12 +279,12 @@ class MkOutput(outputs.Output):
         self._defines = co.OrderedDict(sorted(
             (k, getattr(v, 'define', v)) for k, v in define.items()))
 
-        self._cc = cc or '%(gcc_triple)s-gcc'
-        self._objcopy = objcopy or '%(gcc_triple)s-objcopy'
-        self._objdump = objdump or '%(gcc_triple)s-objdump'
-        self._ar = ar or '%(gcc_triple)s-ar'
-        self._size = size or '%(gcc_triple)s-size'
-        self._gdb = gdb or '%(gcc_triple)s-gdb'
+        self._cc = cc or '%(gcc_prefix)sgcc'
+        self._objcopy = objcopy or '%(gcc_prefix)sobjcopy'
+        self._objdump = objdump or '%(gcc_prefix)sobjdump'
+        self._ar = ar or '%(gcc_prefix)sar'
+        self._size = size or '%(gcc_prefix)ssize'
+        self._gdb = gdb or '%(gcc_prefix)sgdb'
         self._gdb_addr = gdb_addr or 'localhost'
         self._gdb_port = gdb_port or 3333
         self._tty = tty or '$(firstword $(wildcard /dev/ttyACM* /dev/ttyUSB*))'
@@ -267,7 +296,11 @@ class MkOutput(outputs.Output):
 
         self._srcs = srcs if srcs is not None else ['.']
         self._incs = incs if incs is not None else self._srcs
-        self._libs = libs if libs is not None else ['m', 'c', 'gcc', 'nosys']
+        self._libs = (libs
+            if libs is not None else
+            []
+            if self._cpu == 'host' else
+            ['m', 'c', 'gcc', 'nosys'])
 
         self._c_flags = c_flags if c_flags is not None else []
         self._asm_flags = asm_flags if asm_flags is not None else []
@@ -391,6 +424,11 @@ class MkOutput(outputs.Output):
             fpu=self._fpu,
             isa=self._isa,
             gcc_triple=GCC_TRIPLES[self._cpu],
+            gcc_prefix='%s-' % GCC_TRIPLES[self._cpu]
+                if GCC_TRIPLES[self._cpu] else
+                '',
+            bfd_target=BFD_TARGETS[self._cpu],
+            bfd_arch=BFD_ARCHS[self._cpu],
             cargo=self._cargo,
             rust_triple=RUST_TRIPLES[self._cpu],
             wasm_cc=self._wasm_cc,
@@ -558,11 +596,17 @@ class MkOutput(outputs.Output):
         out.printf('endif')
         if out.get('isa', False):
             out.printf('override CFLAGS += -m%(isa)s')
-        if out.get('cpu', False):
+        if out.get('cpu', False) and self._cpu != 'host':
             out.printf('override CFLAGS += -mcpu=%(cpu)s')
         if out.get('fpu', False):
             out.printf('override CFLAGS += -mfpu=%(fpu)s')
             out.printf('override CFLAGS += -mfloat-abi=softfp')
+        if self._cpu == 'host':
+            # boxes are linked at fixed addresses, without the host's
+            # startup code
+            out.printf('override CFLAGS += -fno-pie')
+            out.printf('override CFLAGS += -fno-stack-protector')
+            out.printf('override CFLAGS += -fcf-protection=none')
         out.printf('override CFLAGS += -std=c99')
         out.printf('override CFLAGS += -Wall -Wno-format')
         out.printf('override CFLAGS += -fno-common')
@@ -570,7 +614,9 @@ class MkOutput(outputs.Output):
         out.printf('override CFLAGS += -fdata-sections')
         out.printf('override CFLAGS += -ffreestanding')
         out.printf('override CFLAGS += -fno-builtin')
-        out.printf('override CFLAGS += -fshort-enums')
+        if self._cpu != 'host':
+            # the host's libc expects int-sized enums
+            out.printf('override CFLAGS += -fshort-enums')
         out.printf('override CFLAGS += $(patsubst %%,-I%%,$(INC))')
 
         if not self.no_rust:
@@ -678,11 +724,16 @@ class MkOutput(outputs.Output):
         out.printf('override LDFLAGS += $(patsubst %%,-L%%,$(SRC))')
         out.printf('override LDFLAGS += -Wl,--start-group '
             '$(patsubst %%,-l%%,$(LIB)) -Wl,--end-group')
-        out.printf('override LDFLAGS += -static')
-        out.printf('override LDFLAGS += --specs=nano.specs')
-        out.printf('override LDFLAGS += --specs=nosys.specs')
+        if self._cpu != 'host':
+            out.printf('override LDFLAGS += -static')
+            out.printf('override LDFLAGS += --specs=nano.specs')
+            out.printf('override LDFLAGS += --specs=nosys.specs')
+        else:
+            # linking against libc is left up to the host runtimes
+            out.printf('override LDFLAGS += -no-pie')
         out.printf('override LDFLAGS += -Wl,--gc-sections')
-        out.printf('override LDFLAGS += -Wl,-static')
+        if self._cpu != 'host':
+            out.printf('override LDFLAGS += -Wl,-static')
         out.printf('override LDFLAGS += -Wl,-z,muldefs')
         if not self.no_wasm:
             out.printf('override WASMLDFLAGS += $(WASMCFLAGS)')
@@ -920,6 +971,9 @@ class MkOutput(outputs.Output):
                     '$(TARGET:.elf=.awsm.o)')
             if not self.no_llvm:
                 out.printf('rm -f $(LLVMOBJ)')
+            if self._cpu == 'host':
+                out.printf('rm -f $(TARGET:.elf=.libc.elf) '
+                    '$(TARGET:.elf=.libc.o)')
             if not self.no_wamrc:
                 out.printf('rm -f $(TARGET:.aot=.elf) '
                     '$(TARGET:.aot=.wasm)')
@@ -40,6 +40,45 @@ class Runtime(Inherit(
         else:
             return self.name < other
 
+    def islinkable(self, box, sibling):
+        """
+        Can imports in box be linked directly to exports in a sibling box?
+        Normally calls between boxes need to go through their parent.
+        """
+        return False
+
+    def pageprotects(self, box):
+        """
+        Can the box's pages be protected with __box_<box>_pageprotect, so
+        loaders can page in memory on demand?
+        """
+        return False
+
+    def box_parent(self, parent, box):
+        super().box_parent(parent, box)
+        if any(export.isqueued() for export in box.exports):
+            parent.addimport(
+                '__box_%s_drain' % box.name, 'fn() -> err',
+                source=self.__argname__,
+                doc="Run any queued calls waiting in the box's queue.")
+        self._loadstart_hook = parent.addimport(
+            '__box_%s_loadstart' % box.name, 'fn() -> err',
+            scope=parent.name, source=self.__argname__, weak=True,
+            doc="Start loading the box in steps. Provided by loaders that "
+                "can load in the background.")
+        self._loadstep_hook = parent.addimport(
+            '__box_%s_loadstep' % box.name, 'fn() -> err',
+            scope=parent.name, source=self.__argname__, weak=True,
+            doc="Do the next step of loading the box, returning -EAGAIN "
+                "until the box is loaded.")
+
+    def prefetches(self, box):
+        """
+        Can the box be loaded in the background? This is up to the
+        box's loader.
+        """
+        return bool(self._loadstep_hook.link)
+
     def box(self, box):
         super().box(box)
         self.data_init_hook = box.addimport(
@@ -56,6 +95,598 @@ class Runtime(Inherit(
                 "initializing the bss section. Some loaders take care of "
                 "initialization implicitly, otherwise its left up to the "
                 "runtime. Not actually called.")
+        if any(export.isqueued() for export in box.exports):
+            box.addexport(
+                '__box_%s_drain' % box.name, 'fn() -> err',
+                alias='__box_drain', source=self.__argname__)
+
+    def _skipsload(self, box):
+        """
+        Can init skip loading the box if nothing has been loaded over its
+        memory since it last ran? Only idempotent boxes can pick up where
+        they left off, and only if asked to with skip_reload.
+        """
+        return box.idempotent and box.skip_reload
+
+    def build_parent_c(self, output, parent, box):
+        super().build_parent_c(output, parent, box)
+        if self.prefetches(box):
+            out = output.decls.append(doc='set while the box is loading in '
+                'the background, and once loaded until init picks it up')
+            out.printf('bool __box_%(box)s_prefetching = false;')
+            out.printf('bool __box_%(box)s_prefetched = false;')
+
+        if not self._skipsload(box):
+            return
+
+        out = output.decls.append(doc='set when the box is loaded, cleared '
+            'when a roommate is loaded over it, or the box is clobbered, '
+            'aborts, or faults')
+        out.printf('bool __box_%(box)s_loaded = false;')
+        if box.reload_crc:
+            out = output.decls.append(
+                doc='CRC of the box\'s RAM, taken when the box is clobbered')
+            out.printf('uint32_t __box_%(box)s_crc = 0;')
+            out.printf()
+            out.printf('static uint32_t __box_%(box)s_crc32(void) {')
+            with out.indent():
+                out.printf('static const uint32_t rtable[16] = {')
+                with out.indent():
+                    out.printf('0x00000000, 0x1db71064, 0x3b6e20c8, '
+                        '0x26d930ac,')
+                    out.printf('0x76dc4190, 0x6b6b51f4, 0x4db26158, '
+                        '0x5005713c,')
+                    out.printf('0xedb88320, 0xf00f9344, 0xd6d6a3e8, '
+                        '0xcb61b38c,')
+                    out.printf('0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, '
+                        '0xbdbdf21c,')
+                out.printf('};')
+                out.printf()
+                out.printf('uint32_t crc = 0xffffffff;')
+                for memory in box.memories:
+                    if 'w' not in memory.mode:
+                        continue
+                    with out.pushattrs(
+                            memorystart='__box_%(box)s_%(memory)s_start',
+                            memoryend='__box_%(box)s_%(memory)s_end',
+                            memory=memory.name):
+                        out.printf('extern uint8_t %(memorystart)s;')
+                        out.printf('extern uint8_t %(memoryend)s;')
+                        out.printf('for (const uint8_t *p = &%(memorystart)s; '
+                            'p < &%(memoryend)s; p++) {')
+                        with out.indent():
+                            out.printf('crc = (crc >> 4) ^ '
+                                'rtable[(crc ^ (*p >> 0)) & 0xf];')
+                            out.printf('crc = (crc >> 4) ^ '
+                                'rtable[(crc ^ (*p >> 4)) & 0xf];')
+                        out.printf('}')
+                out.printf('return crc;')
+            out.printf('}')
+
+    def _overlaps(self, box, roommate):
+        """
+        Does the roommate's memory overlap the box's memory? Explicit
+        roommates may only share other resources.
+        """
+        return any(memory.overlaps(memory2)
+            for memory in box.memories
+            for memory2 in roommate.memories
+            if memory.addr is not None and memory2.addr is not None)
+
+    def _build_parent_roommates(self, out, box):
+        """
+        Build the part of init that brings down any roommates. Clobbering
+        a roommate that can skip reloads keeps it loaded, loading over
+        its memory is what unloads it, see _build_parent_loadover.
+        """
+        if box.roommates:
+            out.printf('// bring down any overlapping boxes')
+        for roommate in box.roommates:
+            with out.pushattrs(roommate=roommate.name):
+                out.printf('extern int __box_%(roommate)s_clobber(void);')
+                if roommate.runtime._skipsload(roommate):
+                    out.printf('extern bool __box_%(roommate)s_loaded;')
+                    out.printf('bool %(roommate)s_loaded = '
+                        '__box_%(roommate)s_loaded;')
+                out.printf('err = __box_%(roommate)s_clobber();')
+                out.printf('if (err) {')
+                with out.indent():
+                    out.printf('return err;')
+                out.printf('}')
+                if roommate.runtime._skipsload(roommate):
+                    out.printf('__box_%(roommate)s_loaded = '
+                        '%(roommate)s_loaded;')
+                out.printf()
+
+    def _build_parent_unload(self, out, box):
+        """
+        Build the part of abort and fault handling that forces the box
+        to reload on the next init, its RAM may be in any state.
+        """
+        if self._skipsload(box):
+            out.printf('__box_%(box)s_loaded = false;')
+
+    def _build_parent_loadover(self, out, box, zero=False):
+        """
+        Build the part of loading that takes over the box's memory.
+        Loading invalidates any roommates it overlaps, and if zero is set,
+        the box's RAM is zeroed.
+        """
+        roommates = [roommate for roommate in box.roommates
+            if (roommate.runtime._skipsload(roommate)
+                and self._overlaps(box, roommate))
+            or roommate.runtime.prefetches(roommate)]
+        if self._skipsload(box) or roommates:
+            out.printf('// loading overwrites any roommates')
+            if self._skipsload(box):
+                out.printf('__box_%(box)s_loaded = false;')
+            for roommate in roommates:
+                with out.pushattrs(roommate=roommate.name):
+                    if (roommate.runtime._skipsload(roommate)
+                            and self._overlaps(box, roommate)):
+                        out.printf('extern bool __box_%(roommate)s_loaded;')
+                        out.printf('__box_%(roommate)s_loaded = false;')
+                    if roommate.runtime.prefetches(roommate):
+                        out.printf('// a background load may have reads '
+                            'in flight, let it finish')
+                        out.printf('extern bool '
+                            '__box_%(roommate)s_prefetched;')
+                        out.printf('extern int '
+                            '__box_%(roommate)s_load_poll(void);')
+                        out.printf('while (__box_%(roommate)s_load_poll() '
+                            '== -EAGAIN) {}')
+                        out.printf('__box_%(roommate)s_prefetched = false;')
+            out.printf()
+
+        if zero:
+            out.printf('// zero memory')
+            for memory in box.memoryslices:
+                if 'w' in memory.mode:
+                    with out.pushattrs(
+                            memory=memory.name,
+                            memorystart='__box_%(box)s_%(memory)s_start',
+                            memoryend='__box_%(box)s_%(memory)s_end'):
+                        out.printf('extern uint8_t %(memorystart)s;')
+                        out.printf('extern uint8_t %(memoryend)s;')
+                        out.printf('memset(&%(memorystart)s, 0, '
+                            '&%(memoryend)s - &%(memorystart)s);')
+            out.printf()
+
+    def _build_parent_load(self, out, box, zero=False, resume=True):
+        """
+        Build the part of init that loads the box. Boxes that can skip
+        reloads only load if they were unloaded since they last ran.
+        If resume is set, a box that wasn't unloaded resumes where it
+        left off, see _build_parent_postinit. If the box is already being
+        loaded in the background, init finishes the load instead. See
+        _build_parent_loadover for zero.
+        """
+        skip = self._skipsload(box)
+        prefetch = self.prefetches(box)
+        if skip:
+            if resume:
+                out.printf('// resume the box if it\'s still loaded, only '
+                    'roommates that never')
+                out.printf('// loaded over it have clobbered it since it '
+                    'last ran')
+                if box.reload_crc:
+                    out.printf('bool resume = __box_%(box)s_loaded &&')
+                    out.printf('        __box_%(box)s_crc32() == '
+                        '__box_%(box)s_crc;')
+                else:
+                    out.printf('bool resume = __box_%(box)s_loaded;')
+                out.printf('if (!resume) {')
+            else:
+                out.printf('// load the box if unloaded, or if a roommate '
+                    'has been loaded over it since')
+                if box.reload_crc:
+                    out.printf('if (!__box_%(box)s_loaded ||')
+                    out.printf('        __box_%(box)s_crc32() != '
+                        '__box_%(box)s_crc) {')
+                else:
+                    out.printf('if (!__box_%(box)s_loaded) {')
+            out.pushindent()
+
+        if prefetch:
+            out.printf('if (__box_%(box)s_prefetching || '
+                '__box_%(box)s_prefetched) {')
+            with out.indent():
+                out.printf('// finish loading in the background')
+                out.printf('do {')
+                with out.indent():
+                    out.printf('err = __box_%(box)s_load_poll();')
+                out.printf('} while (err == -EAGAIN);')
+                out.printf('if (err) {')
+                with out.indent():
+                    out.printf('return err;')
+                out.printf('}')
+            out.printf('} else {')
+            out.pushindent()
+
+        self._build_parent_loadover(out, box, zero=zero)
+        if not skip:
+            out.printf('// load the box if unloaded')
+        out.printf('err = __box_%(box)s_load();')
+        out.printf('if (err) {')
+        with out.indent():
+            out.printf('return err;')
+        out.printf('}')
+
+        if prefetch:
+            out.popindent()
+            out.printf('}')
+            out.printf('__box_%(box)s_prefetched = false;')
+        if skip:
+            out.printf('__box_%(box)s_loaded = true;')
+            out.popindent()
+            out.printf('}')
+        out.printf()
+
+    def _build_parent_postinit(self, out, box, postinit):
+        """
+        Build the part of init that calls the box's init, postinit is a
+        C expression that calls it. A box that resumes keeps its RAM as
+        it was, so we don't run its init again, see _build_parent_load.
+        """
+        if self._skipsload(box):
+            out.printf('// call box\'s init, unless the box resumes')
+            out.printf('if (!resume) {')
+            out.pushindent()
+        else:
+            out.printf('// call box\'s init')
+        out.printf('err = %(postinit)s;', postinit=postinit)
+        out.printf('if (err) {')
+        with out.indent():
+            out.printf('return err;')
+        out.printf('}')
+        if self._skipsload(box):
+            out.popindent()
+            out.printf('}')
+        out.printf()
+
+    def _build_parent_prefetch(self, output, box, initialized,
+            map=None, zero=False):
+        """
+        Build __box_<box>_prefetch and __box_<box>_load_poll, which let
+        the system start loading a box before it's needed, if the box's
+        loader can load in steps. Initialized is a C expression, and map,
+        if provided, is a C expression that makes the box's memory
+        accessible, returning an error code.
+        """
+        if not self.prefetches(box):
+            return
+
+        out = output.decls.append(initialized=initialized)
+        out.printf('int __box_%(box)s_prefetch(void) {')
+        with out.indent():
+            out.printf('int err;')
+            out.printf('if (%(initialized)s || '
+                '__box_%(box)s_prefetching || '
+                '__box_%(box)s_prefetched) {')
+            with out.indent():
+                out.printf('return 0;')
+            out.printf('}')
+            if self._skipsload(box):
+                if box.reload_crc:
+                    out.printf('if (__box_%(box)s_loaded &&')
+                    out.printf('        __box_%(box)s_crc32() == '
+                        '__box_%(box)s_crc) {')
+                else:
+                    out.printf('if (__box_%(box)s_loaded) {')
+                with out.indent():
+                    out.printf('return 0;')
+                out.printf('}')
+            out.printf()
+            self._build_parent_roommates(out, box)
+            if map:
+                out.printf('// map the box\'s memory')
+                out.printf('err = %(map)s;', map=map)
+                out.printf('if (err) {')
+                with out.indent():
+                    out.printf('return err;')
+                out.printf('}')
+                out.printf()
+            self._build_parent_loadover(out, box, zero=zero)
+            out.printf('// start loading, __box_%(box)s_load_poll '
+                'does the rest')
+            out.printf('err = __box_%(box)s_loadstart();')
+            out.printf('if (err) {')
+            with out.indent():
+                out.printf('return err;')
+            out.printf('}')
+            out.printf()
+            out.printf('__box_%(box)s_prefetching = true;')
+            out.printf('return 0;')
+        out.printf('}')
+
+        out = output.decls.append()
+        out.printf('int __box_%(box)s_load_poll(void) {')
+        with out.indent():
+            out.printf('if (!__box_%(box)s_prefetching) {')
+            with out.indent():
+                out.printf('return 0;')
+            out.printf('}')
+            out.printf()
+            out.printf('int err = __box_%(box)s_loadstep();')
+            out.printf('if (err == -EAGAIN) {')
+            with out.indent():
+                out.printf('return err;')
+            out.printf('}')
+            out.printf()
+            out.printf('__box_%(box)s_prefetching = false;')
+            out.printf('__box_%(box)s_prefetched = !err;')
+            out.printf('return err;')
+        out.printf('}')
+
+    def _build_parent_clobber(self, out, box, initialized, queued=False):
+        """
+        Build the part of clobber that unloads the box, or remembers the
+        state of the box's RAM, if we check it before skipping loads.
+        Initialized is a C expression, since boxes that never ran don't
+        change their RAM. Roommates restore the loaded flag, see
+        _build_parent_roommates. If queued is set, any calls still in
+        the box's queue are dropped, a box that resumes doesn't run them
+        later.
+        """
+        if queued:
+            out.printf('// drop any queued calls, the box starts over '
+                'or resumes without them')
+            out.printf('if (%(initialized)s) {', initialized=initialized)
+            with out.indent():
+                out.printf('__box_%(box)s_queue->tail = '
+                    '__box_%(box)s_queue->head;')
+            out.printf('}')
+        if self._skipsload(box):
+            if box.reload_crc:
+                out.printf('if (%(initialized)s) {', initialized=initialized)
+                with out.indent():
+                    out.printf('__box_%(box)s_crc = __box_%(box)s_crc32();')
+                out.printf('}')
+            out.printf('__box_%(box)s_loaded = false;')
+
+    def _queuewidth(self, fns):
+        """
+        Number of words in each queue record, one for the entry's index
+        and enough for the largest set of arguments.
+        """
+        return 1 + max(sum(arg.size() for arg in fn.args)//4 for fn in fns)
+
+    def _build_queue(self, output, box, entries):
+        """
+        Build the box side of the queue for queued exports.
+
+        The parent writes records into a single-producer ring buffer in
+        the box's memory without crossing into the box. __box_drain then
+        runs all pending records in one box call. The parent finds the
+        queue through the last entry in the box's jumptable.
+
+        Entries is a list of (i, fn, target) where i is the jumptable
+        index used to tag records, fn is the postbound type of the export,
+        and target is the C function to call.
+        """
+        output.includes.append('<string.h>')
+        out = output.decls.append(
+            queue=box.queue,
+            width=self._queuewidth([fn for _, fn, _ in entries]))
+        out.printf('//// queue implementation ////')
+        out.printf('struct __box_queue {')
+        with out.indent():
+            out.printf('volatile uint32_t head;')
+            out.printf('volatile uint32_t tail;')
+            out.printf('uint32_t records[%(queue)d][%(width)d];')
+        out.printf('} __box_queue;')
+
+        out = output.decls.append(queue=box.queue)
+        out.printf('int __box_drain(void) {')
+        with out.indent():
+            out.printf('uint32_t tail = __box_queue.tail;')
+            out.printf('while (tail != __atomic_load_n(&__box_queue.head, '
+                '__ATOMIC_ACQUIRE)) {')
+            with out.indent():
+                out.printf('const uint32_t *record = '
+                    '__box_queue.records[tail %% %(queue)d];')
+                out.printf('switch (record[0]) {')
+                with out.indent():
+                    for i, fn, target in entries:
+                        out.printf('case %(i)d: {', i=i)
+                        with out.indent():
+                            off = 1
+                            for arg, name in fn.zippedargs():
+                                out.printf('%(arg)s;',
+                                    arg=output.repr_arg(arg, name))
+                                out.printf('memcpy(&%(name)s, '
+                                    '&record[%(off)d], sizeof(%(name)s));',
+                                    name=name, off=off)
+                                off += arg.size()//4
+                            out.printf('// consume before calling, so '
+                                'nested drains don\'t rerun this')
+                            out.printf('tail += 1;')
+                            out.printf('__atomic_store_n(&__box_queue.tail, '
+                                'tail, __ATOMIC_RELEASE);')
+                            out.printf('%(target)s(%(args)s);',
+                                target=target,
+                                args=', '.join(fn.argnames()))
+                            out.printf('break;')
+                        out.printf('}')
+                    out.printf('default:')
+                    with out.indent():
+                        out.printf('return -EINVAL;')
+                out.printf('}')
+                out.printf()
+                out.printf('tail = __box_queue.tail;')
+            out.printf('}')
+            out.printf()
+            out.printf('return 0;')
+        out.printf('}')
+
+    def _build_parent_queue(self, output, box, entries, initialized=None):
+        """
+        Build the parent side of the queue for queued exports, see
+        _build_queue. Each queued import enqueues a record, only calling
+        into the box to drain the queue if it's full. The runtime needs
+        to set __box_<box>_queue during init.
+
+        Entries is a list of (i, fn) where i is the jumptable index of the
+        export and fn is the type of the import. Initialized, if provided,
+        is a C expression to check before enqueueing, for lazy init.
+        """
+        output.includes.append('<string.h>')
+        out = output.decls.append(
+            queue=box.queue,
+            width=self._queuewidth([fn for _, fn in entries]))
+        out.printf('//// %(box)s queue ////')
+        out.printf('struct __box_%(box)s_queue {')
+        with out.indent():
+            out.printf('volatile uint32_t head;')
+            out.printf('volatile uint32_t tail;')
+            out.printf('uint32_t records[%(queue)d][%(width)d];')
+        out.printf('} *__box_%(box)s_queue = NULL;')
+
+        for i, fn in entries:
+            profiled = self._profiled(box.getparent(), box, fn)
+            out = output.decls.append(
+                fn=output.repr_fn(fn)
+                    if profiled is None else
+                    output.repr_fn(fn,
+                        name='__box_%(box)s_unprofiled_%(alias)s',
+                        attrs=['static']),
+                alias=fn.alias,
+                queue=box.queue,
+                i=i)
+            out.printf('%(fn)s {')
+            with out.indent():
+                if initialized:
+                    out.printf('if (!%(initialized)s) {',
+                        initialized=initialized)
+                    with out.indent():
+                        out.printf('int err = __box_%(box)s_init();')
+                        out.printf('if (err) {')
+                        with out.indent():
+                            out.printf('__box_abort(err);')
+                        out.printf('}')
+                    out.printf('}')
+                    out.printf()
+                out.printf('uint32_t head = __box_%(box)s_queue->head;')
+                out.printf('if (head - __box_%(box)s_queue->tail '
+                    '>= %(queue)d) {')
+                with out.indent():
+                    out.printf('int err = __box_%(box)s_drain();')
+                    out.printf('if (err) {')
+                    with out.indent():
+                        out.printf('__box_abort(err);')
+                    out.printf('}')
+                out.printf('}')
+                out.printf()
+                out.printf('uint32_t *record = '
+                    '__box_%(box)s_queue->records[head %% %(queue)d];')
+                out.printf('record[0] = %(i)d;')
+                off = 1
+                for arg, name in fn.zippedargs():
+                    out.printf('memcpy(&record[%(off)d], &%(name)s, '
+                        'sizeof(%(name)s));', name=name, off=off)
+                    off += arg.size()//4
+                out.printf('__atomic_store_n(&__box_%(box)s_queue->head, '
+                    'head+1, __ATOMIC_RELEASE);')
+            out.printf('}')
+
+            if profiled is not None:
+                self._build_parent_profile(output, profiled, fn, fn.alias,
+                    '__box_%%(box)s_unprofiled_%s' % fn.alias)
+
+    def _build_parent_predrain(self, out, fn):
+        """
+        Run any queued calls before a normal call into the box, so calls
+        are seen by the box in the order they were made.
+        """
+        with out.pushattrs(err=fn.uniquename('err')):
+            out.printf('if (__box_%(box)s_queue && '
+                '__box_%(box)s_queue->head != __box_%(box)s_queue->tail) {')
+            with out.indent():
+                out.printf('int %(err)s = __box_%(box)s_drain();')
+                out.printf('if (%(err)s) {')
+                with out.indent():
+                    if fn.isfalible():
+                        out.printf('return %(err)s;')
+                    else:
+                        out.printf('__box_abort(%(err)s);')
+                out.printf('}')
+            out.printf('}')
+            out.printf()
+
+    def _build_parent_trampolines(self, output, box, entries,
+            type='uint32_t'):
+        """
+        Build a table of trampolines in RAM for init='trampoline'.
+
+        Each entry starts pointing to a stub that initializes the box and
+        then redirects through the table. __box_<box>_patch(true), called
+        after init, rewrites the entries to their real targets, so calls
+        don't need to check if the box is initialized.
+
+        Entries is a list of (fn, target) where fn is the type of the
+        entry and target is a C expression for the initialized entry.
+        """
+        out = output.decls.append(type=type)
+        out.printf('//// %(box)s trampolines ////')
+        for fn, _ in entries:
+            out.printf('%(fn)s;',
+                fn=output.repr_fn(fn,
+                    name='__box_%(box)s_lazy_%(alias)s',
+                    attrs=['static']),
+                alias=fn.alias)
+        out.printf()
+        out.printf('%(type)s __box_%(box)s_trampolines[%(count)d] = {',
+            count=len(entries))
+        with out.indent():
+            for fn, _ in entries:
+                out.printf('(%(type)s)__box_%(box)s_lazy_%(alias)s,',
+                    alias=fn.alias)
+        out.printf('};')
+
+        out = output.decls.append(type=type)
+        out.printf('static void __box_%(box)s_patch(bool initialized) {')
+        with out.indent():
+            out.printf('if (initialized) {')
+            with out.indent():
+                for i, (fn, target) in enumerate(entries):
+                    out.printf('__box_%(box)s_trampolines[%(i)d] = '
+                        '(%(type)s)%(target)s;',
+                        i=i, target=target)
+            out.printf('} else {')
+            with out.indent():
+                for i, (fn, _) in enumerate(entries):
+                    out.printf('__box_%(box)s_trampolines[%(i)d] = '
+                        '(%(type)s)__box_%(box)s_lazy_%(alias)s;',
+                        i=i, alias=fn.alias)
+            out.printf('}')
+        out.printf('}')
+
+        for i, (fn, _) in enumerate(entries):
+            out = output.decls.append(
+                fn=output.repr_fn(fn,
+                    name='__box_%(box)s_lazy_%(alias)s',
+                    attrs=['static']),
+                fnptr=output.repr_fnptr(fn, ''),
+                alias=fn.alias,
+                i=i)
+            out.printf('%(fn)s {')
+            with out.indent():
+                out.printf('int err = __box_%(box)s_init();')
+                out.printf('if (err) {')
+                with out.indent():
+                    if fn.isfalible():
+                        out.printf('return err;')
+                    else:
+                        out.printf('__box_abort(err);')
+                out.printf('}')
+                out.printf()
+                out.printf('%(return_)s((%(fnptr)s)\n'
+                    '        __box_%(box)s_trampolines[%(i)d])(%(args)s);',
+                    return_='return ' if fn.rets else '',
+                    args=', '.join(fn.argnames()))
+                if fn.isnoreturn():
+                    out.printf('__builtin_unreachable();')
+            out.printf('}')
 
 
 # Runtime class imports
@@ -68,3 +699,6 @@ from .armv8m_mpu import ARMv8MMPURuntime
 from .awsm import aWsmRuntime
 from .wamr import WamrRuntime
 from .wasm3 import Wasm3Runtime
+from .host_sys import HostSysRuntime
+from .host import HostRuntime
+from .host_mprotect import HostMProtectRuntime
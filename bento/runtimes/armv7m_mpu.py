@@ -14,6 +14,7 @@ from ..glue.error_glue import ErrorGlue
 from ..glue.write_glue import WriteGlue
 from ..glue.abort_glue import AbortGlue
 from ..glue.heap_glue import HeapGlue
+from ..glue.profile_glue import ProfileGlue
 from ..outputs import OutputBlob
 
 MPU_STATE = """
@@ -29,7 +30,7 @@ MPU_IMPL = """
 #define MPU_RBAR ((volatile uint32_t*)0xe000ed9c)
 #define MPU_RASR ((volatile uint32_t*)0xe000eda0)
 
-struct __box_mpuregions {
+struct __box_mpudelta {
     uint32_t control;
     uint32_t count;
     uint32_t regions[][2];
@@ -46,32 +47,49 @@ static int32_t __box_mpu_init(void) {
         *MPU_RBAR = (uint32_t)&__box_callregion | 0x10;
         // disallow execution
         *MPU_RASR = 0x10000001 | ((%(calllog2)d-1) << 1);
+        // start with box regions disabled, switches only write the
+        // regions that differ between boxes
+        for (int i = 0; i < %(mpuregions)d; i++) {
+            *MPU_RBAR = 0x10 | (i+1);
+            *MPU_RASR = 0;
+        }
         // enable the MPU
         *MPU_CTRL = 5;
     }
     return 0;
 }
 
-static void __box_mpu_switch(const struct __box_mpuregions *regions) {
-    // update MPU regions
-    *MPU_CTRL = 0;
-    uint32_t count = regions->count;
-    for (int i = 0; i < %(mpuregions)d; i++) {
-        if (i < count) {
-            *MPU_RBAR = regions->regions[i][0] | 0x10 | (i+1);
-            *MPU_RASR = regions->regions[i][1];
-        } else {
-            *MPU_RBAR = 0x10 | (i+1);
-            *MPU_RASR = 0;
+static void __box_mpu_switch(const struct __box_mpudelta *delta) {
+    // update MPU regions that differ from the previous box
+    uint32_t count = delta->count;
+    if (count > 0) {
+        *MPU_CTRL = 0;
+        const uint32_t *region = delta->regions[0];
+        // RBAR has VALID set, so each RBAR/RASR pair selects its own
+        // region, this lets us write up to 4 regions at a time through
+        // the contiguous RBAR_A1-A3/RASR_A1-A3 alias registers
+        for (; count >= 4; count -= 4, region += 8) {
+            MPU_RBAR[0] = region[0];
+            MPU_RBAR[1] = region[1];
+            MPU_RBAR[2] = region[2];
+            MPU_RBAR[3] = region[3];
+            MPU_RBAR[4] = region[4];
+            MPU_RBAR[5] = region[5];
+            MPU_RBAR[6] = region[6];
+            MPU_RBAR[7] = region[7];
         }
+        for (; count > 0; count -= 1, region += 2) {
+            MPU_RBAR[0] = region[0];
+            MPU_RBAR[1] = region[1];
+        }
+        *MPU_CTRL = 5;
     }
-    *MPU_CTRL = 5;
 
     // update CONTROL state, note that return-from-exception acts
     // as an instruction barrier
     uint32_t control;
     __asm__ volatile ("mrs %%0, control" : "=r"(control));
-    control = (~1 & control) | (regions->control);
+    control = (~1 & control) | (delta->control);
     __asm__ volatile ("msr control, %%0" :: "r"(control));
 }
 """
@@ -96,8 +114,12 @@ struct __box_frame {
 // foward declaration of fault wrapper, may be called directly
 // in other handlers, but only in other handlers! (needs isr context)
 uint64_t __box_faultsetup(int32_t err) {
+    uint32_t active = __box_active;
     // mark box as uninitialized
-    __box_state[__box_active]->initialized = false;
+    __box_state[active]->initialized = false;
+    if (__box_faults[active]) {
+        __box_faults[active]();
+    }
 
     // invoke user handler, should not return
     // TODO should we set this up to be called in non-isr context?
@@ -132,7 +154,7 @@ uint64_t __box_faultsetup(int32_t err) {
     targetstate->caller = targetbf->caller;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
 
     // copy return frame
     targetfp[0] = err;         // r0 = arg0
@@ -171,8 +193,36 @@ void __box_faulthandler(int32_t err) {
 
 uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
         uint32_t op, uint32_t *fp) {
+    // find target, boxes may call sys or call another box directly,
+    // in which case the jumptable contains the call op sys would use
+    // (even), instead of a function pointer (odd)
+    uint32_t caller = __box_active;
+    uint32_t target = (caller == 0)
+        ? op
+        : __box_sys_jumptables[caller-1][((op/4)-2)];
+    uint32_t targetbox = (target & 1)
+        ? 0
+        : (((target/4)-2) %% __BOX_COUNT) + 1;
+    uint32_t targetpc = (target & 1)
+        ? target
+        : __box_jumptables[targetbox-1][((target/4)-2) / __BOX_COUNT + 1];
+    struct __box_state *targetstate = __box_state[targetbox];
+
+    // boxes can't initialize other boxes, if the target box has been
+    // clobbered since the caller was initialized we return an error
+    if (caller != 0 && targetbox != 0 && !targetstate->initialized) {
+        // halt if we can't handle
+        if (!(op & 2)) {
+            __box_abort(-EAGAIN);
+        }
+
+        fp[0] = -EAGAIN;    // r0 = arg0
+        fp[6] = fp[5];      // pc = lr
+        return ((uint64_t)lr) | ((uint64_t)(uint32_t)fp << 32);
+    }
+
     // save lr + sp
-    struct __box_state *state = __box_state[__box_active];
+    struct __box_state *state = __box_state[caller];
     struct __box_frame *frame = (struct __box_frame*)sp;
     frame->fp = fp;
     frame->lr = state->lr;
@@ -181,14 +231,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
-    uint32_t caller = __box_active;
-    __box_active = (caller == 0)
-        ? (((op/4)-2) %% __BOX_COUNT) + 1
-        : 0;
-    uint32_t targetpc = (caller == 0)
-        ? __box_jumptables[__box_active-1][((op/4)-2) / __BOX_COUNT + 1]
-        : __box_sys_jumptables[caller-1][((op/4)-2)];
-    struct __box_state *targetstate = __box_state[__box_active];
+    __box_active = targetbox;
     uint32_t targetlr = targetstate->lr;
     uint32_t *targetsp = targetstate->sp;
     // keep track of caller
@@ -199,7 +242,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetsp;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[caller][__box_active]);
 
     // setup new call frame
     targetsp -= 8;
@@ -260,8 +303,13 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
+    uint32_t active = __box_active;
     __box_active = state->caller;
 
+    // select MPU regions, do this before we can fault since our
+    // deltas depend on the previous box
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
+
     struct __box_state *targetstate = __box_state[__box_active];
     uint32_t targetlr = targetstate->lr;
     // in call?
@@ -276,9 +324,6 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetframe->sp;
     targetstate->caller = targetframe->caller;
 
-    // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
-
     // copy return frame
     targetfp[0] = fp[0];       // r0 = arg0
     targetfp[1] = fp[1];       // r1 = arg1
@@ -373,6 +418,7 @@ class ARMv7MMPURuntime(
         WriteGlue,
         AbortGlue,
         HeapGlue,
+        ProfileGlue,
         runtimes.Runtime):
     """
     A bento-box runtime that uses an Arm v7 MPU to provide memory isolation
@@ -452,39 +498,78 @@ class ARMv7MMPURuntime(
         output.decls.append(MPU_IMPL)
 
     # overridable
-    def _build_mpu_sysregions(self, output, parent):
-        out = output.decls.append()
-        out.printf('const struct __box_mpuregions __box_sys_mpuregions = {')
-        with out.pushindent():
-            out.printf('.control = 0,')
-            out.printf('.count = 0,')
-            out.printf('.regions = {}')
-        out.printf('};')
+    def _box_mpu_regions(self, box):
+        return [
+            (memory.addr,
+                (0x10000000
+                    if 'x' not in memory.mode else
+                    0x00000000)
+                | (0x03000000
+                    if set('rw').issubset(memory.mode) else
+                    0x02000000
+                    if 'r' in memory.mode else
+                    0x00000000)
+                | 0 #(0x00080000)
+                | ((int(math.log2(memory.size))-1) << 1)
+                | 1)
+            for memory in box.memories + box.sharedmemories]
 
     # overridable
-    def _build_mpu_regions(self, output, parent, box):
+    def _mpu_delta(self, slot, region):
+        # RBAR's VALID bit selects the slot, disabled slots are zeroed
+        if region is None:
+            return (0x10 | slot, 0)
+        else:
+            return (region[0] | 0x10 | slot, region[1])
+
+    def _build_mpu_deltas(self, output, parent):
+        # find the MPU slots that change for every box transition at
+        # build time, so switches only write what differs
+        states = [('sys', [])] + [
+            (box.name, self._box_mpu_regions(box))
+            for box in parent.boxes
+            if box.runtime == self]
+
+        for from_, fromregions in states:
+            for to, toregions in states:
+                deltas = []
+                for i in range(self._mpu_regions):
+                    fromregion = (fromregions[i]
+                        if i < len(fromregions) else None)
+                    toregion = (toregions[i]
+                        if i < len(toregions) else None)
+                    if fromregion != toregion:
+                        deltas.append(self._mpu_delta(i+1, toregion))
+
+                out = output.decls.append(from_=from_, to=to)
+                out.printf('const struct __box_mpudelta '
+                    '__box_%(from_)s_to_%(to)s_mpudelta = {')
+                with out.pushindent():
+                    out.printf('.control = %(control)d,',
+                        control=0 if to == 'sys' else 1)
+                    out.printf('.count = %(count)d,', count=len(deltas))
+                    if deltas:
+                        out.printf('.regions = {')
+                        with out.pushindent():
+                            for delta in deltas:
+                                out.printf('{%s},' % ', '.join(
+                                    '%#010x' % word for word in delta))
+                        out.printf('},')
+                    else:
+                        out.printf('.regions = {}')
+                out.printf('};')
+
         out = output.decls.append()
-        out.printf('const struct __box_mpuregions __box_%(box)s_mpuregions = {')
+        out.printf('const struct __box_mpudelta *const '
+            '__box_mpudeltas[__BOX_COUNT+1][__BOX_COUNT+1] = {')
         with out.pushindent():
-            out.printf('.control = 1,')
-            out.printf('.count = %(count)d,', count=len(box.memories))
-            out.printf('.regions = {')
-            with out.pushindent():
-                for memory in box.memories:
-                    out.printf('{%(rbar)#010x, %(rasr)#010x},',
-                        rbar=memory.addr,
-                        rasr= (0x10000000
-                                if 'x' not in memory.mode else
-                                0x00000000)
-                            | (0x03000000
-                                if set('rw').issubset(memory.mode) else
-                                0x02000000
-                                if 'r' in memory.mode else
-                                0x00000000)
-                            | 0 #(0x00080000)
-                            | ((int(math.log2(memory.size))-1) << 1)
-                            | 1)
-            out.printf('},')
+            for from_, _ in states:
+                out.printf('{')
+                with out.pushindent():
+                    for to, _ in states:
+                        out.printf('&__box_%(from_)s_to_%(to)s_mpudelta,',
+                            from_=from_, to=to)
+                out.printf('},')
         out.printf('};')
 
     def box_parent_prologue(self, parent):
@@ -516,6 +601,10 @@ class ARMv7MMPURuntime(
                 box.pushattrs(
                     callregion=self._call_region.addr)
 
+    def islinkable(self, box, sibling):
+        # boxes in the same MPU runtime can call each other directly
+        return sibling.runtime == self
+
     def box_parent(self, parent, box):
         # register hooks
         self._load_hook = parent.addimport(
@@ -546,9 +635,17 @@ class ARMv7MMPURuntime(
         if not box.stack.size:
             print("warning: Box `%s` has no stack!" % box.name)
 
-        # check memory regions against MPU limitations
-        for memory in box.memories:
+        # check memory regions against MPU limitations, note shared
+        # memory needs its own MPU region
+        for memory in box.memories + box.sharedmemories:
             self._check_mpu_region(memory)
+        assert (len(box.memories + box.sharedmemories)
+                <= self._mpu_regions), (
+            "%s: Box `%s` needs %d MPU regions, but only %d are "
+            "available, see --mpu_regions" % (
+                self.name, box.name,
+                len(box.memories + box.sharedmemories),
+                self._mpu_regions))
 
         super().box(box)
         self._jumptable.alloc(box, 'rp')
@@ -571,6 +668,17 @@ class ARMv7MMPURuntime(
             box.addexport('__box_bss_init', 'fn() -> void',
                 scope=box.name, source=self.__argname__, weak=True)
 
+    def _faulted(self, parent, box):
+        """
+        Does the box need __box_<box>_faulted to reset state outside of
+        its __box_state when it faults? This is needed for trampolines,
+        and for boxes that can skip reloads.
+        """
+        return self._skipsload(box) or (box.init == 'trampoline' and
+            any(needsinit and not import_.isqueued()
+                for import_, _, needsinit
+                in self._parentimports(parent, box)))
+
     def _parentimports(self, parent, box):
         """
         Get imports that need linking.
@@ -582,12 +690,16 @@ class ARMv7MMPURuntime(
             'fn(const u32*) -> err32',
             source=self.__argname__), False, False
 
-        # imports that need linking
+        # imports that need linking, if the box has a queue every call
+        # needs a wrapper to drain it, profiling also needs a wrapper
+        queued = any(export.isqueued() for export in box.exports)
+        profiled = self._profiles(parent)
         for import_ in parent.imports:
             if import_.link and import_.link.export.box == box:
                 yield (import_.postbound(),
-                    len(import_.boundargs) > 0 or box.init == 'lazy',
-                    box.init == 'lazy')
+                    len(import_.boundargs) > 0 or box.init != 'manual'
+                        or queued or profiled,
+                    box.init != 'manual')
 
     def _parentexports(self, parent, box):
         """
@@ -604,9 +716,11 @@ class ARMv7MMPURuntime(
             'fn(i32) -> err',
             source=self.__argname__), False
 
-        # exports that need linking
-        for export in parent.exports:
-            if any(link.import_.box == box for link in export.links):
+        # exports that need linking, this may include exports in sibling
+        # boxes, note this must match the order of _imports
+        for import_ in box.imports:
+            if import_.link and import_.link.export.box != box:
+                export = import_.link.export
                 yield export.prebound(), len(export.boundargs) > 0
 
     def _imports(self, box):
@@ -675,15 +789,45 @@ class ARMv7MMPURuntime(
         out.printf('struct __box_state __box_%(box)s_state;')
         out.printf('extern uint32_t __box_%(box)s_jumptable[];')
 
-        self._build_mpu_regions(output, parent, box)
+        # queued calls are written into a queue in the box
+        queued = [(j+1 if box.stack.size > 0 else j, import_)
+            for j, (import_, _, _) in enumerate(
+                self._parentimports(parent, box))
+            if import_.isqueued()]
+        if queued:
+            self._build_parent_queue(output, box, queued,
+                initialized='__box_%(box)s_state.initialized'
+                    if box.init != 'manual' else None)
+
+        # route calls through patchable trampolines?
+        trampolines = {}
+        if box.init == 'trampoline':
+            for import_, _, needsinit in self._parentimports(parent, box):
+                if needsinit and not import_.isqueued():
+                    trampolines[import_.name] = (len(trampolines),
+                        import_.prebound(),
+                        '__box_import_%s' % import_.alias)
+        if trampolines:
+            out = output.decls.append()
+            for _, fn, target in trampolines.values():
+                out.printf('%(fn)s;',
+                    fn=output.repr_fn(fn, name=target, attrs=['extern']))
+            self._build_parent_trampolines(output, box,
+                [(fn, target) for _, fn, target in trampolines.values()])
 
         output.decls.append('//// %(box)s exports ////')
         for import_, needsinit in ((import_, needsinit)
                 for import_, needswrapper, needsinit in
                     self._parentimports(parent, box)
-                if needswrapper):
+                if needswrapper and not import_.isqueued()):
+            profiled = self._profiled(parent, box, import_)
             out = output.decls.append(
-                fn=output.repr_fn(import_),
+                fn=output.repr_fn(import_)
+                    if profiled is None else
+                    output.repr_fn(import_,
+                        name='__box_%(box)s_unprofiled_%(alias)s',
+                        attrs=['static']),
+                fnptr=output.repr_fnptr(import_.prebound(), ''),
                 prebound=output.repr_fn(import_,
                     name='__box_import_%(alias)s',
                     attrs=['extern']),
@@ -691,7 +835,7 @@ class ARMv7MMPURuntime(
             out.printf('%(fn)s {')
             with out.indent():
                 # inject lazy-init?
-                if needsinit:
+                if needsinit and import_.name not in trampolines:
                     out.printf('if (!__box_%(box)s_state.initialized) {')
                     with out.indent():
                         out.printf('int err = __box_%(box)s_init();')
@@ -704,13 +848,35 @@ class ARMv7MMPURuntime(
                         out.printf('}')
                     out.printf('}')
                     out.printf()
-                # jump to real import
-                out.printf('%(prebound)s;')
-                out.printf('%(return_)s__box_import_%(alias)s(%(args)s);',
-                    return_=('return ' if import_.rets else ''),
-                    args=', '.join(map(str, import_.argnamesandbounds())))
+                # run any queued calls first to keep calls in order
+                if queued and import_.source != self.__argname__:
+                    self._build_parent_predrain(out, import_)
+                if import_.name in trampolines:
+                    # jump through trampoline
+                    out.printf('%(return_)s((%(fnptr)s)\n'
+                        '        __box_%(box)s_trampolines[%(i)d])'
+                        '(%(args)s);',
+                        i=trampolines[import_.name][0],
+                        return_=('return ' if import_.rets else ''),
+                        args=', '.join(map(str,
+                            import_.argnamesandbounds())))
+                    if import_.isnoreturn():
+                        # kinda wish we could apply noreturn to C types...
+                        out.printf('__builtin_unreachable();')
+                else:
+                    # jump to real import
+                    out.printf('%(prebound)s;')
+                    out.printf('%(return_)s__box_import_%(alias)s(%(args)s);',
+                        return_=('return ' if import_.rets else ''),
+                        args=', '.join(map(str,
+                            import_.argnamesandbounds())))
             out.printf('}')
 
+            if profiled is not None:
+                self._build_parent_profile(output, profiled, import_,
+                    import_.alias,
+                    '__box_%%(box)s_unprofiled_%s' % import_.alias)
+
         output.decls.append('//// %(box)s imports ////')
 
         # redirect hooks if necessary
@@ -726,34 +892,56 @@ class ARMv7MMPURuntime(
                 doc='redirect %(flush_hook)s -> __box_flush')
             out.printf('#define %(flush_hook)s __box_flush')
 
+        # profile calls into the parent?
+        profiled = self._build_parent_profile_exports(output, parent, box,
+            (export for export, _ in self._parentexports(parent, box)))
+
         # wrappers?
         for export in (export
                 for export, needswrapper in self._parentexports(parent, box)
-                if needswrapper):
+                if needswrapper and export.box in [None, parent]):
             out = output.decls.append(
                 fn=output.repr_fn(
                     export.postbound(),
                     name='__box_%(box)s_export_%(alias)s'),
-                alias=export.alias)
+                alias=export.alias,
+                target=profiled.get(export.name, export.alias))
             out.printf('%(fn)s {')
             with out.indent():
-                out.printf('%(return_)s%(alias)s(%(args)s);',
-                    return_='return ' if import_.rets else '',
+                out.printf('%(return_)s%(target)s(%(args)s);',
+                    return_='return ' if export.rets else '',
                     args=', '.join(map(str, export.argnamesandbounds())))
             out.printf('}')
 
         # import jumptable
+        boxes = [box for box in parent.boxes if box.runtime == self]
         out = output.decls.append()
         out.printf('const uint32_t __box_%(box)s_sys_jumptable[] = {')
         with out.indent():
             for export, needswrapper in self._parentexports(parent, box):
-                out.printf('(uint32_t)%(prefix)s%(alias)s,',
-                    prefix='__box_%(box)s_export_' if needswrapper else '',
-                    alias=export.alias)
+                if export.box not in [None, parent]:
+                    # direct call into sibling box, use the same call op
+                    # sys would use to call the export
+                    out.printf('4*(2 + %(boxcount)d*%(j)d + %(i)d), '
+                        '// %(sibling)s.%(alias)s',
+                        boxcount=len(boxes),
+                        i=boxes.index(export.box),
+                        j=[export_.name for export_, _
+                            in self._exports(export.box)
+                            ].index(export.name),
+                        sibling=export.box.name,
+                        alias=export.alias)
+                else:
+                    out.printf('(uint32_t)%(target)s,',
+                        target='__box_%(box)s_export_'+export.alias
+                            if needswrapper else
+                            profiled.get(export.name, export.alias))
         out.printf('};')
 
         # init
         output.decls.append('//// %(box)s init ////')
+        self._build_parent_prefetch(output, box,
+            '__box_%(box)s_state.initialized', zero=self._zero)
         out = output.decls.append()
         out.printf('int __box_%(box)s_init(void) {')
         with out.indent():
@@ -763,13 +951,35 @@ class ARMv7MMPURuntime(
                 out.printf('return 0;')
             out.printf('}')
             out.printf()
-            if box.roommates:
-                out.printf('// bring down any overlapping boxes')
-            for i, roommate in enumerate(box.roommates):
-                with out.pushattrs(roommate=roommate.name):
-                    out.printf('extern int __box_%(roommate)s_clobber(void);')
-                    out.printf('err = __box_%(roommate)s_clobber();')
-                    out.printf('if (err) {')
+            self._build_parent_roommates(out, box)
+            siblings = [sibling
+                for sibling in parent.boxes
+                if any(export.box == sibling
+                    for export, _ in self._parentexports(parent, box))]
+            if siblings:
+                out.printf('// initialize any boxes we call directly, '
+                    'we can\'t initialize')
+                out.printf('// them from inside a box. They may call us '
+                    'directly too, in which')
+                out.printf('// case we\'re not ready yet and the caller '
+                    'further up finishes')
+                out.printf('// initializing us after they\'re done')
+                out.printf('static bool initializing = false;')
+                out.printf('if (initializing) {')
+                with out.indent():
+                    out.printf('return -EAGAIN;')
+                out.printf('}')
+                out.printf()
+            for sibling in siblings:
+                assert sibling not in box.roommates, ("%s: Box `%s` "
+                    "calls box `%s` directly, but they are roommates" % (
+                        self.name, box.name, sibling.name))
+                with out.pushattrs(sibling=sibling.name):
+                    out.printf('extern int __box_%(sibling)s_init(void);')
+                    out.printf('initializing = true;')
+                    out.printf('err = __box_%(sibling)s_init();')
+                    out.printf('initializing = false;')
+                    out.printf('if (err && err != -EAGAIN) {')
                     with out.indent():
                         out.printf('return err;')
                     out.printf('}')
@@ -789,45 +999,44 @@ class ARMv7MMPURuntime(
             out.printf('__box_%(box)s_state.sp = '
                 '(void*)__box_%(box)s_jumptable[0];')
             out.printf()
-            if self._zero:
-                out.printf('// zero memory')
-                for memory in box.memoryslices:
-                    if 'w' in memory.mode:
-                        with out.pushattrs(
-                                memory=memory.name,
-                                memorystart='__box_%(box)s_%(memory)s_start',
-                                memoryend='__box_%(box)s_%(memory)s_end'):
-                            out.printf('extern uint8_t %(memorystart)s;')
-                            out.printf('extern uint8_t %(memoryend)s;')
-                            out.printf('memset(&%(memorystart)s, 0, '
-                                '&%(memoryend)s - &%(memorystart)s);')
-                out.printf()
-            out.printf('// load the box if unloaded')
-            out.printf('err = __box_%(box)s_load();')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
-            out.printf('// call box\'s init')
+            self._build_parent_load(out, box, zero=self._zero)
             out.printf('extern int __box_%(box)s_postinit(void);')
-            out.printf('err = __box_%(box)s_postinit();')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
+            self._build_parent_postinit(out, box,
+                '__box_%(box)s_postinit()')
+            if queued:
+                out.printf('// find the box\'s queue')
+                out.printf('__box_%(box)s_queue = '
+                    '(void*)__box_%(box)s_jumptable[%(n)d];',
+                    n=(1 if box.stack.size > 0 else 0)
+                        + len(list(self._exports(box))))
+                out.printf()
             out.printf('__box_%(box)s_state.initialized = true;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(true);')
             out.printf('return 0;')
         out.printf('}')
 
         out = output.decls.append()
         out.printf('int __box_%(box)s_clobber(void) {')
         with out.indent():
+            self._build_parent_clobber(out, box,
+                '__box_%(box)s_state.initialized',
+                queued=bool(queued))
             out.printf('__box_%(box)s_state.initialized = false;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(false);')
             out.printf('return 0;')
         out.printf('}')
 
+        if self._faulted(parent, box):
+            out = output.decls.append(doc='called by __box_faultsetup')
+            out.printf('void __box_%(box)s_faulted(void) {')
+            with out.indent():
+                self._build_parent_unload(out, box)
+                if trampolines:
+                    out.printf('__box_%(box)s_patch(false);')
+            out.printf('}')
+
         # stack manipulation
         output.includes.append('<assert.h>')
         out = output.decls.append(
@@ -886,19 +1095,25 @@ class ARMv7MMPURuntime(
                         out.printf('NULL,')
         out.printf('};')
 
-        # mpu regions
-        self._build_mpu_sysregions(output, parent)
-
+        # fault hooks, reset trampolines and loaded state on faults
         out = output.decls.append()
-        out.printf('const struct __box_mpuregions *const '
-            '__box_mpuregions[__BOX_COUNT+1] = {')
-        with out.pushindent():
-            out.printf('&__box_sys_mpuregions,')
+        for box in parent.boxes:
+            if box.runtime == self and box.runtime._faulted(parent, box):
+                out.printf('extern void __box_%(box)s_faulted(void);',
+                    box=box.name)
+        out.printf('void (*const __box_faults[])(void) = {')
+        with out.indent():
+            out.printf('NULL,')
             for box in parent.boxes:
                 if box.runtime == self:
-                    out.printf('&__box_%(box)s_mpuregions,', box=box.name)
+                    if box.runtime._faulted(parent, box):
+                        out.printf('__box_%(box)s_faulted,', box=box.name)
+                    else:
+                        out.printf('NULL,')
         out.printf('};')
 
+        self._build_mpu_deltas(output, parent)
+
         # jumptables
         out = output.decls.append()
         out.printf('const uint32_t *const '
@@ -1029,10 +1244,19 @@ class ARMv7MMPURuntime(
             out.printf('%(fn)s {')
             with out.indent():
                 out.printf('%(return_)s%(alias)s(%(args)s);',
-                    return_='return ' if import_.rets else '',
+                    return_='return ' if export.rets else '',
                     args=', '.join(map(str, export.argnamesandbounds())))
             out.printf('}')
 
+        queued = [(i+1 if box.stack.size > 0 else i,
+                export.postbound(),
+                '__box_export_'+export.alias if needswrapper else
+                    export.alias)
+            for i, (export, needswrapper) in enumerate(self._exports(box))
+            if export.isqueued()]
+        if queued:
+            self._build_queue(output, box, queued)
+
         out = output.decls.append(doc='box-side jumptable')
         out.printf('extern uint8_t __stack_end;')
         out.printf('__attribute__((used, section(".jumptable")))')
@@ -1044,6 +1268,8 @@ class ARMv7MMPURuntime(
                 out.printf('(uint32_t)%(prefix)s%(alias)s,',
                     prefix='__box_export_' if needswrapper else '',
                     alias=export.alias)
+            if queued:
+                out.printf('(uint32_t)&__box_queue,')
         out.printf('};')
 
     def build_ld(self, output, box):
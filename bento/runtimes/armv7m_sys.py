@@ -14,6 +14,7 @@ from ..glue.error_glue import ErrorGlue
 from ..glue.write_glue import WriteGlue
 from ..glue.abort_glue import AbortGlue
 from ..glue.heap_glue import HeapGlue
+from ..glue.profile_glue import ProfileGlue
 
 
 DEFAULT_HANDLER = """
@@ -29,6 +30,7 @@ class ARMv7MSysRuntime(
         WriteGlue,
         AbortGlue,
         HeapGlue,
+        ProfileGlue,
         runtimes.Runtime):
     """
     A bento-box runtime that runs in privledge mode on the system.
@@ -184,6 +186,17 @@ class ARMv7MSysRuntime(
                         out.printf('*d = 0;')
                     out.printf('}')
                     out.printf()
+                for shared in box.shared:
+                    out.printf('// mark %(shared)s shared memory as free',
+                        shared=shared.name)
+                    out.printf('for (uint32_t *d = (uint32_t*)%(addr)#010x; '
+                        'd < (uint32_t*)%(end)#010x; d++) {',
+                        addr=shared.addr,
+                        end=shared.addr + shared.tablesize())
+                    with out.indent():
+                        out.printf('*d = 0;')
+                    out.printf('}')
+                    out.printf()
                 out.printf()
                 out.printf('// FPU bringup?')
                 out.printf('#if defined(__VFP_FP__) && !defined(__SOFTFP__)')
@@ -22,10 +22,10 @@ MPU_IMPL = """
 #define MPU_RBAR     ((volatile uint32_t*)0xe000ed9c)
 #define MPU_RLAR     ((volatile uint32_t*)0xe000eda0)
 
-struct __box_mpuregions {
+struct __box_mpudelta {
     uint32_t control;
     uint32_t count;
-    uint32_t regions[][2];
+    uint32_t regions[][3];
 };
 
 static int32_t __box_mpu_init(void) {
@@ -42,33 +42,37 @@ static int32_t __box_mpu_init(void) {
         *MPU_RLAR = (~0x1f & (
             (uint32_t)&__box_callregion + %(callsize)d - 1))
             | 0x1;
+        // start with box regions disabled, switches only write the
+        // regions that differ between boxes
+        for (int i = 0; i < %(mpuregions)d; i++) {
+            *MPU_RNR = i+1;
+            *MPU_RBAR = 0;
+            *MPU_RLAR = 0;
+        }
         // enable the MPU
         *MPU_CTRL = 5;
     }
     return 0;
 }
 
-static void __box_mpu_switch(const struct __box_mpuregions *regions) {
-    *MPU_CTRL = 0;
-    uint32_t count = regions->count;
-    for (int i = 0; i < %(mpuregions)d; i++) {
-        if (i < count) {
-            *MPU_RNR = i+1;
-            *MPU_RBAR = regions->regions[i][0];
-            *MPU_RLAR = regions->regions[i][1];
-        } else {
-            *MPU_RNR = i+1;
-            *MPU_RBAR = 0;
-            *MPU_RLAR = 0;
+static void __box_mpu_switch(const struct __box_mpudelta *delta) {
+    // update MPU regions that differ from the previous box
+    uint32_t count = delta->count;
+    if (count > 0) {
+        *MPU_CTRL = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            *MPU_RNR = delta->regions[i][0];
+            *MPU_RBAR = delta->regions[i][1];
+            *MPU_RLAR = delta->regions[i][2];
         }
+        *MPU_CTRL = 5;
     }
-    *MPU_CTRL = 5;
 
     // update CONTROL state, note that return-from-exception acts
     // as an instruction barrier
     uint32_t control;
     __asm__ volatile ("mrs %%0, control" : "=r"(control));
-    control = (~1 & control) | (regions->control);
+    control = (~1 & control) | (delta->control);
     __asm__ volatile ("msr control, %%0" :: "r"(control));
 }
 """
@@ -123,35 +127,23 @@ class ARMv8MMPURuntime(ARMv7MMPURuntime):
         output.decls.append(MPU_IMPL)
 
     @override(ARMv7MMPURuntime)
-    def _build_mpu_sysregions(self, output, parent):
-        out = output.decls.append()
-        out.printf('const struct __box_mpuregions __box_sys_mpuregions = {')
-        with out.pushindent():
-            out.printf('.control = 0,')
-            out.printf('.count = 0,')
-            out.printf('.regions = {}')
-        out.printf('};')
+    def _box_mpu_regions(self, box):
+        return [
+            (memory.addr
+                    | (0x1 if 'x' not in memory.mode else 0x0)
+                    | (0x2
+                        if set('rw').issubset(memory.mode) else
+                        0x6
+                        if 'r' in memory.mode else
+                        0x4),
+                (~0x1f & (memory.addr+memory.size-1))
+                    | 0x1)
+            for memory in box.memories + box.sharedmemories]
 
     @override(ARMv7MMPURuntime)
-    def _build_mpu_regions(self, output, parent, box):
-        out = output.decls.append(box=box.name)
-        out.printf('const struct __box_mpuregions __box_%(box)s_mpuregions = {')
-        with out.pushindent():
-            out.printf('.control = 1,')
-            out.printf('.count = %(count)d,', count=len(box.memories))
-            out.printf('.regions = {')
-            with out.pushindent():
-                for memory in box.memories:
-                    out.printf('{%(rbar)#010x, %(rlar)#010x},',
-                        rbar=memory.addr
-                            | (0x1 if 'x' not in memory.mode else 0x0)
-                            | (0x2
-                                if set('rw').issubset(memory.mode) else
-                                0x6
-                                if 'r' in memory.mode else
-                                0x4),
-                        rlar=(~0x1f & (memory.addr+memory.size-1))
-                            | 0x1)
-            out.printf('},')
-        out.printf('};')
-
+    def _mpu_delta(self, slot, region):
+        # no VALID bit, so we need to select the slot with RNR
+        if region is None:
+            return (slot, 0, 0)
+        else:
+            return (slot, region[0], region[1])
@@ -16,6 +16,7 @@ from ..glue.error_glue import ErrorGlue
 from ..glue.write_glue import WriteGlue
 from ..glue.abort_glue import AbortGlue
 from ..glue.heap_glue import HeapGlue
+from ..glue.profile_glue import ProfileGlue
 from ..outputs import OutputBlob
 
 
@@ -445,6 +446,7 @@ class aWsmRuntime(
         WriteGlue,
         AbortGlue,
         HeapGlue,
+        ProfileGlue,
         runtimes.Runtime):
     """
     A bento-box runtime using aWsm, an ahead-of-time compiler for wasm
@@ -473,10 +475,16 @@ class aWsmRuntime(
                 "cost to every box entry point. --no_longjmp disables longjmp "
                 "and forces any unhandled aborts to halt. Note this has no "
                 "affetc if an explicit __box_<box>_abort hook is provided.")
+        parser.add_argument('--outer_longjmp', type=bool,
+            help="Only set up longjmp recovery at the outermost entry into "
+                "the box. Nested entries (box -> sys -> box) reuse the "
+                "outermost recovery point, avoiding a setjmp, but any abort "
+                "unwinds all the way to the outermost entry.")
 
     def __init__(self, bounds_check=None,
             memory=None, table=None,
-            jumptable=None, no_longjmp=None):
+            jumptable=None, no_longjmp=None,
+            outer_longjmp=None):
         super().__init__()
         self._bounds_check = bounds_check or 'branch'
         self._memory = Section('memory', **memory.__dict__)
@@ -487,6 +495,7 @@ class aWsmRuntime(
             self._table.size = 64*8
         self._jumptable = Section('jumptable', **jumptable.__dict__)
         self._no_longjmp = no_longjmp or False
+        self._outer_longjmp = outer_longjmp or False
 
     def box_parent(self, parent, box):
         self._load_hook = parent.addimport(
@@ -513,6 +522,15 @@ class aWsmRuntime(
         super().box_parent(parent, box)
 
     def box(self, box):
+        # boxes only see their linear memory, so can't map in
+        # memory shared with other boxes
+        assert not box.sharedmemories, (
+            "%s: Box `%s` can't use shared memory `%s`, shared memory "
+            "is not supported by wasm runtimes" % (
+                self.name, box.name, box.sharedmemories[0].name))
+        assert not any(export.isqueued() for export in box.exports), (
+            "%s: Box `%s` can't have queued exports, queued exports "
+            "are not supported by wasm runtimes" % (self.name, box.name))
         super().box(box)
         self._memory.alloc(box, 'rw')
         self._table.alloc(box, 'rw')
@@ -554,7 +572,7 @@ class aWsmRuntime(
         # imports that need linking
         for import_ in parent.imports:
             if import_.link and import_.link.export.box == box:
-                yield import_.postbound(), box.init == 'lazy'
+                yield import_.postbound(), box.init != 'manual'
 
     def _parentexports(self, parent, box):
         """
@@ -668,18 +686,42 @@ class aWsmRuntime(
         out.printf('#define __box_%(box)s_exportjumptable '
             '__box_%(box)s_jumptable')
 
+        # route calls through patchable trampolines?
+        trampolines = {}
+        if box.init == 'trampoline':
+            for i, (import_, needsinit) in enumerate(
+                    self._parentimports(parent, box)):
+                if needsinit:
+                    trampolines[import_.name] = (len(trampolines),
+                        import_.prebound(),
+                        '__box_%%(box)s_exportjumptable[%d]' % i)
+        if trampolines:
+            self._build_parent_trampolines(output, box,
+                [(fn, target) for _, fn, target in trampolines.values()])
+
         output.decls.append('//// %(box)s exports ////')
 
         for i, (import_, needsinit) in enumerate(
                 self._parentimports(parent, box)):
+            profiled = self._profiled(parent, box, import_)
             out = output.decls.append(
-                fn=output.repr_fn(import_),
+                fn=output.repr_fn(import_)
+                    if profiled is None else
+                    output.repr_fn(import_,
+                        name='__box_%(box)s_unprofiled_%(alias)s',
+                        attrs=['static']),
                 fnptr=output.repr_fnptr(import_.prebound(), ''),
-                i=i)
+                alias=import_.alias,
+                i=i,
+                jumptable='__box_%(box)s_exportjumptable')
+            if import_.name in trampolines:
+                out.pushattrs(
+                    i=trampolines[import_.name][0],
+                    jumptable='__box_%(box)s_trampolines')
             out.printf('%(fn)s {')
             with out.indent():
                 # inject lazy-init?
-                if needsinit:
+                if needsinit and import_.name not in trampolines:
                     out.printf('if (!__box_%(box)s_initialized) {')
                     with out.indent():
                         out.printf('int err = __box_%(box)s_init();')
@@ -697,11 +739,24 @@ class aWsmRuntime(
                         not self._abort_hook.link and
                         not self._no_longjmp):
                     with out.pushattrs(
-                            pjmpbuf=import_.uniquename('pjmpbuf'),
+                            pjmpbuf=import_.uniquename('pjmpbuf')
+                                if not self._outer_longjmp else 'NULL',
                             jmpbuf=import_.uniquename('jmpbuf'),
                             err=import_.uniquename('err')):
-                        out.printf('jmp_buf *%(pjmpbuf)s = '
-                            '__box_%(box)s_jmpbuf;')
+                        if self._outer_longjmp:
+                            # only the outermost call needs a recovery point
+                            out.printf('if (__box_%(box)s_jmpbuf) {')
+                            with out.indent():
+                                out.printf('return ((%(fnptr)s)\n'
+                                    '        %(jumptable)s[%(i)d])'
+                                    '(%(args)s);',
+                                    args=', '.join(map(str,
+                                        import_.argnamesandbounds())))
+                            out.printf('}')
+                            out.printf()
+                        else:
+                            out.printf('jmp_buf *%(pjmpbuf)s = '
+                                '__box_%(box)s_jmpbuf;')
                         out.printf('jmp_buf %(jmpbuf)s;')
                         out.printf('__box_%(box)s_jmpbuf = &%(jmpbuf)s;')
                         out.printf('int %(err)s = setjmp(%(jmpbuf)s);')
@@ -712,7 +767,7 @@ class aWsmRuntime(
                         out.printf('}')
                 # jump to jumptable entry
                 out.printf('%(return_)s((%(fnptr)s)\n'
-                    '        __box_%(box)s_exportjumptable[%(i)d])(%(args)s);',
+                    '        %(jumptable)s[%(i)d])(%(args)s);',
                     return_=('return ' if import_.rets else '')
                         if not (import_.isfalible() and
                             not self._abort_hook.link and
@@ -729,12 +784,18 @@ class aWsmRuntime(
                         not self._abort_hook.link and
                         not self._no_longjmp):
                     with out.pushattrs(
-                            pjmpbuf=import_.uniquename('pjmpbuf')):
+                            pjmpbuf=import_.uniquename('pjmpbuf')
+                                if not self._outer_longjmp else 'NULL'):
                         out.printf('__box_%(box)s_jmpbuf = %(pjmpbuf)s;')
                         if import_.rets:
                             out.printf('return %(ret)s;',
                                 ret=import_.retname())
             out.printf('}')
+
+            if profiled is not None:
+                self._build_parent_profile(output, profiled, import_,
+                    import_.alias,
+                    '__box_%%(box)s_unprofiled_%s' % import_.alias)
             
         output.decls.append('//// %(box)s imports ////')
 
@@ -749,6 +810,9 @@ class aWsmRuntime(
                 out.printf('%(fn)s {')
                 with out.indent():
                     out.printf('__box_%(box)s_initialized = false;')
+                    self._build_parent_unload(out, box)
+                    if trampolines:
+                        out.printf('__box_%(box)s_patch(false);')
                     out.printf('if (__box_%(box)s_jmpbuf) {')
                     with out.indent():
                         out.printf('longjmp(*__box_%(box)s_jmpbuf, err);')
@@ -776,6 +840,10 @@ class aWsmRuntime(
                 doc='redirect %(flush_hook)s -> __box_flush')
             out.printf('#define %(flush_hook)s __box_flush')
 
+        # profile calls into the parent?
+        profiled = self._build_parent_profile_exports(output, parent, box,
+            (export for export, _ in self._parentexports(parent, box)))
+
         # wrappers?
         for export in (export
                 for export, needswrapper in self._parentexports(parent, box)
@@ -784,10 +852,11 @@ class aWsmRuntime(
                 fn=output.repr_fn(
                     export.postbound(),
                     name='__box_%(box)s_export_%(alias)s'),
-                alias=export.alias)
+                alias=export.alias,
+                target=profiled.get(export.name, export.alias))
             out.printf('%(fn)s {')
             with out.indent():
-                out.printf('%(return_)s%(alias)s(%(args)s);',
+                out.printf('%(return_)s%(target)s(%(args)s);',
                     return_='return ' if import_.rets else '',
                     args=', '.join(map(str, export.argnamesandbounds())))
             out.printf('}')
@@ -797,13 +866,16 @@ class aWsmRuntime(
         out.printf('const uint32_t __box_%(box)s_importjumptable[] = {')
         with out.indent():
             for export, needswrapper in self._parentexports(parent, box):
-                out.printf('(uint32_t)%(prefix)s%(alias)s,',
-                    prefix='__box_%(box)s_export_' if needswrapper else '',
-                    alias=export.alias)
+                out.printf('(uint32_t)%(target)s,',
+                    target='__box_%(box)s_export_'+export.alias
+                        if needswrapper else
+                        profiled.get(export.name, export.alias))
         out.printf('};')
 
         # init
         output.decls.append('//// %(box)s init ////')
+        self._build_parent_prefetch(output, box,
+            '__box_%(box)s_initialized')
         out = output.decls.append()
         out.printf('int __box_%(box)s_init(void) {')
         with out.indent():
@@ -813,40 +885,24 @@ class aWsmRuntime(
                 out.printf('return 0;')
             out.printf('}')
             out.printf()
-            if box.roommates:
-                out.printf('// bring down any overlapping boxes')
-            for i, roommate in enumerate(box.roommates):
-                with out.pushattrs(roommate=roommate.name):
-                    out.printf('extern int __box_%(roommate)s_clobber(void);')
-                    out.printf('err = __box_%(roommate)s_clobber();')
-                    out.printf('if (err) {')
-                    with out.indent():
-                        out.printf('return err;')
-                    out.printf('}')
-                    out.printf()
-            out.printf('// load the box if unloaded')
-            out.printf('err = __box_%(box)s_load();')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
-            out.printf('// call box\'s init')
-            out.printf('err = __box_%(box)s_postinit('
-                '__box_%(box)s_importjumptable);')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
+            self._build_parent_roommates(out, box)
+            self._build_parent_load(out, box)
+            self._build_parent_postinit(out, box,
+                '__box_%(box)s_postinit(__box_%(box)s_importjumptable)')
             out.printf('__box_%(box)s_initialized = true;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(true);')
             out.printf('return 0;')
         out.printf('}')
 
         out = output.decls.append()
         out.printf('int __box_%(box)s_clobber(void) {')
         with out.indent():
+            self._build_parent_clobber(out, box,
+                '__box_%(box)s_initialized')
             out.printf('__box_%(box)s_initialized = false;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(false);')
             out.printf('return 0;')
         out.printf('}')
 
@@ -0,0 +1,683 @@
+#
+# Jumptable-based runtime for boxes running as a part of a host process
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from .. import runtimes
+from ..box import Import
+from .jumptable import JumptableRuntime
+from .host_sys import HostSysRuntime
+
+# box-side libc, the host's libc needs the process's TLS and heap state,
+# so instead of linking libc into the box we resolve libc's functions in
+# the host process during init
+MK_LIBC_RULES = """
+# find symbols the box needs from libc
+%%.libc.elf: $(OBJ) $(LDSCRIPT)
+	$(CC) $(OBJ) $(LDFLAGS) -Wl,--unresolved-symbols=ignore-all -o $@
+
+# create stubs that jump through a table filled in during __box_init
+%%.libc.o: %%.libc.elf
+	$(strip $(OBJDUMP) -t $< | awk '\\
+	    $$2 == "*UND*" && NF == 4 && $$4 !~ /^__box_libc_/ { \\
+	        if (!($$4 in s)) {s[$$4]; n[c++] = $$4}} \\
+	    END {print ".section .text.__box_libc,\\"ax\\",@progbits"} \\
+	    END {for (i = 0; i < c; i++) { \\
+	        print ".globl " n[i]; \\
+	        print ".type " n[i] ",@function"; \\
+	        print n[i] ": jmp *__box_libc_got+" 8*i "(%%rip)"}} \\
+	    END {print ".section .rodata.__box_libc,\\"a\\",@progbits"} \\
+	    END {print ".globl __box_libc_names"} \\
+	    END {print ".balign 8"} \\
+	    END {print "__box_libc_names:"} \\
+	    END {for (i = 0; i < c; i++) print ".quad __box_libc_name" i} \\
+	    END {print ".quad 0"} \\
+	    END {for (i = 0; i < c; i++) \\
+	        print "__box_libc_name" i ": .asciz \\"" n[i] "\\""} \\
+	    END {print ".section .bss.__box_libc,\\"aw\\",@nobits"} \\
+	    END {print ".globl __box_libc_got"} \\
+	    END {print ".balign 8"} \\
+	    END {print "__box_libc_got: .zero " 8*c+8} \\
+	    END {print ".section .note.GNU-stack,\\"\\",@progbits"}' \\
+	    | $(CC) -c -x assembler - -o $@)
+"""
+
+BOX_STDIO = """
+// libc's stdio is replaced by __box_write, we just need unique handles
+static uint8_t __box_stdio[3];
+FILE *stdin = (FILE*)&__box_stdio[0];
+FILE *stdout = (FILE*)&__box_stdio[1];
+FILE *stderr = (FILE*)&__box_stdio[2];
+
+__attribute__((noreturn))
+void __assert_fail(const char *expr, const char *file,
+        unsigned int line, const char *func) {
+    printf("%%s:%%d: assertion \\"%%s\\" failed\\n", file, line, expr);
+    %(abort)s(-1);
+}
+"""
+
+@runtimes.runtime
+class HostRuntime(JumptableRuntime):
+    """
+    A bento-box runtime that runs boxes inside a process on the host
+    (Linux x86-64). Box memories are mapped at fixed addresses and boxes
+    are linked through jumptables. No isolation is applied, see
+    host-mprotect for a variant that isolates boxes.
+    """
+    __argname__ = "host"
+    __arghelp__ = __doc__
+    _isolate = False
+
+    def box(self, box):
+        assert box.parent and box.parent.runtime == 'host_sys', (
+            "The runtime `%s` requires `host-sys` as its parent runtime"
+            % self.__argname__)
+        # memories are mapped with mmap and linked with the small code
+        # model, so must be page-aligned and in the low 2 GiB
+        for memory in box.memories:
+            assert (memory.addr % HostSysRuntime.PAGE == 0 and
+                memory.size % HostSysRuntime.PAGE == 0), (
+                "Memory %s in box %s is not aligned to the host's "
+                "page size %#x" % (
+                    memory.name, box.name, HostSysRuntime.PAGE))
+            assert memory.addr + memory.size <= 0x80000000, (
+                "Memory %s in box %s does not fit in the low 2 GiB of "
+                "the host's address space" % (memory.name, box.name))
+        for shared in box.sharedmemories:
+            assert (shared.addr % HostSysRuntime.PAGE == 0 and
+                shared.size % HostSysRuntime.PAGE == 0), (
+                "Shared memory %s in box %s is not aligned to the host's "
+                "page size %#x" % (
+                    shared.name, box.name, HostSysRuntime.PAGE))
+
+        super().box(box)
+
+    def pageprotects(self, box):
+        # only if we aren't already using page protections for isolation
+        return not self._isolate
+
+    def box_parent(self, parent, box):
+        super().box_parent(parent, box)
+        self._pagefault_hook = parent.addimport(
+            '__box_%s_pagefault' % box.name, 'fn(usize addr) -> err',
+            scope=parent.name, source=self.__argname__, weak=True,
+            doc="Called on faults before aborting the box, lets loaders "
+                "page in memory on demand. Returns 0 if the fault was "
+                "handled.")
+        # we can only hand out control of page protections if we
+        # aren't already using them for isolation
+        if not self._isolate:
+            self._pageprotect_plug = parent.addexport(
+                '__box_%s_pageprotect' % box.name,
+                'fn(mut u8 *page, usize size, u32 prot) -> err',
+                scope=parent.name, source=self.__argname__, weak=True)
+
+    def _parentimports(self, parent, box):
+        # our jumptables are pointer-sized
+        for import_, needsinit in super()._parentimports(parent, box):
+            if import_.name == '__box_%s_postinit' % box.name:
+                yield Import(
+                    '__box_%s_postinit' % box.name,
+                   r'fn(const u64*) -> err32',
+                    source=self.__argname__), needsinit
+            else:
+                yield import_, needsinit
+
+    def _jumptableaddr(self, box):
+        return next(memory.addr for memory in box.memories
+            if memory.name == self._jumptable.memory.name)
+
+    def build_mk(self, output, box):
+        assert output.get('cpu') == 'host', ("The runtime `%s` requires "
+            "the host toolchain, please provide --output.mk.cpu=host"
+            % self.__argname__)
+
+        # target rule
+        output.decls.insert(0, '%(name)-16s ?= %(target)s',
+            name='TARGET', target=output.get('target', '%(box)s.elf'))
+
+        out = output.rules.append(doc='target rule')
+        out.printf('$(TARGET): $(OBJ) $(BOXES) $(LDSCRIPT) '
+            '$(TARGET:.elf=.libc.o)')
+        with out.indent():
+            out.printf('$(CC) $(OBJ) $(BOXES) $(TARGET:.elf=.libc.o) '
+                '$(LDFLAGS) -o $@')
+
+        output.rules.append(MK_LIBC_RULES)
+
+        # skip the jumptable's target rule
+        super(JumptableRuntime, self).build_mk(output, box)
+
+        out = output.decls.append()
+        out.printf('### host glue ###')
+        out.printf('override LDFLAGS += -nostdlib')
+        out.printf('override LDFLAGS += -static')
+        out.printf('override LDFLAGS += -Wl,--build-id=none')
+        out.printf('override LDFLAGS += -lgcc')
+
+    def build_parent_mk(self, output, parent, box):
+        super().build_parent_mk(output, parent, box)
+
+        # without a linker script we need to place loadable memories
+        # explicitly
+        out = output.decls.append()
+        for memory in box.memories:
+            if 'p' in memory.mode:
+                out.printf('override LDFLAGS += '
+                    '-Wl,--section-start=.box.%(box)s.%(memory)s=%(addr)#.8x',
+                    memory=memory.name,
+                    addr=memory.addr)
+
+        # and provide the memory symbols a linker script would, loaders
+        # rely on these
+        out = output.decls.append()
+        for memory in box.memories:
+            with out.pushattrs(memory=memory.name):
+                out.printf('override LDFLAGS += '
+                    '-Wl,--defsym=__box_%(box)s_%(memory)s_start=%(addr)#.8x',
+                    addr=memory.addr)
+                out.printf('override LDFLAGS += '
+                    '-Wl,--defsym=__box_%(box)s_%(memory)s_end=%(addr)#.8x',
+                    addr=memory.addr + memory.size)
+
+    def build_parent_c(self, output, parent, box):
+        # skip the jumptable's glue
+        super(JumptableRuntime, self).build_parent_c(output, parent, box)
+
+        longjmp = not self._abort_hook.link and not self._no_longjmp
+        i = [child for child in parent.boxes
+            if hasattr(child.runtime, '_isolate')].index(box) + 1
+
+        out = output.decls.append()
+        out.printf('//// %(box)s state ////')
+        out.printf('bool __box_%(box)s_initialized = false;')
+        if longjmp:
+            out.printf('jmp_buf *__box_%(box)s_jmpbuf = NULL;')
+        if box.stack.size > 0:
+            out.printf('uint8_t *__box_%(box)s_datasp = NULL;')
+        out.printf('#define __box_%(box)s_exportjumptable '
+            '((const uintptr_t*)%(jumptable)#010x)',
+            jumptable=self._jumptableaddr(box))
+
+        # queued calls are written into a queue in the box, this doesn't
+        # need to switch protections since we're already in the sys
+        queued = [(j+1 if box.stack.size > 0 else j, import_)
+            for j, (import_, _) in enumerate(
+                self._parentimports(parent, box))
+            if import_.isqueued()]
+        if queued:
+            self._build_parent_queue(output, box, queued,
+                initialized='__box_%(box)s_initialized'
+                    if box.init != 'manual' else None)
+
+        # route calls through patchable trampolines?
+        trampolines = {}
+        if box.init == 'trampoline':
+            for j, (import_, needsinit) in enumerate(
+                    self._parentimports(parent, box)):
+                if needsinit and not import_.isqueued():
+                    trampolines[import_.name] = (len(trampolines),
+                        import_.prebound(),
+                        '__box_%%(box)s_exportjumptable[%d]'
+                            % (j+1 if box.stack.size > 0 else j))
+        if trampolines:
+            self._build_parent_trampolines(output, box,
+                [(fn, target) for _, fn, target in trampolines.values()],
+                type='uintptr_t')
+
+        output.decls.append('//// %(box)s exports ////')
+
+        for j, (import_, needsinit) in enumerate(
+                self._parentimports(parent, box)):
+            if import_.isqueued():
+                continue
+            profiled = self._profiled(parent, box, import_)
+            out = output.decls.append(
+                fn=output.repr_fn(import_)
+                    if profiled is None else
+                    output.repr_fn(import_,
+                        name='__box_%(box)s_unprofiled_%(alias)s',
+                        attrs=['static']),
+                fnptr=output.repr_fnptr(import_.prebound(), ''),
+                alias=import_.alias,
+                i=i,
+                j=j+1 if box.stack.size > 0 else j,
+                jumptable='__box_%(box)s_exportjumptable')
+            if import_.name in trampolines:
+                out.pushattrs(
+                    j=trampolines[import_.name][0],
+                    jumptable='__box_%(box)s_trampolines')
+            out.printf('%(fn)s {')
+            with out.indent():
+                # inject lazy-init?
+                if needsinit and import_.name not in trampolines:
+                    out.printf('if (!__box_%(box)s_initialized) {')
+                    with out.indent():
+                        out.printf('int err = __box_%(box)s_init();')
+                        out.printf('if (err) {')
+                        with out.indent():
+                            if import_.isfalible():
+                                out.printf('return err;')
+                            else:
+                                out.printf('__box_abort(err);')
+                        out.printf('}')
+                    out.printf('}')
+                    out.printf()
+                # run any queued calls first to keep calls in order
+                if queued and import_.source != self.__argname__:
+                    self._build_parent_predrain(out, import_)
+                with out.pushattrs(
+                        prev=import_.uniquename('prev'),
+                        pjmpbuf=import_.uniquename('pjmpbuf')
+                            if not self._outer_longjmp else 'NULL',
+                        jmpbuf=import_.uniquename('jmpbuf'),
+                        err=import_.uniquename('err'),
+                        ret=import_.retname()):
+                    out.printf('uint32_t %(prev)s = __box_host_switch(%(i)d);')
+                    # use longjmp?
+                    if import_.isfalible() and longjmp:
+                        if self._outer_longjmp:
+                            # only the outermost call needs a recovery point
+                            out.printf('if (__box_%(box)s_jmpbuf) {')
+                            with out.indent():
+                                out.printf('%(rettype)s = ((%(fnptr)s)\n'
+                                    '        %(jumptable)s[%(j)d])'
+                                    '(%(args)s);',
+                                    rettype=output.repr_arg(
+                                        import_.rets[0], import_.retname()),
+                                    args=', '.join(map(str,
+                                        import_.argnamesandbounds())))
+                                out.printf('__box_host_switch(%(prev)s);')
+                                out.printf('return %(ret)s;')
+                            out.printf('}')
+                            out.printf()
+                        else:
+                            out.printf('jmp_buf *%(pjmpbuf)s = '
+                                '__box_%(box)s_jmpbuf;')
+                        out.printf('jmp_buf %(jmpbuf)s;')
+                        out.printf('__box_%(box)s_jmpbuf = &%(jmpbuf)s;')
+                        out.printf('int %(err)s = setjmp(%(jmpbuf)s);')
+                        out.printf('if (%(err)s) {')
+                        with out.indent():
+                            out.printf('__box_%(box)s_jmpbuf = %(pjmpbuf)s;')
+                            out.printf('__box_host_switch(%(prev)s);')
+                            out.printf('return %(err)s;')
+                        out.printf('}')
+                    # jump to jumptable entry
+                    out.printf('%(return_)s((%(fnptr)s)\n'
+                        '        %(jumptable)s[%(j)d])'
+                        '(%(args)s);',
+                        return_=('%s = ' % output.repr_arg(
+                                import_.rets[0], import_.retname())
+                            if import_.rets else ''),
+                        args=', '.join(map(str,
+                            import_.argnamesandbounds())))
+                    if import_.isnoreturn():
+                        # kinda wish we could apply noreturn to C types...
+                        out.printf('__builtin_unreachable();')
+                    if import_.isfalible() and longjmp:
+                        out.printf('__box_%(box)s_jmpbuf = %(pjmpbuf)s;')
+                    out.printf('__box_host_switch(%(prev)s);')
+                    if import_.rets:
+                        out.printf('return %(ret)s;')
+            out.printf('}')
+
+            if profiled is not None:
+                self._build_parent_profile(output, profiled, import_,
+                    import_.alias,
+                    '__box_%%(box)s_unprofiled_%s' % import_.alias)
+
+        output.decls.append('//// %(box)s imports ////')
+
+        # redirect hooks if necessary
+        if not self._abort_hook.link:
+            if not self._no_longjmp:
+                # use longjmp to recover from explicit aborts
+                output.includes.append('<setjmp.h>')
+                out = output.decls.append(
+                    fn=output.repr_fn(self._abort_hook,
+                        self._abort_hook.name))
+                out.printf('%(fn)s {')
+                with out.indent():
+                    out.printf('__box_%(box)s_initialized = false;')
+                    self._build_parent_unload(out, box)
+                    if trampolines:
+                        out.printf('__box_%(box)s_patch(false);')
+                    out.printf('if (__box_%(box)s_jmpbuf) {')
+                    with out.indent():
+                        out.printf('longjmp(*__box_%(box)s_jmpbuf, err);')
+                    out.printf('} else {')
+                    with out.indent():
+                        out.printf('__box_abort(err);')
+                    out.printf('}')
+                out.printf('}')
+            else:
+                # just redirect to parent's __box_abort
+                out = output.decls.append(
+                    abort_hook=self._abort_hook.name,
+                    doc='redirect %(abort_hook)s -> __box_abort')
+                out.printf('#define %(abort_hook)s __box_abort')
+
+        if not self._write_hook.link:
+            out = output.decls.append(
+                write_hook=self._write_hook.name,
+                doc='redirect %(write_hook)s -> __box_write')
+            out.printf('#define %(write_hook)s __box_write')
+
+        if not self._flush_hook.link:
+            out = output.decls.append(
+                flush_hook=self._flush_hook.name,
+                doc='redirect %(flush_hook)s -> __box_flush')
+            out.printf('#define %(flush_hook)s __box_flush')
+
+        # fault handler, called by the host's signal handler
+        out = output.decls.append()
+        out.printf('__attribute__((noreturn))')
+        out.printf('void __box_%(box)s_fault(int err) {')
+        with out.indent():
+            out.printf('%(abort_hook)s(err);',
+                abort_hook=self._abort_hook.link.export.alias
+                    if self._abort_hook.link else
+                    self._abort_hook.name)
+        out.printf('}')
+
+        if not self._isolate and self._pageprotect_plug.links:
+            out = output.decls.append(
+                fn=output.repr_fn(self._pageprotect_plug))
+            out.printf('%(fn)s {')
+            with out.indent():
+                out.printf('int prot_ = ((prot & 0x4) ? PROT_READ : 0)')
+                out.printf('        | ((prot & 0x2) ? PROT_WRITE : 0)')
+                out.printf('        | ((prot & 0x1) ? PROT_EXEC : 0);')
+                out.printf('if (mprotect(page, size, prot_)) {')
+                with out.indent():
+                    out.printf('return -EFAULT;')
+                out.printf('}')
+                out.printf()
+                out.printf('return 0;')
+            out.printf('}')
+
+        # profile calls into the sys?
+        profiled = self._build_parent_profile_exports(output, parent, box,
+            (export for export, _ in self._parentexports(parent, box)))
+
+        # wrappers, all calls into the sys need to switch protections
+        for export, _ in self._parentexports(parent, box):
+            out = output.decls.append(
+                fn=output.repr_fn(
+                    export.postbound(),
+                    name='__box_%(box)s_export_%(alias)s'),
+                alias=export.alias,
+                target=profiled.get(export.name, export.alias))
+            out.printf('%(fn)s {')
+            with out.indent():
+                with out.pushattrs(
+                        prev=export.uniquename('prev'),
+                        ret=export.uniquename('ret')):
+                    out.printf('uint32_t %(prev)s = __box_host_switch(0);')
+                    if export.isnoreturn():
+                        out.printf('(void)%(prev)s;')
+                        out.printf('%(target)s(%(args)s);',
+                            args=', '.join(map(str,
+                                export.argnamesandbounds())))
+                    else:
+                        out.printf('%(return_)s%(target)s(%(args)s);',
+                            return_='%s = ' % output.repr_arg(
+                                    export.rets[0], export.retname())
+                                if export.rets else '',
+                            args=', '.join(map(str,
+                                export.argnamesandbounds())))
+                        out.printf('__box_host_switch(%(prev)s);')
+                        if export.rets:
+                            out.printf('return %(ret)s;',
+                                ret=export.retname())
+            out.printf('}')
+
+        # import jumptable
+        out = output.decls.append()
+        out.printf('const uintptr_t __box_%(box)s_importjumptable[] = {')
+        with out.indent():
+            out.printf('(uintptr_t)__box_host_resolve,')
+            for export, _ in self._parentexports(parent, box):
+                out.printf('(uintptr_t)__box_%(box)s_export_%(alias)s,',
+                    alias=export.alias)
+        out.printf('};')
+
+        # init
+        output.decls.append('//// %(box)s init ////')
+        self._build_parent_prefetch(output, box,
+            '__box_%(box)s_initialized',
+            map='__box_host_map(%d)' % i)
+        out = output.decls.append()
+        out.printf('int __box_%(box)s_init(void) {')
+        with out.indent():
+            out.printf('int err;')
+            out.printf('if (__box_%(box)s_initialized) {')
+            with out.indent():
+                out.printf('return 0;')
+            out.printf('}')
+            out.printf()
+            self._build_parent_roommates(out, box)
+            out.printf('// map the box\'s memory')
+            out.printf('err = __box_host_map(%(i)d);', i=i)
+            out.printf('if (err) {')
+            with out.indent():
+                out.printf('return err;')
+            out.printf('}')
+            out.printf()
+            self._build_parent_load(out, box)
+            if box.stack.size > 0:
+                out.printf('// prepare data stack')
+                out.printf('__box_%(box)s_datasp = '
+                    '(void*)__box_%(box)s_exportjumptable[0];')
+                out.printf()
+            self._build_parent_postinit(out, box,
+                '__box_%(box)s_postinit(__box_%(box)s_importjumptable)')
+            if queued:
+                out.printf('// find the box\'s queue')
+                out.printf('__box_%(box)s_queue = '
+                    '(void*)__box_%(box)s_exportjumptable[%(n)d];',
+                    n=(1 if box.stack.size > 0 else 0)
+                        + len(list(self._exports(box))))
+                out.printf()
+            out.printf('__box_%(box)s_initialized = true;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(true);')
+            out.printf('return 0;')
+        out.printf('}')
+
+        out = output.decls.append()
+        out.printf('int __box_%(box)s_clobber(void) {')
+        with out.indent():
+            self._build_parent_clobber(out, box,
+                '__box_%(box)s_initialized',
+                queued=bool(queued))
+            out.printf('__box_%(box)s_initialized = false;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(false);')
+            out.printf('__box_host_unmap(%(i)d);', i=i)
+            out.printf('return 0;')
+        out.printf('}')
+
+        # stack manipulation
+        output.includes.append('<assert.h>')
+        stack = next((memory for memory in box.memories
+                if box.stack.size > 0
+                if memory.name == box.stack.memory.name), None)
+        out = output.decls.append(
+            start=stack.addr if stack else 0,
+            end=stack.addr+stack.size if stack else 0)
+        out.printf('void *__box_%(box)s_push(size_t size) {')
+        with out.indent():
+            if box.stack.size > 0:
+                out.printf('size = ((size+7)/8)*8;')
+                out.printf('if (__box_%(box)s_datasp - size '
+                        '< (uint8_t*)%(start)#010x) {')
+                with out.indent():
+                    out.printf('return NULL;')
+                out.printf('}')
+                out.printf()
+                out.printf('__box_%(box)s_datasp -= size;')
+                out.printf('return __box_%(box)s_datasp;')
+            else:
+                out.printf('return NULL;')
+        out.printf('}')
+
+        out = output.decls.append(
+            start=stack.addr if stack else 0,
+            end=stack.addr+stack.size if stack else 0)
+        out.printf('void __box_%(box)s_pop(size_t size) {')
+        with out.indent():
+            if box.stack.size > 0:
+                out.printf('size = ((size+7)/8)*8;')
+                out.printf('assert(__box_%(box)s_datasp + size '
+                    '<= (uint8_t*)%(end)#010x);')
+                out.printf('__box_%(box)s_datasp += size;')
+            else:
+                out.printf('assert(false);')
+        out.printf('}')
+
+    def build_c(self, output, box):
+        # skip the jumptable's glue
+        super(JumptableRuntime, self).build_c(output, box)
+
+        # not pulled in by glibc's headers
+        output.includes.append('<stddef.h>')
+
+        out = output.decls.append()
+        out.printf('//// jumptable implementation ////')
+        out.printf('const uintptr_t *__box_importjumptable;')
+
+        out = output.decls.append()
+        out.printf('int __box_init(const uintptr_t *importjumptable) {')
+        with out.indent():
+            if self.data_init_hook.link:
+                out.printf('// data inited by %(hook)s',
+                    hook=self.data_init_hook.link.export.source)
+                out.printf()
+            else:
+                out.printf('// load data')
+                out.printf('extern uint32_t __data_init_start;')
+                out.printf('extern uint32_t __data_start;')
+                out.printf('extern uint32_t __data_end;')
+                out.printf('const uint32_t *s = &__data_init_start;')
+                out.printf('for (uint32_t *d = &__data_start; '
+                    'd < &__data_end; d++) {')
+                with out.indent():
+                    out.printf('*d = *s++;')
+                out.printf('}')
+                out.printf()
+            if self.bss_init_hook.link:
+                out.printf('// bss inited by %(hook)s',
+                    hook=self.bss_init_hook.link.export.source)
+                out.printf()
+            else:
+                out.printf('// zero bss')
+                out.printf('extern uint32_t __bss_start;')
+                out.printf('extern uint32_t __bss_end;')
+                out.printf('for (uint32_t *d = &__bss_start; '
+                    'd < &__bss_end; d++) {')
+                with out.indent():
+                    out.printf('*d = 0;')
+                out.printf('}')
+                out.printf()
+            out.printf('// resolve libc through the host')
+            out.printf('extern const char *const __box_libc_names[];')
+            out.printf('extern void *__box_libc_got[];')
+            out.printf('void *(*resolve)(const char *name) = '
+                '(void *(*)(const char *))importjumptable[0];')
+            out.printf('for (int i = 0; __box_libc_names[i]; i++) {')
+            with out.indent():
+                out.printf('__box_libc_got[i] = '
+                    'resolve(__box_libc_names[i]);')
+                out.printf('if (!__box_libc_got[i]) {')
+                with out.indent():
+                    out.printf('return -ENOENT;')
+                out.printf('}')
+            out.printf('}')
+            out.printf()
+            out.printf('// set import jumptable')
+            out.printf('__box_importjumptable = importjumptable+1;')
+            out.printf()
+            out.printf('// init libc')
+            out.printf('extern void (*__preinit_array_start[])(void);')
+            out.printf('extern void (*__preinit_array_end[])(void);')
+            out.printf('for (void (**f)(void) = __preinit_array_start; '
+                'f < __preinit_array_end; f++) {')
+            with out.indent():
+                out.printf('(*f)();')
+            out.printf('}')
+            out.printf('extern void (*__init_array_start[])(void);')
+            out.printf('extern void (*__init_array_end[])(void);')
+            out.printf('for (void (**f)(void) = __init_array_start; '
+                'f < __init_array_end; f++) {')
+            with out.indent():
+                out.printf('(*f)();')
+            out.printf('}')
+            out.printf()
+            out.printf('return 0;')
+        out.printf('}')
+
+        if not output.no_stdlib_hooks:
+            output.decls.append(BOX_STDIO)
+
+        output.decls.append('//// imports ////')
+        for i, import_ in enumerate(self._imports(box)):
+            out = output.decls.append(
+                fn=output.repr_fn(import_),
+                fnptr=output.repr_fnptr(import_, ''),
+                i=i)
+            out.printf('%(fn)s {')
+            with out.indent():
+                out.printf('%(return_)s((%(fnptr)s)\n'
+                    '        __box_importjumptable[%(i)d])(%(args)s);',
+                    return_='return ' if import_.rets else '',
+                    args=', '.join(map(str, import_.argnamesandbounds())))
+                if import_.isnoreturn():
+                    # kinda wish we could apply noreturn to C types...
+                    out.printf('__builtin_unreachable();')
+            out.printf('}')
+
+        output.decls.append('//// exports ////')
+        for export in (export
+                for export, needswrapper in self._exports(box)
+                if needswrapper):
+            out = output.decls.append(
+                fn=output.repr_fn(
+                    export.postbound(),
+                    name='__box_export_%(alias)s'),
+                alias=export.alias)
+            out.printf('%(fn)s {')
+            with out.indent():
+                out.printf('%(return_)s%(alias)s(%(args)s);',
+                    return_='return ' if export.rets else '',
+                    args=', '.join(map(str, export.argnamesandbounds())))
+            out.printf('}')
+
+        queued = [(i+1 if box.stack.size > 0 else i,
+                export.postbound(),
+                '__box_export_'+export.alias if needswrapper else
+                    export.alias)
+            for i, (export, needswrapper) in enumerate(self._exports(box))
+            if export.isqueued()]
+        if queued:
+            self._build_queue(output, box, queued)
+
+        out = output.decls.append(doc='box-side jumptable')
+        if box.stack.size > 0:
+            out.printf('extern uint8_t __stack_end;')
+        out.printf('__attribute__((used, section(".jumptable")))')
+        out.printf('const uintptr_t __box_exportjumptable[] = {')
+        with out.pushindent():
+            if box.stack.size > 0:
+                out.printf('(uintptr_t)&__stack_end,')
+            for export, needswrapper in self._exports(box):
+                out.printf('(uintptr_t)%(prefix)s%(alias)s,',
+                    prefix='__box_export_' if needswrapper else '',
+                    alias=export.alias)
+            if queued:
+                out.printf('(uintptr_t)&__box_queue,')
+        out.printf('};')
@@ -0,0 +1,23 @@
+#
+# Runtime for boxes running as a part of a host process, isolated
+# with mprotect
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from .. import runtimes
+from .host import HostRuntime
+
+@runtimes.runtime
+class HostMProtectRuntime(HostRuntime):
+    """
+    A bento-box runtime that runs boxes inside a process on the host
+    (Linux x86-64), using mprotect to isolate boxes from each other.
+    Memory of other boxes is protected with PROT_NONE while the box
+    runs, and any SIGSEGV/SIGBUS raised by the box aborts the box.
+    Note the sys's memory is not protected.
+    """
+    __argname__ = "host_mprotect"
+    __arghelp__ = __doc__
+    _isolate = True
@@ -0,0 +1,358 @@
+#
+# Runtime for running the base system as a process on the host
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from .. import runtimes
+from ..glue.error_glue import ErrorGlue
+from ..glue.write_glue import WriteGlue
+from ..glue.abort_glue import AbortGlue
+from ..glue.profile_glue import ProfileGlue
+
+HOST_STATE = """
+#define __BOX_HOST_PAGE %(page)d
+
+struct __box_host_region {
+    uintptr_t addr;
+    size_t size;
+    uint32_t box;
+    uint32_t shared;
+    int prot;
+    bool isolate;
+};
+"""
+
+HOST_IMPL = """
+uint32_t __box_host_active = 0;
+
+static void __box_host_protect(uint32_t active) {
+    for (int i = 0; i < __BOX_HOST_REGIONS; i++) {
+        const struct __box_host_region *region = &__box_host_regions[i];
+        if (__box_host_prots[i] < 0) {
+            continue;
+        }
+
+        // isolated regions are only accessible to their box, the sys,
+        // and any boxes they are shared with
+        int prot = (active && region->isolate && region->box != active &&
+                !(region->shared & (1 << active)))
+            ? PROT_NONE
+            : region->prot;
+        // only reprotect regions that change
+        if (prot != __box_host_prots[i]) {
+            if (mprotect((void*)region->addr, region->size, prot)) {
+                __box_abort(-EFAULT);
+            }
+            __box_host_prots[i] = prot;
+        }
+    }
+}
+
+uint32_t __box_host_switch(uint32_t box) {
+    uint32_t prev = __box_host_active;
+    if (box != prev) {
+        __box_host_active = box;
+        __box_host_protect(box);
+    }
+    return prev;
+}
+
+int __box_host_map(uint32_t box) {
+    for (int i = 0; i < __BOX_HOST_REGIONS; i++) {
+        const struct __box_host_region *region = &__box_host_regions[i];
+        if (region->box != box || __box_host_prots[i] >= 0) {
+            continue;
+        }
+
+        // loadable memories are already mapped as a part of our
+        // executable, fill in any pages that are missing
+        for (uintptr_t page = region->addr;
+                page < region->addr + region->size;
+                page += __BOX_HOST_PAGE) {
+            void *p = mmap((void*)page, __BOX_HOST_PAGE,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+                    -1, 0);
+            if (p != MAP_FAILED && p != (void*)page) {
+                // kernel doesn't understand MAP_FIXED_NOREPLACE?
+                munmap(p, __BOX_HOST_PAGE);
+                return -ENOMEM;
+            }
+        }
+
+        if (mprotect((void*)region->addr, region->size, region->prot)) {
+            return -EFAULT;
+        }
+        __box_host_prots[i] = region->prot;
+    }
+
+    // make sure the new regions are protected correctly
+    __box_host_protect(__box_host_active);
+    return 0;
+}
+
+void __box_host_unmap(uint32_t box) {
+    // leave the pages mapped, but stop managing them, this lets
+    // roommates reclaim the memory
+    for (int i = 0; i < __BOX_HOST_REGIONS; i++) {
+        if (__box_host_regions[i].box == box) {
+            __box_host_prots[i] = -1;
+        }
+    }
+}
+
+void *__box_host_resolve(const char *name) {
+    return dlsym(RTLD_DEFAULT, name);
+}
+"""
+
+HOST_CLOCK = """
+static inline void __box_profile_enable(void) {
+    // clock_gettime is always running
+}
+
+static inline uint32_t __box_profile_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec*1000000000 + (uint32_t)ts.tv_nsec;
+}
+"""
+
+HOST_INIT = """
+__attribute__((constructor))
+static void __box_host_init(void) {
+    struct sigaction action = {0};
+    action.sa_sigaction = __box_host_fault;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+
+    // map any shared memory owned by the sys
+    if (__box_host_map(0)) {
+        __box_abort(-ENOMEM);
+    }
+}
+"""
+
+@runtimes.runtime
+class HostSysRuntime(
+        ErrorGlue,
+        WriteGlue,
+        AbortGlue,
+        ProfileGlue,
+        runtimes.Runtime):
+    """
+    A bento-box runtime that runs the system as an ordinary process on
+    the host (Linux x86-64). Boxes are mapped at their fixed addresses
+    inside the process. Required at the root of projects using the host
+    runtimes.
+    """
+    __argname__ = "host_sys"
+    __arghelp__ = __doc__
+
+    PAGE = 4096
+
+    # profiled with clock_gettime
+    _profile_unit = 'ns'
+
+    def __init__(self):
+        super().__init__()
+
+    def box(self, box):
+        super().box(box)
+        # default to the host's stdout and exit, can be overridden
+        self._write_plug = box.addexport(
+            '__box_write', 'fn(i32, const u8[size], usize size) -> errsize',
+            scope=box.name, source=self.__argname__, weak=True)
+        self._flush_plug = box.addexport(
+            '__box_flush', 'fn(i32) -> err',
+            scope=box.name, source=self.__argname__, weak=True)
+        self._abort_plug = box.addexport(
+            '__box_abort', 'fn(err) -> noreturn',
+            scope=box.name, source=self.__argname__, weak=True)
+
+    def _hostboxes(self, box):
+        """
+        Get children that live in host runtimes.
+        """
+        return [child for child in box.boxes
+            if hasattr(child.runtime, '_isolate')]
+
+    def _build_profile_clock(self, output, box):
+        output.includes.append('<time.h>')
+        output.decls.append(HOST_CLOCK)
+
+    def build_mk(self, output, box):
+        assert output.get('cpu') == 'host', ("The runtime `%s` requires "
+            "the host toolchain, please provide --output.mk.cpu=host"
+            % self.__argname__)
+
+        # target rule
+        output.decls.insert(0, '%(name)-16s ?= %(target)s',
+            name='TARGET', target=output.get('target', '%(box)s.elf'))
+
+        out = output.rules.append(doc='target rule')
+        out.printf('$(TARGET): $(OBJ) $(BOXES)')
+        with out.indent():
+            out.printf('$(CC) $(OBJ) $(BOXES) $(LDFLAGS) -o $@')
+
+        super().build_mk(output, box)
+
+        out = output.decls.append()
+        out.printf('### host glue ###')
+        out.printf('override CFLAGS += -D_GNU_SOURCE')
+        # boxes are only referenced by address, and their images don't
+        # say anything about the stack
+        out.printf('override LDFLAGS += -Wl,--no-gc-sections')
+        out.printf('override LDFLAGS += -Wl,-z,noexecstack')
+        # boxes resolve libc through us, so make sure all of it is loaded
+        out.printf('override LDFLAGS += -Wl,--no-as-needed -lm -ldl')
+
+    def build_c(self, output, box):
+        super().build_c(output, box)
+
+        output.includes.append('<stdlib.h>')
+        output.includes.append('<unistd.h>')
+        output.decls.append('//// host hooks ////')
+        if self._write_plug.links:
+            out = output.decls.append()
+            out.printf('ssize_t __box_write(int32_t fd, '
+                'const void *buffer, size_t size) {')
+            with out.indent():
+                out.printf('return write(fd, buffer, size);')
+            out.printf('}')
+
+        if self._flush_plug.links:
+            out = output.decls.append()
+            out.printf('int __box_flush(int32_t fd) {')
+            with out.indent():
+                out.printf('return 0;')
+            out.printf('}')
+
+        if self._abort_plug.links:
+            out = output.decls.append()
+            out.printf('__attribute__((noreturn))')
+            out.printf('void __box_abort(int err) {')
+            with out.indent():
+                out.printf('_Exit(err < 0 ? -err : err);')
+            out.printf('}')
+
+        boxes = self._hostboxes(box)
+        if not boxes:
+            return
+
+        output.includes.append('<dlfcn.h>')
+        output.includes.append('<signal.h>')
+        output.includes.append('<sys/mman.h>')
+        output.decls.append('//// host state ////')
+        output.decls.append(HOST_STATE, page=self.PAGE)
+
+        regions = [
+            (memory, i+1, 0, child.runtime._isolate)
+            for i, child in enumerate(boxes)
+            for memory in child.memories]
+        # shared memory belongs to us, but is accessible to each box
+        # it is shared with
+        for shared in box.shared:
+            sharedboxes = [(i+1, child)
+                for i, child in enumerate(boxes)
+                if child.name in shared.boxes]
+            regions.append((shared, 0,
+                sum(1 << i for i, _ in sharedboxes),
+                any(child.runtime._isolate for _, child in sharedboxes)))
+        output.decls.append('#define __BOX_HOST_REGIONS %(count)d',
+            count=len(regions))
+
+        out = output.decls.append()
+        out.printf('const struct __box_host_region '
+            '__box_host_regions[__BOX_HOST_REGIONS] = {')
+        with out.indent():
+            for memory, i, shared, isolate in regions:
+                out.printf('{%(addr)#010x, %(size)#010x, %(i)d, '
+                    '%(shared)#x, %(prot)s, %(isolate)s},',
+                    addr=memory.addr,
+                    size=memory.size,
+                    i=i,
+                    shared=shared,
+                    prot=' | '.join(prot
+                        for mode, prot in [
+                            ('r', 'PROT_READ'),
+                            ('w', 'PROT_WRITE'),
+                            ('x', 'PROT_EXEC')]
+                        if mode in memory.mode) or 'PROT_NONE',
+                    isolate='true' if isolate else 'false')
+        out.printf('};')
+
+        out = output.decls.append(doc='current protection of each region, '
+            '-1 if unmapped')
+        out.printf('int __box_host_prots[__BOX_HOST_REGIONS] = {')
+        with out.indent():
+            for _ in regions:
+                out.printf('-1,')
+        out.printf('};')
+
+        # abort hooks, these must not return
+        out = output.decls.append()
+        for child in boxes:
+            out.printf('__attribute__((noreturn)) '
+                'void __box_%(box)s_fault(int err);', box=child.name)
+        out.printf('void (*const __box_host_aborts[])(int err) = {')
+        with out.indent():
+            for child in boxes:
+                out.printf('__box_%(box)s_fault,', box=child.name)
+        out.printf('};')
+
+        # page fault hooks, these get a chance to handle faults before
+        # we abort
+        pagefaults = [child for child in boxes
+            if child.runtime._pagefault_hook.link]
+        if pagefaults:
+            out = output.decls.append()
+            for child in pagefaults:
+                out.printf('int %(hook)s(uintptr_t addr);',
+                    hook=child.runtime._pagefault_hook.link.export.alias)
+            out.printf('int (*const __box_host_pagefaults[])'
+                '(uintptr_t addr) = {')
+            with out.indent():
+                for child in pagefaults:
+                    out.printf('%(hook)s,',
+                        hook=child.runtime._pagefault_hook.link.export.alias)
+            out.printf('};')
+
+        output.decls.append('//// host implementation ////')
+        output.decls.append(HOST_IMPL)
+
+        out = output.decls.append()
+        out.printf('static void __box_host_fault(int sig, siginfo_t *info, '
+            'void *context) {')
+        with out.indent():
+            if pagefaults:
+                out.printf('// demand paged memory? these may be accessed '
+                    'by anyone')
+                out.printf('for (size_t i = 0; i < %(n)d; i++) {',
+                    n=len(pagefaults))
+                with out.indent():
+                    out.printf('if (__box_host_pagefaults[i]('
+                        '(uintptr_t)info->si_addr) == 0) {')
+                    with out.indent():
+                        out.printf('return;')
+                    out.printf('}')
+                out.printf('}')
+                out.printf()
+            out.printf('uint32_t active = __box_host_active;')
+            out.printf('if (!active) {')
+            with out.indent():
+                out.printf('// fault in the sys, let it crash')
+                out.printf('signal(sig, SIG_DFL);')
+                out.printf('return;')
+            out.printf('}')
+            out.printf()
+            out.printf('// kill the active box, this should not return')
+            out.printf('__box_host_switch(0);')
+            out.printf('__box_host_aborts[active-1](-EFAULT);')
+        out.printf('}')
+
+        output.decls.append(HOST_INIT)
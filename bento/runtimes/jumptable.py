@@ -14,6 +14,7 @@ from ..glue.error_glue import ErrorGlue
 from ..glue.write_glue import WriteGlue
 from ..glue.abort_glue import AbortGlue
 from ..glue.heap_glue import HeapGlue
+from ..glue.profile_glue import ProfileGlue
 from ..outputs import OutputBlob
 
 @runtimes.runtime
@@ -22,6 +23,7 @@ class JumptableRuntime(
         WriteGlue,
         AbortGlue,
         HeapGlue,
+        ProfileGlue,
         runtimes.Runtime):
     """
     A bento-box runtime that uses a jumptable to link between different
@@ -37,11 +39,18 @@ class JumptableRuntime(
                 "cost to every box entry point. --no_longjmp disables longjmp "
                 "and forces any unhandled aborts to halt. Note this has no "
                 "affetc if an explicit __box_<box>_abort hook is provided.")
-
-    def __init__(self, jumptable=None, no_longjmp=None):
+        parser.add_argument('--outer_longjmp', type=bool,
+            help="Only set up longjmp recovery at the outermost entry into "
+                "the box. Nested entries (box -> sys -> box) reuse the "
+                "outermost recovery point, avoiding a setjmp, but any abort "
+                "unwinds all the way to the outermost entry.")
+
+    def __init__(self, jumptable=None, no_longjmp=None,
+            outer_longjmp=None):
         super().__init__()
         self._jumptable = Section('jumptable', **jumptable.__dict__)
         self._no_longjmp = no_longjmp or False
+        self._outer_longjmp = outer_longjmp or False
 
     def box_parent(self, parent, box):
         self._load_hook = parent.addimport(
@@ -97,7 +106,7 @@ class JumptableRuntime(
         # imports that need linking
         for import_ in parent.imports:
             if import_.link and import_.link.export.box == box:
-                yield import_.postbound(), box.init == 'lazy'
+                yield import_.postbound(), box.init != 'manual'
 
     def _parentexports(self, parent, box):
         """
@@ -188,18 +197,55 @@ class JumptableRuntime(
         out.printf('#define __box_%(box)s_exportjumptable '
             '__box_%(box)s_jumptable')
 
+        # queued calls are written into a queue in the box
+        queued = [(i+1 if box.stack.size > 0 else i, import_)
+            for i, (import_, _) in enumerate(
+                self._parentimports(parent, box))
+            if import_.isqueued()]
+        if queued:
+            self._build_parent_queue(output, box, queued,
+                initialized='__box_%(box)s_initialized'
+                    if box.init != 'manual' else None)
+
+        # route calls through patchable trampolines?
+        trampolines = {}
+        if box.init == 'trampoline':
+            for i, (import_, needsinit) in enumerate(
+                    self._parentimports(parent, box)):
+                if needsinit and not import_.isqueued():
+                    trampolines[import_.name] = (len(trampolines),
+                        import_.prebound(),
+                        '__box_%%(box)s_exportjumptable[%d]'
+                            % (i+1 if box.stack.size > 0 else i))
+        if trampolines:
+            self._build_parent_trampolines(output, box,
+                [(fn, target) for _, fn, target in trampolines.values()])
+
         output.decls.append('//// %(box)s exports ////')
 
         for i, (import_, needsinit) in enumerate(
                 self._parentimports(parent, box)):
+            if import_.isqueued():
+                continue
+            profiled = self._profiled(parent, box, import_)
             out = output.decls.append(
-                fn=output.repr_fn(import_),
+                fn=output.repr_fn(import_)
+                    if profiled is None else
+                    output.repr_fn(import_,
+                        name='__box_%(box)s_unprofiled_%(alias)s',
+                        attrs=['static']),
                 fnptr=output.repr_fnptr(import_.prebound(), ''),
-                i=i+1 if box.stack.size > 0 else i)
+                alias=import_.alias,
+                i=i+1 if box.stack.size > 0 else i,
+                jumptable='__box_%(box)s_exportjumptable')
+            if import_.name in trampolines:
+                out.pushattrs(
+                    i=trampolines[import_.name][0],
+                    jumptable='__box_%(box)s_trampolines')
             out.printf('%(fn)s {')
             with out.indent():
                 # inject lazy-init?
-                if needsinit:
+                if needsinit and import_.name not in trampolines:
                     out.printf('if (!__box_%(box)s_initialized) {')
                     with out.indent():
                         out.printf('int err = __box_%(box)s_init();')
@@ -212,16 +258,32 @@ class JumptableRuntime(
                         out.printf('}')
                     out.printf('}')
                     out.printf()
+                # run any queued calls first to keep calls in order
+                if queued and import_.source != self.__argname__:
+                    self._build_parent_predrain(out, import_)
                 # use longjmp?
                 if (import_.isfalible() and
                         not self._abort_hook.link and
                         not self._no_longjmp):
                     with out.pushattrs(
-                            pjmpbuf=import_.uniquename('pjmpbuf'),
+                            pjmpbuf=import_.uniquename('pjmpbuf')
+                                if not self._outer_longjmp else 'NULL',
                             jmpbuf=import_.uniquename('jmpbuf'),
                             err=import_.uniquename('err')):
-                        out.printf('jmp_buf *%(pjmpbuf)s = '
-                            '__box_%(box)s_jmpbuf;')
+                        if self._outer_longjmp:
+                            # only the outermost call needs a recovery point
+                            out.printf('if (__box_%(box)s_jmpbuf) {')
+                            with out.indent():
+                                out.printf('return ((%(fnptr)s)\n'
+                                    '        %(jumptable)s[%(i)d])'
+                                    '(%(args)s);',
+                                    args=', '.join(map(str,
+                                        import_.argnamesandbounds())))
+                            out.printf('}')
+                            out.printf()
+                        else:
+                            out.printf('jmp_buf *%(pjmpbuf)s = '
+                                '__box_%(box)s_jmpbuf;')
                         out.printf('jmp_buf %(jmpbuf)s;')
                         out.printf('__box_%(box)s_jmpbuf = &%(jmpbuf)s;')
                         out.printf('int %(err)s = setjmp(%(jmpbuf)s);')
@@ -232,7 +294,7 @@ class JumptableRuntime(
                         out.printf('}')
                 # jump to jumptable entry
                 out.printf('%(return_)s((%(fnptr)s)\n'
-                    '        __box_%(box)s_exportjumptable[%(i)d])(%(args)s);',
+                    '        %(jumptable)s[%(i)d])(%(args)s);',
                     return_=('return ' if import_.rets else '')
                         if not (import_.isfalible() and
                             not self._abort_hook.link and
@@ -249,12 +311,18 @@ class JumptableRuntime(
                         not self._abort_hook.link and
                         not self._no_longjmp):
                     with out.pushattrs(
-                            pjmpbuf=import_.uniquename('pjmpbuf')):
+                            pjmpbuf=import_.uniquename('pjmpbuf')
+                                if not self._outer_longjmp else 'NULL'):
                         out.printf('__box_%(box)s_jmpbuf = %(pjmpbuf)s;')
                         if import_.rets:
                             out.printf('return %(ret)s;',
                                 ret=import_.retname())
             out.printf('}')
+
+            if profiled is not None:
+                self._build_parent_profile(output, profiled, import_,
+                    import_.alias,
+                    '__box_%%(box)s_unprofiled_%s' % import_.alias)
             
         output.decls.append('//// %(box)s imports ////')
 
@@ -269,6 +337,9 @@ class JumptableRuntime(
                 out.printf('%(fn)s {')
                 with out.indent():
                     out.printf('__box_%(box)s_initialized = false;')
+                    self._build_parent_unload(out, box)
+                    if trampolines:
+                        out.printf('__box_%(box)s_patch(false);')
                     out.printf('if (__box_%(box)s_jmpbuf) {')
                     with out.indent():
                         out.printf('longjmp(*__box_%(box)s_jmpbuf, err);')
@@ -296,6 +367,10 @@ class JumptableRuntime(
                 doc='redirect %(flush_hook)s -> __box_flush')
             out.printf('#define %(flush_hook)s __box_flush')
 
+        # profile calls into the parent?
+        profiled = self._build_parent_profile_exports(output, parent, box,
+            (export for export, _ in self._parentexports(parent, box)))
+
         # wrappers?
         for export in (export
                 for export, needswrapper in self._parentexports(parent, box)
@@ -304,10 +379,11 @@ class JumptableRuntime(
                 fn=output.repr_fn(
                     export.postbound(),
                     name='__box_%(box)s_export_%(alias)s'),
-                alias=export.alias)
+                alias=export.alias,
+                target=profiled.get(export.name, export.alias))
             out.printf('%(fn)s {')
             with out.indent():
-                out.printf('%(return_)s%(alias)s(%(args)s);',
+                out.printf('%(return_)s%(target)s(%(args)s);',
                     return_='return ' if import_.rets else '',
                     args=', '.join(map(str, export.argnamesandbounds())))
             out.printf('}')
@@ -317,13 +393,16 @@ class JumptableRuntime(
         out.printf('const uint32_t __box_%(box)s_importjumptable[] = {')
         with out.indent():
             for export, needswrapper in self._parentexports(parent, box):
-                out.printf('(uint32_t)%(prefix)s%(alias)s,',
-                    prefix='__box_%(box)s_export_' if needswrapper else '',
-                    alias=export.alias)
+                out.printf('(uint32_t)%(target)s,',
+                    target='__box_%(box)s_export_'+export.alias
+                        if needswrapper else
+                        profiled.get(export.name, export.alias))
         out.printf('};')
 
         # init
         output.decls.append('//// %(box)s init ////')
+        self._build_parent_prefetch(output, box,
+            '__box_%(box)s_initialized')
         out = output.decls.append()
         out.printf('int __box_%(box)s_init(void) {')
         with out.indent():
@@ -333,45 +412,37 @@ class JumptableRuntime(
                 out.printf('return 0;')
             out.printf('}')
             out.printf()
-            if box.roommates:
-                out.printf('// bring down any overlapping boxes')
-            for i, roommate in enumerate(box.roommates):
-                with out.pushattrs(roommate=roommate.name):
-                    out.printf('extern int __box_%(roommate)s_clobber(void);')
-                    out.printf('err = __box_%(roommate)s_clobber();')
-                    out.printf('if (err) {')
-                    with out.indent():
-                        out.printf('return err;')
-                    out.printf('}')
-                    out.printf()
+            self._build_parent_roommates(out, box)
             if box.stack.size > 0:
                 out.printf('// prepare data stack')
                 out.printf('__box_%(box)s_datasp = '
                     '(void*)__box_%(box)s_exportjumptable[0];')
                 out.printf()
-            out.printf('// load the box if unloaded')
-            out.printf('err = __box_%(box)s_load();')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
-            out.printf('// call box\'s init')
-            out.printf('err = __box_%(box)s_postinit('
-                '__box_%(box)s_importjumptable);')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
+            self._build_parent_load(out, box)
+            self._build_parent_postinit(out, box,
+                '__box_%(box)s_postinit(__box_%(box)s_importjumptable)')
+            if queued:
+                out.printf('// find the box\'s queue')
+                out.printf('__box_%(box)s_queue = '
+                    '(void*)__box_%(box)s_exportjumptable[%(n)d];',
+                    n=(1 if box.stack.size > 0 else 0)
+                        + len(list(self._exports(box))))
+                out.printf()
             out.printf('__box_%(box)s_initialized = true;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(true);')
             out.printf('return 0;')
         out.printf('}')
 
         out = output.decls.append()
         out.printf('int __box_%(box)s_clobber(void) {')
         with out.indent():
+            self._build_parent_clobber(out, box,
+                '__box_%(box)s_initialized',
+                queued=bool(queued))
             out.printf('__box_%(box)s_initialized = false;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(false);')
             out.printf('return 0;')
         out.printf('}')
 
@@ -504,6 +575,15 @@ class JumptableRuntime(
                     args=', '.join(map(str, export.argnamesandbounds())))
             out.printf('}')
 
+        queued = [(i+1 if box.stack.size > 0 else i,
+                export.postbound(),
+                '__box_export_'+export.alias if needswrapper else
+                    export.alias)
+            for i, (export, needswrapper) in enumerate(self._exports(box))
+            if export.isqueued()]
+        if queued:
+            self._build_queue(output, box, queued)
+
         out = output.decls.append(doc='box-side jumptable')
         if box.stack.size > 0:
             out.printf('extern uint8_t __stack_end;')
@@ -516,6 +596,8 @@ class JumptableRuntime(
                 out.printf('(uint32_t)%(prefix)s%(alias)s,',
                     prefix='__box_export_' if needswrapper else '',
                     alias=export.alias)
+            if queued:
+                out.printf('(uint32_t)&__box_queue,')
         out.printf('};')
 
     def build_ld(self, output, box):
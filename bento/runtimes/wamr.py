@@ -14,6 +14,7 @@ from ..glue.error_glue import ErrorGlue
 from ..glue.write_glue import WriteGlue
 from ..glue.abort_glue import AbortGlue
 from ..glue.heap_glue import HeapGlue
+from ..glue.profile_glue import ProfileGlue
 from ..outputs import OutputBlob, HOutput
 
 C_COMMON = """
@@ -62,6 +63,7 @@ class WamrRuntime(
         WriteGlue,
         AbortGlue,
         HeapGlue,
+        ProfileGlue,
         runtimes.Runtime):
     """
     A bento-box runtime using Wamr, a wasm interpreter
@@ -86,6 +88,11 @@ class WamrRuntime(
             None)
         self._aot = aot or False
 
+    def _skipsload(self, box):
+        # Wamr rewrites the loaded module in place, so it always needs
+        # a fresh copy
+        return False
+
     def box_parent(self, parent, box):
         self._load_hook = parent.addimport(
             '__box_%s_load' % box.name, 'fn() -> err',
@@ -111,6 +118,15 @@ class WamrRuntime(
         super().box_parent(parent, box)
 
     def box(self, box):
+        # boxes only see their linear memory, so can't map in
+        # memory shared with other boxes
+        assert not box.sharedmemories, (
+            "%s: Box `%s` can't use shared memory `%s`, shared memory "
+            "is not supported by wasm runtimes" % (
+                self.name, box.name, box.sharedmemories[0].name))
+        assert not any(export.isqueued() for export in box.exports), (
+            "%s: Box `%s` can't have queued exports, queued exports "
+            "are not supported by wasm runtimes" % (self.name, box.name))
         super().box(box)
         if self._interp_stack is None:
             self._interp_stack = box.stack
@@ -252,8 +268,8 @@ class WamrRuntime(
                 out.writef('$(strip $(OBJCOPY) $< $@')
                 with out.indent():
                     out.writef(' \\\n-I binary')
-                    out.writef(' \\\n-O elf32-littlearm')
-                    out.writef(' \\\n-B arm')
+                    out.writef(' \\\n-O %(bfd_target)s')
+                    out.writef(' \\\n-B %(bfd_arch)s')
                     out.writef(' \\\n--rename-section .data=.text,'
                         'contents,alloc,load,readonly,data')
                     out.printf(')')
@@ -273,8 +289,8 @@ class WamrRuntime(
                 out.writef('$(strip $(OBJCOPY) $< $@')
                 with out.indent():
                     out.writef(' \\\n-I binary')
-                    out.writef(' \\\n-O elf32-littlearm')
-                    out.writef(' \\\n-B arm')
+                    out.writef(' \\\n-O %(bfd_target)s')
+                    out.writef(' \\\n-B %(bfd_arch)s')
                     out.writef(' \\\n--rename-section .data=.text,'
                         'contents,alloc,load,readonly,data')
                     out.printf(')')
@@ -311,6 +327,12 @@ class WamrRuntime(
         out.printf('wasm_module_inst_t __box_%(box)s_module_inst;')
         out.printf('wasm_exec_env_t __box_%(box)s_exec_env;')
         out.printf('int __box_%(box)s_err;')
+        imports = list(self._parentimports(parent, box))
+        if imports:
+            out.printf('// export handles, resolved once during init')
+            out.printf('wasm_function_inst_t '
+                '__box_%(box)s_functions[%(count)d];',
+                count=len(imports))
 
         # redirect hooks if necessary
         if not self._abort_hook.link:
@@ -331,15 +353,18 @@ class WamrRuntime(
 
         # box imports, wamr makes this too easy
         output.decls.append('//// %(box)s imports ////')
+        profiled = self._build_parent_profile_exports(output, parent, box,
+            self._parentexports(parent, box))
         for export in self._parentexports(parent, box):
             if export.name == '__box_abort' and not self._abort_hook.link:
                 continue
             out = output.decls.append(
                 fn=self._repr_fn(export, name='__box_%(box)s_import_%(alias)s'),
-                alias=export.alias)
+                alias=export.alias,
+                target=profiled.get(export.name, export.alias))
             out.printf('%(fn)s {')
             with out.indent():
-                out.printf('%(rets)s%(alias)s(%(args)s);',
+                out.printf('%(rets)s%(target)s(%(args)s);',
                     args=', '.join(map(str, export.argnamesandbounds())),
                     rets='return ' if export.rets else '')
             out.printf('}')
@@ -364,17 +389,61 @@ class WamrRuntime(
                 out.printf('},')
         out.printf('};')
 
+        # route calls through patchable trampolines?
+        trampolines = box.init == 'trampoline' and imports
+        if trampolines:
+            out = output.decls.append()
+            for import_ in imports:
+                out.printf('%(fn)s;',
+                    fn=output.repr_fn(import_,
+                        name='__box_%(box)s_call_%(alias)s',
+                        attrs=['static']),
+                    alias=import_.alias)
+            self._build_parent_trampolines(output, box,
+                [(import_, '__box_%%(box)s_call_%s' % import_.alias)
+                    for import_ in imports])
+
         # box exports
         output.decls.append('//// %(box)s exports ////')
-        for import_ in self._parentimports(parent, box):
+        for i, import_ in enumerate(imports):
             argsize = sum(arg.size() for arg in import_.preboundargs) // 4
             retsize = sum(ret.size() for ret in import_.rets) // 4
             framesize = max(argsize, retsize)
+            profiled = self._profiled(parent, box, import_)
+            if trampolines:
+                out = output.decls.append(
+                    fn=output.repr_fn(import_)
+                        if profiled is None else
+                        output.repr_fn(import_,
+                            name='__box_%(box)s_unprofiled_%(alias)s',
+                            attrs=['static']),
+                    fnptr=output.repr_fnptr(import_, ''),
+                    alias=import_.alias,
+                    i=i)
+                out.printf('%(fn)s {')
+                with out.indent():
+                    out.printf('%(return_)s((%(fnptr)s)\n'
+                        '        __box_%(box)s_trampolines[%(i)d])'
+                        '(%(args)s);',
+                        return_='return ' if import_.rets else '',
+                        args=', '.join(import_.argnames()))
+                    if import_.isnoreturn():
+                        # kinda wish we could apply noreturn to C types...
+                        out.printf('__builtin_unreachable();')
+                out.printf('}')
+
             out = output.decls.append(
-                fn=output.repr_fn(import_),
-                # TODO handle aliases wasm side?
-                linkname=import_.link.export.name,
-                argstring=self._repr_argstring(import_),
+                fn=output.repr_fn(import_,
+                        name='__box_%(box)s_call_%(alias)s',
+                        attrs=['static'])
+                    if trampolines else
+                    output.repr_fn(import_)
+                    if profiled is None else
+                    output.repr_fn(import_,
+                        name='__box_%(box)s_unprofiled_%(alias)s',
+                        attrs=['static']),
+                alias=import_.alias,
+                i=i,
                 f=import_.uniquename('f'),
                 res=import_.uniquename('res'),
                 frame=import_.uniquename('frame') if framesize else 'NULL',
@@ -397,19 +466,8 @@ class WamrRuntime(
                         out.printf('}')
                     out.printf('}')
                     out.printf()
-                out.printf('wasm_function_inst_t %(f)s;')
-                out.printf('%(f)s = wasm_runtime_lookup_function(\n'
-                    '    __box_%(box)s_module_inst,\n',
-                    '    "%(linkname)s",\n'
-                    '    "%(argstring)s");')
-                out.printf('if (!%(f)s) {')
-                with out.indent():
-                    if import_.isfalible():
-                        out.printf('return -ENOEXEC;')
-                    else:
-                        out.printf('__box_abort(-ENOEXEC);')
-                out.printf('}')
-                out.printf()
+                out.printf('wasm_function_inst_t %(f)s = '
+                    '__box_%(box)s_functions[%(i)d];')
                 if import_.isfalible():
                     out.printf('__box_%(box)s_err = 0;')
                 out.printf()
@@ -467,8 +525,15 @@ class WamrRuntime(
                     out.printf('__builtin_unreachable();')
             out.printf('}')
 
+            if profiled is not None:
+                self._build_parent_profile(output, profiled, import_,
+                    import_.alias,
+                    '__box_%%(box)s_unprofiled_%s' % import_.alias)
+
         # init
         output.decls.append('//// %(box)s init ////')
+        self._build_parent_prefetch(output, box,
+            '__box_%(box)s_initialized')
         out = output.decls.append()
         out.printf('int __box_%(box)s_init(void) {')
         with out.indent():
@@ -478,24 +543,8 @@ class WamrRuntime(
                 out.printf('return 0;')
             out.printf('}')
             out.printf()
-            if box.roommates:
-                out.printf('// bring down any overlapping boxes')
-            for i, roommate in enumerate(box.roommates):
-                with out.pushattrs(roommate=roommate.name):
-                    out.printf('extern int __box_%(roommate)s_clobber(void);')
-                    out.printf('err = __box_%(roommate)s_clobber();')
-                    out.printf('if (err) {')
-                    with out.indent():
-                        out.printf('return err;')
-                    out.printf('}')
-                    out.printf()
-            out.printf('// load the box if unloaded')
-            out.printf('err = __box_%(box)s_load();')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
+            self._build_parent_roommates(out, box)
+            self._build_parent_load(out, box)
             # runtime config
             out.printf('// bring up common runtime')
             out.printf('if (!__box_wamr_runtime_initialized) {')
@@ -559,12 +608,34 @@ class WamrRuntime(
                 '    __box_%(box)s_exec_env,\n'
                 '    &__box_%(box)s_err);')
             out.printf()
+            if imports:
+                # resolve exports, these are validated here so calls
+                # only need to index the function table
+                out.printf('// resolve exports')
+                for i, import_ in enumerate(imports):
+                    out.printf('__box_%(box)s_functions[%(i)d] = '
+                        'wasm_runtime_lookup_function(\n'
+                        '    __box_%(box)s_module_inst,\n'
+                        '    "%(linkname)s",\n'
+                        '    "%(argstring)s");',
+                        i=i,
+                        # TODO handle aliases wasm side?
+                        linkname=import_.link.export.name,
+                        argstring=self._repr_argstring(import_))
+                    out.printf('if (!__box_%(box)s_functions[%(i)d]) {',
+                        i=i)
+                    with out.indent():
+                        out.printf('return -ENOEXEC;')
+                    out.printf('}')
+                out.printf()
             # just a few other state things
             out.printf('// setup data stack, note address 0 is NULL')
             out.printf('// so we can\'t start there!')
             out.printf('__box_%(box)s_datasp = 4;')
             out.printf()
             out.printf('__box_%(box)s_initialized = true;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(true);')
             out.printf('return 0;')
         out.printf('}')
 
@@ -579,12 +650,20 @@ class WamrRuntime(
                     '__box_%(box)s_module_inst);')
                 out.printf('wasm_runtime_unload('
                     '__box_%(box)s_module);')
+                if imports:
+                    out.printf('memset(__box_%(box)s_functions, 0,\n'
+                        '    sizeof(__box_%(box)s_functions));')
             out.printf('}')
+            self._build_parent_clobber(out, box,
+                '__box_%(box)s_initialized')
             out.printf('__box_%(box)s_initialized = false;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(false);')
             out.printf('return 0;')
         out.printf('}')
 
         output.includes.append('assert.h')
+        output.includes.append('string.h')
         output.decls.append(C_STUFF,
             data_stack=box.stack.size)
 
@@ -14,6 +14,7 @@ from ..glue.error_glue import ErrorGlue
 from ..glue.write_glue import WriteGlue
 from ..glue.abort_glue import AbortGlue
 from ..glue.heap_glue import HeapGlue
+from ..glue.profile_glue import ProfileGlue
 from ..outputs import OutputBlob
 
 C_COMMON = """
@@ -122,6 +123,7 @@ class Wasm3Runtime(
         WriteGlue,
         AbortGlue,
         HeapGlue,
+        ProfileGlue,
         runtimes.Runtime):
     """
     A bento-box runtime using Wasm3, a wasm interpreter
@@ -166,6 +168,15 @@ class Wasm3Runtime(
         super().box_parent(parent, box)
 
     def box(self, box):
+        # boxes only see their linear memory, so can't map in
+        # memory shared with other boxes
+        assert not box.sharedmemories, (
+            "%s: Box `%s` can't use shared memory `%s`, shared memory "
+            "is not supported by wasm runtimes" % (
+                self.name, box.name, box.sharedmemories[0].name))
+        assert not any(export.isqueued() for export in box.exports), (
+            "%s: Box `%s` can't have queued exports, queued exports "
+            "are not supported by wasm runtimes" % (self.name, box.name))
         super().box(box)
         if self._interp_stack is None:
             self._interp_stack = box.stack
@@ -258,8 +269,8 @@ class Wasm3Runtime(
             out.writef('$(strip $(OBJCOPY) $< $@')
             with out.indent():
                 out.writef(' \\\n-I binary')
-                out.writef(' \\\n-O elf32-littlearm')
-                out.writef(' \\\n-B arm')
+                out.writef(' \\\n-O %(bfd_target)s')
+                out.writef(' \\\n-B %(bfd_arch)s')
                 out.writef(' \\\n--rename-section .data=.text,'
                     'contents,alloc,load,readonly,data')
                 out.printf(')')
@@ -289,6 +300,7 @@ class Wasm3Runtime(
         output.includes.append('<wasm3.h>')
         output.includes.append('<m3_api_defs.h>')
         output.includes.append('<m3_env.h>')
+        output.includes.append('<string.h>')
 
         out = output.decls.append()
         out.printf('//// %(box)s state ////')
@@ -296,6 +308,11 @@ class Wasm3Runtime(
         out.printf('IM3Runtime __box_%(box)s_runtime;')
         out.printf('IM3Module __box_%(box)s_module;')
         out.printf('uint32_t __box_%(box)s_datasp;')
+        imports = list(self._parentimports(parent, box))
+        if imports:
+            out.printf('// export handles, resolved once during init')
+            out.printf('IM3Function __box_%(box)s_functions[%(count)d];',
+                count=len(imports))
 
         output.decls.append(C_STUFF,
             data_stack=box.stack.size)
@@ -318,12 +335,15 @@ class Wasm3Runtime(
 
         # box imports, wasm3 makes this easy
         output.decls.append('//// %(box)s imports ////')
+        profiled = self._build_parent_profile_exports(output, parent, box,
+            self._parentexports(parent, box))
         for export in self._parentexports(parent, box):
             if export.name == '__box_abort' and not self._abort_hook.link:
                 continue
             out = output.decls.append(
                 name='__box_%(box)s_import_%(alias)s',
-                alias=export.alias)
+                alias=export.alias,
+                target=profiled.get(export.name, export.alias))
             out.printf('m3ApiRawFunction(%(name)s) {')
             with out.indent():
                 if export.rets:
@@ -338,7 +358,7 @@ class Wasm3Runtime(
                         out.printf('m3ApiGetArg(%(arg)s, %(name)s);',
                             arg=output.repr_arg(arg, name=''),
                             name=name)
-                out.printf('%(rets)s%(alias)s(%(args)s);',
+                out.printf('%(rets)s%(target)s(%(args)s);',
                     args=', '.join(map(str, export.argnamesandbounds())),
                     rets='%s = ' % output.repr_arg(
                             export.rets[0],
@@ -352,15 +372,59 @@ class Wasm3Runtime(
             out.printf('}')
 
 
+        # route calls through patchable trampolines?
+        trampolines = box.init == 'trampoline' and imports
+        if trampolines:
+            out = output.decls.append()
+            for import_ in imports:
+                out.printf('%(fn)s;',
+                    fn=output.repr_fn(import_,
+                        name='__box_%(box)s_call_%(alias)s',
+                        attrs=['static']),
+                    alias=import_.alias)
+            self._build_parent_trampolines(output, box,
+                [(import_, '__box_%%(box)s_call_%s' % import_.alias)
+                    for import_ in imports])
+
         # box exports, wasm3 doesn't have a great link layer here so
         # this is a bit hacky
         output.decls.append('//// %(box)s exports ////')
-        for import_ in self._parentimports(parent, box):
+        for i, import_ in enumerate(imports):
+            profiled = self._profiled(parent, box, import_)
+            if trampolines:
+                out = output.decls.append(
+                    fn=output.repr_fn(import_)
+                        if profiled is None else
+                        output.repr_fn(import_,
+                            name='__box_%(box)s_unprofiled_%(alias)s',
+                            attrs=['static']),
+                    fnptr=output.repr_fnptr(import_, ''),
+                    alias=import_.alias,
+                    i=i)
+                out.printf('%(fn)s {')
+                with out.indent():
+                    out.printf('%(return_)s((%(fnptr)s)\n'
+                        '        __box_%(box)s_trampolines[%(i)d])'
+                        '(%(args)s);',
+                        return_='return ' if import_.rets else '',
+                        args=', '.join(import_.argnames()))
+                    if import_.isnoreturn():
+                        # kinda wish we could apply noreturn to C types...
+                        out.printf('__builtin_unreachable();')
+                out.printf('}')
+
             out = output.decls.append(
-                fn=output.repr_fn(import_),
-                # TODO handle aliases wasm side?
-                linkname=import_.link.export.name,
-                linkargs=len(import_.preboundargs),
+                fn=output.repr_fn(import_,
+                        name='__box_%(box)s_call_%(alias)s',
+                        attrs=['static'])
+                    if trampolines else
+                    output.repr_fn(import_)
+                    if profiled is None else
+                    output.repr_fn(import_,
+                        name='__box_%(box)s_unprofiled_%(alias)s',
+                        attrs=['static']),
+                alias=import_.alias,
+                i=i,
                 res=import_.uniquename('res'),
                 f=import_.uniquename('f'))
             out.printf('%(fn)s {')
@@ -380,19 +444,8 @@ class Wasm3Runtime(
                     out.printf('}')
                     out.printf()
                 out.printf('M3Result %(res)s;')
-                out.printf('IM3Function %(f)s;')
-                out.printf('%(res)s = m3_FindFunction(&%(f)s,\n'
-                    '        __box_%(box)s_runtime,\n'
-                    '        "%(linkname)s");')
-                out.printf('if (%(res)s || !%(f)s->compiled ||\n'
-                    '        %(f)s->funcType->numArgs != %(linkargs)d) {')
-                with out.indent():
-                    if import_.isfalible():
-                        out.printf('return -ENOEXEC;')
-                    else:
-                        out.printf('__box_abort(-ENOEXEC);')
-                out.printf('}')
-                out.printf()
+                out.printf('IM3Function %(f)s = '
+                    '__box_%(box)s_functions[%(i)d];')
                 out.printf('uint64_t *stack = __box_%(box)s_runtime->stack;')
                 for i, (arg, name) in enumerate(import_.zippedargsandbounds()):
                     if arg.isptr():
@@ -436,8 +489,15 @@ class Wasm3Runtime(
                     out.printf('__builtin_unreachable();')
             out.printf('}')
 
+            if profiled is not None:
+                self._build_parent_profile(output, profiled, import_,
+                    import_.alias,
+                    '__box_%%(box)s_unprofiled_%s' % import_.alias)
+
         # init
         output.decls.append('//// %(box)s init ////')
+        self._build_parent_prefetch(output, box,
+            '__box_%(box)s_initialized')
         out = output.decls.append()
         out.printf('int __box_%(box)s_init(void) {')
         with out.indent():
@@ -447,24 +507,10 @@ class Wasm3Runtime(
                 out.printf('return 0;')
             out.printf('}')
             out.printf()
-            if box.roommates:
-                out.printf('// bring down any overlapping boxes')
-            for i, roommate in enumerate(box.roommates):
-                with out.pushattrs(roommate=roommate.name):
-                    out.printf('extern int __box_%(roommate)s_clobber(void);')
-                    out.printf('err = __box_%(roommate)s_clobber();')
-                    out.printf('if (err) {')
-                    with out.indent():
-                        out.printf('return err;')
-                    out.printf('}')
-                    out.printf()
-            out.printf('// load the box if unloaded')
-            out.printf('err = __box_%(box)s_load();')
-            out.printf('if (err) {')
-            with out.indent():
-                out.printf('return err;')
-            out.printf('}')
-            out.printf()
+            self._build_parent_roommates(out, box)
+            # the image is only parsed, so we can always skip loading it,
+            # but the box starts over
+            self._build_parent_load(out, box, resume=False)
             # initialize environment
             out.printf('// initialize wasm3 environment, this only needs')
             out.printf('// to be done once')
@@ -528,11 +574,36 @@ class Wasm3Runtime(
                         out.printf('return __box_wasm3_toerr(res);')
                     out.printf('}')
                 out.printf()
+            if imports:
+                # resolve exports, these are validated here so calls
+                # only need to index the function table
+                out.printf('// resolve exports')
+                for i, import_ in enumerate(imports):
+                    out.printf('res = m3_FindFunction(\n'
+                        '        &__box_%(box)s_functions[%(i)d],\n'
+                        '        __box_%(box)s_runtime,\n'
+                        '        "%(linkname)s");',
+                        i=i,
+                        # TODO handle aliases wasm side?
+                        linkname=import_.link.export.name)
+                    out.printf('if (res ||\n'
+                        '        !__box_%(box)s_functions[%(i)d]->compiled ||\n'
+                        '        __box_%(box)s_functions[%(i)d]'
+                            '->funcType->numArgs != %(linkargs)d) {',
+                        i=i,
+                        linkargs=len(import_.preboundargs))
+                    with out.indent():
+                        out.printf('m3_FreeRuntime(__box_%(box)s_runtime);')
+                        out.printf('return -ENOEXEC;')
+                    out.printf('}')
+                out.printf()
             out.printf('// setup data stack, note address 0 is NULL')
             out.printf('// so we can\'t start there!')
             out.printf('__box_%(box)s_datasp = 4;')
             out.printf()
             out.printf('__box_%(box)s_initialized = true;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(true);')
             out.printf('return 0;')
         out.printf('}')
 
@@ -542,8 +613,15 @@ class Wasm3Runtime(
             out.printf('if (__box_%(box)s_initialized) {')
             with out.indent():
                 out.printf('m3_FreeRuntime(__box_%(box)s_runtime);')
+                if imports:
+                    out.printf('memset(__box_%(box)s_functions, 0,\n'
+                        '        sizeof(__box_%(box)s_functions));')
             out.printf('}')
+            self._build_parent_clobber(out, box,
+                '__box_%(box)s_initialized')
             out.printf('__box_%(box)s_initialized = false;')
+            if trampolines:
+                out.printf('__box_%(box)s_patch(false);')
             out.printf('return 0;')
         out.printf('}')
 
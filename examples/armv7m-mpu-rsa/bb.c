@@ -244,7 +244,7 @@ extern void __box_return(void);
 #define MPU_RBAR ((volatile uint32_t*)0xe000ed9c)
 #define MPU_RASR ((volatile uint32_t*)0xe000eda0)
 
-struct __box_mpuregions {
+struct __box_mpudelta {
     uint32_t control;
     uint32_t count;
     uint32_t regions[][2];
@@ -261,32 +261,49 @@ static int32_t __box_mpu_init(void) {
         *MPU_RBAR = (uint32_t)&__box_callregion | 0x10;
         // disallow execution
         *MPU_RASR = 0x10000001 | ((7-1) << 1);
+        // start with box regions disabled, switches only write the
+        // regions that differ between boxes
+        for (int i = 0; i < 4; i++) {
+            *MPU_RBAR = 0x10 | (i+1);
+            *MPU_RASR = 0;
+        }
         // enable the MPU
         *MPU_CTRL = 5;
     }
     return 0;
 }
 
-static void __box_mpu_switch(const struct __box_mpuregions *regions) {
-    // update MPU regions
-    *MPU_CTRL = 0;
-    uint32_t count = regions->count;
-    for (int i = 0; i < 4; i++) {
-        if (i < count) {
-            *MPU_RBAR = regions->regions[i][0] | 0x10 | (i+1);
-            *MPU_RASR = regions->regions[i][1];
-        } else {
-            *MPU_RBAR = 0x10 | (i+1);
-            *MPU_RASR = 0;
+static void __box_mpu_switch(const struct __box_mpudelta *delta) {
+    // update MPU regions that differ from the previous box
+    uint32_t count = delta->count;
+    if (count > 0) {
+        *MPU_CTRL = 0;
+        const uint32_t *region = delta->regions[0];
+        // RBAR has VALID set, so each RBAR/RASR pair selects its own
+        // region, this lets us write up to 4 regions at a time through
+        // the contiguous RBAR_A1-A3/RASR_A1-A3 alias registers
+        for (; count >= 4; count -= 4, region += 8) {
+            MPU_RBAR[0] = region[0];
+            MPU_RBAR[1] = region[1];
+            MPU_RBAR[2] = region[2];
+            MPU_RBAR[3] = region[3];
+            MPU_RBAR[4] = region[4];
+            MPU_RBAR[5] = region[5];
+            MPU_RBAR[6] = region[6];
+            MPU_RBAR[7] = region[7];
         }
+        for (; count > 0; count -= 1, region += 2) {
+            MPU_RBAR[0] = region[0];
+            MPU_RBAR[1] = region[1];
+        }
+        *MPU_CTRL = 5;
     }
-    *MPU_CTRL = 5;
 
     // update CONTROL state, note that return-from-exception acts
     // as an instruction barrier
     uint32_t control;
     __asm__ volatile ("mrs %0, control" : "=r"(control));
-    control = (~1 & control) | (regions->control);
+    control = (~1 & control) | (delta->control);
     __asm__ volatile ("msr control, %0" :: "r"(control));
 }
 
@@ -394,6 +411,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -440,11 +458,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -528,7 +545,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -588,7 +605,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -608,7 +625,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -995,15 +1013,6 @@ static int __box_alicebox_load(void) {
 struct __box_state __box_alicebox_state;
 extern uint32_t __box_alicebox_jumptable[];
 
-const struct __box_mpuregions __box_alicebox_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000fe000, 0x02000019},
-        {0x2003e000, 0x13000019},
-    },
-};
-
 //// alicebox exports ////
 
 int alicebox_getpubkey(char *buffer, size_t size) {
@@ -1134,8 +1143,8 @@ int __box_alicebox_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_alicebox_postinit(void);
+    // call box's init
     err = __box_alicebox_postinit();
     if (err) {
         return err;
@@ -1180,15 +1189,6 @@ static int __box_bobbox_load(void) {
 struct __box_state __box_bobbox_state;
 extern uint32_t __box_bobbox_jumptable[];
 
-const struct __box_mpuregions __box_bobbox_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000fc000, 0x02000019},
-        {0x2003c000, 0x13000019},
-    },
-};
-
 //// bobbox exports ////
 
 int bobbox_getpubkey(char *buffer, size_t size) {
@@ -1319,8 +1319,8 @@ int __box_bobbox_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_bobbox_postinit(void);
+    // call box's init
     err = __box_bobbox_postinit();
     if (err) {
         return err;
@@ -1365,15 +1365,6 @@ static int __box_tlsbox_load(void) {
 struct __box_state __box_tlsbox_state;
 extern uint32_t __box_tlsbox_jumptable[];
 
-const struct __box_mpuregions __box_tlsbox_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000c0000, 0x02000021},
-        {0x20030000, 0x1300001d},
-    },
-};
-
 //// tlsbox exports ////
 
 int tlsbox_drbg_seed(void) {
@@ -1523,8 +1514,8 @@ int __box_tlsbox_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_tlsbox_postinit(void);
+    // call box's init
     err = __box_tlsbox_postinit();
     if (err) {
         return err;
@@ -1574,17 +1565,170 @@ void (*const __box_aborts[])(int err) = {
     NULL,
 };
 
-const struct __box_mpuregions __box_sys_mpuregions = {
+void (*const __box_faults[])(void) = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+const struct __box_mpudelta __box_sys_to_sys_mpudelta = {
+    .control = 0,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta __box_sys_to_alicebox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fe011, 0x02000019},
+        {0x2003e012, 0x13000019},
+    },
+};
+
+const struct __box_mpudelta __box_sys_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fc011, 0x02000019},
+        {0x2003c012, 0x13000019},
+    },
+};
+
+const struct __box_mpudelta __box_sys_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000c0011, 0x02000021},
+        {0x20030012, 0x1300001d},
+    },
+};
+
+const struct __box_mpudelta __box_alicebox_to_sys_mpudelta = {
     .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000011, 0x00000000},
+        {0x00000012, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_alicebox_to_alicebox_mpudelta = {
+    .control = 1,
     .count = 0,
     .regions = {}
 };
 
-const struct __box_mpuregions *const __box_mpuregions[__BOX_COUNT+1] = {
-    &__box_sys_mpuregions,
-    &__box_alicebox_mpuregions,
-    &__box_bobbox_mpuregions,
-    &__box_tlsbox_mpuregions,
+const struct __box_mpudelta __box_alicebox_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fc011, 0x02000019},
+        {0x2003c012, 0x13000019},
+    },
+};
+
+const struct __box_mpudelta __box_alicebox_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000c0011, 0x02000021},
+        {0x20030012, 0x1300001d},
+    },
+};
+
+const struct __box_mpudelta __box_bobbox_to_sys_mpudelta = {
+    .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000011, 0x00000000},
+        {0x00000012, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_bobbox_to_alicebox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fe011, 0x02000019},
+        {0x2003e012, 0x13000019},
+    },
+};
+
+const struct __box_mpudelta __box_bobbox_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta __box_bobbox_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000c0011, 0x02000021},
+        {0x20030012, 0x1300001d},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_sys_mpudelta = {
+    .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000011, 0x00000000},
+        {0x00000012, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_alicebox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fe011, 0x02000019},
+        {0x2003e012, 0x13000019},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fc011, 0x02000019},
+        {0x2003c012, 0x13000019},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta *const __box_mpudeltas[__BOX_COUNT+1][__BOX_COUNT+1] = {
+    {
+        &__box_sys_to_sys_mpudelta,
+        &__box_sys_to_alicebox_mpudelta,
+        &__box_sys_to_bobbox_mpudelta,
+        &__box_sys_to_tlsbox_mpudelta,
+    },
+    {
+        &__box_alicebox_to_sys_mpudelta,
+        &__box_alicebox_to_alicebox_mpudelta,
+        &__box_alicebox_to_bobbox_mpudelta,
+        &__box_alicebox_to_tlsbox_mpudelta,
+    },
+    {
+        &__box_bobbox_to_sys_mpudelta,
+        &__box_bobbox_to_alicebox_mpudelta,
+        &__box_bobbox_to_bobbox_mpudelta,
+        &__box_bobbox_to_tlsbox_mpudelta,
+    },
+    {
+        &__box_tlsbox_to_sys_mpudelta,
+        &__box_tlsbox_to_alicebox_mpudelta,
+        &__box_tlsbox_to_bobbox_mpudelta,
+        &__box_tlsbox_to_tlsbox_mpudelta,
+    },
 };
 
 const uint32_t *const __box_jumptables[__BOX_COUNT] = {
@@ -1609,8 +1753,12 @@ struct __box_frame {
 // foward declaration of fault wrapper, may be called directly
 // in other handlers, but only in other handlers! (needs isr context)
 uint64_t __box_faultsetup(int32_t err) {
+    uint32_t active = __box_active;
     // mark box as uninitialized
-    __box_state[__box_active]->initialized = false;
+    __box_state[active]->initialized = false;
+    if (__box_faults[active]) {
+        __box_faults[active]();
+    }
 
     // invoke user handler, should not return
     // TODO should we set this up to be called in non-isr context?
@@ -1645,7 +1793,7 @@ uint64_t __box_faultsetup(int32_t err) {
     targetstate->caller = targetbf->caller;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
 
     // copy return frame
     targetfp[0] = err;         // r0 = arg0
@@ -1684,8 +1832,36 @@ void __box_faulthandler(int32_t err) {
 
 uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
         uint32_t op, uint32_t *fp) {
+    // find target, boxes may call sys or call another box directly,
+    // in which case the jumptable contains the call op sys would use
+    // (even), instead of a function pointer (odd)
+    uint32_t caller = __box_active;
+    uint32_t target = (caller == 0)
+        ? op
+        : __box_sys_jumptables[caller-1][((op/4)-2)];
+    uint32_t targetbox = (target & 1)
+        ? 0
+        : (((target/4)-2) % __BOX_COUNT) + 1;
+    uint32_t targetpc = (target & 1)
+        ? target
+        : __box_jumptables[targetbox-1][((target/4)-2) / __BOX_COUNT + 1];
+    struct __box_state *targetstate = __box_state[targetbox];
+
+    // boxes can't initialize other boxes, if the target box has been
+    // clobbered since the caller was initialized we return an error
+    if (caller != 0 && targetbox != 0 && !targetstate->initialized) {
+        // halt if we can't handle
+        if (!(op & 2)) {
+            __box_abort(-EAGAIN);
+        }
+
+        fp[0] = -EAGAIN;    // r0 = arg0
+        fp[6] = fp[5];      // pc = lr
+        return ((uint64_t)lr) | ((uint64_t)(uint32_t)fp << 32);
+    }
+
     // save lr + sp
-    struct __box_state *state = __box_state[__box_active];
+    struct __box_state *state = __box_state[caller];
     struct __box_frame *frame = (struct __box_frame*)sp;
     frame->fp = fp;
     frame->lr = state->lr;
@@ -1694,14 +1870,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
-    uint32_t caller = __box_active;
-    __box_active = (caller == 0)
-        ? (((op/4)-2) % __BOX_COUNT) + 1
-        : 0;
-    uint32_t targetpc = (caller == 0)
-        ? __box_jumptables[__box_active-1][((op/4)-2) / __BOX_COUNT + 1]
-        : __box_sys_jumptables[caller-1][((op/4)-2)];
-    struct __box_state *targetstate = __box_state[__box_active];
+    __box_active = targetbox;
     uint32_t targetlr = targetstate->lr;
     uint32_t *targetsp = targetstate->sp;
     // keep track of caller
@@ -1712,7 +1881,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetsp;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[caller][__box_active]);
 
     // setup new call frame
     targetsp -= 8;
@@ -1773,8 +1942,13 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
+    uint32_t active = __box_active;
     __box_active = state->caller;
 
+    // select MPU regions, do this before we can fault since our
+    // deltas depend on the previous box
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
+
     struct __box_state *targetstate = __box_state[__box_active];
     uint32_t targetlr = targetstate->lr;
     // in call?
@@ -1789,9 +1963,6 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetframe->sp;
     targetstate->caller = targetframe->caller;
 
-    // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
-
     // copy return frame
     targetfp[0] = fp[0];       // r0 = arg0
     targetfp[1] = fp[1];       // r1 = arg1
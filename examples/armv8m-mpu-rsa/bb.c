@@ -247,10 +247,10 @@ extern void __box_return(void);
 #define MPU_RBAR     ((volatile uint32_t*)0xe000ed9c)
 #define MPU_RLAR     ((volatile uint32_t*)0xe000eda0)
 
-struct __box_mpuregions {
+struct __box_mpudelta {
     uint32_t control;
     uint32_t count;
-    uint32_t regions[][2];
+    uint32_t regions[][3];
 };
 
 static int32_t __box_mpu_init(void) {
@@ -267,33 +267,37 @@ static int32_t __box_mpu_init(void) {
         *MPU_RLAR = (~0x1f & (
             (uint32_t)&__box_callregion + 1048576 - 1))
             | 0x1;
+        // start with box regions disabled, switches only write the
+        // regions that differ between boxes
+        for (int i = 0; i < 4; i++) {
+            *MPU_RNR = i+1;
+            *MPU_RBAR = 0;
+            *MPU_RLAR = 0;
+        }
         // enable the MPU
         *MPU_CTRL = 5;
     }
     return 0;
 }
 
-static void __box_mpu_switch(const struct __box_mpuregions *regions) {
-    *MPU_CTRL = 0;
-    uint32_t count = regions->count;
-    for (int i = 0; i < 4; i++) {
-        if (i < count) {
-            *MPU_RNR = i+1;
-            *MPU_RBAR = regions->regions[i][0];
-            *MPU_RLAR = regions->regions[i][1];
-        } else {
-            *MPU_RNR = i+1;
-            *MPU_RBAR = 0;
-            *MPU_RLAR = 0;
+static void __box_mpu_switch(const struct __box_mpudelta *delta) {
+    // update MPU regions that differ from the previous box
+    uint32_t count = delta->count;
+    if (count > 0) {
+        *MPU_CTRL = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            *MPU_RNR = delta->regions[i][0];
+            *MPU_RBAR = delta->regions[i][1];
+            *MPU_RLAR = delta->regions[i][2];
         }
+        *MPU_CTRL = 5;
     }
-    *MPU_CTRL = 5;
 
     // update CONTROL state, note that return-from-exception acts
     // as an instruction barrier
     uint32_t control;
     __asm__ volatile ("mrs %0, control" : "=r"(control));
-    control = (~1 & control) | (regions->control);
+    control = (~1 & control) | (delta->control);
     __asm__ volatile ("msr control, %0" :: "r"(control));
 }
 
@@ -401,6 +405,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -447,11 +452,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -535,7 +539,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -595,7 +599,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -615,7 +619,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -1007,15 +1012,6 @@ static int __box_alicebox_load(void) {
 struct __box_state __box_alicebox_state;
 extern uint32_t __box_alicebox_jumptable[];
 
-const struct __box_mpuregions __box_alicebox_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000fe006, 0x000fffe1},
-        {0x2003e003, 0x2003ffe1},
-    },
-};
-
 //// alicebox exports ////
 
 int alicebox_getpubkey(char *buffer, size_t size) {
@@ -1146,8 +1142,8 @@ int __box_alicebox_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_alicebox_postinit(void);
+    // call box's init
     err = __box_alicebox_postinit();
     if (err) {
         return err;
@@ -1192,15 +1188,6 @@ static int __box_bobbox_load(void) {
 struct __box_state __box_bobbox_state;
 extern uint32_t __box_bobbox_jumptable[];
 
-const struct __box_mpuregions __box_bobbox_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000fc006, 0x000fdfe1},
-        {0x2003c003, 0x2003dfe1},
-    },
-};
-
 //// bobbox exports ////
 
 int bobbox_getpubkey(char *buffer, size_t size) {
@@ -1331,8 +1318,8 @@ int __box_bobbox_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_bobbox_postinit(void);
+    // call box's init
     err = __box_bobbox_postinit();
     if (err) {
         return err;
@@ -1377,15 +1364,6 @@ static int __box_tlsbox_load(void) {
 struct __box_state __box_tlsbox_state;
 extern uint32_t __box_tlsbox_jumptable[];
 
-const struct __box_mpuregions __box_tlsbox_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000c0006, 0x000dffe1},
-        {0x20030003, 0x20037fe1},
-    },
-};
-
 //// tlsbox exports ////
 
 int tlsbox_drbg_seed(void) {
@@ -1535,8 +1513,8 @@ int __box_tlsbox_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_tlsbox_postinit(void);
+    // call box's init
     err = __box_tlsbox_postinit();
     if (err) {
         return err;
@@ -1586,17 +1564,170 @@ void (*const __box_aborts[])(int err) = {
     NULL,
 };
 
-const struct __box_mpuregions __box_sys_mpuregions = {
+void (*const __box_faults[])(void) = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+const struct __box_mpudelta __box_sys_to_sys_mpudelta = {
+    .control = 0,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta __box_sys_to_alicebox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000fe006, 0x000fffe1},
+        {0x00000002, 0x2003e003, 0x2003ffe1},
+    },
+};
+
+const struct __box_mpudelta __box_sys_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000fc006, 0x000fdfe1},
+        {0x00000002, 0x2003c003, 0x2003dfe1},
+    },
+};
+
+const struct __box_mpudelta __box_sys_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000c0006, 0x000dffe1},
+        {0x00000002, 0x20030003, 0x20037fe1},
+    },
+};
+
+const struct __box_mpudelta __box_alicebox_to_sys_mpudelta = {
     .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x00000000, 0x00000000},
+        {0x00000002, 0x00000000, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_alicebox_to_alicebox_mpudelta = {
+    .control = 1,
     .count = 0,
     .regions = {}
 };
 
-const struct __box_mpuregions *const __box_mpuregions[__BOX_COUNT+1] = {
-    &__box_sys_mpuregions,
-    &__box_alicebox_mpuregions,
-    &__box_bobbox_mpuregions,
-    &__box_tlsbox_mpuregions,
+const struct __box_mpudelta __box_alicebox_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000fc006, 0x000fdfe1},
+        {0x00000002, 0x2003c003, 0x2003dfe1},
+    },
+};
+
+const struct __box_mpudelta __box_alicebox_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000c0006, 0x000dffe1},
+        {0x00000002, 0x20030003, 0x20037fe1},
+    },
+};
+
+const struct __box_mpudelta __box_bobbox_to_sys_mpudelta = {
+    .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x00000000, 0x00000000},
+        {0x00000002, 0x00000000, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_bobbox_to_alicebox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000fe006, 0x000fffe1},
+        {0x00000002, 0x2003e003, 0x2003ffe1},
+    },
+};
+
+const struct __box_mpudelta __box_bobbox_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta __box_bobbox_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000c0006, 0x000dffe1},
+        {0x00000002, 0x20030003, 0x20037fe1},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_sys_mpudelta = {
+    .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x00000000, 0x00000000},
+        {0x00000002, 0x00000000, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_alicebox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000fe006, 0x000fffe1},
+        {0x00000002, 0x2003e003, 0x2003ffe1},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_bobbox_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x00000001, 0x000fc006, 0x000fdfe1},
+        {0x00000002, 0x2003c003, 0x2003dfe1},
+    },
+};
+
+const struct __box_mpudelta __box_tlsbox_to_tlsbox_mpudelta = {
+    .control = 1,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta *const __box_mpudeltas[__BOX_COUNT+1][__BOX_COUNT+1] = {
+    {
+        &__box_sys_to_sys_mpudelta,
+        &__box_sys_to_alicebox_mpudelta,
+        &__box_sys_to_bobbox_mpudelta,
+        &__box_sys_to_tlsbox_mpudelta,
+    },
+    {
+        &__box_alicebox_to_sys_mpudelta,
+        &__box_alicebox_to_alicebox_mpudelta,
+        &__box_alicebox_to_bobbox_mpudelta,
+        &__box_alicebox_to_tlsbox_mpudelta,
+    },
+    {
+        &__box_bobbox_to_sys_mpudelta,
+        &__box_bobbox_to_alicebox_mpudelta,
+        &__box_bobbox_to_bobbox_mpudelta,
+        &__box_bobbox_to_tlsbox_mpudelta,
+    },
+    {
+        &__box_tlsbox_to_sys_mpudelta,
+        &__box_tlsbox_to_alicebox_mpudelta,
+        &__box_tlsbox_to_bobbox_mpudelta,
+        &__box_tlsbox_to_tlsbox_mpudelta,
+    },
 };
 
 const uint32_t *const __box_jumptables[__BOX_COUNT] = {
@@ -1621,8 +1752,12 @@ struct __box_frame {
 // foward declaration of fault wrapper, may be called directly
 // in other handlers, but only in other handlers! (needs isr context)
 uint64_t __box_faultsetup(int32_t err) {
+    uint32_t active = __box_active;
     // mark box as uninitialized
-    __box_state[__box_active]->initialized = false;
+    __box_state[active]->initialized = false;
+    if (__box_faults[active]) {
+        __box_faults[active]();
+    }
 
     // invoke user handler, should not return
     // TODO should we set this up to be called in non-isr context?
@@ -1657,7 +1792,7 @@ uint64_t __box_faultsetup(int32_t err) {
     targetstate->caller = targetbf->caller;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
 
     // copy return frame
     targetfp[0] = err;         // r0 = arg0
@@ -1696,8 +1831,36 @@ void __box_faulthandler(int32_t err) {
 
 uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
         uint32_t op, uint32_t *fp) {
+    // find target, boxes may call sys or call another box directly,
+    // in which case the jumptable contains the call op sys would use
+    // (even), instead of a function pointer (odd)
+    uint32_t caller = __box_active;
+    uint32_t target = (caller == 0)
+        ? op
+        : __box_sys_jumptables[caller-1][((op/4)-2)];
+    uint32_t targetbox = (target & 1)
+        ? 0
+        : (((target/4)-2) % __BOX_COUNT) + 1;
+    uint32_t targetpc = (target & 1)
+        ? target
+        : __box_jumptables[targetbox-1][((target/4)-2) / __BOX_COUNT + 1];
+    struct __box_state *targetstate = __box_state[targetbox];
+
+    // boxes can't initialize other boxes, if the target box has been
+    // clobbered since the caller was initialized we return an error
+    if (caller != 0 && targetbox != 0 && !targetstate->initialized) {
+        // halt if we can't handle
+        if (!(op & 2)) {
+            __box_abort(-EAGAIN);
+        }
+
+        fp[0] = -EAGAIN;    // r0 = arg0
+        fp[6] = fp[5];      // pc = lr
+        return ((uint64_t)lr) | ((uint64_t)(uint32_t)fp << 32);
+    }
+
     // save lr + sp
-    struct __box_state *state = __box_state[__box_active];
+    struct __box_state *state = __box_state[caller];
     struct __box_frame *frame = (struct __box_frame*)sp;
     frame->fp = fp;
     frame->lr = state->lr;
@@ -1706,14 +1869,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
-    uint32_t caller = __box_active;
-    __box_active = (caller == 0)
-        ? (((op/4)-2) % __BOX_COUNT) + 1
-        : 0;
-    uint32_t targetpc = (caller == 0)
-        ? __box_jumptables[__box_active-1][((op/4)-2) / __BOX_COUNT + 1]
-        : __box_sys_jumptables[caller-1][((op/4)-2)];
-    struct __box_state *targetstate = __box_state[__box_active];
+    __box_active = targetbox;
     uint32_t targetlr = targetstate->lr;
     uint32_t *targetsp = targetstate->sp;
     // keep track of caller
@@ -1724,7 +1880,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetsp;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[caller][__box_active]);
 
     // setup new call frame
     targetsp -= 8;
@@ -1785,8 +1941,13 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
+    uint32_t active = __box_active;
     __box_active = state->caller;
 
+    // select MPU regions, do this before we can fault since our
+    // deltas depend on the previous box
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
+
     struct __box_state *targetstate = __box_state[__box_active];
     uint32_t targetlr = targetstate->lr;
     // in call?
@@ -1801,9 +1962,6 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetframe->sp;
     targetstate->caller = targetframe->caller;
 
-    // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
-
     // copy return frame
     targetfp[0] = fp[0];       // r0 = arg0
     targetfp[1] = fp[1];       // r1 = arg1
@@ -145,8 +145,8 @@ void *__wrap_malloc(size_t size) {
             }
 
             // mark as used
-            ptr[0]        = psize | 0x80000000;
-            ptr[size+2-1] = psize | 0x80000000;
+            ptr[0]         = psize | 0x80000000;
+            ptr[psize+2-1] = psize | 0x80000000;
 
             return ptr+1;
         }
@@ -196,12 +196,11 @@ void *__wrap_calloc(size_t size) {
 }
 
 void *__wrap_realloc(void *pptr, size_t size) {
-    ssize_t psize = pptr ? ((ssize_t*)pptr)[-1] : 0;
+    size_t psize = pptr ? 4*(((ssize_t*)pptr)[-1] & 0x7fffffff) : 0;
 
     void *nptr = __wrap_malloc(size);
     if (nptr) {
-        // yes this copies extra, we don't really care
-        memmove(nptr, pptr, psize);
+        memmove(nptr, pptr, psize < size ? psize : size);
 
         __wrap_free(pptr);
     }
@@ -263,6 +262,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -309,11 +309,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -397,7 +396,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -457,7 +456,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((visibility("hidden")))
@@ -477,7 +476,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((visibility("hidden")))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((visibility("hidden")))
@@ -203,25 +203,65 @@ static inline uint32_t __box_bd_alignup(uint32_t a, uint32_t alignment) {
 typedef uint32_t glz_size_t;
 typedef uint32_t glz_off_t;
 
-int __box_glz_bddecode(uint8_t k,
+// read a single bit, only calling read when we cross into a new byte
+static inline int __box_glz_bdbit(
         int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
-        void *ctx,
-        glz_off_t off,
-        uint8_t *output, glz_size_t size) {
+        void *ctx, glz_off_t off, uint8_t *x, glz_off_t *xoff) {
+    if (off/8 != *xoff) {
+        int err = read(ctx, off/8, x, 1);
+        if (err) {
+            return err;
+        }
+        *xoff = off/8;
+    }
+    return 1 & (*x >> (7-off%8));
+}
+
+// decoder state, saved between symbols so decoding can be resumed
+struct __box_glz_bdstate {
+    uint8_t k;
+    glz_off_t off;
+    glz_size_t size;
+    glz_off_t poff;
+    glz_size_t psize;
+    uint8_t *output;
+};
+
+// decode at most limit bytes, returning -EAGAIN if there is more to
+// decode, note the symbol table is read through its own ctx, this lets
+// the caller buffer table lookups separately from the bitstream
+int __box_glz_bdstep(struct __box_glz_bdstate *state,
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, void *table_ctx,
+        glz_size_t limit) {
+    uint8_t k = state->k;
+    glz_off_t off = state->off;
+    glz_size_t size = state->size;
     // glz "stack"
-    glz_off_t poff = 0;
-    glz_size_t psize = 0;
-    uint8_t x[2];
+    glz_off_t poff = state->poff;
+    glz_size_t psize = state->psize;
+    uint8_t *output = state->output;
+    uint8_t x;
+    glz_off_t xoff = -1;
 
     while (size > 0) {
+        if (limit == 0) {
+            state->off = off;
+            state->size = size;
+            state->poff = poff;
+            state->psize = psize;
+            state->output = output;
+            return -EAGAIN;
+        }
+
         // decode rice code
         uint_fast16_t rice = 0;
         while (true) {
-            int err = read(ctx, off/8, x, 1);
-            if (err) {
-                return err;
+            int bit = __box_glz_bdbit(read, ctx, off, &x, &xoff);
+            if (bit < 0) {
+                return bit;
             }
-            if (!(1 & (x[0] >> (7-off%8)))) {
+            if (!bit) {
                 off += 1;
                 break;
             }
@@ -229,38 +269,40 @@ int __box_glz_bddecode(uint8_t k,
             off += 1;
         }
         for (glz_off_t i = 0; i < k; i++) {
-            int err = read(ctx, off/8, x, 1);
-            if (err) {
-                return err;
+            int bit = __box_glz_bdbit(read, ctx, off, &x, &xoff);
+            if (bit < 0) {
+                return bit;
             }
-            rice = (rice << 1) | (1 & (x[0] >> (7-off%8)));
+            rice = (rice << 1) | bit;
             off += 1;
         }
 
         // map through table
-        int err = read(ctx, (9*rice)/8, x, 2);
+        uint8_t y[2];
+        int err = read(table_ctx, (9*rice)/8, y, 2);
         if (err) {
             return err;
         }
         rice = 0x1ff & (
-            (x[0] << 8) |
-            (x[1] << 0)) >> (7-(9*rice)%8);
+            (y[0] << 8) |
+            (y[1] << 0)) >> (7-(9*rice)%8);
 
         // indirect reference or literal?
         if (rice < 0x100) {
             *output++ = rice;
             size -= 1;
+            limit -= 1;
         } else {
             glz_size_t nsize = (rice & 0xff) + 2;
             glz_off_t noff = 0;
             while (true) {
                 glz_off_t n = 0;
                 for (glz_off_t i = 0; i < GLZ_M+1; i++) {
-                    int err = read(ctx, off/8, x, 1);
-                    if (err) {
-                        return err;
+                    int bit = __box_glz_bdbit(read, ctx, off, &x, &xoff);
+                    if (bit < 0) {
+                        return bit;
                     }
-                    n = (n << 1) | (1 & (x[0] >> (7-off%8)));
+                    n = (n << 1) | bit;
                     off += 1;
                 }
 
@@ -291,9 +333,19 @@ int __box_glz_bddecode(uint8_t k,
         }
     }
 
+    state->size = 0;
     return 0;
 }
 
+int __box_glz_bddecode(uint8_t k,
+        int (*read)(void *ctx, uint32_t addr, void *buffer, size_t size),
+        void *ctx, void *table_ctx,
+        glz_off_t off,
+        uint8_t *output, glz_size_t size) {
+    struct __box_glz_bdstate state = {k, off, size, 0, 0, output};
+    return __box_glz_bdstep(&state, read, ctx, table_ctx, -1);
+}
+
 uint32_t __box_active = 0;
 extern uint32_t __box_callregion;
 extern void __box_return(void);
@@ -304,7 +356,7 @@ extern void __box_return(void);
 #define MPU_RBAR ((volatile uint32_t*)0xe000ed9c)
 #define MPU_RASR ((volatile uint32_t*)0xe000eda0)
 
-struct __box_mpuregions {
+struct __box_mpudelta {
     uint32_t control;
     uint32_t count;
     uint32_t regions[][2];
@@ -321,32 +373,49 @@ static int32_t __box_mpu_init(void) {
         *MPU_RBAR = (uint32_t)&__box_callregion | 0x10;
         // disallow execution
         *MPU_RASR = 0x10000001 | ((6-1) << 1);
+        // start with box regions disabled, switches only write the
+        // regions that differ between boxes
+        for (int i = 0; i < 4; i++) {
+            *MPU_RBAR = 0x10 | (i+1);
+            *MPU_RASR = 0;
+        }
         // enable the MPU
         *MPU_CTRL = 5;
     }
     return 0;
 }
 
-static void __box_mpu_switch(const struct __box_mpuregions *regions) {
-    // update MPU regions
-    *MPU_CTRL = 0;
-    uint32_t count = regions->count;
-    for (int i = 0; i < 4; i++) {
-        if (i < count) {
-            *MPU_RBAR = regions->regions[i][0] | 0x10 | (i+1);
-            *MPU_RASR = regions->regions[i][1];
-        } else {
-            *MPU_RBAR = 0x10 | (i+1);
-            *MPU_RASR = 0;
+static void __box_mpu_switch(const struct __box_mpudelta *delta) {
+    // update MPU regions that differ from the previous box
+    uint32_t count = delta->count;
+    if (count > 0) {
+        *MPU_CTRL = 0;
+        const uint32_t *region = delta->regions[0];
+        // RBAR has VALID set, so each RBAR/RASR pair selects its own
+        // region, this lets us write up to 4 regions at a time through
+        // the contiguous RBAR_A1-A3/RASR_A1-A3 alias registers
+        for (; count >= 4; count -= 4, region += 8) {
+            MPU_RBAR[0] = region[0];
+            MPU_RBAR[1] = region[1];
+            MPU_RBAR[2] = region[2];
+            MPU_RBAR[3] = region[3];
+            MPU_RBAR[4] = region[4];
+            MPU_RBAR[5] = region[5];
+            MPU_RBAR[6] = region[6];
+            MPU_RBAR[7] = region[7];
+        }
+        for (; count > 0; count -= 1, region += 2) {
+            MPU_RBAR[0] = region[0];
+            MPU_RBAR[1] = region[1];
         }
+        *MPU_CTRL = 5;
     }
-    *MPU_CTRL = 5;
 
     // update CONTROL state, note that return-from-exception acts
     // as an instruction barrier
     uint32_t control;
     __asm__ volatile ("mrs %0, control" : "=r"(control));
-    control = (~1 & control) | (regions->control);
+    control = (~1 & control) | (delta->control);
     __asm__ volatile ("msr control, %0" :: "r"(control));
 }
 
@@ -454,6 +523,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -500,11 +570,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -588,7 +657,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -648,7 +717,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -668,7 +737,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -1050,62 +1120,99 @@ const uint32_t __isr_vector[256] = {
 #define BOX_BOX1_BUFFER_SIZE 16
 #define BOX_BOX1_READ_SIZE 1
 
-// bdread with buffer_size buffering, translation, and bounds checking
-uint32_t __box_box1_buffer_block;
-uint32_t __box_box1_buffer_off;
-uint8_t __box_box1_buffer[BOX_BOX1_BUFFER_SIZE];
+// bdread with read-ahead buffering, translation, and bounds checking,
+// hits/misses count reads served from the buffer vs reads that needed
+// the block device, these are useful for sizing the buffers
+struct __box_box1_window {
+    uint32_t off;
+    uint32_t buffer_block;
+    uint32_t buffer_off;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t buffer_size;
+    uint8_t *buffer;
+};
+
 static int __box_box1_buffer_read(void *ctx,
         uint32_t addr, void *buffer, size_t size) {
-    uint32_t off = (uint32_t)ctx;
-    addr = addr + off;
+    struct __box_box1_window *window = ctx;
+    addr = addr + window->off;
     if (addr + size > 8193) {
         return -EINVAL;
     }
 
     uint32_t block = addr / BOX_BOX1_BLOCK_SIZE;
-    off = addr - (block * BOX_BOX1_BLOCK_SIZE);
+    uint32_t off = addr - (block * BOX_BOX1_BLOCK_SIZE);
+    uint32_t misses = window->misses;
 
     while (size > 0) {
-        if (block == __box_box1_buffer_block &&
-                off >= __box_box1_buffer_off &&
-                off < __box_box1_buffer_off + BOX_BOX1_BUFFER_SIZE) {
+        if (block == window->buffer_block &&
+                off >= window->buffer_off &&
+                off < window->buffer_off + window->buffer_size) {
             size_t delta = __box_bd_min(
-                BOX_BOX1_BUFFER_SIZE-(off-__box_box1_buffer_off),
+                window->buffer_size-(off-window->buffer_off),
                 size);
             memcpy(buffer,
-                    &__box_box1_buffer[off - __box_box1_buffer_off],
+                    &window->buffer[off - window->buffer_off],
                     delta);
+            buffer = (uint8_t*)buffer + delta;
             off += delta;
             size -= delta;
+            if (off >= BOX_BOX1_BLOCK_SIZE) {
+                block += 1;
+                off -= BOX_BOX1_BLOCK_SIZE;
+            }
             continue;
         }
 
         // load buffer, first condition can't fail
         uint32_t nblock = block;
-        uint32_t noff = __box_bd_aligndown(off, BOX_BOX1_BUFFER_SIZE);
+        uint32_t noff = __box_bd_aligndown(off, window->buffer_size);
         int err = __box_bdread(nblock, noff,
-                __box_box1_buffer,
-                BOX_BOX1_BUFFER_SIZE);
+                window->buffer,
+                window->buffer_size);
         if (err) {
             return err;
         }
-        __box_box1_buffer_block = nblock;
-        __box_box1_buffer_off = noff;
+        window->buffer_block = nblock;
+        window->buffer_off = noff;
+        window->misses += 1;
     }
 
+    if (window->misses == misses) {
+        window->hits += 1;
+    }
     return 0;
 }
 
+uint8_t __box_box1_buffer[BOX_BOX1_BUFFER_SIZE];
+struct __box_box1_window __box_box1_window = {
+    .buffer_size = BOX_BOX1_BUFFER_SIZE,
+    .buffer = __box_box1_buffer,
+};
+
+#define BOX_BOX1_TABLE_BUFFER_SIZE 16
+
+uint8_t __box_box1_table_buffer[BOX_BOX1_TABLE_BUFFER_SIZE];
+struct __box_box1_window __box_box1_table_window = {
+    .buffer_size = BOX_BOX1_TABLE_BUFFER_SIZE,
+    .buffer = __box_box1_table_buffer,
+};
+
 // add checks for input size
 int __box_box1_load(void) {
     extern uint8_t __box_box1_ram_start;
     extern uint8_t __box_box1_ram_end;
-    // init buffer
-    __box_box1_buffer_block = -1;
+    // init buffers
+    __box_box1_window.off = 0;
+    __box_box1_window.buffer_block = -1;
+    __box_box1_table_window.off = 0 + 8;
+    __box_box1_table_window.buffer_block = -1;
 
     // load metadata
     uint32_t x[2];
-    int err = __box_box1_buffer_read(NULL, 0, x, sizeof(x));
+    int err = __box_box1_buffer_read(&__box_box1_window,
+            0, x, sizeof(x));
     if (err) {
         return err;
     }
@@ -1123,8 +1230,11 @@ int __box_box1_load(void) {
     }
 
     // decompress region
+    __box_box1_window.off = 0 + 8;
     return __box_glz_bddecode(k,
-            __box_box1_buffer_read, (void*)(0 + 8),
+            __box_box1_buffer_read,
+            &__box_box1_window,
+            &__box_box1_table_window,
             off,
             &__box_box1_ram_start,
             size);
@@ -1134,15 +1244,6 @@ int __box_box1_load(void) {
 struct __box_state __box_box1_state;
 extern uint32_t __box_box1_jumptable[];
 
-const struct __box_mpuregions __box_box1_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000fe000, 0x12000019},
-        {0x2003e000, 0x03000019},
-    },
-};
-
 //// box1 exports ////
 
 int32_t box1_add2(int32_t a0, int32_t a1) {
@@ -1220,8 +1321,8 @@ int __box_box1_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_box1_postinit(void);
+    // call box's init
     err = __box_box1_postinit();
     if (err) {
         return err;
@@ -1261,62 +1362,99 @@ void __box_box1_pop(size_t size) {
 #define BOX_BOX2_BUFFER_SIZE 16
 #define BOX_BOX2_READ_SIZE 1
 
-// bdread with buffer_size buffering, translation, and bounds checking
-uint32_t __box_box2_buffer_block;
-uint32_t __box_box2_buffer_off;
-uint8_t __box_box2_buffer[BOX_BOX2_BUFFER_SIZE];
+// bdread with read-ahead buffering, translation, and bounds checking,
+// hits/misses count reads served from the buffer vs reads that needed
+// the block device, these are useful for sizing the buffers
+struct __box_box2_window {
+    uint32_t off;
+    uint32_t buffer_block;
+    uint32_t buffer_off;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t buffer_size;
+    uint8_t *buffer;
+};
+
 static int __box_box2_buffer_read(void *ctx,
         uint32_t addr, void *buffer, size_t size) {
-    uint32_t off = (uint32_t)ctx;
-    addr = addr + off;
-    if (addr + size > 8193) {
+    struct __box_box2_window *window = ctx;
+    addr = addr + window->off;
+    if (addr + size > 16385) {
         return -EINVAL;
     }
 
     uint32_t block = addr / BOX_BOX2_BLOCK_SIZE;
-    off = addr - (block * BOX_BOX2_BLOCK_SIZE);
+    uint32_t off = addr - (block * BOX_BOX2_BLOCK_SIZE);
+    uint32_t misses = window->misses;
 
     while (size > 0) {
-        if (block == __box_box2_buffer_block &&
-                off >= __box_box2_buffer_off &&
-                off < __box_box2_buffer_off + BOX_BOX2_BUFFER_SIZE) {
+        if (block == window->buffer_block &&
+                off >= window->buffer_off &&
+                off < window->buffer_off + window->buffer_size) {
             size_t delta = __box_bd_min(
-                BOX_BOX2_BUFFER_SIZE-(off-__box_box2_buffer_off),
+                window->buffer_size-(off-window->buffer_off),
                 size);
             memcpy(buffer,
-                    &__box_box2_buffer[off - __box_box2_buffer_off],
+                    &window->buffer[off - window->buffer_off],
                     delta);
+            buffer = (uint8_t*)buffer + delta;
             off += delta;
             size -= delta;
+            if (off >= BOX_BOX2_BLOCK_SIZE) {
+                block += 1;
+                off -= BOX_BOX2_BLOCK_SIZE;
+            }
             continue;
         }
 
         // load buffer, first condition can't fail
         uint32_t nblock = block;
-        uint32_t noff = __box_bd_aligndown(off, BOX_BOX2_BUFFER_SIZE);
+        uint32_t noff = __box_bd_aligndown(off, window->buffer_size);
         int err = __box_bdread(nblock, noff,
-                __box_box2_buffer,
-                BOX_BOX2_BUFFER_SIZE);
+                window->buffer,
+                window->buffer_size);
         if (err) {
             return err;
         }
-        __box_box2_buffer_block = nblock;
-        __box_box2_buffer_off = noff;
+        window->buffer_block = nblock;
+        window->buffer_off = noff;
+        window->misses += 1;
     }
 
+    if (window->misses == misses) {
+        window->hits += 1;
+    }
     return 0;
 }
 
+uint8_t __box_box2_buffer[BOX_BOX2_BUFFER_SIZE];
+struct __box_box2_window __box_box2_window = {
+    .buffer_size = BOX_BOX2_BUFFER_SIZE,
+    .buffer = __box_box2_buffer,
+};
+
+#define BOX_BOX2_TABLE_BUFFER_SIZE 16
+
+uint8_t __box_box2_table_buffer[BOX_BOX2_TABLE_BUFFER_SIZE];
+struct __box_box2_window __box_box2_table_window = {
+    .buffer_size = BOX_BOX2_TABLE_BUFFER_SIZE,
+    .buffer = __box_box2_table_buffer,
+};
+
 // add checks for input size
 int __box_box2_load(void) {
     extern uint8_t __box_box2_ram_start;
     extern uint8_t __box_box2_ram_end;
-    // init buffer
-    __box_box2_buffer_block = -1;
+    // init buffers
+    __box_box2_window.off = 0;
+    __box_box2_window.buffer_block = -1;
+    __box_box2_table_window.off = 8192 + 8;
+    __box_box2_table_window.buffer_block = -1;
 
     // load metadata
     uint32_t x[2];
-    int err = __box_box2_buffer_read(NULL, 8192, x, sizeof(x));
+    int err = __box_box2_buffer_read(&__box_box2_window,
+            8192, x, sizeof(x));
     if (err) {
         return err;
     }
@@ -1334,8 +1472,11 @@ int __box_box2_load(void) {
     }
 
     // decompress region
+    __box_box2_window.off = 8192 + 8;
     return __box_glz_bddecode(k,
-            __box_box2_buffer_read, (void*)(8192 + 8),
+            __box_box2_buffer_read,
+            &__box_box2_window,
+            &__box_box2_table_window,
             off,
             &__box_box2_ram_start,
             size);
@@ -1345,15 +1486,6 @@ int __box_box2_load(void) {
 struct __box_state __box_box2_state;
 extern uint32_t __box_box2_jumptable[];
 
-const struct __box_mpuregions __box_box2_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000fc000, 0x12000019},
-        {0x2003e000, 0x03000019},
-    },
-};
-
 //// box2 exports ////
 
 int32_t box2_add2(int32_t a0, int32_t a1) {
@@ -1431,8 +1563,8 @@ int __box_box2_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_box2_postinit(void);
+    // call box's init
     err = __box_box2_postinit();
     if (err) {
         return err;
@@ -1472,62 +1604,99 @@ void __box_box2_pop(size_t size) {
 #define BOX_BOX3_BUFFER_SIZE 16
 #define BOX_BOX3_READ_SIZE 1
 
-// bdread with buffer_size buffering, translation, and bounds checking
-uint32_t __box_box3_buffer_block;
-uint32_t __box_box3_buffer_off;
-uint8_t __box_box3_buffer[BOX_BOX3_BUFFER_SIZE];
+// bdread with read-ahead buffering, translation, and bounds checking,
+// hits/misses count reads served from the buffer vs reads that needed
+// the block device, these are useful for sizing the buffers
+struct __box_box3_window {
+    uint32_t off;
+    uint32_t buffer_block;
+    uint32_t buffer_off;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t buffer_size;
+    uint8_t *buffer;
+};
+
 static int __box_box3_buffer_read(void *ctx,
         uint32_t addr, void *buffer, size_t size) {
-    uint32_t off = (uint32_t)ctx;
-    addr = addr + off;
-    if (addr + size > 8193) {
+    struct __box_box3_window *window = ctx;
+    addr = addr + window->off;
+    if (addr + size > 24577) {
         return -EINVAL;
     }
 
     uint32_t block = addr / BOX_BOX3_BLOCK_SIZE;
-    off = addr - (block * BOX_BOX3_BLOCK_SIZE);
+    uint32_t off = addr - (block * BOX_BOX3_BLOCK_SIZE);
+    uint32_t misses = window->misses;
 
     while (size > 0) {
-        if (block == __box_box3_buffer_block &&
-                off >= __box_box3_buffer_off &&
-                off < __box_box3_buffer_off + BOX_BOX3_BUFFER_SIZE) {
+        if (block == window->buffer_block &&
+                off >= window->buffer_off &&
+                off < window->buffer_off + window->buffer_size) {
             size_t delta = __box_bd_min(
-                BOX_BOX3_BUFFER_SIZE-(off-__box_box3_buffer_off),
+                window->buffer_size-(off-window->buffer_off),
                 size);
             memcpy(buffer,
-                    &__box_box3_buffer[off - __box_box3_buffer_off],
+                    &window->buffer[off - window->buffer_off],
                     delta);
+            buffer = (uint8_t*)buffer + delta;
             off += delta;
             size -= delta;
+            if (off >= BOX_BOX3_BLOCK_SIZE) {
+                block += 1;
+                off -= BOX_BOX3_BLOCK_SIZE;
+            }
             continue;
         }
 
         // load buffer, first condition can't fail
         uint32_t nblock = block;
-        uint32_t noff = __box_bd_aligndown(off, BOX_BOX3_BUFFER_SIZE);
+        uint32_t noff = __box_bd_aligndown(off, window->buffer_size);
         int err = __box_bdread(nblock, noff,
-                __box_box3_buffer,
-                BOX_BOX3_BUFFER_SIZE);
+                window->buffer,
+                window->buffer_size);
         if (err) {
             return err;
         }
-        __box_box3_buffer_block = nblock;
-        __box_box3_buffer_off = noff;
+        window->buffer_block = nblock;
+        window->buffer_off = noff;
+        window->misses += 1;
     }
 
+    if (window->misses == misses) {
+        window->hits += 1;
+    }
     return 0;
 }
 
+uint8_t __box_box3_buffer[BOX_BOX3_BUFFER_SIZE];
+struct __box_box3_window __box_box3_window = {
+    .buffer_size = BOX_BOX3_BUFFER_SIZE,
+    .buffer = __box_box3_buffer,
+};
+
+#define BOX_BOX3_TABLE_BUFFER_SIZE 16
+
+uint8_t __box_box3_table_buffer[BOX_BOX3_TABLE_BUFFER_SIZE];
+struct __box_box3_window __box_box3_table_window = {
+    .buffer_size = BOX_BOX3_TABLE_BUFFER_SIZE,
+    .buffer = __box_box3_table_buffer,
+};
+
 // add checks for input size
 int __box_box3_load(void) {
     extern uint8_t __box_box3_ram_start;
     extern uint8_t __box_box3_ram_end;
-    // init buffer
-    __box_box3_buffer_block = -1;
+    // init buffers
+    __box_box3_window.off = 0;
+    __box_box3_window.buffer_block = -1;
+    __box_box3_table_window.off = 16384 + 8;
+    __box_box3_table_window.buffer_block = -1;
 
     // load metadata
     uint32_t x[2];
-    int err = __box_box3_buffer_read(NULL, 16384, x, sizeof(x));
+    int err = __box_box3_buffer_read(&__box_box3_window,
+            16384, x, sizeof(x));
     if (err) {
         return err;
     }
@@ -1545,8 +1714,11 @@ int __box_box3_load(void) {
     }
 
     // decompress region
+    __box_box3_window.off = 16384 + 8;
     return __box_glz_bddecode(k,
-            __box_box3_buffer_read, (void*)(16384 + 8),
+            __box_box3_buffer_read,
+            &__box_box3_window,
+            &__box_box3_table_window,
             off,
             &__box_box3_ram_start,
             size);
@@ -1556,15 +1728,6 @@ int __box_box3_load(void) {
 struct __box_state __box_box3_state;
 extern uint32_t __box_box3_jumptable[];
 
-const struct __box_mpuregions __box_box3_mpuregions = {
-    .control = 1,
-    .count = 2,
-    .regions = {
-        {0x000fa000, 0x12000019},
-        {0x2003e000, 0x03000019},
-    },
-};
-
 //// box3 exports ////
 
 int32_t box3_add2(int32_t a0, int32_t a1) {
@@ -1642,8 +1805,8 @@ int __box_box3_init(void) {
         return err;
     }
 
-    // call box's init
     extern int __box_box3_postinit(void);
+    // call box's init
     err = __box_box3_postinit();
     if (err) {
         return err;
@@ -1693,17 +1856,164 @@ void (*const __box_aborts[])(int err) = {
     NULL,
 };
 
-const struct __box_mpuregions __box_sys_mpuregions = {
+void (*const __box_faults[])(void) = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+const struct __box_mpudelta __box_sys_to_sys_mpudelta = {
     .control = 0,
     .count = 0,
     .regions = {}
 };
 
-const struct __box_mpuregions *const __box_mpuregions[__BOX_COUNT+1] = {
-    &__box_sys_mpuregions,
-    &__box_box1_mpuregions,
-    &__box_box2_mpuregions,
-    &__box_box3_mpuregions,
+const struct __box_mpudelta __box_sys_to_box1_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fe011, 0x12000019},
+        {0x2003e012, 0x03000019},
+    },
+};
+
+const struct __box_mpudelta __box_sys_to_box2_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fc011, 0x12000019},
+        {0x2003e012, 0x03000019},
+    },
+};
+
+const struct __box_mpudelta __box_sys_to_box3_mpudelta = {
+    .control = 1,
+    .count = 2,
+    .regions = {
+        {0x000fa011, 0x12000019},
+        {0x2003e012, 0x03000019},
+    },
+};
+
+const struct __box_mpudelta __box_box1_to_sys_mpudelta = {
+    .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000011, 0x00000000},
+        {0x00000012, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_box1_to_box1_mpudelta = {
+    .control = 1,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta __box_box1_to_box2_mpudelta = {
+    .control = 1,
+    .count = 1,
+    .regions = {
+        {0x000fc011, 0x12000019},
+    },
+};
+
+const struct __box_mpudelta __box_box1_to_box3_mpudelta = {
+    .control = 1,
+    .count = 1,
+    .regions = {
+        {0x000fa011, 0x12000019},
+    },
+};
+
+const struct __box_mpudelta __box_box2_to_sys_mpudelta = {
+    .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000011, 0x00000000},
+        {0x00000012, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_box2_to_box1_mpudelta = {
+    .control = 1,
+    .count = 1,
+    .regions = {
+        {0x000fe011, 0x12000019},
+    },
+};
+
+const struct __box_mpudelta __box_box2_to_box2_mpudelta = {
+    .control = 1,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta __box_box2_to_box3_mpudelta = {
+    .control = 1,
+    .count = 1,
+    .regions = {
+        {0x000fa011, 0x12000019},
+    },
+};
+
+const struct __box_mpudelta __box_box3_to_sys_mpudelta = {
+    .control = 0,
+    .count = 2,
+    .regions = {
+        {0x00000011, 0x00000000},
+        {0x00000012, 0x00000000},
+    },
+};
+
+const struct __box_mpudelta __box_box3_to_box1_mpudelta = {
+    .control = 1,
+    .count = 1,
+    .regions = {
+        {0x000fe011, 0x12000019},
+    },
+};
+
+const struct __box_mpudelta __box_box3_to_box2_mpudelta = {
+    .control = 1,
+    .count = 1,
+    .regions = {
+        {0x000fc011, 0x12000019},
+    },
+};
+
+const struct __box_mpudelta __box_box3_to_box3_mpudelta = {
+    .control = 1,
+    .count = 0,
+    .regions = {}
+};
+
+const struct __box_mpudelta *const __box_mpudeltas[__BOX_COUNT+1][__BOX_COUNT+1] = {
+    {
+        &__box_sys_to_sys_mpudelta,
+        &__box_sys_to_box1_mpudelta,
+        &__box_sys_to_box2_mpudelta,
+        &__box_sys_to_box3_mpudelta,
+    },
+    {
+        &__box_box1_to_sys_mpudelta,
+        &__box_box1_to_box1_mpudelta,
+        &__box_box1_to_box2_mpudelta,
+        &__box_box1_to_box3_mpudelta,
+    },
+    {
+        &__box_box2_to_sys_mpudelta,
+        &__box_box2_to_box1_mpudelta,
+        &__box_box2_to_box2_mpudelta,
+        &__box_box2_to_box3_mpudelta,
+    },
+    {
+        &__box_box3_to_sys_mpudelta,
+        &__box_box3_to_box1_mpudelta,
+        &__box_box3_to_box2_mpudelta,
+        &__box_box3_to_box3_mpudelta,
+    },
 };
 
 const uint32_t *const __box_jumptables[__BOX_COUNT] = {
@@ -1728,8 +2038,12 @@ struct __box_frame {
 // foward declaration of fault wrapper, may be called directly
 // in other handlers, but only in other handlers! (needs isr context)
 uint64_t __box_faultsetup(int32_t err) {
+    uint32_t active = __box_active;
     // mark box as uninitialized
-    __box_state[__box_active]->initialized = false;
+    __box_state[active]->initialized = false;
+    if (__box_faults[active]) {
+        __box_faults[active]();
+    }
 
     // invoke user handler, should not return
     // TODO should we set this up to be called in non-isr context?
@@ -1764,7 +2078,7 @@ uint64_t __box_faultsetup(int32_t err) {
     targetstate->caller = targetbf->caller;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
 
     // copy return frame
     targetfp[0] = err;         // r0 = arg0
@@ -1803,8 +2117,36 @@ void __box_faulthandler(int32_t err) {
 
 uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
         uint32_t op, uint32_t *fp) {
+    // find target, boxes may call sys or call another box directly,
+    // in which case the jumptable contains the call op sys would use
+    // (even), instead of a function pointer (odd)
+    uint32_t caller = __box_active;
+    uint32_t target = (caller == 0)
+        ? op
+        : __box_sys_jumptables[caller-1][((op/4)-2)];
+    uint32_t targetbox = (target & 1)
+        ? 0
+        : (((target/4)-2) % __BOX_COUNT) + 1;
+    uint32_t targetpc = (target & 1)
+        ? target
+        : __box_jumptables[targetbox-1][((target/4)-2) / __BOX_COUNT + 1];
+    struct __box_state *targetstate = __box_state[targetbox];
+
+    // boxes can't initialize other boxes, if the target box has been
+    // clobbered since the caller was initialized we return an error
+    if (caller != 0 && targetbox != 0 && !targetstate->initialized) {
+        // halt if we can't handle
+        if (!(op & 2)) {
+            __box_abort(-EAGAIN);
+        }
+
+        fp[0] = -EAGAIN;    // r0 = arg0
+        fp[6] = fp[5];      // pc = lr
+        return ((uint64_t)lr) | ((uint64_t)(uint32_t)fp << 32);
+    }
+
     // save lr + sp
-    struct __box_state *state = __box_state[__box_active];
+    struct __box_state *state = __box_state[caller];
     struct __box_frame *frame = (struct __box_frame*)sp;
     frame->fp = fp;
     frame->lr = state->lr;
@@ -1813,14 +2155,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
-    uint32_t caller = __box_active;
-    __box_active = (caller == 0)
-        ? (((op/4)-2) % __BOX_COUNT) + 1
-        : 0;
-    uint32_t targetpc = (caller == 0)
-        ? __box_jumptables[__box_active-1][((op/4)-2) / __BOX_COUNT + 1]
-        : __box_sys_jumptables[caller-1][((op/4)-2)];
-    struct __box_state *targetstate = __box_state[__box_active];
+    __box_active = targetbox;
     uint32_t targetlr = targetstate->lr;
     uint32_t *targetsp = targetstate->sp;
     // keep track of caller
@@ -1831,7 +2166,7 @@ uint64_t __box_callsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetsp;
 
     // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
+    __box_mpu_switch(__box_mpudeltas[caller][__box_active]);
 
     // setup new call frame
     targetsp -= 8;
@@ -1892,8 +2227,13 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     state->lr = lr;
     state->sp = sp;
 
+    uint32_t active = __box_active;
     __box_active = state->caller;
 
+    // select MPU regions, do this before we can fault since our
+    // deltas depend on the previous box
+    __box_mpu_switch(__box_mpudeltas[active][__box_active]);
+
     struct __box_state *targetstate = __box_state[__box_active];
     uint32_t targetlr = targetstate->lr;
     // in call?
@@ -1908,9 +2248,6 @@ uint64_t __box_returnsetup(uint32_t lr, uint32_t *sp,
     targetstate->sp = targetframe->sp;
     targetstate->caller = targetframe->caller;
 
-    // select MPU regions
-    __box_mpu_switch(__box_mpuregions[__box_active]);
-
     // copy return frame
     targetfp[0] = fp[0];       // r0 = arg0
     targetfp[1] = fp[1];       // r1 = arg1
@@ -0,0 +1,40 @@
+/*
+ * Bento-linker example
+ *
+ * Copyright (c) 2020, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "bb.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+const int32_t n = 2;
+
+int32_t box2_ping(int32_t a) {
+    return a + n;
+}
+
+int32_t box2_ping_import(int32_t a) {
+    return sys_ping(a) + n;
+}
+
+int32_t box2_ping_abort(int32_t a) {
+    if (!a) {
+        exit(-n);
+    }
+
+    printf("box%d: should not reach here!\n", n);
+    return n;
+}
+
+int32_t box2_ping_fault(int32_t a) {
+    // box1's ram, only faults if we are isolated
+    volatile int32_t *p = (volatile int32_t*)(uintptr_t)(0x2003e000 + a);
+    return *p + n;
+}
+
+int box2_hello(void) {
+    printf("box%d says hello!\n", n);
+    return 0;
+}
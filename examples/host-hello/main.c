@@ -0,0 +1,60 @@
+/*
+ * Bento-linker example
+ *
+ * Copyright (c) 2020, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "bb.h"
+
+// timing things
+uint64_t timer_getns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+}
+
+// used to debug box imports
+int32_t sys_ping(int32_t a) {
+    return a + 3;
+}
+
+int main(void) {
+    printf("hi from the host!\n");
+    uint64_t start = timer_getns();
+
+    int32_t x1, x2;
+    printf("testing box ping\n");
+    x1 = box1_ping(0);
+    x2 = box2_ping(0);
+    printf("results: %d %d\n", x1, x2);
+
+    printf("testing box import ping\n");
+    x1 = box1_ping_import(0);
+    x2 = box2_ping_import(0);
+    printf("results: %d %d\n", x1, x2);
+
+    printf("testing box abort ping\n");
+    x1 = box1_ping_abort(0);
+    x2 = box2_ping_abort(0);
+    printf("results: %d %d\n", x1, x2);
+
+    printf("testing box fault ping\n");
+    x1 = box1_ping_fault(0);
+    x2 = box2_ping_fault(0);
+    printf("results: %d %d\n", x1, x2);
+
+    printf("testing box printf\n");
+    x1 = box1_hello();
+    x2 = box2_hello();
+    printf("return values: %d %d\n", x1, x2);
+
+    uint64_t ns = timer_getns() - start;
+    printf("done\n");
+    printf("sys: %u ns\n", (uint32_t)ns);
+    return 0;
+}
@@ -0,0 +1,1083 @@
+////// AUTOGENERATED //////
+#include <assert.h>
+#include <dlfcn.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+//// box imports ////
+
+int box1_filter(int32_t frame);
+
+int32_t box1_peek(int32_t frame);
+
+int32_t box2_checksum(int32_t frame);
+
+//// box hooks ////
+
+// Initialize box box1. Resets the box to its initial state if already
+// initialized.
+int __box_box1_init(void);
+
+// Mark the box box1 as needing to be reinitialized.
+int __box_box1_clobber(void);
+
+// Allocate size bytes on the box's data stack. May return NULL if a stack
+// overflow would occur.
+void *__box_box1_push(size_t size);
+
+// Deallocate size bytes on the box's data stack.
+void __box_box1_pop(size_t size);
+
+// Initialize box box2. Resets the box to its initial state if already
+// initialized.
+int __box_box2_init(void);
+
+// Mark the box box2 as needing to be reinitialized.
+int __box_box2_clobber(void);
+
+// Allocate size bytes on the box's data stack. May return NULL if a stack
+// overflow would occur.
+void *__box_box2_push(size_t size);
+
+// Deallocate size bytes on the box's data stack.
+void __box_box2_pop(size_t size);
+
+//// shared memory ////
+
+// Shared memory frames, split into 4 buffers of 4088 bytes. Each buffer is
+// owned by at most one box at a time.
+#define __BOX_SHARED_FRAMES_COUNT 4
+#define __BOX_SHARED_FRAMES_SIZE 4088
+#define __BOX_SHARED_FRAMES_FREE 0
+#define __BOX_SHARED_FRAMES_SYS 1
+#define __BOX_SHARED_FRAMES_BOX1 2
+#define __BOX_SHARED_FRAMES_BOX2 3
+
+// Allocate a free buffer in frames, returning a handle owned by the caller,
+// or a negative error code if no buffers are free.
+int __box_shared_frames_alloc(void);
+
+// Get the address of a buffer in frames. Returns NULL if the buffer is not
+// owned by the caller.
+void *__box_shared_frames_buffer(int handle);
+
+// Transfer ownership of a buffer in frames to another box, one of
+// __BOX_SHARED_FRAMES_<BOX>. The caller must own the buffer.
+int __box_shared_frames_give(int handle, int owner);
+
+// Release a buffer in frames. The caller must own the buffer.
+int __box_shared_frames_free(int handle);
+
+// Release all buffers in frames owned by a box, useful if the box aborts
+// while owning buffers. Returns the number of buffers released.
+int __box_shared_frames_reclaim(int owner);
+
+// May be called by well-behaved code to terminate the box if execution can
+// not continue. Notably used for asserts. Note that __box_abort may be
+// skipped if the box is killed because of an illegal operation. Must not
+// return.
+__attribute__((noreturn))
+void __box_abort(int err);
+
+// Provides a minimal implementation of stdout to the box. The exact behavior
+// depends on the superbox's implementation of __box_write. If none is
+// provided, __box_write links but does nothing.
+ssize_t __box_write(int32_t fd, const void *buffer, size_t size);
+
+// Provides a minimal implementation of stdout to the box. The exact behavior
+// depends on the superbox's implementation of __box_flush. If none is
+// provided, __box_flush links but does nothing.
+int __box_flush(int32_t fd);
+
+//// box error codes ////
+enum box_errors {
+    EOK              = 0,    // No error
+    EGENERAL         = 1,    // General error
+    ENOENT           = 2,    // No such file or directory
+    ESRCH            = 3,    // No such process
+    EINTR            = 4,    // Interrupted system call
+    EIO              = 5,    // I/O error
+    ENXIO            = 6,    // No such device or address
+    E2BIG            = 7,    // Argument list too long
+    ENOEXEC          = 8,    // Exec format error
+    EBADF            = 9,    // Bad file number
+    ECHILD           = 10,   // No child processes
+    EAGAIN           = 11,   // Try again
+    ENOMEM           = 12,   // Out of memory
+    EACCES           = 13,   // Permission denied
+    EFAULT           = 14,   // Bad address
+    EBUSY            = 16,   // Device or resource busy
+    EEXIST           = 17,   // File exists
+    EXDEV            = 18,   // Cross-device link
+    ENODEV           = 19,   // No such device
+    ENOTDIR          = 20,   // Not a directory
+    EISDIR           = 21,   // Is a directory
+    EINVAL           = 22,   // Invalid argument
+    ENFILE           = 23,   // File table overflow
+    EMFILE           = 24,   // Too many open files
+    ENOTTY           = 25,   // Not a typewriter
+    ETXTBSY          = 26,   // Text file busy
+    EFBIG            = 27,   // File too large
+    ENOSPC           = 28,   // No space left on device
+    ESPIPE           = 29,   // Illegal seek
+    EROFS            = 30,   // Read-only file system
+    EMLINK           = 31,   // Too many links
+    EPIPE            = 32,   // Broken pipe
+    EDOM             = 33,   // Math argument out of domain of func
+    ERANGE           = 34,   // Math result not representable
+    EDEADLK          = 35,   // Resource deadlock would occur
+    ENAMETOOLONG     = 36,   // File name too long
+    ENOLCK           = 37,   // No record locks available
+    ENOSYS           = 38,   // Function not implemented
+    ENOTEMPTY        = 39,   // Directory not empty
+    ELOOP            = 40,   // Too many symbolic links encountered
+    ENOMSG           = 42,   // No message of desired type
+    EIDRM            = 43,   // Identifier removed
+    ENOSTR           = 60,   // Device not a stream
+    ENODATA          = 61,   // No data available
+    ETIME            = 62,   // Timer expired
+    ENOSR            = 63,   // Out of streams resources
+    ENOLINK          = 67,   // Link has been severed
+    EPROTO           = 71,   // Protocol error
+    EMULTIHOP        = 72,   // Multihop attempted
+    EBADMSG          = 74,   // Not a data message
+    EOVERFLOW        = 75,   // Value too large for defined data type
+    EILSEQ           = 84,   // Illegal byte sequence
+    ENOTSOCK         = 88,   // Socket operation on non-socket
+    EDESTADDRREQ     = 89,   // Destination address required
+    EMSGSIZE         = 90,   // Message too long
+    EPROTOTYPE       = 91,   // Protocol wrong type for socket
+    ENOPROTOOPT      = 92,   // Protocol not available
+    EPROTONOSUPPORT  = 93,   // Protocol not supported
+    EOPNOTSUPP       = 95,   // Operation not supported on transport endpoint
+    EAFNOSUPPORT     = 97,   // Address family not supported by protocol
+    EADDRINUSE       = 98,   // Address already in use
+    EADDRNOTAVAIL    = 99,   // Cannot assign requested address
+    ENETDOWN         = 100,  // Network is down
+    ENETUNREACH      = 101,  // Network is unreachable
+    ENETRESET        = 102,  // Network dropped connection because of reset
+    ECONNABORTED     = 103,  // Software caused connection abort
+    ECONNRESET       = 104,  // Connection reset by peer
+    ENOBUFS          = 105,  // No buffer space available
+    EISCONN          = 106,  // Transport endpoint is already connected
+    ENOTCONN         = 107,  // Transport endpoint is not connected
+    ETIMEDOUT        = 110,  // Connection timed out
+    ECONNREFUSED     = 111,  // Connection refused
+    EHOSTUNREACH     = 113,  // No route to host
+    EALREADY         = 114,  // Operation already in progress
+    EINPROGRESS      = 115,  // Operation now in progress
+    ESTALE           = 116,  // Stale NFS file handle
+    EDQUOT           = 122,  // Quota exceeded
+    ECANCELED        = 125,  // Operation Canceled
+    EOWNERDEAD       = 130,  // Owner died
+    ENOTRECOVERABLE  = 131,  // State not recoverable
+};
+
+//// frames shared memory ////
+
+#define __BOX_SHARED_FRAMES_OWNERS ((uint8_t*)0x20038000)
+#define __BOX_SHARED_FRAMES_BUFFERS ((uint8_t*)0x20038008)
+#define __BOX_SHARED_FRAMES_SELF 1
+
+int __box_shared_frames_alloc(void) {
+    for (int i = 0; i < __BOX_SHARED_FRAMES_COUNT; i++) {
+        uint8_t free = __BOX_SHARED_FRAMES_FREE;
+        if (__atomic_compare_exchange_n(
+                &__BOX_SHARED_FRAMES_OWNERS[i], &free,
+                __BOX_SHARED_FRAMES_SELF, false,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return i;
+        }
+    }
+
+    return -ENOMEM;
+}
+
+void *__box_shared_frames_buffer(int handle) {
+    if (handle < 0 || handle >= __BOX_SHARED_FRAMES_COUNT ||
+            __atomic_load_n(&__BOX_SHARED_FRAMES_OWNERS[handle],
+                __ATOMIC_ACQUIRE) != __BOX_SHARED_FRAMES_SELF) {
+        return NULL;
+    }
+
+    return __BOX_SHARED_FRAMES_BUFFERS + handle*__BOX_SHARED_FRAMES_SIZE;
+}
+
+int __box_shared_frames_give(int handle, int owner) {
+    if (handle < 0 || handle >= __BOX_SHARED_FRAMES_COUNT) {
+        return -EBADF;
+    }
+    if (owner <= __BOX_SHARED_FRAMES_FREE || owner > 3) {
+        return -EINVAL;
+    }
+
+    uint8_t self = __BOX_SHARED_FRAMES_SELF;
+    if (!__atomic_compare_exchange_n(
+            &__BOX_SHARED_FRAMES_OWNERS[handle], &self,
+            owner, false,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return -EACCES;
+    }
+
+    return 0;
+}
+
+int __box_shared_frames_free(int handle) {
+    if (handle < 0 || handle >= __BOX_SHARED_FRAMES_COUNT) {
+        return -EBADF;
+    }
+
+    uint8_t self = __BOX_SHARED_FRAMES_SELF;
+    if (!__atomic_compare_exchange_n(
+            &__BOX_SHARED_FRAMES_OWNERS[handle], &self,
+            __BOX_SHARED_FRAMES_FREE, false,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return -EACCES;
+    }
+
+    return 0;
+}
+
+int __box_shared_frames_reclaim(int owner) {
+    int count = 0;
+    for (int i = 0; i < __BOX_SHARED_FRAMES_COUNT; i++) {
+        uint8_t owner_ = owner;
+        if (__atomic_compare_exchange_n(
+                &__BOX_SHARED_FRAMES_OWNERS[i], &owner_,
+                __BOX_SHARED_FRAMES_FREE, false,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            count += 1;
+        }
+    }
+
+    return count;
+}
+
+//// __box_abort glue ////
+
+__attribute__((used))
+__attribute__((noreturn))
+void __wrap_abort(void) {
+    __box_abort(-1);
+}
+
+__attribute__((used))
+void __wrap_exit(int code) {
+    __box_abort(code > 0 ? -code : code);
+}
+
+#if defined(__GNUC__)
+__attribute__((noreturn))
+void __assert_func(const char *file, int line,
+        const char *func, const char *expr) {
+    printf("%s:%d: assertion \"%s\" failed\n", file, line, expr);
+    __box_abort(-1);
+}
+
+__attribute__((noreturn))
+void _exit(int code) {
+    __box_abort(code > 0 ? -code : code);
+}
+#endif
+
+//// __box_write glue ////
+
+ssize_t __box_cbprintf(
+        ssize_t (*write)(void *ctx, const void *buf, size_t size), void *ctx,
+        const char *format, va_list args) {
+    const char *p = format;
+    ssize_t res = 0;
+    while (true) {
+        // first consume everything until a '%'
+        size_t skip = strcspn(p, "%");
+        if (skip > 0) {
+            ssize_t nres = write(ctx, p, skip);
+            if (nres < 0) {
+                return nres;
+            }
+            res += nres;
+        }
+
+        p += skip;
+
+        // hit end of string?
+        if (!*p) {
+            return res;
+        }
+
+        // format parser
+        bool zero_justify = false;
+        bool left_justify = false;
+        bool precision_mode = false;
+        size_t width = 0;
+        size_t precision = 0;
+
+        char mode = 'c';
+        uint32_t value = 0;
+        const char *str = NULL;
+        size_t size = 0;
+
+        for (;; p++) {
+            if (p[1] >= '0' && p[1] <= '9') {
+                // precision/width
+                if (precision_mode) {
+                    precision = precision*10 + (p[1]-'0');
+                } else if (p[1] > '0' || width > 0) {
+                    width = width*10 + (p[1]-'0');
+                } else {
+                    zero_justify = true;
+                }
+
+            } else if (p[1] == '*') {
+                // dynamic precision/width
+                if (precision_mode) {
+                    precision = va_arg(args, size_t);
+                } else {
+                    width = va_arg(args, size_t);
+                }
+
+            } else if (p[1] == '.') {
+                // switch mode
+                precision_mode = true;
+
+            } else if (p[1] == '-') {
+                // left-justify
+                left_justify = true;
+
+            } else if (p[1] == '%') {
+                // single '%'
+                mode = 'c';
+                value = '%';
+                size = 1;
+                break;
+
+            } else if (p[1] == 'c') {
+                // char
+                mode = 'c';
+                value = va_arg(args, int);
+                size = 1;
+                break;
+
+            } else if (p[1] == 's') {
+                // string
+                mode = 's';
+                str = va_arg(args, const char *);
+                // find size, don't allow overruns
+                size = 0;
+                while (str[size] && (precision == 0 || size < precision)) {
+                    size += 1;
+                }
+                break;
+
+            } else if (p[1] == 'd' || p[1] == 'i') {
+                // signed decimal number
+                mode = 'd';
+                int32_t d = va_arg(args, int32_t);
+                value = (uint32_t)d;
+                size = 0;
+                if (d < 0) {
+                    size += 1;
+                    d = -d;
+                }
+                for (uint32_t t = d; t > 0; t /= 10) {
+                    size += 1;
+                }
+                if (size == 0) {
+                    size += 1;
+                }
+                break;
+
+            } else if (p[1] == 'u') {
+                // unsigned decimal number
+                mode = 'u';
+                value = va_arg(args, uint32_t);
+                size = 0;
+                for (uint32_t t = value; t > 0; t /= 10) {
+                    size += 1;
+                }
+                if (size == 0) {
+                    size += 1;
+                }
+                break;
+
+            } else if (p[1] >= ' ' && p[1] <= '?') {
+                // unknown modifier? skip
+
+            } else {
+                // hex or unknown character, terminate
+
+                // make it prettier for pointers
+                if (!(p[1] == 'x' || p[1] == 'X')) {
+                    zero_justify = true;
+                    width = 2*sizeof(void*);
+                }
+
+                // hexadecimal number
+                mode = 'x';
+                value = va_arg(args, uint32_t);
+                size = 0;
+                for (uint32_t t = value; t > 0; t /= 16) {
+                    size += 1;
+                }
+                if (size == 0) {
+                    size += 1;
+                }
+                break;
+            }
+        }
+
+        // consume the format
+        p += 2;
+
+        // format printing
+        if (!left_justify) {
+            for (ssize_t i = 0; i < (ssize_t)width-(ssize_t)size; i++) {
+                char c = (zero_justify) ? '0' : ' ';
+                ssize_t nres = write(ctx, &c, 1);
+                if (nres < 0) {
+                    return nres;
+                }
+                res += nres;
+            }
+        }
+
+        if (mode == 'c') {
+            ssize_t nres = write(ctx, &value, 1);
+            if (nres < 0) {
+                return nres;
+            }
+            res += nres;
+        } else if (mode == 's') {
+            ssize_t nres = write(ctx, str, size);
+            if (nres < 0) {
+                return nres;
+            }
+            res += nres;
+        } else if (mode == 'x') {
+            for (ssize_t i = size-1; i >= 0; i--) {
+                uint32_t digit = (value >> (4*i)) & 0xf;
+
+                char c = ((digit >= 10) ? ('a'-10) : '0') + digit;
+                ssize_t nres = write(ctx, &c, 1);
+                if (nres < 0) {
+                    return nres;
+                }
+                res += nres;
+            }
+        } else if (mode == 'd' || mode == 'u') {
+            ssize_t i = size-1;
+
+            if (mode == 'd' && (int32_t)value < 0) {
+                ssize_t nres = write(ctx, "-", 1);
+                if (nres < 0) {
+                    return nres;
+                }
+                res += nres;
+
+                value = -value;
+                i -= 1;
+            }
+
+            for (; i >= 0; i--) {
+                uint32_t temp = value;
+                for (int j = 0; j < i; j++) {
+                    temp /= 10;
+                }
+                uint32_t digit = temp % 10;
+
+                char c = '0' + digit;
+                ssize_t nres = write(ctx, &c, 1);
+                if (nres < 0) {
+                    return nres;
+                }
+                res += nres;
+            }
+        }
+
+        if (left_justify) {
+            for (ssize_t i = 0; i < (ssize_t)width-(ssize_t)size; i++) {
+                char c = ' ';
+                ssize_t nres = write(ctx, &c, 1);
+                if (nres < 0) {
+                    return nres;
+                }
+                res += nres;
+            }
+        }
+    }
+}
+
+static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
+}
+
+__attribute__((used))
+ssize_t __wrap_vprintf(const char *format, va_list args) {
+    return __box_cbprintf(__box_vprintf_write, (void*)1, format, args);
+}
+
+__attribute__((used))
+ssize_t __wrap_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    ssize_t res = __wrap_vprintf(format, args);
+    va_end(args);
+    return res;
+}
+
+__attribute__((used))
+ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
+    int32_t fd = (f == stdout) ? 1 : 2;
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
+}
+
+__attribute__((used))
+ssize_t __wrap_fprintf(FILE *f, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    ssize_t res = __wrap_vfprintf(f, format, args);
+    va_end(args);
+    return res;
+}
+
+__attribute__((used))
+int __wrap_fflush(FILE *f) {
+    int32_t fd = (f == stdout) ? 1 : 2;
+    return __box_flush(fd);
+}
+
+#if defined(__GNUC__)
+int _write(int handle, const char *buffer, int size) {
+    return __box_write(handle, (const uint8_t*)buffer, size);
+}
+#endif
+
+//// host hooks ////
+
+ssize_t __box_write(int32_t fd, const void *buffer, size_t size) {
+    return write(fd, buffer, size);
+}
+
+int __box_flush(int32_t fd) {
+    return 0;
+}
+
+__attribute__((noreturn))
+void __box_abort(int err) {
+    _Exit(err < 0 ? -err : err);
+}
+
+//// host state ////
+
+#define __BOX_HOST_PAGE 4096
+
+struct __box_host_region {
+    uintptr_t addr;
+    size_t size;
+    uint32_t box;
+    uint32_t shared;
+    int prot;
+    bool isolate;
+};
+
+#define __BOX_HOST_REGIONS 5
+
+const struct __box_host_region __box_host_regions[__BOX_HOST_REGIONS] = {
+    {0x1003e000, 0x00002000, 1, 0x0, PROT_READ | PROT_EXEC, false},
+    {0x2003e000, 0x00002000, 1, 0x0, PROT_READ | PROT_WRITE, false},
+    {0x1003c000, 0x00002000, 2, 0x0, PROT_READ | PROT_EXEC, true},
+    {0x2003c000, 0x00002000, 2, 0x0, PROT_READ | PROT_WRITE, true},
+    {0x20038000, 0x00004000, 0, 0x6, PROT_READ | PROT_WRITE, true},
+};
+
+// current protection of each region, -1 if unmapped
+int __box_host_prots[__BOX_HOST_REGIONS] = {
+    -1,
+    -1,
+    -1,
+    -1,
+    -1,
+};
+
+__attribute__((noreturn)) void __box_box1_fault(int err);
+__attribute__((noreturn)) void __box_box2_fault(int err);
+void (*const __box_host_aborts[])(int err) = {
+    __box_box1_fault,
+    __box_box2_fault,
+};
+
+//// host implementation ////
+
+uint32_t __box_host_active = 0;
+
+static void __box_host_protect(uint32_t active) {
+    for (int i = 0; i < __BOX_HOST_REGIONS; i++) {
+        const struct __box_host_region *region = &__box_host_regions[i];
+        if (__box_host_prots[i] < 0) {
+            continue;
+        }
+
+        // isolated regions are only accessible to their box, the sys,
+        // and any boxes they are shared with
+        int prot = (active && region->isolate && region->box != active &&
+                !(region->shared & (1 << active)))
+            ? PROT_NONE
+            : region->prot;
+        // only reprotect regions that change
+        if (prot != __box_host_prots[i]) {
+            if (mprotect((void*)region->addr, region->size, prot)) {
+                __box_abort(-EFAULT);
+            }
+            __box_host_prots[i] = prot;
+        }
+    }
+}
+
+uint32_t __box_host_switch(uint32_t box) {
+    uint32_t prev = __box_host_active;
+    if (box != prev) {
+        __box_host_active = box;
+        __box_host_protect(box);
+    }
+    return prev;
+}
+
+int __box_host_map(uint32_t box) {
+    for (int i = 0; i < __BOX_HOST_REGIONS; i++) {
+        const struct __box_host_region *region = &__box_host_regions[i];
+        if (region->box != box || __box_host_prots[i] >= 0) {
+            continue;
+        }
+
+        // loadable memories are already mapped as a part of our
+        // executable, fill in any pages that are missing
+        for (uintptr_t page = region->addr;
+                page < region->addr + region->size;
+                page += __BOX_HOST_PAGE) {
+            void *p = mmap((void*)page, __BOX_HOST_PAGE,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+                    -1, 0);
+            if (p != MAP_FAILED && p != (void*)page) {
+                // kernel doesn't understand MAP_FIXED_NOREPLACE?
+                munmap(p, __BOX_HOST_PAGE);
+                return -ENOMEM;
+            }
+        }
+
+        if (mprotect((void*)region->addr, region->size, region->prot)) {
+            return -EFAULT;
+        }
+        __box_host_prots[i] = region->prot;
+    }
+
+    // make sure the new regions are protected correctly
+    __box_host_protect(__box_host_active);
+    return 0;
+}
+
+void __box_host_unmap(uint32_t box) {
+    // leave the pages mapped, but stop managing them, this lets
+    // roommates reclaim the memory
+    for (int i = 0; i < __BOX_HOST_REGIONS; i++) {
+        if (__box_host_regions[i].box == box) {
+            __box_host_prots[i] = -1;
+        }
+    }
+}
+
+void *__box_host_resolve(const char *name) {
+    return dlsym(RTLD_DEFAULT, name);
+}
+
+static void __box_host_fault(int sig, siginfo_t *info, void *context) {
+    uint32_t active = __box_host_active;
+    if (!active) {
+        // fault in the sys, let it crash
+        signal(sig, SIG_DFL);
+        return;
+    }
+
+    // kill the active box, this should not return
+    __box_host_switch(0);
+    __box_host_aborts[active-1](-EFAULT);
+}
+
+__attribute__((constructor))
+static void __box_host_init(void) {
+    struct sigaction action = {0};
+    action.sa_sigaction = __box_host_fault;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+
+    // map any shared memory owned by the sys
+    if (__box_host_map(0)) {
+        __box_abort(-ENOMEM);
+    }
+}
+
+//// box1 loading ////
+
+static int __box_box1_load(void) {
+    // default loader does nothing
+    return 0;
+}
+
+//// box1 state ////
+bool __box_box1_initialized = false;
+jmp_buf *__box_box1_jmpbuf = NULL;
+uint8_t *__box_box1_datasp = NULL;
+#define __box_box1_exportjumptable ((const uintptr_t*)0x1003e000)
+
+//// box1 exports ////
+
+int32_t __box_box1_postinit(const uint64_t *a0) {
+    uint32_t prev = __box_host_switch(1);
+    jmp_buf *pjmpbuf = __box_box1_jmpbuf;
+    jmp_buf jmpbuf;
+    __box_box1_jmpbuf = &jmpbuf;
+    int err = setjmp(jmpbuf);
+    if (err) {
+        __box_box1_jmpbuf = pjmpbuf;
+        __box_host_switch(prev);
+        return err;
+    }
+    int32_t r0 = ((int32_t (*)(const uint64_t *a0))
+            __box_box1_exportjumptable[1])(a0);
+    __box_box1_jmpbuf = pjmpbuf;
+    __box_host_switch(prev);
+    return r0;
+}
+
+int box1_filter(int32_t frame) {
+    if (!__box_box1_initialized) {
+        int err = __box_box1_init();
+        if (err) {
+            return err;
+        }
+    }
+
+    uint32_t prev = __box_host_switch(1);
+    jmp_buf *pjmpbuf = __box_box1_jmpbuf;
+    jmp_buf jmpbuf;
+    __box_box1_jmpbuf = &jmpbuf;
+    int err = setjmp(jmpbuf);
+    if (err) {
+        __box_box1_jmpbuf = pjmpbuf;
+        __box_host_switch(prev);
+        return err;
+    }
+    int r0 = ((int (*)(int32_t frame))
+            __box_box1_exportjumptable[2])(frame);
+    __box_box1_jmpbuf = pjmpbuf;
+    __box_host_switch(prev);
+    return r0;
+}
+
+int32_t box1_peek(int32_t frame) {
+    if (!__box_box1_initialized) {
+        int err = __box_box1_init();
+        if (err) {
+            return err;
+        }
+    }
+
+    uint32_t prev = __box_host_switch(1);
+    jmp_buf *pjmpbuf = __box_box1_jmpbuf;
+    jmp_buf jmpbuf;
+    __box_box1_jmpbuf = &jmpbuf;
+    int err = setjmp(jmpbuf);
+    if (err) {
+        __box_box1_jmpbuf = pjmpbuf;
+        __box_host_switch(prev);
+        return err;
+    }
+    int32_t r0 = ((int32_t (*)(int32_t frame))
+            __box_box1_exportjumptable[3])(frame);
+    __box_box1_jmpbuf = pjmpbuf;
+    __box_host_switch(prev);
+    return r0;
+}
+
+//// box1 imports ////
+
+__attribute__((noreturn))
+void __box_box1_abort(int err) {
+    __box_box1_initialized = false;
+    if (__box_box1_jmpbuf) {
+        longjmp(*__box_box1_jmpbuf, err);
+    } else {
+        __box_abort(err);
+    }
+}
+
+// redirect __box_box1_write -> __box_write
+#define __box_box1_write __box_write
+
+// redirect __box_box1_flush -> __box_flush
+#define __box_box1_flush __box_flush
+
+__attribute__((noreturn))
+void __box_box1_fault(int err) {
+    __box_box1_abort(err);
+}
+
+__attribute__((noreturn))
+void __box_box1_export___box_box1_abort(int a0) {
+    uint32_t prev = __box_host_switch(0);
+    (void)prev;
+    __box_box1_abort(a0);
+}
+
+ssize_t __box_box1_export___box_box1_write(int32_t a0, const void *a1, size_t a2) {
+    uint32_t prev = __box_host_switch(0);
+    ssize_t r0 = __box_box1_write(a0, a1, a2);
+    __box_host_switch(prev);
+    return r0;
+}
+
+int __box_box1_export___box_box1_flush(int32_t a0) {
+    uint32_t prev = __box_host_switch(0);
+    int r0 = __box_box1_flush(a0);
+    __box_host_switch(prev);
+    return r0;
+}
+
+const uintptr_t __box_box1_importjumptable[] = {
+    (uintptr_t)__box_host_resolve,
+    (uintptr_t)__box_box1_export___box_box1_abort,
+    (uintptr_t)__box_box1_export___box_box1_write,
+    (uintptr_t)__box_box1_export___box_box1_flush,
+};
+
+//// box1 init ////
+
+int __box_box1_init(void) {
+    int err;
+    if (__box_box1_initialized) {
+        return 0;
+    }
+
+    // map the box's memory
+    err = __box_host_map(1);
+    if (err) {
+        return err;
+    }
+
+    // load the box if unloaded
+    err = __box_box1_load();
+    if (err) {
+        return err;
+    }
+
+    // prepare data stack
+    __box_box1_datasp = (void*)__box_box1_exportjumptable[0];
+
+    // call box's init
+    err = __box_box1_postinit(__box_box1_importjumptable);
+    if (err) {
+        return err;
+    }
+
+    __box_box1_initialized = true;
+    return 0;
+}
+
+int __box_box1_clobber(void) {
+    __box_box1_initialized = false;
+    __box_host_unmap(1);
+    return 0;
+}
+
+void *__box_box1_push(size_t size) {
+    size = ((size+7)/8)*8;
+    if (__box_box1_datasp - size < (uint8_t*)0x2003e000) {
+        return NULL;
+    }
+
+    __box_box1_datasp -= size;
+    return __box_box1_datasp;
+}
+
+void __box_box1_pop(size_t size) {
+    size = ((size+7)/8)*8;
+    assert(__box_box1_datasp + size <= (uint8_t*)0x20040000);
+    __box_box1_datasp += size;
+}
+
+//// box2 loading ////
+
+static int __box_box2_load(void) {
+    // default loader does nothing
+    return 0;
+}
+
+//// box2 state ////
+bool __box_box2_initialized = false;
+jmp_buf *__box_box2_jmpbuf = NULL;
+uint8_t *__box_box2_datasp = NULL;
+#define __box_box2_exportjumptable ((const uintptr_t*)0x1003c000)
+
+//// box2 exports ////
+
+int32_t __box_box2_postinit(const uint64_t *a0) {
+    uint32_t prev = __box_host_switch(2);
+    jmp_buf *pjmpbuf = __box_box2_jmpbuf;
+    jmp_buf jmpbuf;
+    __box_box2_jmpbuf = &jmpbuf;
+    int err = setjmp(jmpbuf);
+    if (err) {
+        __box_box2_jmpbuf = pjmpbuf;
+        __box_host_switch(prev);
+        return err;
+    }
+    int32_t r0 = ((int32_t (*)(const uint64_t *a0))
+            __box_box2_exportjumptable[1])(a0);
+    __box_box2_jmpbuf = pjmpbuf;
+    __box_host_switch(prev);
+    return r0;
+}
+
+int32_t box2_checksum(int32_t frame) {
+    if (!__box_box2_initialized) {
+        int err = __box_box2_init();
+        if (err) {
+            return err;
+        }
+    }
+
+    uint32_t prev = __box_host_switch(2);
+    jmp_buf *pjmpbuf = __box_box2_jmpbuf;
+    jmp_buf jmpbuf;
+    __box_box2_jmpbuf = &jmpbuf;
+    int err = setjmp(jmpbuf);
+    if (err) {
+        __box_box2_jmpbuf = pjmpbuf;
+        __box_host_switch(prev);
+        return err;
+    }
+    int32_t r0 = ((int32_t (*)(int32_t frame))
+            __box_box2_exportjumptable[2])(frame);
+    __box_box2_jmpbuf = pjmpbuf;
+    __box_host_switch(prev);
+    return r0;
+}
+
+//// box2 imports ////
+
+__attribute__((noreturn))
+void __box_box2_abort(int err) {
+    __box_box2_initialized = false;
+    if (__box_box2_jmpbuf) {
+        longjmp(*__box_box2_jmpbuf, err);
+    } else {
+        __box_abort(err);
+    }
+}
+
+// redirect __box_box2_write -> __box_write
+#define __box_box2_write __box_write
+
+// redirect __box_box2_flush -> __box_flush
+#define __box_box2_flush __box_flush
+
+__attribute__((noreturn))
+void __box_box2_fault(int err) {
+    __box_box2_abort(err);
+}
+
+__attribute__((noreturn))
+void __box_box2_export___box_box2_abort(int a0) {
+    uint32_t prev = __box_host_switch(0);
+    (void)prev;
+    __box_box2_abort(a0);
+}
+
+ssize_t __box_box2_export___box_box2_write(int32_t a0, const void *a1, size_t a2) {
+    uint32_t prev = __box_host_switch(0);
+    ssize_t r0 = __box_box2_write(a0, a1, a2);
+    __box_host_switch(prev);
+    return r0;
+}
+
+int __box_box2_export___box_box2_flush(int32_t a0) {
+    uint32_t prev = __box_host_switch(0);
+    int r0 = __box_box2_flush(a0);
+    __box_host_switch(prev);
+    return r0;
+}
+
+const uintptr_t __box_box2_importjumptable[] = {
+    (uintptr_t)__box_host_resolve,
+    (uintptr_t)__box_box2_export___box_box2_abort,
+    (uintptr_t)__box_box2_export___box_box2_write,
+    (uintptr_t)__box_box2_export___box_box2_flush,
+};
+
+//// box2 init ////
+
+int __box_box2_init(void) {
+    int err;
+    if (__box_box2_initialized) {
+        return 0;
+    }
+
+    // map the box's memory
+    err = __box_host_map(2);
+    if (err) {
+        return err;
+    }
+
+    // load the box if unloaded
+    err = __box_box2_load();
+    if (err) {
+        return err;
+    }
+
+    // prepare data stack
+    __box_box2_datasp = (void*)__box_box2_exportjumptable[0];
+
+    // call box's init
+    err = __box_box2_postinit(__box_box2_importjumptable);
+    if (err) {
+        return err;
+    }
+
+    __box_box2_initialized = true;
+    return 0;
+}
+
+int __box_box2_clobber(void) {
+    __box_box2_initialized = false;
+    __box_host_unmap(2);
+    return 0;
+}
+
+void *__box_box2_push(size_t size) {
+    size = ((size+7)/8)*8;
+    if (__box_box2_datasp - size < (uint8_t*)0x2003c000) {
+        return NULL;
+    }
+
+    __box_box2_datasp -= size;
+    return __box_box2_datasp;
+}
+
+void __box_box2_pop(size_t size) {
+    size = ((size+7)/8)*8;
+    assert(__box_box2_datasp + size <= (uint8_t*)0x2003e000);
+    __box_box2_datasp += size;
+}
+
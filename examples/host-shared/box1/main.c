@@ -0,0 +1,32 @@
+/*
+ * Bento-linker example
+ *
+ * Copyright (c) 2020, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "bb.h"
+#include <stdio.h>
+
+int box1_filter(int32_t frame) {
+    uint8_t *buffer = __box_shared_frames_buffer(frame);
+    if (!buffer) {
+        return -EACCES;
+    }
+
+    // simple low-pass filter, in place
+    uint8_t prev = 0;
+    for (int i = 0; i < __BOX_SHARED_FRAMES_SIZE; i++) {
+        uint8_t x = buffer[i];
+        buffer[i] = (prev + x) / 2;
+        prev = x;
+    }
+
+    // pass on to box2
+    return __box_shared_frames_give(frame, __BOX_SHARED_FRAMES_BOX2);
+}
+
+int32_t box1_peek(int32_t frame) {
+    // only succeeds if we own the frame
+    return __box_shared_frames_buffer(frame) ? 0 : -EACCES;
+}
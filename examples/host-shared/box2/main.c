@@ -0,0 +1,29 @@
+/*
+ * Bento-linker example
+ *
+ * Copyright (c) 2020, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "bb.h"
+#include <stdio.h>
+
+int32_t box2_checksum(int32_t frame) {
+    const uint8_t *buffer = __box_shared_frames_buffer(frame);
+    if (!buffer) {
+        return -EACCES;
+    }
+
+    int32_t sum = 0;
+    for (int i = 0; i < __BOX_SHARED_FRAMES_SIZE; i++) {
+        sum += buffer[i];
+    }
+
+    // done with the frame
+    int err = __box_shared_frames_free(frame);
+    if (err) {
+        return err;
+    }
+
+    return sum;
+}
@@ -0,0 +1,49 @@
+/*
+ * Bento-linker example
+ *
+ * Copyright (c) 2020, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "bb.h"
+
+int main(void) {
+    printf("hi from the host!\n");
+
+    // pass frames through the pipeline sys -> box1 -> box2, box1
+    // filters the frame in place and hands it off to box2, which
+    // checksums it and releases it
+    for (int i = 0; i < 8; i++) {
+        int frame = __box_shared_frames_alloc();
+        assert(frame >= 0);
+        uint8_t *buffer = __box_shared_frames_buffer(frame);
+        for (int j = 0; j < __BOX_SHARED_FRAMES_SIZE; j++) {
+            buffer[j] = i + j;
+        }
+
+        int err = __box_shared_frames_give(frame, __BOX_SHARED_FRAMES_BOX1);
+        assert(!err);
+        // we no longer own the frame
+        assert(!__box_shared_frames_buffer(frame));
+
+        err = box1_filter(frame);
+        assert(!err);
+        int32_t sum = box2_checksum(frame);
+        printf("frame %d checksum: %d\n", frame, sum);
+    }
+
+    printf("testing frame ownership\n");
+    int frame = __box_shared_frames_alloc();
+    int32_t x1 = box1_peek(frame);
+    int err = __box_shared_frames_give(frame, __BOX_SHARED_FRAMES_BOX1);
+    assert(!err);
+    int32_t x2 = box1_peek(frame);
+    int32_t x3 = __box_shared_frames_reclaim(__BOX_SHARED_FRAMES_BOX1);
+    printf("results: %d %d %d\n", x1, x2, x3);
+
+    printf("done\n");
+    return 0;
+}
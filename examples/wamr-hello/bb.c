@@ -1,5 +1,6 @@
 ////// AUTOGENERATED //////
 #include "assert.h"
+#include "string.h"
 #include "wasm_export.h"
 #include <stdarg.h>
 #include <stdbool.h>
@@ -268,6 +269,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -314,11 +316,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -402,7 +403,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -462,7 +463,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -482,7 +483,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -885,6 +887,8 @@ wasm_module_t __box_box1_module;
 wasm_module_inst_t __box_box1_module_inst;
 wasm_exec_env_t __box_box1_exec_env;
 int __box_box1_err;
+// export handles, resolved once during init
+wasm_function_inst_t __box_box1_functions[4];
 
 // default __box_abort implementation
 void __box_box1_import___box_box1_abort(
@@ -952,15 +956,7 @@ int box1_hello(void) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box1_module_inst,
-        "box1_hello",
-        "()i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box1_functions[0];
     __box_box1_err = 0;
 
     __attribute__((aligned(4)))
@@ -991,15 +987,7 @@ int32_t box1_ping(int32_t a0) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box1_module_inst,
-        "box1_ping",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box1_functions[1];
     __box_box1_err = 0;
 
     __attribute__((aligned(4)))
@@ -1031,15 +1019,7 @@ int32_t box1_ping_abort(int32_t a0) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box1_module_inst,
-        "box1_ping_abort",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box1_functions[2];
     __box_box1_err = 0;
 
     __attribute__((aligned(4)))
@@ -1071,15 +1051,7 @@ int32_t box1_ping_import(int32_t a0) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box1_module_inst,
-        "box1_ping_import",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box1_functions[3];
     __box_box1_err = 0;
 
     __attribute__((aligned(4)))
@@ -1165,6 +1137,36 @@ int __box_box1_init(void) {
         __box_box1_exec_env,
         &__box_box1_err);
 
+    // resolve exports
+    __box_box1_functions[0] = wasm_runtime_lookup_function(
+        __box_box1_module_inst,
+        "box1_hello",
+        "()i");
+    if (!__box_box1_functions[0]) {
+        return -ENOEXEC;
+    }
+    __box_box1_functions[1] = wasm_runtime_lookup_function(
+        __box_box1_module_inst,
+        "box1_ping",
+        "(i)i");
+    if (!__box_box1_functions[1]) {
+        return -ENOEXEC;
+    }
+    __box_box1_functions[2] = wasm_runtime_lookup_function(
+        __box_box1_module_inst,
+        "box1_ping_abort",
+        "(i)i");
+    if (!__box_box1_functions[2]) {
+        return -ENOEXEC;
+    }
+    __box_box1_functions[3] = wasm_runtime_lookup_function(
+        __box_box1_module_inst,
+        "box1_ping_import",
+        "(i)i");
+    if (!__box_box1_functions[3]) {
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_box1_datasp = 4;
@@ -1178,6 +1180,8 @@ int __box_box1_clobber(void) {
         wasm_runtime_destroy_exec_env(__box_box1_exec_env);
         wasm_runtime_deinstantiate(__box_box1_module_inst);
         wasm_runtime_unload(__box_box1_module);
+        memset(__box_box1_functions, 0,
+            sizeof(__box_box1_functions));
     }
     __box_box1_initialized = false;
     return 0;
@@ -1215,6 +1219,8 @@ wasm_module_t __box_box2_module;
 wasm_module_inst_t __box_box2_module_inst;
 wasm_exec_env_t __box_box2_exec_env;
 int __box_box2_err;
+// export handles, resolved once during init
+wasm_function_inst_t __box_box2_functions[4];
 
 // default __box_abort implementation
 void __box_box2_import___box_box2_abort(
@@ -1282,15 +1288,7 @@ int box2_hello(void) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box2_module_inst,
-        "box2_hello",
-        "()i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box2_functions[0];
     __box_box2_err = 0;
 
     __attribute__((aligned(4)))
@@ -1321,15 +1319,7 @@ int32_t box2_ping(int32_t a0) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box2_module_inst,
-        "box2_ping",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box2_functions[1];
     __box_box2_err = 0;
 
     __attribute__((aligned(4)))
@@ -1361,15 +1351,7 @@ int32_t box2_ping_abort(int32_t a0) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box2_module_inst,
-        "box2_ping_abort",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box2_functions[2];
     __box_box2_err = 0;
 
     __attribute__((aligned(4)))
@@ -1401,15 +1383,7 @@ int32_t box2_ping_import(int32_t a0) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_box2_module_inst,
-        "box2_ping_import",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_box2_functions[3];
     __box_box2_err = 0;
 
     __attribute__((aligned(4)))
@@ -1495,6 +1469,36 @@ int __box_box2_init(void) {
         __box_box2_exec_env,
         &__box_box2_err);
 
+    // resolve exports
+    __box_box2_functions[0] = wasm_runtime_lookup_function(
+        __box_box2_module_inst,
+        "box2_hello",
+        "()i");
+    if (!__box_box2_functions[0]) {
+        return -ENOEXEC;
+    }
+    __box_box2_functions[1] = wasm_runtime_lookup_function(
+        __box_box2_module_inst,
+        "box2_ping",
+        "(i)i");
+    if (!__box_box2_functions[1]) {
+        return -ENOEXEC;
+    }
+    __box_box2_functions[2] = wasm_runtime_lookup_function(
+        __box_box2_module_inst,
+        "box2_ping_abort",
+        "(i)i");
+    if (!__box_box2_functions[2]) {
+        return -ENOEXEC;
+    }
+    __box_box2_functions[3] = wasm_runtime_lookup_function(
+        __box_box2_module_inst,
+        "box2_ping_import",
+        "(i)i");
+    if (!__box_box2_functions[3]) {
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_box2_datasp = 4;
@@ -1508,6 +1512,8 @@ int __box_box2_clobber(void) {
         wasm_runtime_destroy_exec_env(__box_box2_exec_env);
         wasm_runtime_deinstantiate(__box_box2_module_inst);
         wasm_runtime_unload(__box_box2_module);
+        memset(__box_box2_functions, 0,
+            sizeof(__box_box2_functions));
     }
     __box_box2_initialized = false;
     return 0;
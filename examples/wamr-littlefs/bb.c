@@ -1,5 +1,6 @@
 ////// AUTOGENERATED //////
 #include "assert.h"
+#include "string.h"
 #include "wasm_export.h"
 #include <stdarg.h>
 #include <stdbool.h>
@@ -266,6 +267,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -312,11 +314,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -400,7 +401,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -460,7 +461,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -480,7 +481,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -883,6 +885,8 @@ wasm_module_t __box_lfsbox_module;
 wasm_module_inst_t __box_lfsbox_module_inst;
 wasm_exec_env_t __box_lfsbox_exec_env;
 int __box_lfsbox_err;
+// export handles, resolved once during init
+wasm_function_inst_t __box_lfsbox_functions[9];
 
 // default __box_abort implementation
 void __box_lfsbox_import___box_lfsbox_abort(
@@ -1000,15 +1004,7 @@ int lfsbox_file_close(int32_t fd) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_file_close",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[0];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1040,15 +1036,7 @@ int32_t lfsbox_file_open(const char *path, uint32_t flags) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_file_open",
-        "(*i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[1];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1083,15 +1071,7 @@ ssize_t lfsbox_file_read(int32_t fd, void *buffer, size_t size) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_file_read",
-        "(i*i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[2];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1127,15 +1107,7 @@ int32_t lfsbox_file_seek(int32_t fd, int32_t off, uint32_t whence) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_file_seek",
-        "(iii)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[3];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1169,15 +1141,7 @@ ssize_t lfsbox_file_write(int32_t fd, const void *buffer, size_t size) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_file_write",
-        "(i*i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[4];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1213,15 +1177,7 @@ int lfsbox_format(void) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_format",
-        "()i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[5];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1252,15 +1208,7 @@ int lfsbox_mount(void) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_mount",
-        "()i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[6];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1291,15 +1239,7 @@ int lfsbox_rename(const char *oldpath, const char *newpath) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_rename",
-        "(**)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[7];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1336,15 +1276,7 @@ int lfsbox_unmount(void) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_lfsbox_module_inst,
-        "lfsbox_unmount",
-        "()i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_lfsbox_functions[8];
     __box_lfsbox_err = 0;
 
     __attribute__((aligned(4)))
@@ -1429,6 +1361,71 @@ int __box_lfsbox_init(void) {
         __box_lfsbox_exec_env,
         &__box_lfsbox_err);
 
+    // resolve exports
+    __box_lfsbox_functions[0] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_file_close",
+        "(i)i");
+    if (!__box_lfsbox_functions[0]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[1] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_file_open",
+        "(*i)i");
+    if (!__box_lfsbox_functions[1]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[2] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_file_read",
+        "(i*i)i");
+    if (!__box_lfsbox_functions[2]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[3] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_file_seek",
+        "(iii)i");
+    if (!__box_lfsbox_functions[3]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[4] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_file_write",
+        "(i*i)i");
+    if (!__box_lfsbox_functions[4]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[5] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_format",
+        "()i");
+    if (!__box_lfsbox_functions[5]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[6] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_mount",
+        "()i");
+    if (!__box_lfsbox_functions[6]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[7] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_rename",
+        "(**)i");
+    if (!__box_lfsbox_functions[7]) {
+        return -ENOEXEC;
+    }
+    __box_lfsbox_functions[8] = wasm_runtime_lookup_function(
+        __box_lfsbox_module_inst,
+        "lfsbox_unmount",
+        "()i");
+    if (!__box_lfsbox_functions[8]) {
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_lfsbox_datasp = 4;
@@ -1442,6 +1439,8 @@ int __box_lfsbox_clobber(void) {
         wasm_runtime_destroy_exec_env(__box_lfsbox_exec_env);
         wasm_runtime_deinstantiate(__box_lfsbox_module_inst);
         wasm_runtime_unload(__box_lfsbox_module);
+        memset(__box_lfsbox_functions, 0,
+            sizeof(__box_lfsbox_functions));
     }
     __box_lfsbox_initialized = false;
     return 0;
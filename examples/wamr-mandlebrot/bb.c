@@ -1,5 +1,6 @@
 ////// AUTOGENERATED //////
 #include "assert.h"
+#include "string.h"
 #include "wasm_export.h"
 #include <stdarg.h>
 #include <stdbool.h>
@@ -238,6 +239,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -284,11 +286,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -372,7 +373,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -432,7 +433,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -452,7 +453,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -855,6 +857,8 @@ wasm_module_t __box_mandlebrot_module;
 wasm_module_inst_t __box_mandlebrot_module_inst;
 wasm_exec_env_t __box_mandlebrot_exec_env;
 int __box_mandlebrot_err;
+// export handles, resolved once during init
+wasm_function_inst_t __box_mandlebrot_functions[1];
 
 // default __box_abort implementation
 void __box_mandlebrot_import___box_mandlebrot_abort(
@@ -912,15 +916,7 @@ int mandlebrot(size_t width, size_t height, uint32_t iterations) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_mandlebrot_module_inst,
-        "mandlebrot",
-        "(iii)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_mandlebrot_functions[0];
     __box_mandlebrot_err = 0;
 
     __attribute__((aligned(4)))
@@ -1008,6 +1004,15 @@ int __box_mandlebrot_init(void) {
         __box_mandlebrot_exec_env,
         &__box_mandlebrot_err);
 
+    // resolve exports
+    __box_mandlebrot_functions[0] = wasm_runtime_lookup_function(
+        __box_mandlebrot_module_inst,
+        "mandlebrot",
+        "(iii)i");
+    if (!__box_mandlebrot_functions[0]) {
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_mandlebrot_datasp = 4;
@@ -1021,6 +1026,8 @@ int __box_mandlebrot_clobber(void) {
         wasm_runtime_destroy_exec_env(__box_mandlebrot_exec_env);
         wasm_runtime_deinstantiate(__box_mandlebrot_module_inst);
         wasm_runtime_unload(__box_mandlebrot_module);
+        memset(__box_mandlebrot_functions, 0,
+            sizeof(__box_mandlebrot_functions));
     }
     __box_mandlebrot_initialized = false;
     return 0;
@@ -1,5 +1,6 @@
 ////// AUTOGENERATED //////
 #include "assert.h"
+#include "string.h"
 #include "wasm_export.h"
 #include <stdarg.h>
 #include <stdbool.h>
@@ -276,6 +277,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -322,11 +324,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -410,7 +411,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -470,7 +471,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -490,7 +491,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -893,6 +895,8 @@ wasm_module_t __box_mazebuilder_module;
 wasm_module_inst_t __box_mazebuilder_module_inst;
 wasm_exec_env_t __box_mazebuilder_exec_env;
 int __box_mazebuilder_err;
+// export handles, resolved once during init
+wasm_function_inst_t __box_mazebuilder_functions[5];
 
 // default __box_abort implementation
 void __box_mazebuilder_import___box_mazebuilder_abort(
@@ -1020,15 +1024,7 @@ int maze_erode(uint32_t iterations) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_mazebuilder_module_inst,
-        "maze_erode",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_mazebuilder_functions[0];
     __box_mazebuilder_err = 0;
 
     __attribute__((aligned(4)))
@@ -1060,15 +1056,7 @@ int maze_findend(size_t *x, size_t *y) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_mazebuilder_module_inst,
-        "maze_findend",
-        "(**)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_mazebuilder_functions[1];
     __box_mazebuilder_err = 0;
 
     __attribute__((aligned(4)))
@@ -1105,15 +1093,7 @@ int maze_findstart(size_t *x, size_t *y) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_mazebuilder_module_inst,
-        "maze_findstart",
-        "(**)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_mazebuilder_functions[2];
     __box_mazebuilder_err = 0;
 
     __attribute__((aligned(4)))
@@ -1150,15 +1130,7 @@ int maze_generate_prim(size_t startx, size_t starty) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_mazebuilder_module_inst,
-        "maze_generate_prim",
-        "(ii)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_mazebuilder_functions[3];
     __box_mazebuilder_err = 0;
 
     __attribute__((aligned(4)))
@@ -1191,15 +1163,7 @@ int maze_reduce(uint32_t iterations) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_mazebuilder_module_inst,
-        "maze_reduce",
-        "(i)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_mazebuilder_functions[4];
     __box_mazebuilder_err = 0;
 
     __attribute__((aligned(4)))
@@ -1292,6 +1256,43 @@ int __box_mazebuilder_init(void) {
         __box_mazebuilder_exec_env,
         &__box_mazebuilder_err);
 
+    // resolve exports
+    __box_mazebuilder_functions[0] = wasm_runtime_lookup_function(
+        __box_mazebuilder_module_inst,
+        "maze_erode",
+        "(i)i");
+    if (!__box_mazebuilder_functions[0]) {
+        return -ENOEXEC;
+    }
+    __box_mazebuilder_functions[1] = wasm_runtime_lookup_function(
+        __box_mazebuilder_module_inst,
+        "maze_findend",
+        "(**)i");
+    if (!__box_mazebuilder_functions[1]) {
+        return -ENOEXEC;
+    }
+    __box_mazebuilder_functions[2] = wasm_runtime_lookup_function(
+        __box_mazebuilder_module_inst,
+        "maze_findstart",
+        "(**)i");
+    if (!__box_mazebuilder_functions[2]) {
+        return -ENOEXEC;
+    }
+    __box_mazebuilder_functions[3] = wasm_runtime_lookup_function(
+        __box_mazebuilder_module_inst,
+        "maze_generate_prim",
+        "(ii)i");
+    if (!__box_mazebuilder_functions[3]) {
+        return -ENOEXEC;
+    }
+    __box_mazebuilder_functions[4] = wasm_runtime_lookup_function(
+        __box_mazebuilder_module_inst,
+        "maze_reduce",
+        "(i)i");
+    if (!__box_mazebuilder_functions[4]) {
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_mazebuilder_datasp = 4;
@@ -1305,6 +1306,8 @@ int __box_mazebuilder_clobber(void) {
         wasm_runtime_destroy_exec_env(__box_mazebuilder_exec_env);
         wasm_runtime_deinstantiate(__box_mazebuilder_module_inst);
         wasm_runtime_unload(__box_mazebuilder_module);
+        memset(__box_mazebuilder_functions, 0,
+            sizeof(__box_mazebuilder_functions));
     }
     __box_mazebuilder_initialized = false;
     return 0;
@@ -1342,6 +1345,8 @@ wasm_module_t __box_mazesolver_module;
 wasm_module_inst_t __box_mazesolver_module_inst;
 wasm_exec_env_t __box_mazesolver_exec_env;
 int __box_mazesolver_err;
+// export handles, resolved once during init
+wasm_function_inst_t __box_mazesolver_functions[1];
 
 // default __box_abort implementation
 void __box_mazesolver_import___box_mazesolver_abort(
@@ -1469,15 +1474,7 @@ int32_t maze_solve(size_t startx, size_t starty, size_t endx, size_t endy) {
         }
     }
 
-    wasm_function_inst_t f;
-    f = wasm_runtime_lookup_function(
-        __box_mazesolver_module_inst,
-        "maze_solve",
-        "(iiii)i");
-    if (!f) {
-        return -ENOEXEC;
-    }
-
+    wasm_function_inst_t f = __box_mazesolver_functions[0];
     __box_mazesolver_err = 0;
 
     __attribute__((aligned(4)))
@@ -1573,6 +1570,15 @@ int __box_mazesolver_init(void) {
         __box_mazesolver_exec_env,
         &__box_mazesolver_err);
 
+    // resolve exports
+    __box_mazesolver_functions[0] = wasm_runtime_lookup_function(
+        __box_mazesolver_module_inst,
+        "maze_solve",
+        "(iiii)i");
+    if (!__box_mazesolver_functions[0]) {
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_mazesolver_datasp = 4;
@@ -1586,6 +1592,8 @@ int __box_mazesolver_clobber(void) {
         wasm_runtime_destroy_exec_env(__box_mazesolver_exec_env);
         wasm_runtime_deinstantiate(__box_mazesolver_module_inst);
         wasm_runtime_unload(__box_mazesolver_module);
+        memset(__box_mazesolver_functions, 0,
+            sizeof(__box_mazesolver_functions));
     }
     __box_mazesolver_initialized = false;
     return 0;
@@ -322,6 +322,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -368,11 +369,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -456,7 +456,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -516,7 +516,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -536,7 +536,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -937,6 +938,8 @@ bool __box_box1_initialized = false;
 IM3Runtime __box_box1_runtime;
 IM3Module __box_box1_module;
 uint32_t __box_box1_datasp;
+// export handles, resolved once during init
+IM3Function __box_box1_functions[4];
 
 __attribute__((unused))
 static uint32_t __box_box1_fromptr(const void *ptr) {
@@ -1014,15 +1017,7 @@ int box1_hello(void) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box1_runtime,
-            "box1_hello");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 0) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box1_functions[0];
     uint64_t *stack = __box_box1_runtime->stack;
     m3StackCheckInit();
     res = (M3Result)Call(
@@ -1048,15 +1043,7 @@ int32_t box1_ping(int32_t a0) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box1_runtime,
-            "box1_ping");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box1_functions[1];
     uint64_t *stack = __box_box1_runtime->stack;
     *(int32_t*)&stack[0] = a0;
     m3StackCheckInit();
@@ -1083,15 +1070,7 @@ int32_t box1_ping_abort(int32_t a0) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box1_runtime,
-            "box1_ping_abort");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box1_functions[2];
     uint64_t *stack = __box_box1_runtime->stack;
     *(int32_t*)&stack[0] = a0;
     m3StackCheckInit();
@@ -1118,15 +1097,7 @@ int32_t box1_ping_import(int32_t a0) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box1_runtime,
-            "box1_ping_import");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box1_functions[3];
     uint64_t *stack = __box_box1_runtime->stack;
     *(int32_t*)&stack[0] = a0;
     m3StackCheckInit();
@@ -1229,6 +1200,48 @@ int __box_box1_init(void) {
         return __box_wasm3_toerr(res);
     }
 
+    // resolve exports
+    res = m3_FindFunction(
+            &__box_box1_functions[0],
+            __box_box1_runtime,
+            "box1_hello");
+    if (res ||
+            !__box_box1_functions[0]->compiled ||
+            __box_box1_functions[0]->funcType->numArgs != 0) {
+        m3_FreeRuntime(__box_box1_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_box1_functions[1],
+            __box_box1_runtime,
+            "box1_ping");
+    if (res ||
+            !__box_box1_functions[1]->compiled ||
+            __box_box1_functions[1]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_box1_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_box1_functions[2],
+            __box_box1_runtime,
+            "box1_ping_abort");
+    if (res ||
+            !__box_box1_functions[2]->compiled ||
+            __box_box1_functions[2]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_box1_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_box1_functions[3],
+            __box_box1_runtime,
+            "box1_ping_import");
+    if (res ||
+            !__box_box1_functions[3]->compiled ||
+            __box_box1_functions[3]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_box1_runtime);
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_box1_datasp = 4;
@@ -1240,6 +1253,8 @@ int __box_box1_init(void) {
 int __box_box1_clobber(void) {
     if (__box_box1_initialized) {
         m3_FreeRuntime(__box_box1_runtime);
+        memset(__box_box1_functions, 0,
+                sizeof(__box_box1_functions));
     }
     __box_box1_initialized = false;
     return 0;
@@ -1257,6 +1272,8 @@ bool __box_box2_initialized = false;
 IM3Runtime __box_box2_runtime;
 IM3Module __box_box2_module;
 uint32_t __box_box2_datasp;
+// export handles, resolved once during init
+IM3Function __box_box2_functions[4];
 
 __attribute__((unused))
 static uint32_t __box_box2_fromptr(const void *ptr) {
@@ -1334,15 +1351,7 @@ int box2_hello(void) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box2_runtime,
-            "box2_hello");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 0) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box2_functions[0];
     uint64_t *stack = __box_box2_runtime->stack;
     m3StackCheckInit();
     res = (M3Result)Call(
@@ -1368,15 +1377,7 @@ int32_t box2_ping(int32_t a0) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box2_runtime,
-            "box2_ping");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box2_functions[1];
     uint64_t *stack = __box_box2_runtime->stack;
     *(int32_t*)&stack[0] = a0;
     m3StackCheckInit();
@@ -1403,15 +1404,7 @@ int32_t box2_ping_abort(int32_t a0) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box2_runtime,
-            "box2_ping_abort");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box2_functions[2];
     uint64_t *stack = __box_box2_runtime->stack;
     *(int32_t*)&stack[0] = a0;
     m3StackCheckInit();
@@ -1438,15 +1431,7 @@ int32_t box2_ping_import(int32_t a0) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_box2_runtime,
-            "box2_ping_import");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_box2_functions[3];
     uint64_t *stack = __box_box2_runtime->stack;
     *(int32_t*)&stack[0] = a0;
     m3StackCheckInit();
@@ -1549,6 +1534,48 @@ int __box_box2_init(void) {
         return __box_wasm3_toerr(res);
     }
 
+    // resolve exports
+    res = m3_FindFunction(
+            &__box_box2_functions[0],
+            __box_box2_runtime,
+            "box2_hello");
+    if (res ||
+            !__box_box2_functions[0]->compiled ||
+            __box_box2_functions[0]->funcType->numArgs != 0) {
+        m3_FreeRuntime(__box_box2_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_box2_functions[1],
+            __box_box2_runtime,
+            "box2_ping");
+    if (res ||
+            !__box_box2_functions[1]->compiled ||
+            __box_box2_functions[1]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_box2_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_box2_functions[2],
+            __box_box2_runtime,
+            "box2_ping_abort");
+    if (res ||
+            !__box_box2_functions[2]->compiled ||
+            __box_box2_functions[2]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_box2_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_box2_functions[3],
+            __box_box2_runtime,
+            "box2_ping_import");
+    if (res ||
+            !__box_box2_functions[3]->compiled ||
+            __box_box2_functions[3]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_box2_runtime);
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_box2_datasp = 4;
@@ -1560,6 +1587,8 @@ int __box_box2_init(void) {
 int __box_box2_clobber(void) {
     if (__box_box2_initialized) {
         m3_FreeRuntime(__box_box2_runtime);
+        memset(__box_box2_functions, 0,
+                sizeof(__box_box2_functions));
     }
     __box_box2_initialized = false;
     return 0;
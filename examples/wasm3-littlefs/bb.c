@@ -320,6 +320,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -366,11 +367,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -454,7 +454,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -514,7 +514,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -534,7 +534,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -935,6 +936,8 @@ bool __box_lfsbox_initialized = false;
 IM3Runtime __box_lfsbox_runtime;
 IM3Module __box_lfsbox_module;
 uint32_t __box_lfsbox_datasp;
+// export handles, resolved once during init
+IM3Function __box_lfsbox_functions[9];
 
 __attribute__((unused))
 static uint32_t __box_lfsbox_fromptr(const void *ptr) {
@@ -1050,15 +1053,7 @@ int lfsbox_file_close(int32_t fd) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_file_close");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[0];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     *(int32_t*)&stack[0] = fd;
     m3StackCheckInit();
@@ -1085,15 +1080,7 @@ int32_t lfsbox_file_open(const char *path, uint32_t flags) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_file_open");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 2) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[1];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     *(uint32_t*)&stack[0] = __box_lfsbox_fromptr(path);
     *(uint32_t*)&stack[1] = flags;
@@ -1121,15 +1108,7 @@ ssize_t lfsbox_file_read(int32_t fd, void *buffer, size_t size) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_file_read");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 3) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[2];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     *(int32_t*)&stack[0] = fd;
     *(uint32_t*)&stack[1] = __box_lfsbox_fromptr(buffer);
@@ -1158,15 +1137,7 @@ int32_t lfsbox_file_seek(int32_t fd, int32_t off, uint32_t whence) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_file_seek");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 3) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[3];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     *(int32_t*)&stack[0] = fd;
     *(int32_t*)&stack[1] = off;
@@ -1195,15 +1166,7 @@ ssize_t lfsbox_file_write(int32_t fd, const void *buffer, size_t size) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_file_write");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 3) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[4];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     *(int32_t*)&stack[0] = fd;
     *(uint32_t*)&stack[1] = __box_lfsbox_fromptr(buffer);
@@ -1232,15 +1195,7 @@ int lfsbox_format(void) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_format");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 0) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[5];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     m3StackCheckInit();
     res = (M3Result)Call(
@@ -1266,15 +1221,7 @@ int lfsbox_mount(void) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_mount");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 0) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[6];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     m3StackCheckInit();
     res = (M3Result)Call(
@@ -1300,15 +1247,7 @@ int lfsbox_rename(const char *oldpath, const char *newpath) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_rename");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 2) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[7];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     *(uint32_t*)&stack[0] = __box_lfsbox_fromptr(oldpath);
     *(uint32_t*)&stack[1] = __box_lfsbox_fromptr(newpath);
@@ -1336,15 +1275,7 @@ int lfsbox_unmount(void) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_lfsbox_runtime,
-            "lfsbox_unmount");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 0) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_lfsbox_functions[8];
     uint64_t *stack = __box_lfsbox_runtime->stack;
     m3StackCheckInit();
     res = (M3Result)Call(
@@ -1491,6 +1422,98 @@ int __box_lfsbox_init(void) {
         return __box_wasm3_toerr(res);
     }
 
+    // resolve exports
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[0],
+            __box_lfsbox_runtime,
+            "lfsbox_file_close");
+    if (res ||
+            !__box_lfsbox_functions[0]->compiled ||
+            __box_lfsbox_functions[0]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[1],
+            __box_lfsbox_runtime,
+            "lfsbox_file_open");
+    if (res ||
+            !__box_lfsbox_functions[1]->compiled ||
+            __box_lfsbox_functions[1]->funcType->numArgs != 2) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[2],
+            __box_lfsbox_runtime,
+            "lfsbox_file_read");
+    if (res ||
+            !__box_lfsbox_functions[2]->compiled ||
+            __box_lfsbox_functions[2]->funcType->numArgs != 3) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[3],
+            __box_lfsbox_runtime,
+            "lfsbox_file_seek");
+    if (res ||
+            !__box_lfsbox_functions[3]->compiled ||
+            __box_lfsbox_functions[3]->funcType->numArgs != 3) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[4],
+            __box_lfsbox_runtime,
+            "lfsbox_file_write");
+    if (res ||
+            !__box_lfsbox_functions[4]->compiled ||
+            __box_lfsbox_functions[4]->funcType->numArgs != 3) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[5],
+            __box_lfsbox_runtime,
+            "lfsbox_format");
+    if (res ||
+            !__box_lfsbox_functions[5]->compiled ||
+            __box_lfsbox_functions[5]->funcType->numArgs != 0) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[6],
+            __box_lfsbox_runtime,
+            "lfsbox_mount");
+    if (res ||
+            !__box_lfsbox_functions[6]->compiled ||
+            __box_lfsbox_functions[6]->funcType->numArgs != 0) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[7],
+            __box_lfsbox_runtime,
+            "lfsbox_rename");
+    if (res ||
+            !__box_lfsbox_functions[7]->compiled ||
+            __box_lfsbox_functions[7]->funcType->numArgs != 2) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_lfsbox_functions[8],
+            __box_lfsbox_runtime,
+            "lfsbox_unmount");
+    if (res ||
+            !__box_lfsbox_functions[8]->compiled ||
+            __box_lfsbox_functions[8]->funcType->numArgs != 0) {
+        m3_FreeRuntime(__box_lfsbox_runtime);
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_lfsbox_datasp = 4;
@@ -1502,6 +1525,8 @@ int __box_lfsbox_init(void) {
 int __box_lfsbox_clobber(void) {
     if (__box_lfsbox_initialized) {
         m3_FreeRuntime(__box_lfsbox_runtime);
+        memset(__box_lfsbox_functions, 0,
+                sizeof(__box_lfsbox_functions));
     }
     __box_lfsbox_initialized = false;
     return 0;
@@ -292,6 +292,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -338,11 +339,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -426,7 +426,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -486,7 +486,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -506,7 +506,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -907,6 +908,8 @@ bool __box_mandlebrot_initialized = false;
 IM3Runtime __box_mandlebrot_runtime;
 IM3Module __box_mandlebrot_module;
 uint32_t __box_mandlebrot_datasp;
+// export handles, resolved once during init
+IM3Function __box_mandlebrot_functions[1];
 
 __attribute__((unused))
 static uint32_t __box_mandlebrot_fromptr(const void *ptr) {
@@ -977,15 +980,7 @@ int mandlebrot(size_t width, size_t height, uint32_t iterations) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_mandlebrot_runtime,
-            "mandlebrot");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 3) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_mandlebrot_functions[0];
     uint64_t *stack = __box_mandlebrot_runtime->stack;
     *(size_t*)&stack[0] = width;
     *(size_t*)&stack[1] = height;
@@ -1081,6 +1076,18 @@ int __box_mandlebrot_init(void) {
         return __box_wasm3_toerr(res);
     }
 
+    // resolve exports
+    res = m3_FindFunction(
+            &__box_mandlebrot_functions[0],
+            __box_mandlebrot_runtime,
+            "mandlebrot");
+    if (res ||
+            !__box_mandlebrot_functions[0]->compiled ||
+            __box_mandlebrot_functions[0]->funcType->numArgs != 3) {
+        m3_FreeRuntime(__box_mandlebrot_runtime);
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_mandlebrot_datasp = 4;
@@ -1092,6 +1099,8 @@ int __box_mandlebrot_init(void) {
 int __box_mandlebrot_clobber(void) {
     if (__box_mandlebrot_initialized) {
         m3_FreeRuntime(__box_mandlebrot_runtime);
+        memset(__box_mandlebrot_functions, 0,
+                sizeof(__box_mandlebrot_functions));
     }
     __box_mandlebrot_initialized = false;
     return 0;
@@ -330,6 +330,7 @@ ssize_t __box_cbprintf(
 
         char mode = 'c';
         uint32_t value = 0;
+        const char *str = NULL;
         size_t size = 0;
 
         for (;; p++) {
@@ -376,11 +377,10 @@ ssize_t __box_cbprintf(
             } else if (p[1] == 's') {
                 // string
                 mode = 's';
-                const char *s = va_arg(args, const char *);
-                value = (uint32_t)s;
+                str = va_arg(args, const char *);
                 // find size, don't allow overruns
                 size = 0;
-                while (s[size] && (precision == 0 || size < precision)) {
+                while (str[size] && (precision == 0 || size < precision)) {
                     size += 1;
                 }
                 break;
@@ -464,7 +464,7 @@ ssize_t __box_cbprintf(
             }
             res += nres;
         } else if (mode == 's') {
-            ssize_t nres = write(ctx, (const char*)(uintptr_t)value, size);
+            ssize_t nres = write(ctx, str, size);
             if (nres < 0) {
                 return nres;
             }
@@ -524,7 +524,7 @@ ssize_t __box_cbprintf(
 }
 
 static ssize_t __box_vprintf_write(void *ctx, const void *buf, size_t size) {
-    return __box_write((int32_t)ctx, buf, size);
+    return __box_write((int32_t)(intptr_t)ctx, buf, size);
 }
 
 __attribute__((used))
@@ -544,7 +544,8 @@ ssize_t __wrap_printf(const char *format, ...) {
 __attribute__((used))
 ssize_t __wrap_vfprintf(FILE *f, const char *format, va_list args) {
     int32_t fd = (f == stdout) ? 1 : 2;
-    return __box_cbprintf(__box_vprintf_write, (void*)fd, format, args);
+    return __box_cbprintf(__box_vprintf_write, (void*)(intptr_t)fd,
+            format, args);
 }
 
 __attribute__((used))
@@ -945,6 +946,8 @@ bool __box_mazebuilder_initialized = false;
 IM3Runtime __box_mazebuilder_runtime;
 IM3Module __box_mazebuilder_module;
 uint32_t __box_mazebuilder_datasp;
+// export handles, resolved once during init
+IM3Function __box_mazebuilder_functions[5];
 
 __attribute__((unused))
 static uint32_t __box_mazebuilder_fromptr(const void *ptr) {
@@ -1066,15 +1069,7 @@ int maze_erode(uint32_t iterations) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_mazebuilder_runtime,
-            "maze_erode");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_mazebuilder_functions[0];
     uint64_t *stack = __box_mazebuilder_runtime->stack;
     *(uint32_t*)&stack[0] = iterations;
     m3StackCheckInit();
@@ -1101,15 +1096,7 @@ int maze_findend(size_t *x, size_t *y) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_mazebuilder_runtime,
-            "maze_findend");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 2) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_mazebuilder_functions[1];
     uint64_t *stack = __box_mazebuilder_runtime->stack;
     *(uint32_t*)&stack[0] = __box_mazebuilder_fromptr(x);
     *(uint32_t*)&stack[1] = __box_mazebuilder_fromptr(y);
@@ -1137,15 +1124,7 @@ int maze_findstart(size_t *x, size_t *y) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_mazebuilder_runtime,
-            "maze_findstart");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 2) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_mazebuilder_functions[2];
     uint64_t *stack = __box_mazebuilder_runtime->stack;
     *(uint32_t*)&stack[0] = __box_mazebuilder_fromptr(x);
     *(uint32_t*)&stack[1] = __box_mazebuilder_fromptr(y);
@@ -1173,15 +1152,7 @@ int maze_generate_prim(size_t startx, size_t starty) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_mazebuilder_runtime,
-            "maze_generate_prim");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 2) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_mazebuilder_functions[3];
     uint64_t *stack = __box_mazebuilder_runtime->stack;
     *(size_t*)&stack[0] = startx;
     *(size_t*)&stack[1] = starty;
@@ -1209,15 +1180,7 @@ int maze_reduce(uint32_t iterations) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_mazebuilder_runtime,
-            "maze_reduce");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 1) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_mazebuilder_functions[4];
     uint64_t *stack = __box_mazebuilder_runtime->stack;
     *(uint32_t*)&stack[0] = iterations;
     m3StackCheckInit();
@@ -1381,6 +1344,58 @@ int __box_mazebuilder_init(void) {
         return __box_wasm3_toerr(res);
     }
 
+    // resolve exports
+    res = m3_FindFunction(
+            &__box_mazebuilder_functions[0],
+            __box_mazebuilder_runtime,
+            "maze_erode");
+    if (res ||
+            !__box_mazebuilder_functions[0]->compiled ||
+            __box_mazebuilder_functions[0]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_mazebuilder_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_mazebuilder_functions[1],
+            __box_mazebuilder_runtime,
+            "maze_findend");
+    if (res ||
+            !__box_mazebuilder_functions[1]->compiled ||
+            __box_mazebuilder_functions[1]->funcType->numArgs != 2) {
+        m3_FreeRuntime(__box_mazebuilder_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_mazebuilder_functions[2],
+            __box_mazebuilder_runtime,
+            "maze_findstart");
+    if (res ||
+            !__box_mazebuilder_functions[2]->compiled ||
+            __box_mazebuilder_functions[2]->funcType->numArgs != 2) {
+        m3_FreeRuntime(__box_mazebuilder_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_mazebuilder_functions[3],
+            __box_mazebuilder_runtime,
+            "maze_generate_prim");
+    if (res ||
+            !__box_mazebuilder_functions[3]->compiled ||
+            __box_mazebuilder_functions[3]->funcType->numArgs != 2) {
+        m3_FreeRuntime(__box_mazebuilder_runtime);
+        return -ENOEXEC;
+    }
+    res = m3_FindFunction(
+            &__box_mazebuilder_functions[4],
+            __box_mazebuilder_runtime,
+            "maze_reduce");
+    if (res ||
+            !__box_mazebuilder_functions[4]->compiled ||
+            __box_mazebuilder_functions[4]->funcType->numArgs != 1) {
+        m3_FreeRuntime(__box_mazebuilder_runtime);
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_mazebuilder_datasp = 4;
@@ -1392,6 +1407,8 @@ int __box_mazebuilder_init(void) {
 int __box_mazebuilder_clobber(void) {
     if (__box_mazebuilder_initialized) {
         m3_FreeRuntime(__box_mazebuilder_runtime);
+        memset(__box_mazebuilder_functions, 0,
+                sizeof(__box_mazebuilder_functions));
     }
     __box_mazebuilder_initialized = false;
     return 0;
@@ -1409,6 +1426,8 @@ bool __box_mazesolver_initialized = false;
 IM3Runtime __box_mazesolver_runtime;
 IM3Module __box_mazesolver_module;
 uint32_t __box_mazesolver_datasp;
+// export handles, resolved once during init
+IM3Function __box_mazesolver_functions[1];
 
 __attribute__((unused))
 static uint32_t __box_mazesolver_fromptr(const void *ptr) {
@@ -1530,15 +1549,7 @@ int32_t maze_solve(size_t startx, size_t starty, size_t endx, size_t endy) {
     }
 
     M3Result res;
-    IM3Function f;
-    res = m3_FindFunction(&f,
-            __box_mazesolver_runtime,
-            "maze_solve");
-    if (res || !f->compiled ||
-            f->funcType->numArgs != 4) {
-        return -ENOEXEC;
-    }
-
+    IM3Function f = __box_mazesolver_functions[0];
     uint64_t *stack = __box_mazesolver_runtime->stack;
     *(size_t*)&stack[0] = startx;
     *(size_t*)&stack[1] = starty;
@@ -1705,6 +1716,18 @@ int __box_mazesolver_init(void) {
         return __box_wasm3_toerr(res);
     }
 
+    // resolve exports
+    res = m3_FindFunction(
+            &__box_mazesolver_functions[0],
+            __box_mazesolver_runtime,
+            "maze_solve");
+    if (res ||
+            !__box_mazesolver_functions[0]->compiled ||
+            __box_mazesolver_functions[0]->funcType->numArgs != 4) {
+        m3_FreeRuntime(__box_mazesolver_runtime);
+        return -ENOEXEC;
+    }
+
     // setup data stack, note address 0 is NULL
     // so we can't start there!
     __box_mazesolver_datasp = 4;
@@ -1716,6 +1739,8 @@ int __box_mazesolver_init(void) {
 int __box_mazesolver_clobber(void) {
     if (__box_mazesolver_initialized) {
         m3_FreeRuntime(__box_mazesolver_runtime);
+        memset(__box_mazesolver_functions, 0,
+                sizeof(__box_mazesolver_functions));
     }
     __box_mazesolver_initialized = false;
     return 0;
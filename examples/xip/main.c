@@ -0,0 +1,102 @@
+/*
+ * Bento-linker example
+ *
+ * Copyright (c) 2020, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <nrfx_uarte.h>
+#include "bb.h"
+
+// uart hooks for nrfx
+nrfx_uarte_t uart = {
+    .p_reg = NRF_UARTE0,
+    .drv_inst_idx = NRFX_UARTE0_INST_IDX,
+};
+const nrfx_uarte_config_t uart_config = {
+    .pseltxd = 6,
+    .pselrxd = 8,
+    .pselcts = NRF_UARTE_PSEL_DISCONNECTED,
+    .pselrts = NRF_UARTE_PSEL_DISCONNECTED,
+    .p_context = NULL,
+    .baudrate = NRF_UARTE_BAUDRATE_115200,
+    .interrupt_priority = NRFX_UARTE_DEFAULT_CONFIG_IRQ_PRIORITY,
+    .hal_cfg = {
+        .hwfc = NRF_UARTE_HWFC_DISABLED,
+        .parity = NRF_UARTE_PARITY_EXCLUDED,
+        NRFX_UARTE_DEFAULT_EXTENDED_STOP_CONFIG
+        NRFX_UARTE_DEFAULT_EXTENDED_PARITYTYPE_CONFIG
+    }
+};
+
+// stdout hook
+ssize_t __box_write(int32_t handle, const void *p, size_t size) {
+    // stdout or stderr only
+    assert(handle == 1 || handle == 2);
+    const char *buffer = p;
+
+    int i = 0;
+    while (true) {
+        char *nl = memchr(&buffer[i], '\n', size-i);
+        int span = nl ? nl-&buffer[i] : size-i;
+        if ((uint32_t)buffer < 0x2000000) {
+            // special case for flash
+            for (int j = 0; j < span; j++) {
+                char c = buffer[i+j];
+                nrfx_err_t err = nrfx_uarte_tx(&uart, (uint8_t*)&c, 1);
+                assert(err == NRFX_SUCCESS);
+                (void)err;
+            }
+        } else { 
+            nrfx_err_t err = nrfx_uarte_tx(&uart, (uint8_t*)&buffer[i], span);
+            assert(err == NRFX_SUCCESS);
+            (void)err;
+        } 
+        i += span;
+
+        if (i >= size) {
+            return size;
+        }
+
+        char r[2] = "\r\n";
+        nrfx_err_t err = nrfx_uarte_tx(&uart, (uint8_t*)r, sizeof(r));
+        assert(err == NRFX_SUCCESS);
+        (void)err;
+        i += 1;
+    }
+}
+
+void main(void) {
+    nrfx_err_t err = nrfx_uarte_init(&uart, &uart_config, NULL);
+    assert(err == NRFX_SUCCESS);
+    (void)err;
+
+    printf("hi from nrf52840!\n");
+
+    // TODO
+    // The boxes execute in place from the external QSPI flash, which
+    // must be enabled, and so memory-mapped, before any box is run.
+    // The QSPI setup is not implemented, we are only able to show
+    // successful compilation.
+
+    printf("pinging box1\n");
+    int32_t x = box1_add2(1, 2);
+    printf("1 + 2 = %d\n", x);
+    printf("pinging box2\n");
+    x = box2_add2(1, 2);
+    printf("1 + 2 = %d\n", x);
+    printf("pinging box3\n");
+    x = box3_add2(1, 2);
+    printf("1 + 2 = %d\n", x);
+
+    printf("testing printf\n");
+    int x1 = box1_hello();
+    int x2 = box2_hello();
+    int x3 = box3_hello();
+    printf("return values: %d %d %d\n", x1, x2, x3);
+
+    printf("done\n");
+}
@@ -0,0 +1,94 @@
+//!
+//! GLZ encoder benchmarks
+//!
+//! Compresses the example text files and the box images in bento's
+//! examples, these are dominated by the encoder's match finder.
+//!
+//! Copyright (c) 2020, Arm Limited. All rights reserved.
+//! SPDX-License-Identifier: BSD-3-Clause
+//!
+
+use glz::bits::*;
+use glz::GLZ;
+
+use std::fs;
+use std::path::PathBuf;
+
+use criterion::criterion_group;
+use criterion::criterion_main;
+use criterion::BenchmarkId;
+use criterion::Criterion;
+use criterion::Throughput;
+
+fn inputs() -> Vec<(String, Vec<u8>)> {
+    let mut paths: Vec<PathBuf> = Vec::new();
+
+    // example text
+    for entry in fs::read_dir("examples").unwrap() {
+        let path = entry.unwrap().path();
+        if path.extension().map_or(false, |ext| ext == "txt") {
+            paths.push(path);
+        }
+    }
+
+    // box images, these are what bento actually compresses
+    for entry in fs::read_dir("../../examples").unwrap() {
+        let path = entry.unwrap().path().join("box1/box1.box.ram");
+        if path.is_file() {
+            paths.push(path);
+        }
+    }
+
+    paths.sort();
+    paths.into_iter()
+        .map(|path| {
+            let name = path.strip_prefix("../..").unwrap_or(&path)
+                .display().to_string();
+            (name, fs::read(&path).unwrap())
+        })
+        .collect()
+}
+
+fn encode(c: &mut Criterion) {
+    let glz = GLZ::with_config(GLZ::DEFAULT_K, GLZ::DEFAULT_L, GLZ::DEFAULT_M);
+    let mut group = c.benchmark_group("encode");
+    group.sample_size(10);
+    for (name, input) in &inputs() {
+        group.throughput(Throughput::Bytes(input.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(name), input,
+            |b, input| b.iter(|| glz.encode(input).unwrap()));
+    }
+    group.finish();
+}
+
+fn encode_optimal(c: &mut Criterion) {
+    let mut glz = GLZ::with_config(
+        GLZ::DEFAULT_K, GLZ::DEFAULT_L, GLZ::DEFAULT_M);
+    glz.set_optimal(true);
+    let mut group = c.benchmark_group("encode_optimal");
+    group.sample_size(10);
+    for (name, input) in &inputs() {
+        group.throughput(Throughput::Bytes(input.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(name), input,
+            |b, input| b.iter(|| glz.encode(input).unwrap()));
+    }
+    group.finish();
+}
+
+fn encode_all(c: &mut Criterion) {
+    // granular encoding shares history across slices, as used for
+    // seekable archives
+    let glz = GLZ::with_config(GLZ::DEFAULT_K, GLZ::DEFAULT_L, GLZ::DEFAULT_M);
+    let mut group = c.benchmark_group("encode_all");
+    group.sample_size(10);
+    for (name, input) in &inputs() {
+        let slices: Vec<&[u8]> = input.chunks(4096).collect();
+        group.throughput(Throughput::Bytes(input.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(name), &slices,
+            |b, slices| b.iter(|| glz.encode_all(slices).unwrap()));
+    }
+    group.finish();
+}
+
+criterion_group!(benches, encode, encode_optimal, encode_all);
+criterion_main!(benches);
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+#
+# Generate the decoders benchmarked by decoder_bench.c from the templates
+# in bento's glz loader, so the benchmark measures the code boxes
+# actually run. The templates are read with ast, so this doesn't need
+# bento's dependencies. Usage:
+#
+#   python3 bench_decoders.py <bit|word|fast> > decoder_bench_<mode>.c
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import argparse
+import ast
+import os
+import sys
+
+GLZ_PY = os.path.join(os.path.dirname(__file__),
+    '..', '..', '..', 'bento', 'loaders', 'glz.py')
+
+TEMPLATES = {
+    'bit':  'BOX_GLZ_DECODE',
+    'word': 'BOX_GLZ_DECODE_WORD',
+    'fast': 'BOX_GLZ_DECODE_FAST',
+}
+
+PROLOGUE = """\
+// Generated from %(template)s in bento/loaders/glz.py by
+// bench_decoders.py, do not edit
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+"""
+
+def template(path, name):
+    """
+    Find a string assigned to a name at the top-level of a module.
+    """
+    with open(path) as f:
+        module = ast.parse(f.read(), path)
+    for node in module.body:
+        if (isinstance(node, ast.Assign)
+                and any(isinstance(target, ast.Name) and target.id == name
+                    for target in node.targets)):
+            return ast.literal_eval(node.value)
+    assert False, "no %s in %s?" % (name, path)
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generate a GLZ decoder for decoder_bench.c from "
+            "bento's glz loader.")
+    parser.add_argument('mode', choices=sorted(TEMPLATES),
+        help="Which decoder to generate, this is the loader's "
+            "--decoder, or fast for blobs compressed with -m fast.")
+    parser.add_argument('--glz-py', default=GLZ_PY,
+        help="Path to bento's glz loader. Defaults to %(default)s.")
+    args = parser.parse_args()
+
+    # the templates are %-formatted, each decoder gets its own name
+    decode = template(args.glz_py, TEMPLATES[args.mode]) % {}
+    assert '__box_glz_decode(' in decode, (
+        "no __box_glz_decode in %s?" % TEMPLATES[args.mode])
+    decode = decode.replace('__box_glz_decode(',
+        'glz_decode_%s(' % args.mode)
+
+    sys.stdout.write(PROLOGUE % dict(template=TEMPLATES[args.mode]))
+    sys.stdout.write(decode)
+
+if __name__ == "__main__":
+    main()
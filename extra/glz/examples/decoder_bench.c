@@ -0,0 +1,199 @@
+/*
+ * Host-side throughput benchmark comparing the bit-serial GLZ decoder
+ * against the word-at-a-time decoder, which keeps a 32-bit bit buffer
+ * and counts the rice prefix with clz. Both decoders must produce
+ * byte-identical output. The decoders are generated from the templates
+ * in bento's glz loader, see bench_decoders.py, so this measures the
+ * code boxes actually run.
+ *
+ * Blobs compressed with glz -m fast are decoded with the fast mode
+ * decoder instead, select these with -m fast before the files. The
+ * compression ratio is printed alongside, so both modes can be compared.
+ *
+ * Copyright (c) 2020, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+
+typedef uint32_t glz_off_t;
+typedef uint32_t glz_size_t;
+
+// the decoders are generated from bento's glz loader by
+// bench_decoders.py, these decompress size bytes at off after skipping
+// skip bytes, we don't use a dictionary
+struct __box_glz_dict;
+
+int glz_decode_bit(uint8_t k, const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
+        glz_size_t skip, uint8_t *output, glz_size_t size);
+int glz_decode_word(uint8_t k, const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
+        glz_size_t skip, uint8_t *output, glz_size_t size);
+int glz_decode_fast(uint8_t k, const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
+        glz_size_t skip, uint8_t *output, glz_size_t size);
+
+// benchmark helpers
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+typedef int (*glz_decode_t)(uint8_t k, const struct __box_glz_dict *dict,
+        const uint8_t *blob, glz_size_t blob_size, glz_off_t off,
+        glz_size_t skip, uint8_t *output, glz_size_t size);
+
+static double bench(glz_decode_t decode, int iterations,
+        uint8_t k, const uint8_t *blob, glz_size_t blob_size,
+        glz_off_t off, uint8_t *output, glz_size_t size) {
+    double start = now();
+    for (int i = 0; i < iterations; i++) {
+        int err = decode(k, NULL, blob, blob_size, off, 0, output, size);
+        if (err) {
+            fprintf(stderr, "decode failure %d :(\n", err);
+            exit(2);
+        }
+    }
+    double elapsed = now() - start;
+    return ((double)size*iterations / (1024*1024)) / elapsed;
+}
+
+int main(int argc, char **argv) {
+    int iterations = 1000;
+    int i = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        char *end;
+        iterations = strtol(argv[2], &end, 0);
+        if (*end != '\0' || iterations <= 0) {
+            fprintf(stderr, "bad iterations \"%s\"?\n", argv[2]);
+            return 1;
+        }
+        i = 3;
+    }
+
+    if (i >= argc) {
+        fprintf(stderr, "usage: %s [-n <iterations>] "
+            "[[-m <mode>] <file>...]...\n", argv[0]);
+        return 1;
+    }
+
+    bool fast = false;
+    printf("%-40s %8s %8s %12s %12s %12s\n",
+        "file", "size", "ratio", "bit MiB/s", "word MiB/s", "fast MiB/s");
+    for (; i < argc; i++) {
+        // mode applies to the files that follow
+        if (strcmp(argv[i], "-m") == 0) {
+            if (i+1 >= argc || (strcmp(argv[i+1], "compact") != 0 &&
+                    strcmp(argv[i+1], "fast") != 0)) {
+                fprintf(stderr, "bad mode \"%s\"?\n",
+                    i+1 < argc ? argv[i+1] : "");
+                return 1;
+            }
+            fast = strcmp(argv[i+1], "fast") == 0;
+            i += 1;
+            continue;
+        }
+
+        // mmap file
+        int fd = open(argv[i], O_RDONLY, 0);
+        if (fd < 0) {
+            fprintf(stderr, "could not open file \"%s\"?\n", argv[i]);
+            return 1;
+        }
+
+        struct stat fdstat;
+        int err = fstat(fd, &fdstat);
+        if (err) {
+            fprintf(stderr, "file stat failed \"%s\"?\n", argv[i]);
+            return 1;
+        }
+        size_t blob_size = fdstat.st_size;
+        if (blob_size < 8) {
+            fprintf(stderr, "file too small \"%s\"?\n", argv[i]);
+            return 1;
+        }
+
+        const uint8_t *blob = mmap(NULL, blob_size,
+                PROT_READ, MAP_PRIVATE, fd, 0);
+        if (blob == MAP_FAILED) {
+            fprintf(stderr, "could not mmap file \"%s\"?\n", argv[i]);
+            return 1;
+        }
+
+        // decode metadata, see decoder.c
+        glz_off_t off = ((uint32_t)blob[0] << 0) |
+                ((uint32_t)blob[1] << 8) |
+                ((uint32_t)blob[2] << 16);
+        uint8_t k = 0xf & blob[3];
+        glz_size_t size = ((uint32_t)blob[4] << 0) |
+                ((uint32_t)blob[5] << 8) |
+                ((uint32_t)blob[6] << 16) |
+                ((uint32_t)blob[7] << 24);
+
+        if (fast) {
+            uint8_t *output = malloc(size);
+            if (!output) {
+                fprintf(stderr, "could not allocated output (%u bytes)\n",
+                    size);
+                return 3;
+            }
+
+            double mibs = bench(glz_decode_fast, iterations,
+                    k, blob+8, blob_size-8, off, output, size);
+            printf("%-40s %8u %8.2f %12s %12s %12.2f\n",
+                argv[i], size, (double)size/blob_size, "-", "-", mibs);
+
+            free(output);
+            munmap((void*)blob, blob_size);
+            close(fd);
+            continue;
+        }
+
+        uint8_t *output_bit = malloc(size);
+        uint8_t *output_word = malloc(size);
+        if (!output_bit || !output_word) {
+            fprintf(stderr, "could not allocated output (%u bytes)\n", size);
+            return 3;
+        }
+
+        // decoders must agree byte-for-byte
+        int err_bit = glz_decode_bit(k, NULL, blob+8, blob_size-8, off,
+                0, output_bit, size);
+        int err_word = glz_decode_word(k, NULL, blob+8, blob_size-8, off,
+                0, output_word, size);
+        if (err_bit != err_word ||
+                memcmp(output_bit, output_word, size) != 0) {
+            fprintf(stderr, "decoder mismatch \"%s\" :(\n", argv[i]);
+            return 2;
+        }
+
+        double bit = bench(glz_decode_bit, iterations,
+                k, blob+8, blob_size-8, off, output_bit, size);
+        double word = bench(glz_decode_word, iterations,
+                k, blob+8, blob_size-8, off, output_word, size);
+        printf("%-40s %8u %8.2f %12.2f %12.2f %12s\n",
+            argv[i], size, (double)size/blob_size, bit, word, "-");
+
+        free(output_bit);
+        free(output_word);
+        munmap((void*)blob, blob_size);
+        close(fd);
+    }
+
+    return 0;
+}
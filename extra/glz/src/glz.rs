@@ -6,10 +6,16 @@
 //!
 
 use std::collections::HashMap;
+use std::collections::HashSet;
+use std::iter;
+use std::cmp;
+use std::hash::BuildHasherDefault;
+use std::hash::Hasher;
 
 use crate::bits::*;
 use crate::errors::*;
 use crate::rice::GolombRice;
+use crate::leb128::LEB128;
 use crate::hist::Hist;
 use crate::hist::BijectEncoder;
 use std::cmp::Reverse;
@@ -63,6 +69,9 @@ pub struct GLZ {
     l: usize, // size of length field in references
     m: usize, // size of offset units
     rice: BijectEncoder<GolombRice, Hist>,
+    optimal: bool, // use optimal parsing when encoding
+    seek: Option<usize>, // checkpoint interval when encoding
+    fast: bool, // byte-aligned symbols, see encode1_fast
 }
 
 #[derive(Debug, Copy, Clone, PartialEq)]
@@ -71,12 +80,160 @@ enum GLZSym<U: Sym> {
     Ref{off: usize, size: usize},
 }
 
+#[derive(Debug, Copy, Clone, PartialEq)]
+enum FastSym {
+    Run(usize),
+    Ref{off: usize, size: usize, run: usize},
+}
+
+// Dictionary of patterns we can reference, these are prefixes of
+// previously emitted immediates. Patterns are keyed by a polynomial
+// rolling hash, which lets us extend a pattern by one symbol at a
+// time, forwards when inserting and backwards when searching, without
+// rehashing the whole pattern. Hits are compared against the pattern,
+// so a collision can only cost us a match, never correctness.
+struct History<'a, U: Sym> {
+    pows: Vec<u64>,
+    patterns: HashMap<u64, (&'a [U], usize), BuildHasherDefault<MixHasher>>,
+    runs: HashMap<usize, usize>, // literals left in the run, fast mode only
+}
+
+// our keys are already hashes, they just need their high bits mixed
+// into the low bits HashMap uses for buckets
+#[derive(Default)]
+struct MixHasher(u64);
+
+impl Hasher for MixHasher {
+    fn write(&mut self, _: &[u8]) {
+        unreachable!();
+    }
+
+    fn write_u64(&mut self, x: u64) {
+        self.0 = (x ^ (x >> 32)).wrapping_mul(0x9e3779b97f4a7c15);
+    }
+
+    fn finish(&self) -> u64 {
+        self.0 ^ (self.0 >> 29)
+    }
+}
+
+impl<'a, U: Sym> History<'a, U> {
+    const BASE: u64 = 0x100000001b3;
+
+    fn new() -> Self {
+        Self{
+            pows: vec![1],
+            patterns: HashMap::default(),
+            runs: HashMap::new(),
+        }
+    }
+
+    // offset symbols by one so leading zeros still change the hash
+    fn sym(x: U) -> u64 {
+        Into::<u32>::into(x) as u64 + 1
+    }
+
+    fn pow(&mut self, n: usize) -> u64 {
+        while self.pows.len() <= n {
+            let last = *self.pows.last().unwrap();
+            self.pows.push(last.wrapping_mul(Self::BASE));
+        }
+        self.pows[n]
+    }
+
+    fn hash(pattern: &[U]) -> u64 {
+        pattern.iter().fold(0, |h, &x|
+            h.wrapping_mul(Self::BASE).wrapping_add(Self::sym(x)))
+    }
+
+    fn get(&self, pattern: &[U]) -> Option<usize> {
+        self.patterns.get(&Self::hash(pattern))
+            .filter(|(p, _)| *p == pattern)
+            .map(|&(_, off)| off)
+    }
+
+    // insert the prefixes of slice with sizes in [2, max]
+    fn insert_prefixes(&mut self, slice: &'a [U], max: usize, off: usize) {
+        let mut h = slice.first().map(|&x| Self::sym(x)).unwrap_or(0);
+        for r in 2..=max.min(slice.len()) {
+            h = h.wrapping_mul(Self::BASE).wrapping_add(Self::sym(slice[r-1]));
+            self.patterns.insert(h, (&slice[..r], off));
+        }
+    }
+
+    // find the suffixes of slice with sizes in [2, max] that match a
+    // pattern, as (size, off) pairs from shortest to longest
+    fn find_suffixes(
+        &mut self,
+        slice: &[U],
+        max: usize,
+        matches: &mut Vec<(usize, usize)>,
+    ) {
+        matches.clear();
+        let max = max.min(slice.len());
+        self.pow(max);
+        let mut h = 0u64;
+        for size in 1..=max {
+            let i = slice.len() - size;
+            h = h.wrapping_add(
+                Self::sym(slice[i]).wrapping_mul(self.pows[size-1]));
+            if size < 2 {
+                continue;
+            }
+            if let Some(&(p, off)) = self.patterns.get(&h) {
+                if p == &slice[i..] {
+                    matches.push((size, off));
+                }
+            }
+        }
+    }
+}
+
+// State for optimal parsing. Instead of greedily picking whichever symbol
+// compresses the current position best, we find the cheapest parse of a
+// window of upcoming positions by dynamic programming over the bit costs
+// of our symbols, and emit the first symbol of that parse.
+//
+// Matches in the window are found with the current history, which is
+// missing anything the parse itself would add, so only the first symbol
+// of the parse is exact. This is why we parse the whole window again for
+// every symbol.
+struct Optimal {
+    window: usize,
+    imms: Vec<Option<usize>>,           // cost of each immediate
+    sizes: Vec<Option<usize>>,          // cost of each reference size
+    matches: Vec<Vec<(usize, usize)>>,  // matches at each position
+    costs: Vec<[(usize, usize); 2]>,    // (cost, size of first reference)
+}
+
+impl Optimal {
+    fn new(glz: &GLZ) -> Self {
+        let cost = |x: u32| glz.rice.encode_u32(x).ok().map(|x| x.len());
+        let window = 2usize.pow(glz.l as u32 + 1);
+        Self{
+            window: window,
+            imms: (0..2u32.pow(GLZ::WIDTH as u32))
+                .map(cost)
+                .collect(),
+            sizes: (0..2u32.pow(glz.l as u32))
+                .map(|size| cost(size + 2u32.pow(GLZ::WIDTH as u32)))
+                .collect(),
+            matches: vec![Vec::new(); window],
+            costs: Vec::with_capacity(window+1),
+        }
+    }
+}
+
 impl GLZ {
     pub const DEFAULT_K: usize  = GLZ::WIDTH+1;
     pub const DEFAULT_L: usize  = 5;
     pub const DEFAULT_M: usize  = 4;
     pub const WIDTH: usize      = 8;
 
+    // limits of fast mode's runs and references
+    const FAST_RUN: usize       = 2usize.pow(7);
+    const FAST_SIZE: usize      = 2usize.pow(7)+1;
+
     pub fn new() -> Self {
         Self::with_config(Self::DEFAULT_K, Self::DEFAULT_L, Self::DEFAULT_M)
     }
@@ -89,6 +246,9 @@ impl GLZ {
                 GolombRice::new(k),
                 Hist::new(),
             ),
+            optimal: false,
+            seek: None,
+            fast: false,
         }
     }
 
@@ -105,6 +265,9 @@ impl GLZ {
                 GolombRice::new(k),
                 Hist::with_table(decode_table),
             ),
+            optimal: false,
+            seek: None,
+            fast: false,
         }
     }
 
@@ -114,11 +277,7 @@ impl GLZ {
         m: usize,
         hist: &Hist,
     ) -> Self {
-        // use hist as bijecter to map probabilities to best rice code
-        let mut hist = hist.clone();
-        hist.sort();
-        hist.compact();
-
+        let hist = Self::biject_hist(hist);
         let rice = if let Some(k) = k {
             GolombRice::new(k)
         } else {
@@ -132,9 +291,21 @@ impl GLZ {
                 rice,
                 hist,
             ),
+            optimal: false,
+            seek: None,
+            fast: false,
         }
     }
 
+    // use hist as bijecter to map probabilities to best rice code, this
+    // is the histogram K is chosen against
+    pub fn biject_hist(hist: &Hist) -> Hist {
+        let mut hist = hist.clone();
+        hist.sort();
+        hist.compact();
+        hist
+    }
+
     pub fn from_seed<I: IntoIterator<Item=U>, U: Sym>(
         k: Option<usize>,
         l: usize,
@@ -163,6 +334,30 @@ impl GLZ {
         self.m
     }
 
+    pub fn optimal(&self) -> bool {
+        self.optimal
+    }
+
+    pub fn set_optimal(&mut self, optimal: bool) {
+        self.optimal = optimal;
+    }
+
+    pub fn seek(&self) -> Option<usize> {
+        self.seek
+    }
+
+    pub fn set_seek(&mut self, seek: Option<usize>) {
+        self.seek = seek;
+    }
+
+    pub fn fast(&self) -> bool {
+        self.fast
+    }
+
+    pub fn set_fast(&mut self, fast: bool) {
+        self.fast = fast;
+    }
+
     pub fn encode_table<U: Sym>(&self) -> Result<Vec<U>> {
         self.rice.bijecter().encode_table()
     }
@@ -261,50 +456,158 @@ impl GLZ {
         self.decode_sym(&bits[off..])
     }
 
+    // number of bits needed to encode a reference's offset
+    fn off_cost(&self, off: usize) -> usize {
+        let mut nibbles = 0;
+        let mut noff = off + 1;
+        while noff != 0 {
+            noff -= 1;
+            nibbles += 1;
+            noff >>= self.m;
+        }
+        nibbles * (self.m+1)
+    }
+
+    // find the cheapest parse of the window ending at slice's end, returns
+    // the reference to emit, if any, as a (size, off) pair
+    fn plan<'a, U: Sym>(
+        &self,
+        history: &mut History<'a, U>,
+        optimal: &mut Optimal,
+        off: usize,
+        slice: &'a [U],
+    ) -> Result<Option<(usize, usize)>> {
+        const NONE: usize = usize::MAX;
+        let j = slice.len();
+        let end = j.saturating_sub(optimal.window);
+
+        // find matches for every position in the window
+        let n = j - end;
+        for i in 0..n {
+            history.find_suffixes(
+                &slice[..j-i],
+                2usize.pow(self.l as u32),
+                &mut optimal.matches[i]);
+        }
+
+        // costs[i][forced] = cheapest parse of the last i positions, forced
+        // if the parse ends in a reference, which must be followed by an
+        // immediate. References running past the window are treated as
+        // ending at the window.
+        optimal.costs.clear();
+        optimal.costs.resize(n+1, [(NONE, 0); 2]);
+        optimal.costs[0][0] = (0, 0);
+        for i in 0..n {
+            let p = j - i;
+            for forced in 0..2 {
+                let (cost, first) = optimal.costs[i][forced];
+                if cost == NONE {
+                    continue;
+                }
+
+                let imm = optimal.imms.get(u32::cast(slice[p-1])? as usize)
+                    .copied().flatten();
+                if let Some(imm) = imm {
+                    let next = &mut optimal.costs[i+1][0];
+                    if cost + imm < next.0 {
+                        *next = (cost + imm, if i == 0 { 0 } else { first });
+                    }
+                }
+
+                if forced == 1 {
+                    continue;
+                }
+
+                for &(size, poff) in &optimal.matches[i] {
+                    if let Some(sizecost) = optimal.sizes[size-2] {
+                        let cost = cost + sizecost
+                            + self.off_cost(off+cost-poff);
+                        let next = &mut optimal.costs[(i+size).min(n)][1];
+                        if cost < next.0 {
+                            *next = (cost, if i == 0 { size } else { first });
+                        }
+                    }
+                }
+            }
+        }
+
+        let [free, forced] = optimal.costs[n];
+        let (_, first) = if forced.0 < free.0 { forced } else { free };
+        Ok(optimal.matches[0].iter()
+            .find(|&&(size, _)| size == first)
+            .copied())
+    }
+
     fn encode1<'a, U: Sym>(
         &self,
-        history: &mut HashMap<&'a [U], usize>,
+        history: &mut History<'a, U>,
         off: &mut usize,
         slice: &'a [U],
         mut prog: impl FnMut(usize),
     ) -> Result<BitVec> {
+        if self.fast {
+            return self.encode1_fast(history, off, slice, prog);
+        }
+
         let mut patterns: Vec<BitVec> = Vec::new();
+        let mut matches: Vec<(usize, usize)> = Vec::new();
+        let mut optimal = if self.optimal {
+            Some(Optimal::new(self))
+        } else {
+            None
+        };
         let mut j = slice.len();
         let mut lastmatch = j;
         let mut forceimm = false;
         while j > 0 {
-            // find longest suffix in dictionary that matches criteria
-            // this looks (and is) very expensive (O(n^2))
-            let mut refconsume = 0;
-            let mut ref_: Option<BitVec> = None;
-            let lookahead = j
-                .checked_sub(2usize.pow(self.l as u32))
-                .unwrap_or(0);
-            for i in (lookahead..j).rev() {
-                if let Some(nref) = history
-                    .get(&slice[i..j])
-                    .and_then(|&poff|
-                        self.encode_sym::<U>(GLZSym::Ref{
-                            off: *off-poff,
-                            size: slice[i..j].len(),
-                        }).ok()
-                    )
-                {
-                    refconsume = j-i;
-                    ref_ = Some(nref);
-                }
-            }
-            let refratio = ref_.as_ref()
-                .map(|ref_| refconsume as f64 / ref_.len() as f64)
-                .unwrap_or(0.0);
-
             let immconsume = 1;
             let imm = self.encode_sym(GLZSym::Imm(slice[j-1]))?;
             let immratio = immconsume as f64 / imm.len() as f64;
 
+            let ref_: Option<(usize, BitVec)> = if forceimm {
+                // force an immediate to guarantee O(n) decompression (at
+                // minimum one character per reference)
+                None
+            } else if let Some(optimal) = optimal.as_mut() {
+                // find the cheapest parse
+                match self.plan(history, optimal, *off, &slice[..j])? {
+                    Some((size, poff)) => Some((size,
+                        self.encode_sym::<U>(GLZSym::Ref{
+                            off: *off-poff,
+                            size: size,
+                        })?)),
+                    None => None,
+                }
+            } else {
+                // find longest suffix in dictionary that we can encode, this
+                // is O(2^L) thanks to the rolling hash
+                history.find_suffixes(
+                    &slice[..j],
+                    2usize.pow(self.l as u32),
+                    &mut matches);
+                matches.iter().rev()
+                    .find_map(|&(size, poff)|
+                        self.encode_sym::<U>(GLZSym::Ref{
+                            off: *off-poff,
+                            size: size,
+                        }).ok().map(|ref_| (size, ref_)))
+                    // only worth the overhead of the reference if it
+                    // compresses better than an immediate
+                    .filter(|(size, ref_)|
+                        *size as f64 / ref_.len() as f64 > immratio)
+            };
+
             let consume: usize;
             let emit: usize;
-            if forceimm || immratio >= refratio {
+            if let Some((refconsume, ref_)) = ref_ {
+                // found a pattern, emit reference
+                consume = refconsume;
+                emit = ref_.len();
+                patterns.push(ref_);
+
+                lastmatch = j;
+                forceimm = true;
+            } else {
                 // not worth the overhead of the reference, emit immediate(s)
                 consume = immconsume;
                 emit = imm.len();
@@ -313,32 +616,206 @@ impl GLZ {
 
                 // add every prefix to dictionary since last match, note we
                 // also update the substrings of our original match, which
-                // should improve offset locality. This is worst case O(n^2)
-                // if no repetition is ever found.
+                // should improve offset locality
                 let i = j-consume;
-                for r in (i+2..lastmatch+1).take(2usize.pow(self.l as u32)) {
-                    history.insert(&slice[i..r], *off+emit);
-                }
+                history.insert_prefixes(
+                    &slice[i..lastmatch],
+                    2usize.pow(self.l as u32)+1,
+                    *off+emit);
+            }
+
+            prog(consume);
+            j -= consume;
+            *off += emit;
+        }
+
+        Ok(patterns.into_iter().rev().flatten().collect())
+    }
+
+    // Fast mode trades some compression for symbols that are all whole
+    // bytes, which are much cheaper to decode when decompression is
+    // CPU-bound rather than flash-bound. There is no Golomb-Rice table,
+    // literals are stored as-is in runs that can be copied in one go, and
+    // references are the same forward references as above, just measured
+    // in bytes:
+    //
+    // literals:
+    // [0nnnnnnn|xxxxxxxx|xxxxxxxx|...]
+    //       ^   \------------------/
+    //       |            '-- n+1 literals
+    //       '--------------- 7-bit run length - 1
+    //
+    // reference:
+    // [1sssssss|rrrrrrrr|1xxxxxxx|0xxxxxxx]
+    //       ^        ^   \---------------/
+    //       |        |           '-- LEB128 byte offset
+    //       |        '-------------- literals left in the target's run - 1
+    //       '----------------------- 7-bit length - 2
+    //
+    // Patterns are still prefixes of previously emitted literals, so a
+    // reference can land in the middle of a run, which is why references
+    // carry the number of literals left in the run they land in. Otherwise
+    // decompression is the same, O(1) RAM with at most one level of
+    // recursion.
+    fn encode1_fast<'a, U: Sym>(
+        &self,
+        history: &mut History<'a, U>,
+        off: &mut usize,
+        slice: &'a [U],
+        mut prog: impl FnMut(usize),
+    ) -> Result<BitVec> {
+        let mut patterns: Vec<BitVec> = Vec::new();
+        let mut matches: Vec<(usize, usize)> = Vec::new();
+        let mut j = slice.len();
+        let mut lastmatch = j;
+        let mut forceimm = false;
+        let mut run = 0;
+        while j > 0 {
+            let ref_: Option<(usize, BitVec)> = if forceimm {
+                // force a literal to guarantee O(n) decompression
+                None
             } else {
-                // found a pattern, emit reference
+                // find longest suffix in dictionary, our current run needs
+                // to be closed before the reference
+                history.find_suffixes(&slice[..j], Self::FAST_SIZE,
+                    &mut matches);
+                let roff = *off + if run > 0 { 8 } else { 0 };
+                match matches.last() {
+                    Some(&(size, poff)) => Some((size,
+                        self.encode_fast_sym(FastSym::Ref{
+                            off: roff-poff,
+                            size: size,
+                            run: history.runs[&poff],
+                        })?)),
+                    None => None,
+                }
+                // only worth it if it saves more than the extra run it
+                // costs us
+                .filter(|(size, ref_)| 8*size > ref_.len() + 8)
+            };
+
+            let consume: usize;
+            if let Some((refconsume, ref_)) = ref_ {
+                // found a pattern, close our run and emit reference
+                if run > 0 {
+                    patterns.push(self.encode_fast_sym(FastSym::Run(run))?);
+                    *off += 8;
+                    run = 0;
+                }
+
                 consume = refconsume;
-                emit = ref_.as_ref().unwrap().len();
-                patterns.push(ref_.unwrap());
+                *off += ref_.len();
+                patterns.push(ref_);
 
-                // force an immediate to guarantee O(n) decompression (at
-                // minimum one character per reference)
                 lastmatch = j;
                 forceimm = true;
+            } else {
+                // emit literal, closing our run if it's full
+                if run == Self::FAST_RUN {
+                    patterns.push(self.encode_fast_sym(FastSym::Run(run))?);
+                    *off += 8;
+                    run = 0;
+                }
+
+                consume = 1;
+                patterns.push(8.encode_u32(u32::cast(slice[j-1])?)?);
+                *off += 8;
+                run += 1;
+                forceimm = false;
+
+                // add every prefix to dictionary since last match, along
+                // with how many literals are left in the run
+                let i = j-consume;
+                history.runs.insert(*off, run);
+                history.insert_prefixes(
+                    &slice[i..lastmatch],
+                    Self::FAST_SIZE,
+                    *off);
             }
 
             prog(consume);
             j -= consume;
-            *off += emit;
+        }
+
+        if run > 0 {
+            patterns.push(self.encode_fast_sym(FastSym::Run(run))?);
+            *off += 8;
         }
 
         Ok(patterns.into_iter().rev().flatten().collect())
     }
 
+    fn encode_fast_sym(&self, sym: FastSym) -> Result<BitVec> {
+        let bits = match sym {
+            FastSym::Run(size) => {
+                ensure!(size >= 1 && size <= Self::FAST_RUN,
+                    "bad run {}", size);
+                8.encode_u32(size as u32 - 1)
+            }
+            FastSym::Ref{off, size, run} => {
+                ensure!(off % 8 == 0, "unaligned offset {}", off);
+                ensure!(size >= 2 && size <= Self::FAST_SIZE,
+                    "bad size {}", size);
+                ensure!(run >= 1 && run <= Self::FAST_RUN,
+                    "bad run {}", run);
+                Ok(8.encode_u32(0x80 | (size as u32 - 2))?.into_iter()
+                    .chain(8.encode_u32(run as u32 - 1)?)
+                    .chain(LEB128.encode_u32((off / 8) as u32)?)
+                    .collect())
+            }
+        };
+
+        bits.chain_err(|| format!("could not encode GLZ symbol {:?}", sym))
+    }
+
+    fn decode_fast_sym_at(
+        &self,
+        bits: &BitSlice,
+        off: usize,
+    ) -> Result<(FastSym, usize)> {
+        let (sym, diff) = (|| -> Result<(FastSym, usize)> {
+            let (x, mut diff) = 8.decode_u32_at(bits, off)?;
+            if x < 0x80 {
+                return Ok((FastSym::Run(x as usize + 1), diff));
+            }
+
+            let (run, d) = 8.decode_u32_at(bits, off+diff)?;
+            diff += d;
+            let (noff, d) = LEB128.decode_u32_at(bits, off+diff)?;
+            diff += d;
+            Ok((FastSym::Ref{
+                off: 8*noff as usize,
+                size: (x & 0x7f) as usize + 2,
+                run: run as usize + 1,
+            }, diff))
+        })().chain_err(|| "could not decode GLZ symbol")?;
+
+        Ok((sym, diff))
+    }
+
+    // compress a slice with encode1, or if we have a seek interval, in
+    // chunks so every seek bytes of the slice start on a new symbol, chunks
+    // are compressed back to front, same as symbols, so they stay contiguous
+    fn encode_chunks<'a, U: Sym>(
+        &self,
+        history: &mut History<'a, U>,
+        off: &mut usize,
+        slice: &'a [U],
+        mut prog: impl FnMut(usize),
+    ) -> Result<BitVec> {
+        let seek = match self.seek {
+            Some(seek) => seek,
+            None => return self.encode1(history, off, slice, prog),
+        };
+
+        let mut chunks: Vec<BitVec> = Vec::new();
+        for chunk in slice.chunks(seek).rev() {
+            chunks.push(self.encode1(history, off, chunk, &mut prog)?);
+        }
+
+        Ok(chunks.into_iter().rev().flatten().collect())
+    }
+
     fn decode1<U: Sym>(
         &self,
         bits: &BitSlice,
@@ -347,6 +824,10 @@ impl GLZ {
         prog: &mut impl FnMut(usize),
         depth: u32,
     ) -> Result<Vec<U>> {
+        if self.fast {
+            return self.decode1_fast(bits, off, 0, size, prog, depth);
+        }
+
         // check that we have bounded recursion
         ensure!(depth < 2, "exceeded max depth ({} < {})", depth, 2);
 
@@ -393,6 +874,76 @@ impl GLZ {
         Ok(bytes)
     }
 
+    // decode1 for fast mode, run is the number of literals left in the run
+    // we start in
+    fn decode1_fast<U: Sym>(
+        &self,
+        bits: &BitSlice,
+        off: usize,
+        run: usize,
+        size: Option<usize>,
+        prog: &mut impl FnMut(usize),
+        depth: u32,
+    ) -> Result<Vec<U>> {
+        // check that we have bounded recursion
+        ensure!(depth < 2, "exceeded max depth ({} < {})", depth, 2);
+
+        let mut bytes: Vec<U> = Vec::new();
+        let mut off = off;
+        let mut run = run;
+        let mut cycles = 0;
+        while match size {
+            Some(size) => bytes.len() < size,
+            None => off < bits.len(),
+        } {
+            if run > 0 {
+                // copy literal
+                let (x, diff) = 8.decode_u32_at(bits, off)?;
+                bytes.push(U::cast(x)?);
+                off += diff;
+                run -= 1;
+                prog(1);
+            } else {
+                // decode symbol
+                match self.decode_fast_sym_at(bits, off)? {
+                    (FastSym::Run(size), diff) => {
+                        off += diff;
+                        run = size;
+                    }
+                    (FastSym::Ref{off: refoff, size: refsize, run: refrun},
+                            diff) => {
+                        off += diff;
+                        if size.is_some()
+                                && refsize >= size.unwrap()-bytes.len() {
+                            off += refoff;
+                            run = refrun;
+                        } else {
+                            let ref_: Vec<U> = self.decode1_fast(
+                                bits,
+                                off + refoff,
+                                refrun,
+                                Some(refsize),
+                                prog,
+                                depth + 1,
+                            )?;
+                            bytes.extend(ref_);
+                        }
+                    }
+                }
+            }
+
+            // check that runtime is linear
+            cycles += 1;
+            if size.is_some() {
+                ensure!(cycles <= 2*size.unwrap() as u32,
+                    "exceeded runtime limit ({} <= {})",
+                        cycles, 2*size.unwrap());
+            }
+        }
+
+        Ok(bytes)
+    }
+
     // traversal functions, intended for building up histograms
     pub fn traverse_syms<U: Sym, F: FnMut(U)>(
         &self,
@@ -430,35 +981,194 @@ impl GLZ {
 
         Ok(())
     }
-}
 
-impl Encode for GLZ {
-    fn encode_with_prog<U: Sym>(
+    // Slices compressed with a seek interval are cut into chunks of that
+    // many bytes, each starting on a new symbol. References can still
+    // point anywhere, so this costs very little, but it lets us start
+    // decompressing at any chunk. The bit offsets of the chunks after the
+    // first are the slice's checkpoints.
+    //
+    // To decompress off..off+len, start at checkpoint off/seek and skip
+    // off%seek bytes.
+
+    // Find the checkpoints of a slice compressed with a seek interval
+    pub fn checkpoints(
         &self,
-        bytes: &[U],
-        prog: impl FnMut(usize),
-    ) -> Result<BitVec> {
-        self.encode1(&mut HashMap::new(), &mut 0, bytes, prog)
+        bits: &BitSlice,
+        off: usize,
+        len: usize,
+        seek: usize,
+    ) -> Result<Vec<usize>> {
+        ensure!(seek > 0, "seek interval must be non-zero");
+
+        let mut checkpoints: Vec<usize> = Vec::new();
+        let mut off = off;
+        let mut pos = 0;
+        while pos < len {
+            let next = (checkpoints.len()+1)*seek;
+            if pos == next {
+                checkpoints.push(off);
+            }
+            ensure!(pos < (checkpoints.len()+1)*seek,
+                "symbol crosses checkpoint at {}, was this compressed \
+                with a seek interval of {}?", next, seek);
+
+            // only need the symbols at the top-level
+            let (size, diff) = if self.fast {
+                match self.decode_fast_sym_at(bits, off)? {
+                    (FastSym::Run(size), diff) => (size, diff + 8*size),
+                    (FastSym::Ref{size, ..}, diff) => (size, diff),
+                }
+            } else {
+                match self.decode_sym_at::<u32>(bits, off)? {
+                    (GLZSym::Imm(_), diff) => (1, diff),
+                    (GLZSym::Ref{size, ..}, diff) => (size, diff),
+                }
+            };
+
+            if size < len-pos {
+                off += diff;
+                pos += size;
+            } else {
+                // tail reference or the last symbol, this can only finish
+                // the last chunk
+                pos = len;
+            }
+        }
+
+        ensure!(checkpoints.len() == (cmp::max(len, 1)-1)/seek,
+            "missing checkpoints, was this compressed with a seek \
+            interval of {}?", seek);
+        Ok(checkpoints)
     }
 
-    fn decode_with_prog<U: Sym>(
+    // Dictionaries let a set of independently compressed blobs share the
+    // patterns they have in common. A dictionary is compressed once on
+    // its own, and blobs compressed against it are laid out so that their
+    // bits are followed by the dictionary's bits. Since references are
+    // relative offsets forward into the bitstream, references past the
+    // end of a blob simply land in the dictionary, and decompression
+    // doesn't need to know a dictionary is involved.
+    //
+    // Note the dictionary and blobs must share the same K and table.
+
+    // Train a dictionary of at most size symbols from runs the slices
+    // have in common, most valuable first, so references into the
+    // dictionary have short offsets
+    pub fn train<U: Sym>(slices: &[&[U]], size: usize) -> Vec<U> {
+        const W: usize = 8;
+
+        // count how many slices each window appears in
+        let mut counts: HashMap<&[U], (usize, usize)> = HashMap::new();
+        for (i, slice) in slices.iter().enumerate() {
+            for window in slice.windows(W) {
+                let count = counts.entry(window).or_insert((0, i));
+                if count.0 == 0 || count.1 != i {
+                    *count = (count.0 + 1, i);
+                }
+            }
+        }
+
+        // find runs of windows that appear in more than one slice,
+        // scoring each run by how much it could save the other slices
+        let mut runs: Vec<(usize, &[U])> = Vec::new();
+        for slice in slices {
+            let shared = |j: usize| counts[&slice[j..j+W]].0;
+            let mut j = 0;
+            while j+W <= slice.len() {
+                if shared(j) < 2 {
+                    j += 1;
+                    continue;
+                }
+
+                let mut k = j;
+                let mut n = usize::MAX;
+                while k+W <= slice.len() && shared(k) >= 2 {
+                    n = n.min(shared(k));
+                    k += 1;
+                }
+                runs.push(((n-1) * (k-j), &slice[j..k-1+W]));
+                j = k;
+            }
+        }
+        runs.sort_by(|a, b| b.0.cmp(&a.0).then(a.1.cmp(b.1)));
+
+        // greedily fill the dictionary, skipping runs it already covers
+        let mut dict: Vec<U> = Vec::new();
+        let mut covered: HashSet<&[U]> = HashSet::new();
+        for (_, run) in runs {
+            if dict.len() >= size {
+                break;
+            }
+
+            if run.windows(W).all(|window| covered.contains(window)) {
+                continue;
+            }
+
+            let run = &run[..run.len().min(size - dict.len())];
+            dict.extend_from_slice(run);
+            covered.extend(run.windows(W));
+        }
+
+        dict
+    }
+
+    // Compress a dictionary, dictionaries are always parsed greedily so
+    // the history we build when compressing against one is exactly the
+    // history of these bits
+    pub fn encode_dict<U: Sym>(&self, dict: &[U]) -> Result<BitVec> {
+        GLZ{optimal: false, ..self.clone()}
+            .encode1(&mut History::new(), &mut 0, dict, |_|())
+    }
+
+    // Compress slices against a dictionary, this returns only the bits
+    // of the slices, which must be followed by the dictionary's bits
+    // during decompression. Offsets may point into the dictionary.
+    pub fn encode_all_with_dict<U: Sym>(
         &self,
-        bits: &BitSlice,
-        mut prog: impl FnMut(usize),
-    ) -> Result<Vec<U>> {
-        self.decode1(bits, 0, None, &mut prog, 0)
+        dict: &[U],
+        slices: &[&[U]],
+    ) -> Result<(BitVec, Vec<(usize, usize)>)> {
+        self.encode_all_with_dict_and_prog(dict, slices,
+            (iter::repeat(()), |_|(), |_|()))
     }
-}
 
-impl GranularEncode for GLZ {
-    fn encode_all_with_prog<U: Sym, T>(
+    pub fn encode_all_with_dict_and_prog<U: Sym, T>(
         &self,
+        dict: &[U],
         slices: &[&[U]],
+        prog: (impl IntoIterator<Item=T>, impl FnMut(T), impl FnMut(usize)),
+    ) -> Result<(BitVec, Vec<(usize, usize)>)> {
+        let (bits, offs) = self.encode_all1(Some(dict), slices, prog)?;
+        if self.optimal {
+            // keep whichever is smaller, see encode_with_prog
+            let greedy = GLZ{optimal: false, ..self.clone()}
+                .encode_all_with_dict(dict, slices)?;
+            if greedy.0.len() < bits.len() {
+                return Ok(greedy);
+            }
+        }
+
+        Ok((bits, offs))
+    }
+
+    fn encode_all1<'a, U: Sym, T>(
+        &self,
+        dict: Option<&'a [U]>,
+        slices: &[&'a [U]],
         mut prog: (impl IntoIterator<Item=T>, impl FnMut(T), impl FnMut(usize)),
     ) -> Result<(BitVec, Vec<(usize, usize)>)> {
-        let mut history: HashMap<&[U], usize> = HashMap::new();
+        let mut history: History<U> = History::new();
         let mut off = 0; // compressed offset
 
+        // start with the dictionary's history, the dictionary's bits
+        // are not part of our output
+        if let Some(dict) = dict {
+            GLZ{optimal: false, ..self.clone()}
+                .encode1(&mut history, &mut off, dict, |_|())?;
+        }
+        let end = off;
+
         // sort so that smaller slices have smaller offset values
         let mut sorted_slices: Vec<_> = slices.iter()
             .zip(prog.0)
@@ -471,12 +1181,15 @@ impl GranularEncode for GLZ {
             prog.1(tag);
             if offs.contains_key(slice) {
                 // found duplicate in blob? deduplicate
-            } else if let Some(off) = history.get(slice).copied() {
-                // found slice inside a pattern
+            } else if let Some(off) = history.get(slice)
+                    .filter(|_| self.seek.is_none() && !self.fast) {
+                // found slice inside a pattern, we can't do this if we
+                // need checkpoints, or in fast mode, where patterns can
+                // start in the middle of a run
                 offs.insert(slice, off);
             } else {
                 // compress our slice
-                blobs.push(self.encode1(
+                blobs.push(self.encode_chunks(
                     &mut history,
                     &mut off,
                     slice,
@@ -485,8 +1198,8 @@ impl GranularEncode for GLZ {
             }
         }
 
-        let total: usize = blobs.iter().map(|b| b.len()).sum();
-        Ok((
+        let total: usize = end + blobs.iter().map(|b| b.len()).sum::<usize>();
+        let (bits, offs): (BitVec, Vec<(usize, usize)>) = (
             // build blob
             blobs.into_iter()
                 .rev()
@@ -499,7 +1212,59 @@ impl GranularEncode for GLZ {
                     slice.len(),
                 ))
                 .collect(),
-        ))
+        );
+
+        Ok((bits, offs))
+    }
+}
+
+impl Encode for GLZ {
+    fn encode_with_prog<U: Sym>(
+        &self,
+        bytes: &[U],
+        prog: impl FnMut(usize),
+    ) -> Result<BitVec> {
+        let bits = self.encode_chunks(
+            &mut History::new(), &mut 0, bytes, prog)?;
+        if self.optimal {
+            // optimal parsing can't see how its own symbols change the
+            // history, so on small inputs it can lose to greedy parsing,
+            // keep whichever is smaller
+            let greedy = GLZ{optimal: false, ..self.clone()}.encode(bytes)?;
+            if greedy.len() < bits.len() {
+                return Ok(greedy);
+            }
+        }
+
+        Ok(bits)
+    }
+
+    fn decode_with_prog<U: Sym>(
+        &self,
+        bits: &BitSlice,
+        mut prog: impl FnMut(usize),
+    ) -> Result<Vec<U>> {
+        self.decode1(bits, 0, None, &mut prog, 0)
+    }
+}
+
+impl GranularEncode for GLZ {
+    fn encode_all_with_prog<U: Sym, T>(
+        &self,
+        slices: &[&[U]],
+        prog: (impl IntoIterator<Item=T>, impl FnMut(T), impl FnMut(usize)),
+    ) -> Result<(BitVec, Vec<(usize, usize)>)> {
+        let (bits, offs) = self.encode_all1(None, slices, prog)?;
+        if self.optimal {
+            // keep whichever is smaller, see encode_with_prog
+            let greedy = GLZ{optimal: false, ..self.clone()}
+                .encode_all(slices)?;
+            if greedy.0.len() < bits.len() {
+                return Ok(greedy);
+            }
+        }
+
+        Ok((bits, offs))
     }
 
     fn decode_at_with_prog<U: Sym>(
@@ -705,4 +1470,212 @@ mod tests {
 
         Ok(())
     }
+
+    #[test]
+    fn optimal_symmetry_test() -> Result<()> {
+        let glz = GLZ::with_config(8, 5, 3);
+        let mut optimal = glz.clone();
+        optimal.set_optimal(true);
+
+        let phrase = &[
+            &b"hello world hello hello world! hello hello "[..],
+            &b"world world hello! world hello world hello "[..],
+            &b"hello world hello world world hello!"[..],
+        ].concat();
+        assert_eq!(glz.encode(phrase)?.len(), 474);
+        assert_eq!(optimal.encode(phrase)?.len(), 458);
+        assert_eq!(
+            optimal.decode::<u8>(&optimal.encode(phrase)?)?,
+            phrase.to_vec()
+        );
+
+        let phrase = &[
+            &b"hhhhh wwwww hhhhh hhhhh wwwww! hhhhh hhhhh "[..],
+            &b"wwwww wwwww hhhhh! wwwww hhhhh wwwww hhhhh "[..],
+            &b"hhhhh wwwww!"[..],
+        ].concat();
+        assert_eq!(glz.encode(phrase)?.len(), 631);
+        assert_eq!(optimal.encode(phrase)?.len(), 522);
+        assert_eq!(
+            optimal.decode::<u8>(&optimal.encode(phrase)?)?,
+            phrase.to_vec()
+        );
+
+        let phrase = &[
+            &b"hellohello worldworld hellohello hello "[..],
+            &b"world worldworld hello hellohelloworld "[..],
+            &b"worldhello helloworld hello world!"[..],
+        ].concat();
+        assert_eq!(glz.encode(phrase)?.len(), 592);
+        assert_eq!(optimal.encode(phrase)?.len(), 552);
+        assert_eq!(
+            optimal.decode::<u8>(&optimal.encode(phrase)?)?,
+            phrase.to_vec()
+        );
+
+        Ok(())
+    }
+
+    #[test]
+    fn dict_symmetry_test() -> Result<()> {
+        let glz = GLZ::with_config(8, 5, 3);
+        let slices: &[&[u8]] = &[
+            b"the quick brown fox jumps over the lazy dog, hello world!",
+            b"hello world! the quick brown fox naps by the lazy dog",
+            b"jumps over the lazy dog, the quick brown fox, hello!",
+        ];
+
+        let dict = GLZ::train(slices, 64);
+        assert_eq!(dict.len(), 58);
+        let dict_bits = glz.encode_dict(&dict)?;
+        assert_eq!(dict_bits.len(), 499);
+
+        for (slice, sizes) in slices.iter().zip(&[
+                (499, 111),
+                (454, 164),
+                (445, 124)]) {
+            let (bits, _) = glz.encode_all(&[*slice])?;
+            let (dict_slice_bits, offs) = glz.encode_all_with_dict(
+                &dict, &[*slice])?;
+            assert_eq!((bits.len(), dict_slice_bits.len()), *sizes);
+
+            let bits: BitVec = dict_slice_bits.iter()
+                .chain(&dict_bits)
+                .collect();
+            assert_eq!(
+                glz.decode_at::<u8>(&bits, offs[0].0, offs[0].1)?,
+                slice.to_vec()
+            );
+        }
+
+        Ok(())
+    }
+
+    #[test]
+    fn seek_symmetry_test() -> Result<()> {
+        let mut glz = GLZ::with_config(8, 5, 3);
+        let slices: &[&[u8]] = &[
+            &[
+                &b"hello world hello hello world! hello hello "[..],
+                &b"world world hello! world hello world hello "[..],
+                &b"hello world hello world world hello!"[..],
+            ].concat(),
+            b"hello world! hello again",
+            b"",
+        ];
+
+        let (bits, _) = glz.encode_all(slices)?;
+        assert_eq!(bits.len(), 630);
+        glz.set_seek(Some(16));
+        let (seek_bits, offs) = glz.encode_all(slices)?;
+        assert_eq!(seek_bits.len(), 743);
+
+        for (slice, (off, len)) in slices.iter().zip(offs) {
+            assert_eq!(
+                glz.decode_at::<u8>(&seek_bits, off, len)?,
+                slice.to_vec()
+            );
+
+            let checkpoints = glz.checkpoints(&seek_bits, off, len, 16)?;
+            assert_eq!(checkpoints.len(), (cmp::max(len, 1)-1)/16);
+            for i in 0..len {
+                for j in i..cmp::min(i+20, len) {
+                    let start = if i/16 > 0 { checkpoints[i/16-1] } else { off };
+                    let bytes = glz.decode_at::<u8>(
+                        &seek_bits, start, i%16 + j-i)?;
+                    assert_eq!(&bytes[i%16..], &slice[i..j]);
+                }
+            }
+        }
+
+        // slices that weren't compressed with a seek interval don't have
+        // checkpoints
+        let (bits, offs) = GLZ::with_config(8, 5, 3).encode_all(slices)?;
+        assert!(glz.checkpoints(&bits, offs[0].0, offs[0].1, 16).is_err());
+
+        Ok(())
+    }
+
+    #[test]
+    fn fast_sym_symmetry_test() -> Result<()> {
+        let glz = GLZ::new();
+        for (sym, size) in &[
+                (FastSym::Run(1), 8),
+                (FastSym::Run(128), 8),
+                (FastSym::Ref{off: 0, size: 2, run: 1}, 24),
+                (FastSym::Ref{off: 8*127, size: 129, run: 128}, 24),
+                (FastSym::Ref{off: 8*123456, size: 31, run: 7}, 40)] {
+            let bits = glz.encode_fast_sym(*sym)?;
+            assert_eq!(bits.len(), *size);
+            assert_eq!(glz.decode_fast_sym_at(&bits, 0)?, (*sym, *size));
+        }
+
+        assert!(glz.encode_fast_sym(FastSym::Run(129)).is_err());
+        assert!(glz.encode_fast_sym(
+            FastSym::Ref{off: 8, size: 130, run: 1}).is_err());
+        assert!(glz.encode_fast_sym(
+            FastSym::Ref{off: 4, size: 2, run: 1}).is_err());
+
+        Ok(())
+    }
+
+    #[test]
+    fn fast_symmetry_test() -> Result<()> {
+        let mut glz = GLZ::with_config(8, 5, 3);
+        let slices: &[&[u8]] = &[
+            &[
+                &b"hello world hello hello world! hello hello "[..],
+                &b"world world hello! world hello world hello "[..],
+                &b"hello world hello world world hello!"[..],
+                &[b'x'; 300][..],
+            ].concat(),
+            b"hello world! hello again",
+            b"",
+        ];
+
+        let (bits, _) = glz.encode_all(slices)?;
+        assert_eq!(bits.len(), 1163);
+        glz.set_fast(true);
+        let (fast_bits, offs) = glz.encode_all(slices)?;
+        assert_eq!(fast_bits.len(), 1544);
+        assert_eq!(fast_bits.len() % 8, 0);
+
+        for (slice, (off, len)) in slices.iter().zip(&offs) {
+            assert_eq!(off % 8, 0);
+            assert_eq!(
+                glz.decode_at::<u8>(&fast_bits, *off, *len)?,
+                slice.to_vec()
+            );
+        }
+
+        // checkpoints work the same
+        glz.set_seek(Some(16));
+        let (seek_bits, offs) = glz.encode_all(slices)?;
+        for (slice, (off, len)) in slices.iter().zip(offs) {
+            let checkpoints = glz.checkpoints(&seek_bits, off, len, 16)?;
+            for i in 0..len {
+                let start = if i/16 > 0 { checkpoints[i/16-1] } else { off };
+                let j = cmp::min(i+20, len);
+                let bytes = glz.decode_at::<u8>(
+                    &seek_bits, start, i%16 + j-i)?;
+                assert_eq!(&bytes[i%16..], &slice[i..j]);
+            }
+        }
+
+        // and so do dictionaries
+        glz.set_seek(None);
+        let dict = GLZ::train(&slices[..2], 64);
+        let dict_bits = glz.encode_dict(&dict)?;
+        let (dict_slice_bits, offs) = glz.encode_all_with_dict(
+            &dict, &[slices[1]])?;
+        let bits: BitVec = dict_slice_bits.iter()
+            .chain(&dict_bits)
+            .collect();
+        assert_eq!(
+            glz.decode_at::<u8>(&bits, offs[0].0, offs[0].1)?,
+            slices[1].to_vec()
+        );
+
+        Ok(())
+    }
 }
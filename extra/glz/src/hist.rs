@@ -14,7 +14,7 @@ use std::ops::Index;
 use std::iter;
 use std::fmt;
 use std::fmt::Debug;
-use std::rc::Rc;
+use std::sync::Arc;
 use std::mem;
 
 use error_chain::ensure;
@@ -23,7 +23,7 @@ use error_chain::ensure;
 // Simple histogram class for Sym types
 #[derive(Clone)]
 pub struct Hist {
-    hist: Rc<Vec<usize>>,
+    hist: Arc<Vec<usize>>, // Arc so GLZ can be shared across threads
     table: Option<(Vec<u32>, Vec<u32>)>,
 }
 
@@ -34,7 +34,7 @@ impl Hist {
 
     pub fn with_capacity(capacity: usize) -> Self {
         Self{
-            hist: Rc::new(Vec::with_capacity(capacity)),
+            hist: Arc::new(Vec::with_capacity(capacity)),
             table: None,
         }
     }
@@ -83,7 +83,7 @@ impl Hist {
 
     pub fn increment_by<U: Sym>(&mut self, n: U, diff: usize) {
         let n = self.map_decode(n).unwrap().into() as usize;
-        let hist = Rc::make_mut(&mut self.hist);
+        let hist = Arc::make_mut(&mut self.hist);
         hist.resize(max(n+1, hist.len()), 0);
         hist[n] += diff;
     }
@@ -94,7 +94,7 @@ impl Hist {
 
     pub fn decrement_by<U: Sym>(&mut self, n: U, diff: usize) {
         let n = self.map_decode(n).unwrap().into() as usize;
-        let hist = Rc::make_mut(&mut self.hist);
+        let hist = Arc::make_mut(&mut self.hist);
         *hist.get_mut(n).unwrap_or(&mut 0) -= diff;
     }
 
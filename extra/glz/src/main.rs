@@ -10,6 +10,7 @@ use glz::errors::*;
 use glz::LEB128;
 use glz::GLZ;
 use glz::Hist;
+use glz::GolombRice;
 
 use std::io;
 use std::fs;
@@ -23,6 +24,10 @@ use std::thread;
 use std::cmp;
 use std::process;
 use std::convert::TryInto;
+use std::collections::HashMap;
+use std::sync::mpsc;
+use std::sync::atomic::AtomicUsize;
+use std::sync::atomic::Ordering;
 
 use error_chain::bail;
 
@@ -47,6 +52,8 @@ const VERSION: [u8; 2] = [VERSION_MAJOR, VERSION_MINOR];
 
 // Flags
 const FLAG_LEB128   : u16 = 0x0001;
+const FLAG_SEEK     : u16 = 0x0002;
+const FLAG_FAST     : u16 = 0x0004;
 
 // Type
 const TYPE_NONE     : u8 = 0x0;
@@ -57,6 +64,14 @@ const TYPE_ARCHIVE  : u8 = 0x3;
 #[derive(Debug, StructOpt)]
 #[structopt(rename_all = "kebab")]
 struct CommonOpt {
+    /// Compression mode. Compact uses Golomb-Rice codes for the smallest
+    /// output. Fast uses byte-aligned literal runs and references, which
+    /// are much cheaper to decompress, at some cost in compression. When
+    /// decompressing, this is only needed with --no-magic.
+    #[structopt(short = "m", long, default_value = "compact",
+        raw(possible_values = r#"&["compact", "fast"]"#))]
+    mode: String,
+
     /// Override K-constant, this is the width of the Golomb-Rice code's
     /// denominator in bits. By default the best K is approximated from
     /// the input data.
@@ -131,6 +146,14 @@ struct CommonOpt {
     /// file size a bit, but requires more complex support at decompression.
     #[structopt(long)]
     leb128: bool,
+
+    /// Seek mode. Compresses each file with a checkpoint every this many
+    /// bytes, and prepends the checkpoints after any other headers. This
+    /// enables decompressing any slice of a file by only decompressing
+    /// from the closest checkpoint. When decompressing, this is only
+    /// needed with --no-magic, the interval is stored with the checkpoints.
+    #[structopt(long)]
+    seek: Option<usize>,
 }
 
 #[derive(Debug, StructOpt)]
@@ -144,10 +167,45 @@ struct EncodeOpt {
     #[structopt(short, long)]
     output: Option<String>,
 
+    /// Find the cheapest parse of the input using the bit costs of the
+    /// Golomb-Rice table, instead of greedily choosing between immediates
+    /// and references. Slower to compress, but produces smaller output
+    /// that is just as fast to decompress.
+    #[structopt(long)]
+    optimal: bool,
+
+    /// Compress the inputs in parallel using this many threads, 0 uses
+    /// one thread per core. Each input is compressed independently, so
+    /// references can't cross inputs, and the table is found from these
+    /// independent inputs. The output format is the same, and the output
+    /// is the same for any number of threads, but it differs from the
+    /// output without -j. The dict command already compresses each input
+    /// independently, so there -j doesn't change the output.
+    #[structopt(short, long)]
+    jobs: Option<usize>,
+
+    /// Compress against a dictionary created with the dict command. The
+    /// dictionary's table is used instead of storing a table, and
+    /// references may point into the dictionary, which must be provided
+    /// again to decompress.
+    #[structopt(long, parse(from_os_str))]
+    dict: Option<PathBuf>,
+
     #[structopt(flatten)]
     common: CommonOpt,
 }
 
+#[derive(Debug, StructOpt)]
+#[structopt(rename_all = "kebab")]
+struct DictOpt {
+    /// Max size of the dictionary in bytes, before compression.
+    #[structopt(short, long, default_value = "4096")]
+    size: usize,
+
+    #[structopt(flatten)]
+    encode: EncodeOpt,
+}
+
 #[derive(Debug, StructOpt)]
 #[structopt(rename_all = "kebab")]
 struct DecodeOpt {
@@ -168,10 +226,20 @@ struct DecodeOpt {
     #[structopt(long)]
     len: Option<usize>,
 
+    /// Offset into the file to start decompression. If the file was
+    /// compressed with --seek, decompression starts at the closest
+    /// checkpoint.
+    #[structopt(long)]
+    at: Option<usize>,
+
     /// Output file
     #[structopt(short, long)]
     output: Option<String>,
 
+    /// Dictionary the file was compressed against.
+    #[structopt(long, parse(from_os_str))]
+    dict: Option<PathBuf>,
+
     #[structopt(flatten)]
     common: CommonOpt,
 }
@@ -212,6 +280,14 @@ enum Opt {
         #[structopt(flatten)]
         ls: LsOpt,
     },
+
+    /// Train a dictionary from the patterns shared by a set of files,
+    /// each file can then be compressed against the dictionary with
+    /// encode --dict
+    Dict {
+        #[structopt(flatten)]
+        dict: DictOpt,
+    },
 }
 
 
@@ -309,9 +385,138 @@ where
     with_prog_all(msg, quiet, &[], &[inputs], |(_, _, prog)| f(prog))
 }
 
+// Map over inputs in parallel, with at most jobs threads
+fn par_map<T, R, F>(
+    jobs: usize,
+    inputs: &[T],
+    prog: &mut dyn FnMut(usize),
+    f: F,
+) -> Result<Vec<R>>
+where
+    T: Sync,
+    R: Send,
+    F: Fn(&T, &mut dyn FnMut(usize)) -> Result<R> + Sync,
+{
+    let jobs = match jobs {
+        0 => thread::available_parallelism().map(|n| n.get()).unwrap_or(1),
+        jobs => jobs,
+    };
+
+    let next = AtomicUsize::new(0);
+    let (tx, rx) = mpsc::channel();
+    let mut results: Vec<(usize, Result<R>)> = thread::scope(|scope| {
+        let workers: Vec<_> = (0..cmp::min(jobs, inputs.len()))
+            .map(|_| {
+                let tx = tx.clone();
+                let next = &next;
+                let f = &f;
+                scope.spawn(move || {
+                    let mut results = Vec::new();
+                    loop {
+                        let i = next.fetch_add(1, Ordering::Relaxed);
+                        if i >= inputs.len() {
+                            break;
+                        }
+
+                        // batch progress, waking the main thread on
+                        // every symbol costs more than compressing it
+                        let mut pending = 0;
+                        results.push((i, f(&inputs[i], &mut |diff| {
+                            pending += diff;
+                            if pending >= 4096 {
+                                tx.send(pending).unwrap();
+                                pending = 0;
+                            }
+                        })));
+                        tx.send(pending).unwrap();
+                    }
+                    results
+                })
+            })
+            .collect();
+
+        // progress bars live on our thread
+        drop(tx);
+        for diff in rx {
+            prog(diff);
+        }
+
+        workers.into_iter()
+            .flat_map(|worker| worker.join().unwrap())
+            .collect()
+    });
+
+    results.sort_by_key(|(i, _)| *i);
+    results.into_iter().map(|(_, result)| result).collect()
+}
+
+// Compress inputs independently in parallel, this gives the same output
+// format as GLZ's encode_all, since references are relative we can just
+// concatenate each input's bits
+fn encode_all_par(
+    glz: &GLZ,
+    jobs: usize,
+    inputs: &[&[u8]],
+    prog: &mut dyn FnMut(usize),
+) -> Result<(BitVec, Vec<(usize, usize)>)> {
+    // deduplicate, and sort so that smaller inputs have smaller offsets
+    let mut unique: Vec<&[u8]> = inputs.to_vec();
+    unique.sort_by_key(|input| (input.len(), *input));
+    unique.dedup();
+
+    let blobs = par_map(jobs, &unique, prog, |input, prog| {
+        glz.encode_with_prog(input, prog)
+    })?;
+
+    let mut offs: HashMap<&[u8], usize> = HashMap::new();
+    let mut off = 0;
+    for (input, blob) in unique.iter().zip(&blobs) {
+        offs.insert(input, off);
+        off += blob.len();
+    }
+
+    Ok((
+        // build blob
+        blobs.iter()
+            .flatten()
+            .collect(),
+        // collect offsets+size pairs in the original order
+        inputs.iter()
+            .map(|input| (offs[input], input.len()))
+            .collect(),
+    ))
+}
+
+// Find K in parallel, each candidate K is costed against the histogram
+// independently, so this picks the same K as GLZ::from_hist
+fn from_hist_par(
+    jobs: usize,
+    k: Option<usize>,
+    l: usize,
+    m: usize,
+    hist: &Hist,
+) -> Result<GLZ> {
+    let k = match k {
+        Some(k) => k,
+        None => {
+            let hist = GLZ::biject_hist(hist);
+            let ks: Vec<usize> = GolombRice::candidates(&hist).collect();
+            let costs = par_map(jobs, &ks, &mut |_| (), |&k, _| {
+                Ok(GolombRice::new(k).cost(&hist))
+            })?;
+            costs.into_iter().zip(ks).min().unwrap().1
+        }
+    };
+
+    Ok(GLZ::from_hist(Some(k), l, m, hist))
+}
+
 // Some helpers
 fn mkflags(opt: &CommonOpt, flags: u16) -> u16 {
-    flags | if opt.leb128 { FLAG_LEB128 } else { 0 }
+    flags
+        | if opt.leb128 { FLAG_LEB128 } else { 0 }
+        | if opt.seek.is_some() { FLAG_SEEK } else { 0 }
+        | if opt.mode == "fast" { FLAG_FAST } else { 0 }
 }
 
 fn mktype(opt: &CommonOpt, _flags: u16) -> u8 {
@@ -325,6 +530,10 @@ fn print_k(_opt: &CommonOpt, k: usize) {
     println!("K: {}", k);
 }
 
+fn print_fast(_opt: &CommonOpt) {
+    println!("mode: fast, no table");
+}
+
 fn print_table(opt: &CommonOpt, table: &[u32]) {
     print!("table: [");
     if opt.print_table {
@@ -597,6 +806,42 @@ impl Write for EstimatorFile {
     }
 }
 
+// Load a dictionary created by the dict command, returning a GLZ with the
+// dictionary's table, the dictionary, and the dictionary's bits
+fn read_dict(
+    path: &PathBuf,
+    opt: &CommonOpt,
+) -> Result<(GLZ, Vec<u8>, BitVec)> {
+    let mut f = File::open(path)?;
+    let (flags, type_, k, table_size) = f.read_meta(opt)?;
+    if type_ != TYPE_LEN {
+        bail!("{} is not a dictionary?", path.to_string_lossy());
+    }
+    let size = f.read_size(flags)?;
+    let k = k.ok_or_else(|| "unknown K in dictionary?")?;
+
+    // the dictionary's bits start on a byte boundary after the table
+    let mut buf: Vec<u8> = Vec::new();
+    f.read_to_end(&mut buf)?;
+    let table: Vec<u32> = (1+GLZ::WIDTH).decode(
+        &buf.as_bitslice()[..table_size])?;
+    let mut glz = GLZ::with_table(k, opt.l, opt.m, &table);
+    glz.set_fast(flags & FLAG_FAST != 0);
+    let bits = &buf.as_bitslice()[((table_size+8-1)/8)*8..];
+    let dict: Vec<u8> = glz.decode_at(bits, 0, size)
+        .chain_err(|| format!("could not read {}, was it compressed \
+            with -m {}?", path.to_string_lossy(), opt.mode))?;
+
+    // we need to be able to recreate the dictionary's history exactly
+    let dict_bits = glz.encode_dict(&dict)?;
+    if dict_bits.len() > bits.len() || dict_bits != bits[..dict_bits.len()] {
+        bail!("{} was created by an incompatible version of glz?",
+            path.to_string_lossy());
+    }
+
+    Ok((glz, dict, dict_bits))
+}
+
 // High-level commands start here
 fn encode(opt: &EncodeOpt) -> Result<()> {
     // time ourselves
@@ -624,23 +869,53 @@ fn encode(opt: &EncodeOpt) -> Result<()> {
     let l = opt.common.l;
     let m = opt.common.m;
 
+    // compressing against a dictionary?
+    let dict = match opt.dict {
+        Some(ref path) => Some(read_dict(path, &opt.common)?),
+        None => None,
+    };
+
     // estimate k/table if necessary
-    let glz = match (opt.common.k, &opt.common.table) {
-        (k, table) if table.len() == 0 => {
+    let fast = opt.common.mode == "fast";
+    if fast && opt.optimal {
+        bail!("optimal parsing needs a Golomb-Rice table, \
+            can't use it with -m fast");
+    }
+    let mut glz = match (&dict, opt.common.k, &opt.common.table) {
+        (Some((glz, _, _)), _, _) if glz.fast() != fast => {
+            bail!("dictionary was not compressed with -m {}?",
+                opt.common.mode);
+        },
+        (Some((glz, _, _)), _, _) => {
+            // use the dictionary's table
+            glz.clone()
+        },
+        (None, _, _) if fast => {
+            // fast mode has no table
+            let mut glz = GLZ::new();
+            glz.set_fast(true);
+            glz
+        },
+        (None, k, table) if table.len() == 0 => {
             let mut hist = Hist::new();
             for _ in 0..opt.common.passes {
-                let (glz, bits) = with_prog_all(
-                    "finding constants...",
-                    opt.common.quiet,
-                    &paths,
-                    &inputs.iter().map(|x| x.len()).collect::<Vec<_>>(),
-                    |prog| {
-                        let glz = GLZ::with_config(GLZ::DEFAULT_K, l, m);
-                        let (bits, _) = glz.encode_all_with_prog(
-                            &inputs, prog)?;
-                        Ok((glz, bits))
-                    }
-                )?;
+                let glz = GLZ::with_config(GLZ::DEFAULT_K, l, m);
+                let (bits, _) = if let Some(jobs) = opt.jobs {
+                    with_prog(
+                        "finding constants...",
+                        opt.common.quiet,
+                        inputs.iter().map(|x| x.len()).sum(),
+                        |prog| encode_all_par(&glz, jobs, &inputs, prog)
+                    )?
+                } else {
+                    with_prog_all(
+                        "finding constants...",
+                        opt.common.quiet,
+                        &paths,
+                        &inputs.iter().map(|x| x.len()).collect::<Vec<_>>(),
+                        |prog| glz.encode_all_with_prog(&inputs, prog)
+                    )?
+                };
                 hist = with_prog(
                     "optimizing...",
                     opt.common.quiet,
@@ -661,9 +936,13 @@ fn encode(opt: &EncodeOpt) -> Result<()> {
                 hist.draw(None);
             }
 
-            GLZ::from_hist(k, l, m, &hist)
+            if let Some(jobs) = opt.jobs {
+                from_hist_par(jobs, k, l, m, &hist)?
+            } else {
+                GLZ::from_hist(k, l, m, &hist)
+            }
         },
-        (Some(k), table) => {
+        (None, Some(k), table) => {
             GLZ::with_table(k, l, m, table)
         },
         _ => {
@@ -671,29 +950,85 @@ fn encode(opt: &EncodeOpt) -> Result<()> {
         }
     };
 
-    let k = glz.k();
-    let table = glz.decode_table::<u32>()?;
-    print_k(&opt.common, k);
-    print_table(&opt.common, &table);
+    let (k, table) = if fast {
+        print_fast(&opt.common);
+        (0, Vec::new())
+    } else {
+        let k = glz.k();
+        let table = glz.decode_table::<u32>()?;
+        print_k(&opt.common, k);
+        print_table(&opt.common, &table);
+        (k, table)
+    };
 
     // compress!
-    let (output, mut ranges) = with_prog_all(
-        "compressing...",
-        opt.common.quiet,
-        &paths,
-        &inputs.iter().map(|x| x.len()).collect::<Vec<_>>(),
-        |prog| {
-            glz.encode_all_with_prog(&inputs, prog)
+    glz.set_optimal(opt.optimal);
+    glz.set_seek(opt.common.seek);
+    let (output, mut ranges) = if let Some((_, dict, _)) = &dict {
+        if opt.jobs.is_some() {
+            bail!("can't compress in parallel with a dictionary, \
+                every input needs to be followed by the dictionary");
         }
-    )?;
 
-    // adjust offsets for start-of-table?
-    if !opt.common.no_table {
-        for (off, _) in ranges.iter_mut() {
-            *off += (1+GLZ::WIDTH) * table.len();
+        with_prog_all(
+            "compressing...",
+            opt.common.quiet,
+            &paths,
+            &inputs.iter().map(|x| x.len()).collect::<Vec<_>>(),
+            |prog| {
+                glz.encode_all_with_dict_and_prog(dict, &inputs, prog)
+            }
+        )?
+    } else if let Some(jobs) = opt.jobs {
+        with_prog(
+            "compressing...",
+            opt.common.quiet,
+            inputs.iter().map(|x| x.len()).sum(),
+            |prog| encode_all_par(&glz, jobs, &inputs, prog)
+        )?
+    } else {
+        with_prog_all(
+            "compressing...",
+            opt.common.quiet,
+            &paths,
+            &inputs.iter().map(|x| x.len()).collect::<Vec<_>>(),
+            |prog| {
+                glz.encode_all_with_prog(&inputs, prog)
+            }
+        )?
+    };
+
+    // our bits are prefixed with either the table, or with a dictionary,
+    // padding so our bits end on a byte boundary where the dictionary's
+    // bits will start
+    let prefix: BitVec = if dict.is_some() {
+        iter::repeat(false).take((8 - output.len()%8) % 8).collect()
+    } else if !opt.common.no_table && !fast {
+        (1+GLZ::WIDTH).encode(&table)?
+    } else {
+        BitVec::new()
+    };
+
+    // find checkpoints of each file, but not of archive names
+    let mut checkpoints: Vec<usize> = Vec::new();
+    if let Some(seek) = opt.common.seek {
+        if !opt.common.archive && !opt.common.index && paths.len() != 1 {
+            bail!("can't seek in multiple files without --index \
+                or --archive");
+        }
+        for (off, len) in &ranges[..paths.len()] {
+            checkpoints.extend(glz.checkpoints(&output, *off, *len, seek)?);
         }
     }
 
+    // adjust offsets for start-of-table?
+    for (off, _) in ranges.iter_mut() {
+        *off += prefix.len();
+    }
+    for off in checkpoints.iter_mut() {
+        *off += prefix.len();
+    }
+
     let files: Vec<(String, usize, usize)> = paths.iter()
         .zip(ranges.iter())
         .map(|(path, (poff, plen))| (
@@ -702,9 +1037,7 @@ fn encode(opt: &EncodeOpt) -> Result<()> {
             *plen
         ))
         .collect();
-    print_files(&opt.common, &files,
-        if !opt.common.no_table { (1+GLZ::WIDTH)*table.len() + output.len() }
-        else { output.len() });
+    print_files(&opt.common, &files, prefix.len() + output.len());
 
     let mut f = if let Some(ref outfile) = opt.output {
         EstimatorFile::Some(File::create(outfile)?)
@@ -737,38 +1070,37 @@ fn encode(opt: &EncodeOpt) -> Result<()> {
                 } 
             },
             TYPE_LEN => {
-                f.write_meta(&opt.common, flags, type_, k,
-                    if !opt.common.no_table {
-                        table.len() * (1+GLZ::WIDTH)
-                    } else {
-                        0
-                    })?;
+                f.write_meta(&opt.common, flags, type_, k, prefix.len())?;
                 f.write_size(flags, inputs.iter()
                     .map(|x| x.len())
                     .sum())?;
             },
             TYPE_NONE => {
-                f.write_meta(&opt.common, flags, type_, k,
-                    if !opt.common.no_table {
-                        table.len() * (1+GLZ::WIDTH)
-                    } else {
-                        0
-                    })?;
+                f.write_meta(&opt.common, flags, type_, k, prefix.len())?;
             },
             _ => {
                 bail!("unknown type {}?", type_);
             },
         }
-    }
 
-    if !opt.common.no_table {
-        f.write_bits(&(1+GLZ::WIDTH).encode(&table)?
-                .iter().chain(&output)
-                .collect::<BitVec>())?;
-    } else {
-        f.write_bits(&output)?;
+        // with a dictionary we also need to know where our bits end
+        if dict.is_some() {
+            f.write_size(flags, (prefix.len() + output.len()) / 8)?;
+        }
+
+        if let Some(seek) = opt.common.seek {
+            f.write_size(flags, seek)?;
+            f.write_size(flags, checkpoints.len())?;
+            for off in &checkpoints {
+                f.write_size(flags, *off)?;
+            }
+        }
     }
 
+    f.write_bits(&prefix.iter()
+        .chain(&output)
+        .collect::<BitVec>())?;
+
     let before = inputs[..paths.len()].iter().fold(0, |s, a| s+a.len());
     let after = f.len()?;
     println!("compressed {} -> {} ({}%) in ~{}",
@@ -839,12 +1171,52 @@ fn decode(opt: &DecodeOpt) -> Result<()> {
         }
     }
 
+    // compressed against a dictionary? our bits are followed by the
+    // dictionary's bits
+    let dict = match opt.dict {
+        Some(ref path) => Some(read_dict(path, &opt.common)?),
+        None => None,
+    };
+    let blob_size = if dict.is_some() && !opt.common.no_headers {
+        Some(f.read_size(flags)?)
+    } else {
+        None
+    };
+
+    // load checkpoints?
+    let mut seek: Option<(usize, Vec<usize>)> = None;
+    if flags & FLAG_SEEK != 0 && !opt.common.no_headers {
+        let interval = f.read_size(flags)?;
+        let count = f.read_size(flags)?;
+        let checkpoints = (0..count)
+            .map(|_| f.read_size(flags))
+            .collect::<Result<_>>()?;
+        seek = Some((interval, checkpoints));
+    }
+
     // load table/blob?
+    let fast = flags & FLAG_FAST != 0;
     let mut buf: Vec<u8> = Vec::new();
+    let dict_blob: BitVec;
     let table: Vec<u32>;
     let blob: &BitSlice;
     let off: usize;
-    if !opt.common.no_table {
+    if let Some((glz, _, bits)) = &dict {
+        f.read_to_end(&mut buf)?;
+        if let Some(blob_size) = blob_size {
+            buf.truncate(blob_size);
+        }
+        table = if fast { Vec::new() } else { glz.decode_table()? };
+        dict_blob = buf.as_bitslice().iter().chain(bits).collect();
+        blob = &dict_blob;
+        off = table_size.unwrap_or(0);
+    } else if fast {
+        // fast mode has no table
+        f.read_to_end(&mut buf)?;
+        table = Vec::new();
+        blob = buf.as_bitslice();
+        off = table_size.unwrap_or(0);
+    } else if !opt.common.no_table {
         let table_size = table_size.ok_or_else(|| "unknown table size?")?;
         f.read_to_end(&mut buf)?;
         table = (1+GLZ::WIDTH).decode(&buf.as_bitslice()[..table_size])?;
@@ -858,48 +1230,58 @@ fn decode(opt: &DecodeOpt) -> Result<()> {
     }
 
     // have everything we need?
-    let k = match (k, opt.common.k) {
-        (_, Some(k)) => k,
-        (Some(k), _) => k,
-        _ => bail!("unknown K, provide -K?"),
-    };
-    let table = match (&table, &opt.common.table) {
-        (_, table) if table.len() > 0 => table,
-        (table, _) if table.len() > 0 => table,
-        _ => bail!("unknown table, provide --table?"),
-    };
+    let glz = if fast {
+        print_fast(&opt.common);
+        let mut glz = GLZ::new();
+        glz.set_fast(true);
+        glz
+    } else {
+        let k = match (k, opt.common.k, &dict) {
+            (_, _, Some((glz, _, _))) => glz.k(),
+            (_, Some(k), _) => k,
+            (Some(k), _, _) => k,
+            _ => bail!("unknown K, provide -K?"),
+        };
+        let table = match (&table, &opt.common.table) {
+            (_, table) if table.len() > 0 => table,
+            (table, _) if table.len() > 0 => table,
+            _ => bail!("unknown table, provide --table?"),
+        };
 
-    print_k(&opt.common, k);
-    print_table(&opt.common, table);
-    let glz = GLZ::with_table(k, opt.common.l, opt.common.m, table);
+        print_k(&opt.common, k);
+        print_table(&opt.common, table);
+        GLZ::with_table(k, opt.common.l, opt.common.m, table)
+    };
 
     // lookup what we want to decompress
-    let (target_off, target_len): (usize, usize) = 'target: loop {
+    let (target_off, target_len, target_file)
+            : (usize, usize, Option<usize>) = 'target: loop {
         match (opt.off, opt.len, &opt.file, size) {
             (Some(off), Some(len), _, _) => {
-                break 'target (off, len);
+                break 'target (off, len, None);
             },
             (_, _, Some(file), _) => {
-                for ((poff, plen), (off, len)) in archive_files {
+                for (i, ((poff, plen), (off, len)))
+                        in archive_files.iter().enumerate() {
                     let name = String::from_utf8(
-                        glz.decode_at(&blob, poff, plen)?
+                        glz.decode_at(&blob, *poff, *plen)?
                     ).chain_err(|| "utf8 error in name field")?;
 
                     if &name == file {
-                        break 'target (off, len);
+                        break 'target (*off, *len, Some(i));
                     }
                 }
 
                 for (i, (off, len)) in index_files.iter().enumerate() {
                     if &format!("{}", i) == file {
-                        break 'target (*off, *len);
+                        break 'target (*off, *len, Some(i));
                     }
                 }
 
                 bail!("file {} not found?", file);
             },
             (_, _, _, Some(size)) => {
-                break 'target (off, size);
+                break 'target (off, size, Some(0));
             },
             _ => {
                 bail!("what am I decompressing? \
@@ -911,14 +1293,47 @@ fn decode(opt: &DecodeOpt) -> Result<()> {
         HumanBytes(target_off as u64),
         target_len);
 
+    // starting somewhere in the file? we can start at the closest
+    // checkpoint if we have any, but we still need to skip some bytes
+    let (target_off, target_skip, target_len) = match opt.at {
+        Some(at) => {
+            if at > target_len {
+                bail!("offset {} is past the end of the file ({})?",
+                    at, target_len);
+            }
+            let len = cmp::min(opt.len.unwrap_or(target_len), target_len-at);
+            match (&seek, target_file) {
+                (Some((interval, checkpoints)), Some(i)) => {
+                    // skip the checkpoints of files before us
+                    let lens: Vec<usize> = archive_files.iter()
+                        .map(|(_, (_, len))| *len)
+                        .chain(index_files.iter().map(|(_, len)| *len))
+                        .chain(size)
+                        .collect();
+                    let before: usize = lens[..i].iter()
+                        .map(|len| (cmp::max(*len, 1)-1) / interval)
+                        .sum();
+                    match at / interval {
+                        0 => (target_off, at, len),
+                        c => (checkpoints[before+c-1], at % interval, len),
+                    }
+                },
+                _ => (target_off, at, len),
+            }
+        },
+        None => (target_off, 0, target_len),
+    };
+
     let output: Vec<u8> = with_prog(
         "decompressing...",
         opt.common.quiet,
-        target_len,
+        target_skip + target_len,
         |prog| {
-            glz.decode_at_with_prog(blob, target_off, target_len, prog)
+            glz.decode_at_with_prog(blob,
+                target_off, target_skip + target_len, prog)
         }
     )?;
+    let output = &output[target_skip..];
 
     if let Some(ref outfile) = opt.output {
         fs::write(outfile, &output)?;
@@ -988,12 +1403,30 @@ fn ls(opt: &LsOpt) -> Result<()> {
         }
     }
 
+    // skip checkpoints
+    let mut seek: Option<(usize, usize)> = None;
+    if flags & FLAG_SEEK != 0 && !opt.common.no_headers {
+        let interval = f.read_size(flags)?;
+        let count = f.read_size(flags)?;
+        for _ in 0..count {
+            f.read_size(flags)?;
+        }
+        seek = Some((interval, count));
+    }
+
     // load table/blob?
+    let fast = flags & FLAG_FAST != 0;
     let mut buf: Vec<u8> = Vec::new();
     let table: Vec<u32>;
     let blob: &BitSlice;
     let off: usize;
-    if !opt.common.no_table {
+    if fast {
+        // fast mode has no table
+        f.read_to_end(&mut buf)?;
+        table = Vec::new();
+        blob = buf.as_bitslice();
+        off = table_size.unwrap_or(0);
+    } else if !opt.common.no_table {
         let table_size = table_size.ok_or_else(|| "unknown table size?")?;
         f.read_to_end(&mut buf)?;
         table = (1+GLZ::WIDTH).decode(&buf.as_bitslice()[..table_size])?;
@@ -1007,20 +1440,27 @@ fn ls(opt: &LsOpt) -> Result<()> {
     }
 
     // have everything we need?
-    let k = match (k, opt.common.k) {
-        (_, Some(k)) => k,
-        (Some(k), _) => k,
-        _ => bail!("unknown K, provide -K?"),
-    };
-    let table = match (&table, &opt.common.table) {
-        (_, table) if table.len() > 0 => table,
-        (table, _) if table.len() > 0 => table,
-        _ => bail!("unknown table, provide --table?"),
-    };
+    let glz = if fast {
+        print_fast(&opt.common);
+        let mut glz = GLZ::new();
+        glz.set_fast(true);
+        glz
+    } else {
+        let k = match (k, opt.common.k) {
+            (_, Some(k)) => k,
+            (Some(k), _) => k,
+            _ => bail!("unknown K, provide -K?"),
+        };
+        let table = match (&table, &opt.common.table) {
+            (_, table) if table.len() > 0 => table,
+            (table, _) if table.len() > 0 => table,
+            _ => bail!("unknown table, provide --table?"),
+        };
 
-    print_k(&opt.common, k);
-    print_table(&opt.common, table);
-    let glz = GLZ::with_table(k, opt.common.l, opt.common.m, table);
+        print_k(&opt.common, k);
+        print_table(&opt.common, table);
+        GLZ::with_table(k, opt.common.l, opt.common.m, table)
+    };
 
     // decompress path info
     let mut files: Vec<(String, usize, usize)> = Vec::new();
@@ -1043,6 +1483,9 @@ fn ls(opt: &LsOpt) -> Result<()> {
     }
 
     print_files(&opt.common, &files, blob.len());
+    if let Some((interval, count)) = seek {
+        println!("checkpoints: {} every {}", count, HumanBytes(interval as u64));
+    }
 
     let before: usize = files.iter().map(|(_, _, len)| len).sum();
     let after = EstimatorFile::Some(f).len()?;
@@ -1055,12 +1498,174 @@ fn ls(opt: &LsOpt) -> Result<()> {
     Ok(())
 }
 
+fn dict(opt: &DictOpt) -> Result<()> {
+    // time ourselves
+    let time = Instant::now();
+
+    // read all files into buffers
+    let paths: &[PathBuf] = &opt.encode.input;
+    let inputs: Vec<Vec<u8>> = paths.iter()
+        .map(|path| fs::read(path))
+        .collect::<io::Result<_>>()?;
+    let inputs: Vec<&[u8]> = inputs.iter()
+        .map(|data| data.as_slice())
+        .collect();
+
+    // get relevant options and defaults
+    let common = &opt.encode.common;
+    let l = common.l;
+    let m = common.m;
+
+    // find what our inputs have in common
+    let dict = GLZ::train(&inputs, opt.size);
+
+    // estimate k/table if necessary, note every input is compressed
+    // against the dictionary independently
+    let fast = common.mode == "fast";
+    if fast && opt.encode.optimal {
+        bail!("optimal parsing needs a Golomb-Rice table, \
+            can't use it with -m fast");
+    }
+    let mut glz = match (common.k, &common.table) {
+        _ if fast => {
+            // fast mode has no table
+            let mut glz = GLZ::new();
+            glz.set_fast(true);
+            glz
+        },
+        (k, table) if table.len() == 0 => {
+            let mut hist = Hist::new();
+            for _ in 0..common.passes {
+                let glz = GLZ::with_config(GLZ::DEFAULT_K, l, m);
+                let mut bits = vec![glz.encode_dict(&dict)?];
+                if let Some(jobs) = opt.encode.jobs {
+                    // inputs are already compressed independently here,
+                    // so this is the same as the serial pass
+                    bits.extend(par_map(jobs, &inputs, &mut |_| (),
+                        |input, _| {
+                            Ok(glz.encode_all_with_dict(&dict, &[*input])?.0)
+                        }
+                    )?);
+                } else {
+                    for input in &inputs {
+                        bits.push(
+                            glz.encode_all_with_dict(&dict, &[*input])?.0);
+                    }
+                }
+
+                hist = Hist::new();
+                for bits in &bits {
+                    glz.traverse_syms(bits, |op: u32| {
+                        hist.increment(op);
+                    })?;
+                }
+            }
+
+            if !common.quiet {
+                let mut hist = hist.clone();
+                hist.sort();
+                hist.draw(None);
+            }
+
+            if let Some(jobs) = opt.encode.jobs {
+                from_hist_par(jobs, k, l, m, &hist)?
+            } else {
+                GLZ::from_hist(k, l, m, &hist)
+            }
+        },
+        (Some(k), table) => {
+            GLZ::with_table(k, l, m, table)
+        },
+        _ => {
+            bail!("can't solve for just K, please provide --table");
+        }
+    };
+
+    let (k, table) = if fast {
+        print_fast(common);
+        (0, Vec::new())
+    } else {
+        let k = glz.k();
+        let table = glz.decode_table::<u32>()?;
+        print_k(common, k);
+        print_table(common, &table);
+        (k, table)
+    };
+
+    // compress the dictionary, and each input against the dictionary to
+    // see how much we've saved compared to compressing each input alone
+    glz.set_optimal(opt.encode.optimal);
+    let dict_bits = glz.encode_dict(&dict)?;
+    println!("files:");
+    let mut before = 0;
+    let mut alone = 0;
+    let mut after = 0;
+    for (path, input) in paths.iter().zip(&inputs) {
+        let mut input_glz = if fast {
+            glz.clone()
+        } else {
+            GLZ::from_seed(None, l, m, input.iter().copied())
+        };
+        input_glz.set_optimal(opt.encode.optimal);
+        let input_table = if fast {
+            0
+        } else {
+            input_glz.decode_table::<u32>()?.len()
+        };
+        let input_alone = ((1+GLZ::WIDTH)*input_table
+            + input_glz.encode_all(&[*input])?.0.len() + 8-1) / 8;
+        let input_after = (glz.encode_all_with_dict(&dict, &[*input])?.0.len()
+            + 8-1) / 8;
+        println!("{:>8} {} -> {} alone, {} with dict",
+            format!("{}", HumanBytes(input.len() as u64)),
+            path.to_string_lossy(),
+            HumanBytes(input_alone as u64),
+            HumanBytes(input_after as u64));
+        before += input.len();
+        alone += input_alone;
+        after += input_after;
+    }
+
+    let mut f = if let Some(ref outfile) = opt.encode.output {
+        EstimatorFile::Some(File::create(outfile)?)
+    } else {
+        EstimatorFile::None(0)
+    };
+
+    // dictionaries are just compressed files, but the table is padded so
+    // the dictionary's bits start on a byte boundary
+    let flags = mkflags(common, 0);
+    if !common.no_headers {
+        f.write_meta(common, flags, TYPE_LEN, k,
+            table.len() * (1+GLZ::WIDTH))?;
+        f.write_size(flags, dict.len())?;
+    }
+    f.write_bits(&(1+GLZ::WIDTH).encode(&table)?)?;
+    f.write_bits(&dict_bits)?;
+
+    let dict_after = f.len()? as usize;
+    println!("dictionary {} -> {}",
+        HumanBytes(dict.len() as u64),
+        HumanBytes(dict_after as u64));
+    println!("compressed {} -> {} alone, {} + {} with dict ({}%) in ~{}",
+        HumanBytes(before as u64),
+        HumanBytes(alone as u64),
+        HumanBytes(after as u64),
+        HumanBytes(dict_after as u64),
+        (100*(alone as i32 - (after+dict_after) as i32)) / alone as i32,
+        HumanDuration(time.elapsed())
+    );
+
+    Ok(())
+}
+
 // Entry point
 fn main() {
     let err: Result<()> = match Opt::from_args() {
         Opt::Encode{encode: ref opt} => encode(opt),
         Opt::Decode{decode: ref opt} => decode(opt),
         Opt::Ls    {ls:     ref opt} => ls    (opt),
+        Opt::Dict  {dict:   ref opt} => dict  (opt),
     };
 
     if let Err(ref e) = err {
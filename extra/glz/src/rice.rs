@@ -6,6 +6,7 @@
 //!
 
 use std::iter;
+use std::ops::RangeInclusive;
 
 use crate::bits::*;
 use crate::errors::*;
@@ -27,21 +28,29 @@ impl GolombRice {
         // find best k from our histogram, this
         // assumes the histogram will be used with
         // the Golomb Rice encoding in a BijectEncoderr
+        let k = Self::candidates(hist).map(|k| {
+            (Self::new(k).cost(hist), k)
+        }).min().unwrap().1;
+
+        Self::new(k)
+    }
+
+    // k values worth trying for a histogram, larger k can't do better
+    // than encoding every symbol in the same number of bits
+    pub fn candidates(hist: &Hist) -> RangeInclusive<usize> {
         let bound = hist.bound() as u32;
         if bound == 0 {
-            return Self::new(0);
+            return 0..=0;
         }
 
-        let bound = 32 - (bound-1).leading_zeros();
-        let k = (0..=bound as usize).map(|k| {
-            let gr = Self::new(k);
-            let size: usize = hist.iter::<u32>().map(|(n, c)| {
-                c * gr.encode_sym(n).unwrap().len()
-            }).sum();
-            (size, k)
-        }).min().unwrap().1;
+        0..=(32 - (bound-1).leading_zeros()) as usize
+    }
 
-        Self::new(k)
+    // size in bits of every symbol in a histogram
+    pub fn cost(&self, hist: &Hist) -> usize {
+        hist.iter::<u32>().map(|(n, c)| {
+            c * self.encode_sym(n).unwrap().len()
+        }).sum()
     }
 
     pub fn from_seed<I: IntoIterator<Item=U>, U: Sym>(seed: I) -> Self {
@@ -40,27 +40,30 @@ fn cli_encode_decode_test() -> Result<(), Box<dyn error::Error>> {
         .collect();
     paths.sort();
 
-    for (path_txt, path_glz, path_out) in &paths {
-        let path_txt = path_txt.to_str().unwrap();
-        let path_glz = path_glz.to_str().unwrap();
-        let path_out = path_out.to_str().unwrap();
+    // in both compact and fast mode
+    for mode in &["compact", "fast"] {
+        for (path_txt, path_glz, path_out) in &paths {
+            let path_txt = path_txt.to_str().unwrap();
+            let path_glz = path_glz.to_str().unwrap();
+            let path_out = path_out.to_str().unwrap();
 
-        let status = process::Command::new("./target/debug/glz")
-            .args(&["encode", "-q", path_txt, "-o", path_glz])
-            .status()?;
-        assert!(status.success());
-        let status = process::Command::new("./target/debug/glz")
-            .args(&["ls", "-q", path_glz])
-            .status()?;
-        assert!(status.success());
-        let status = process::Command::new("./target/debug/glz")
-            .args(&["decode", "-q", path_glz, "-o", path_out])
-            .status()?;
-        assert!(status.success());
-        let status = process::Command::new("diff")
-            .args(&["-q", "-s", path_txt, path_out])
-            .status()?;
-        assert!(status.success());
+            let status = process::Command::new("./target/debug/glz")
+                .args(&["encode", "-q", "-m", mode, path_txt, "-o", path_glz])
+                .status()?;
+            assert!(status.success());
+            let status = process::Command::new("./target/debug/glz")
+                .args(&["ls", "-q", path_glz])
+                .status()?;
+            assert!(status.success());
+            let status = process::Command::new("./target/debug/glz")
+                .args(&["decode", "-q", path_glz, "-o", path_out])
+                .status()?;
+            assert!(status.success());
+            let status = process::Command::new("diff")
+                .args(&["-q", "-s", path_txt, path_out])
+                .status()?;
+            assert!(status.success());
+        }
     }
     Ok(())
 }
@@ -247,3 +250,50 @@ fn cli_example_decoders_test() -> Result<(), Box<dyn error::Error>> {
 
     Ok(())
 }
+
+#[test]
+#[serial]
+fn cli_encode_decode_jobs_test() -> Result<(), Box<dyn error::Error>> {
+    // with -j each input is compressed independently, so a slice of
+    // another input can't reuse that input's history, give it one
+    let data = fs::read("./examples/data3.txt")?;
+    fs::create_dir_all("./target/jobs")?;
+    fs::write("./target/jobs/tail.txt", &data[data.len()/2..])?;
+    let paths = ["./examples/data3.txt", "./target/jobs/tail.txt"];
+
+    let mut outputs = Vec::new();
+    for jobs in &[None, Some("1"), Some("4")] {
+        let path_glz = format!("./target/jobs/j{}.glz", jobs.unwrap_or(""));
+        let mut args = vec!["encode", "-q", "-I"];
+        if let Some(jobs) = jobs {
+            args.extend(&["-j", jobs]);
+        }
+        args.extend(&paths);
+        args.extend(&["-o", &path_glz]);
+        let status = process::Command::new("./target/debug/glz")
+            .args(&args)
+            .status()?;
+        assert!(status.success());
+
+        for (i, path_txt) in paths.iter().enumerate() {
+            let path_out = format!("./target/jobs/{}.out", i);
+            let status = process::Command::new("./target/debug/glz")
+                .args(&["decode", "-q", "-f", &i.to_string(), &path_glz,
+                    "-o", &path_out])
+                .status()?;
+            assert!(status.success());
+            let status = process::Command::new("diff")
+                .args(&["-q", "-s", path_txt, &path_out])
+                .status()?;
+            assert!(status.success());
+        }
+
+        outputs.push(fs::read(&path_glz)?);
+    }
+
+    // the output doesn't depend on the number of jobs, but it does differ
+    // from the serial output, which can share history between inputs
+    assert!(outputs[1] == outputs[2]);
+    assert!(outputs[0].len() < outputs[1].len());
+    Ok(())
+}
@@ -0,0 +1,387 @@
+#!/usr/bin/env python3
+#
+# Host harness for prefetching in the bd loader
+#
+# Generates a host project where the sys alternates between two boxes,
+# one that only computes, and one that is loaded from a slow block
+# device simulated in the sys with a thread. Measures how long it takes
+# to get through the first box's work and a call into the second box,
+# first loading the second box on demand, then prefetching it while the
+# first box runs. Prefetching is checked for correctness in
+# tests/test_loaders.py, this only measures. Run directly:
+#
+#   python3 tests/bd_prefetch.py
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import argparse
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+from bento.box import Box
+
+RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2007ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+export.__box_box2_bdread = 'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'
+export.__box_box2_bdread_async = 'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'
+import.__box_box2_bdread_done = 'fn(err err) -> void'
+
+import.box1_work = 'fn(u32 x) -> u32'
+import.box2_sum = 'fn() -> u32'
+
+[box.box1]
+runtime = 'host'
+memory.flash = 'rxp 0x4000'
+memory.ram = 'rw 0x4000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box1_work = 'fn(u32 x) -> u32'
+
+[box.box2]
+runtime = 'host'
+loader.loader = 'bd'
+loader.bd.region = '0x00000000-0x000fffff'
+loader.bd.block_size = %(block_size)d
+loader.bd.prefetch = true
+memory.text = 'rwx %(text_size)#x'
+memory.ram = 'rw 0x4000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box2_sum = 'fn() -> u32'
+"""
+
+SYS_MAIN = """
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bb.h"
+
+// simulated slow block device, backed by an image in memory, every
+// read takes a fixed latency
+static uint8_t *image;
+static size_t image_size;
+static uint32_t reads;
+
+static int bdread(uint32_t block, uint32_t off, void *buffer, size_t size) {
+    size_t addr = (size_t)block*%(block_size)d + off;
+    if (addr + size > image_size) {
+        return -EINVAL;
+    }
+
+    usleep(%(latency)d);
+    memcpy(buffer, &image[addr], size);
+    reads += 1;
+    return 0;
+}
+
+int __box_box2_bdread(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    return bdread(block, off, buffer, size);
+}
+
+// asynchronous reads are served by a thread, standing in for DMA
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static struct {
+    bool busy;
+    uint32_t block;
+    uint32_t off;
+    void *buffer;
+    size_t size;
+} request;
+
+static void *bdthread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (!request.busy) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        pthread_mutex_unlock(&lock);
+
+        int err = bdread(request.block, request.off,
+                request.buffer, request.size);
+
+        pthread_mutex_lock(&lock);
+        request.busy = false;
+        pthread_mutex_unlock(&lock);
+        __box_box2_bdread_done(err);
+        pthread_mutex_lock(&lock);
+    }
+    return NULL;
+}
+
+int __box_box2_bdread_async(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    pthread_mutex_lock(&lock);
+    if (request.busy) {
+        pthread_mutex_unlock(&lock);
+        return -EBUSY;
+    }
+    request.block = block;
+    request.off = off;
+    request.buffer = buffer;
+    request.size = size;
+    request.busy = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+static uint32_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static int run(const char *name, bool prefetch) {
+    uint32_t before = reads;
+    uint32_t start = now();
+    if (prefetch) {
+        int err = __box_box2_prefetch();
+        if (err) {
+            printf("prefetch failed %%d\\n", err);
+            return -1;
+        }
+    }
+
+    // box1 does its work in steps, polling between steps like an
+    // idle loop would
+    for (uint32_t i = 0; i < %(steps)d; i++) {
+        box1_work(%(work)d);
+        if (prefetch) {
+            int err = __box_box2_load_poll();
+            if (err && err != -EAGAIN) {
+                printf("load_poll failed %%d\\n", err);
+                return -1;
+            }
+        }
+    }
+
+    uint32_t sum = box2_sum();
+    uint32_t latency = now() - start;
+    if (sum != %(expected)uU) {
+        printf("%%s: sum = %%u, expected %%u\\n", name, sum, %(expected)uU);
+        return -1;
+    }
+
+    printf("reads %%s %%u\\n", name, reads - before);
+    printf("latency %%s %%u\\n", name, latency);
+    return __box_box2_clobber();
+}
+
+int main(int argc, char **argv) {
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        printf("can't open %%s\\n", argv[1]);
+        return 1;
+    }
+    image = malloc(0x100000);
+    image_size = fread(image, 1, 0x100000, f);
+    fclose(f);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, bdthread, NULL);
+
+    int err = __box_box1_init();
+    if (err) {
+        printf("init failed %%d\\n", err);
+        return 1;
+    }
+
+    if (run("demand", false) || run("prefetch", true)) {
+        return 1;
+    }
+
+    return 0;
+}
+"""
+
+BOX1_MAIN = """
+#include "bb.h"
+
+uint32_t box1_work(uint32_t x) {
+    uint32_t h = 0;
+    for (uint32_t i = 0; i < x; i++) {
+        h = (h ^ i) * 0x01000193;
+        __asm__ volatile ("" : "+r"(h));
+    }
+    return h;
+}
+"""
+
+BOX2_MAIN = """
+#include "bb.h"
+
+static const uint32_t table[%(n)d] = {
+%(table)s
+};
+
+uint32_t box2_sum(void) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < %(n)d; i++) {
+        sum += table[i];
+    }
+    return sum;
+}
+"""
+
+def generate(path, args):
+    """
+    Generate and write out the prefetch project into path, returning
+    the box so we know where its memories ended up.
+    """
+    # a table that takes up most of box2's text, so there's something
+    # to load
+    n = (args.size - 0x2000) // 4
+    table = [(i * 2654435761) & 0xffffffff for i in range(n)]
+
+    for name in ['box1', 'box2']:
+        os.makedirs(os.path.join(path, name), exist_ok=True)
+    with open(os.path.join(path, 'recipe.toml'), 'w') as f:
+        f.write(RECIPE.lstrip() % dict(
+            block_size=args.block_size,
+            text_size=args.size))
+    with open(os.path.join(path, 'main.c'), 'w') as f:
+        f.write(SYS_MAIN.lstrip() % dict(
+            block_size=args.block_size,
+            latency=args.latency,
+            steps=args.steps,
+            work=args.work,
+            expected=sum(table) & 0xffffffff))
+    with open(os.path.join(path, 'box1', 'main.c'), 'w') as f:
+        f.write(BOX1_MAIN.lstrip())
+    with open(os.path.join(path, 'box2', 'main.c'), 'w') as f:
+        f.write(BOX2_MAIN.lstrip() % dict(
+            n=n,
+            table='\n'.join('    %#010x,' % x for x in table)))
+
+    box = Box.scan(path=path)
+    box.box()
+    box.link()
+    box.build()
+
+    def outputwrite(box):
+        for output in box.outputs:
+            with open(output.path, 'w') as outf:
+                outf.write(output.getvalue())
+        for child in box.boxes:
+            outputwrite(child)
+    outputwrite(box)
+    return next(child for child in box.boxes if child.name == 'box2')
+
+def segments(path):
+    """
+    Yield (addr, data) for each loadable segment in an ELF64 file.
+    """
+    with open(path, 'rb') as f:
+        elf = f.read()
+    phoff, = struct.unpack_from('<Q', elf, 0x20)
+    phentsize, phnum = struct.unpack_from('<HH', elf, 0x36)
+    for i in range(phnum):
+        type_, _, off, addr, _, filesz, _, _ = struct.unpack_from(
+            '<IIQQQQQQ', elf, phoff + i*phentsize)
+        if type_ == 1 and filesz:
+            yield addr, elf[off:off+filesz]
+
+def image(box, elf, block_size):
+    """
+    Build the block device image, this is the multi-region image of the
+    box's memories.
+    """
+    memories = {}
+    for memory in box.memories:
+        memories[memory.name] = bytearray(memory.size)
+    for addr, data in segments(elf):
+        for memory in box.memories:
+            if addr >= memory.addr and addr < memory.addr + memory.size:
+                off = addr - memory.addr
+                memories[memory.name][off:off+len(data)] = data
+
+    loaded = [memory for memory in box.memoryslices if 'w' in memory.mode]
+    image = bytearray()
+    image += struct.pack('<I', len(loaded))
+    for memory in loaded:
+        image += struct.pack('<I', memory.size)
+    for memory in loaded:
+        image += memories[memory.name]
+    # reads may be buffered up to the end of a block
+    image += bytes(-len(image) % block_size)
+    return image
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Measure prefetching in the bd loader on the host.")
+    parser.add_argument('--size', type=lambda x: int(x, 0), default=0x18000,
+        help="Size of the box's text, most of which is a table the box "
+            "reads. Defaults to 0x18000.")
+    parser.add_argument('--block_size', type=int, default=4096,
+        help="Block size of the simulated block device. Defaults to 4096.")
+    parser.add_argument('--latency', type=int, default=1000,
+        help="Latency of each read in microseconds. Defaults to 1000.")
+    parser.add_argument('--steps', type=int, default=50,
+        help="Number of steps of work before calling the loaded box. "
+            "Defaults to 50.")
+    parser.add_argument('--work', type=int, default=200000,
+        help="Iterations of work in each step. Defaults to 200000.")
+    parser.add_argument('-k', '--keep',
+        help="Keep the generated project in this directory.")
+    args = parser.parse_args()
+
+    dir = args.keep or tempfile.mkdtemp(prefix='bento-prefetch-')
+    try:
+        box = generate(dir, args)
+        subprocess.check_call(['make', '-C', dir, '-j', '-s'],
+            stdout=subprocess.DEVNULL)
+        with open(os.path.join(dir, 'box2.img'), 'wb') as f:
+            f.write(image(box, os.path.join(dir, 'box2', 'box2.elf'),
+                args.block_size))
+
+        proc = subprocess.run(
+            [os.path.join(dir, 'sys.elf'), os.path.join(dir, 'box2.img')],
+            stdout=subprocess.PIPE, universal_newlines=True)
+    finally:
+        if not args.keep:
+            shutil.rmtree(dir)
+    print(proc.stdout, end='')
+    assert proc.returncode == 0, "exited with %d" % proc.returncode
+
+    latency = {m.group(1): int(m.group(2))
+        for m in re.finditer(r'^latency (\w+) (\d+)$', proc.stdout, re.M)}
+    # the reads overlap with box1's work
+    assert latency['prefetch'] < latency['demand'], (
+        "prefetch latency %dus >= demand latency %dus" % (
+            latency['prefetch'], latency['demand']))
+    print('ok, %.1fx' % (latency['demand'] / latency['prefetch']))
+
+if __name__ == "__main__":
+    main()
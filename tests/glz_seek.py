@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+#
+# Host harness for the glz loader's compressed assets
+#
+# Generates a host project with a box that keeps a font-like table in its
+# compressed assets, for a few checkpoint intervals. Measures how long it
+# takes the sys to read random slices of the assets compared to
+# decompressing all of them. The same project is checked for correctness
+# in tests/test_loaders.py, this only measures. Needs the glz
+# command-line tool, see extra/glz. Run directly:
+#
+#   python3 tests/glz_seek.py --glz extra/glz/target/release/glz
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+from bento.box import Box
+
+RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2007ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+import.box1_glyphsum = 'fn(u32) -> u32'
+
+[box.box1]
+runtime = 'host'
+loader.loader = 'glz'
+loader.glz.glz = '%(glz)s'
+loader.glz.glz_flags = ['-m %(mode)s']
+loader.glz.decoder = '%(decoder)s'
+loader.glz.assets = true
+loader.glz.seek = %(seek)d
+memory.flash = 'rp 0x10000'
+memory.ram   = 'rwx 0x4000'
+stack = 0x800
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box1_glyphsum = 'fn(u32) -> u32'
+"""
+
+# glyphs of 8x8 pixels, so there's something to compress
+ASSET = """
+static uint8_t asset(uint32_t i) {
+    uint32_t glyph = i / 64;
+    uint32_t row = (i / 8) %% 8;
+    uint32_t col = i %% 8;
+    uint32_t x = (glyph * 2654435761u) >> (row + col);
+    return ((x & 0x7) == 0 ? 0xff : 0x00)
+        ^ ((row == 0 || row == 7) ? 0 : (uint8_t)(col * 31));
+}
+"""
+
+def asset(i):
+    glyph = i // 64
+    row = (i // 8) % 8
+    col = i % 8
+    x = ((glyph * 2654435761) & 0xffffffff) >> (row + col)
+    return ((0xff if x & 0x7 == 0 else 0x00)
+        ^ (0 if row == 0 or row == 7 else (col * 31) & 0xff))
+
+SYS_MAIN = """
+#include <stdio.h>
+#include <time.h>
+#include "bb.h"
+
+#define SIZE %(size)d
+#define READS 1000
+#define READ_SIZE %(read_size)d
+%(asset)s
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+static uint8_t buffer[SIZE];
+
+static int check(uint32_t off, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        if (buffer[i] != asset(off+i)) {
+            printf("mismatch at %%u\\n", off+i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    // the box reads its own assets
+    for (uint32_t glyph = 0; glyph < SIZE/64; glyph += 37) {
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < 64; i++) {
+            sum += asset(64*glyph + i);
+        }
+        if (box1_glyphsum(glyph) != sum) {
+            printf("box1_glyphsum(%%u) failed\\n", glyph);
+            return 1;
+        }
+    }
+
+    // decompress everything
+    uint64_t full = -1;
+    for (int i = 0; i < 10; i++) {
+        uint64_t start = now();
+        int err = __box_box1_read_compressed(0, buffer, SIZE);
+        uint64_t time = now() - start;
+        full = time < full ? time : full;
+        if (err || check(0, SIZE)) {
+            printf("full read failed %%d\\n", err);
+            return 1;
+        }
+    }
+
+    // decompress random slices
+    uint64_t random = 0;
+    uint32_t seed = 1;
+    for (int i = 0; i < READS; i++) {
+        seed = seed*1103515245 + 12345;
+        uint32_t off = (seed >> 8) %% (SIZE - READ_SIZE);
+        uint64_t start = now();
+        int err = __box_box1_read_compressed(off, buffer, READ_SIZE);
+        random += now() - start;
+        if (err || check(off, READ_SIZE)) {
+            printf("read at %%u failed %%d\\n", off, err);
+            return 1;
+        }
+    }
+
+    // and reads that are out of bounds
+    if (__box_box1_read_compressed(SIZE-1, buffer, 2) != -EINVAL) {
+        printf("out of bounds read succeeded\\n");
+        return 1;
+    }
+
+    printf("full %%u\\n", (uint32_t)full);
+    printf("random %%u\\n", (uint32_t)(random / READS));
+    printf("ok\\n");
+    return 0;
+}
+"""
+
+BOX_MAIN = """
+#include "bb.h"
+
+__attribute__((section(".assets")))
+static const uint8_t font[%(size)d] = {
+%(table)s
+};
+
+uint32_t box1_glyphsum(uint32_t glyph) {
+    uint8_t buffer[64];
+    int err = __box_box1_read_compressed((uint32_t)(uintptr_t)&font[64*glyph],
+            buffer, sizeof(buffer));
+    if (err) {
+        return 0;
+    }
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < sizeof(buffer); i++) {
+        sum += buffer[i];
+    }
+    return sum;
+}
+"""
+
+def generate(path, seek, args):
+    """
+    Generate and write out the project into path.
+    """
+    os.makedirs(os.path.join(path, 'box1'), exist_ok=True)
+    with open(os.path.join(path, 'recipe.toml'), 'w') as f:
+        f.write(RECIPE.lstrip() % dict(
+            glz=os.path.abspath(args.glz) if os.path.dirname(args.glz)
+                else args.glz,
+            mode=args.mode,
+            decoder=args.decoder,
+            seek=seek))
+    with open(os.path.join(path, 'main.c'), 'w') as f:
+        f.write(SYS_MAIN.lstrip() % dict(
+            size=args.size,
+            read_size=args.read_size,
+            asset=ASSET % dict()))
+    with open(os.path.join(path, 'box1', 'main.c'), 'w') as f:
+        table = [asset(i) for i in range(args.size)]
+        f.write(BOX_MAIN.lstrip() % dict(
+            size=args.size,
+            table='\n'.join('    %s' % ' '.join(
+                    '%#04x,' % x for x in table[i:i+8])
+                for i in range(0, len(table), 8))))
+
+    box = Box.scan(path=path)
+    box.box()
+    box.link()
+    box.build()
+
+    def outputwrite(box):
+        for output in box.outputs:
+            with open(output.path, 'w') as outf:
+                outf.write(output.getvalue())
+        for child in box.boxes:
+            outputwrite(child)
+    outputwrite(box)
+
+def sections(path):
+    """
+    Yield (name, size) for each allocated section in an ELF64 file.
+    """
+    with open(path, 'rb') as f:
+        elf = f.read()
+    shoff, = struct.unpack_from('<Q', elf, 0x28)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x3a)
+    headers = [struct.unpack_from('<IIQQQQ', elf, shoff + i*shentsize)
+        for i in range(shnum)]
+    strtab = headers[shstrndx][4]
+    for name, _, flags, _, _, size in headers:
+        # SHF_ALLOC
+        if flags & 0x2 and size:
+            name = elf[strtab+name:elf.index(b'\0', strtab+name)]
+            yield name.decode(), size
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Measure random reads of compressed assets against "
+            "decompressing all of them on the host.")
+    parser.add_argument('--glz', default='glz',
+        help="Path to the glz command-line tool. Defaults to glz.")
+    parser.add_argument('--decoder', choices=['bit', 'word'], default='bit',
+        help="GLZ decoder to read the assets with. Defaults to bit.")
+    parser.add_argument('-m', '--mode', choices=['compact', 'fast'],
+        default='compact',
+        help="GLZ mode to compress the assets with, fast mode has its own "
+            "decoder. Defaults to compact.")
+    parser.add_argument('--seek', type=lambda x: int(x, 0), action='append',
+        help="Checkpoint intervals to compare. Defaults to 64, 256, "
+            "and 1024.")
+    parser.add_argument('--size', type=lambda x: int(x, 0), default=0x8000,
+        help="Size of the assets in bytes. Defaults to 0x8000.")
+    parser.add_argument('--read-size', type=lambda x: int(x, 0), default=64,
+        help="Size of the random reads in bytes. Defaults to 64.")
+    parser.add_argument('-k', '--keep',
+        help="Keep the generated projects in this directory.")
+    args = parser.parse_args()
+    seeks = args.seek or [64, 256, 1024]
+
+    dir = args.keep or tempfile.mkdtemp(prefix='bento-glzseek-')
+    try:
+        results = []
+        for seek in seeks:
+            path = os.path.join(dir, 'seek%d' % seek)
+            generate(path, seek, args)
+            subprocess.check_call(['make', '-C', path, '-j', '-s'],
+                stdout=subprocess.DEVNULL)
+
+            proc = subprocess.run([os.path.join(path, 'sys.elf')],
+                stdout=subprocess.PIPE, universal_newlines=True)
+            assert proc.returncode == 0, "exited with %d:\n%s" % (
+                proc.returncode, proc.stdout)
+            assert proc.stdout.endswith('ok\n'), proc.stdout
+            times = dict(line.split() for line in proc.stdout.splitlines()
+                if len(line.split()) == 2)
+
+            # the blob is the box's only section
+            blob = sum(size
+                for section, size in sections(os.path.join(path, 'sys.elf'))
+                if section.startswith('.box.box1.'))
+            results.append((seek, blob, int(times['full']),
+                int(times['random'])))
+
+        # compare against the same images compressed without checkpoints
+        path = os.path.join(dir, 'seek%d' % seeks[0], 'box1')
+        images = ['box1.box.ram', 'box1.box.assets']
+        subprocess.check_call(['make', '-C', path, '-s'] + images,
+            stdout=subprocess.DEVNULL)
+        subprocess.check_call([args.glz, 'encode', '-q', '-n', '-I',
+                '-m', args.mode]
+            + images + ['-o', 'noseek.glz'],
+            cwd=path, stdout=subprocess.DEVNULL)
+        noseek = os.path.getsize(os.path.join(path, 'noseek.glz'))
+    finally:
+        if not args.keep:
+            shutil.rmtree(dir)
+
+    print('%d bytes of assets, %d byte reads, %s decoder' % (
+        args.size, args.read_size,
+        'fast' if args.mode == 'fast' else args.decoder))
+    print('%-8s %10s %12s %12s %8s' % (
+        'seek', 'blob', 'full (ns)', 'read (ns)', 'speedup'))
+    print('%-8s %10d %12s %12s %8s' % ('none', noseek, '-', '-', '-'))
+    for seek, blob, full, random in results:
+        print('%-8d %10d %12d %12d %7.1fx' % (
+            seek, blob, full, random, full / max(random, 1)))
+
+    for seek, _, full, random in results:
+        assert random < full, (
+            "seek %d: read %d >= full %d" % (seek, random, full))
+    print('ok')
+
+if __name__ == "__main__":
+    main()
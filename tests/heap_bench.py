@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+#
+# Host benchmark for the wasm heap allocators
+#
+# Builds each allocator in bento/glue/heap_glue.py against a fake wasm
+# memory on the host and measures malloc/free/realloc latency under a
+# churn of small allocations. The allocators are checked for correctness
+# with the same churn in tests/test_heap.py, this only measures. Run
+# directly:
+#
+#   python3 tests/heap_bench.py
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+from bento.glue import heap_glue
+
+PRELUDE = """
+#define _POSIX_C_SOURCE 199309L
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+
+// wasm32 words, the heaps rely on the sign bit of 32-bit words
+#define ssize_t int32_t
+
+// fake wasm memory, the heap is allocated at the end
+static uint8_t __bench_memory[%(memory_size)d]
+    __attribute__((aligned(64*1024)));
+#define __builtin_wasm_memory_size(i) \\
+    (((uintptr_t)__bench_memory + sizeof(__bench_memory)) / (64*1024))
+
+static void __box_abort(int err) {
+    fprintf(stderr, "heap corrupted (%%d)\\n", err);
+    exit(2);
+}
+"""
+
+DRIVER = """
+#define LIVE %(live)d
+
+static uint64_t now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+}
+
+static uint32_t xorshift(uint32_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+// mostly small allocations, similar to a CBOR parser
+static size_t size(uint32_t *x) {
+    uint32_t r = xorshift(x) %% 100;
+    if (r < 70) {
+        return 4 + xorshift(x) %% 29;
+    } else if (r < 95) {
+        return 33 + xorshift(x) %% 224;
+    } else {
+        return 257 + xorshift(x) %% 768;
+    }
+}
+
+struct stat {
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+};
+
+static void record(struct stat *s, uint64_t t) {
+    s->count += 1;
+    s->total += t;
+    s->max = t > s->max ? t : s->max;
+}
+
+static void check(uint8_t *p, size_t n, uint8_t tag) {
+    if (n && (p[0] != tag || p[n-1] != tag)) {
+        fprintf(stderr, "allocation corrupted\\n");
+        exit(2);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint8_t *ptrs[LIVE] = {NULL};
+    size_t sizes[LIVE] = {0};
+    struct stat malloc_ = {0}, free_ = {0}, realloc_ = {0};
+    uint64_t failed = 0;
+    uint32_t x = 0x2545f491;
+
+    for (long i = 0; i < %(iterations)d; i++) {
+        uint32_t slot = xorshift(&x) %% LIVE;
+        uint8_t tag = (uint8_t)slot;
+        uint32_t op = xorshift(&x) %% 4;
+
+        if (!ptrs[slot]) {
+            size_t n = size(&x);
+            uint64_t t = now();
+            uint8_t *p = __wrap_malloc(n);
+            record(&malloc_, now() - t);
+            if (!p) {
+                failed += 1;
+                continue;
+            }
+            memset(p, tag, n);
+            ptrs[slot] = p;
+            sizes[slot] = n;
+        } else if (op == 0) {
+            size_t n = size(&x);
+            check(ptrs[slot], sizes[slot], tag);
+            uint64_t t = now();
+            uint8_t *p = __wrap_realloc(ptrs[slot], n);
+            record(&realloc_, now() - t);
+            if (!p) {
+                failed += 1;
+                continue;
+            }
+            check(p, n < sizes[slot] ? n : sizes[slot], tag);
+            memset(p, tag, n);
+            ptrs[slot] = p;
+            sizes[slot] = n;
+        } else {
+            check(ptrs[slot], sizes[slot], tag);
+            uint64_t t = now();
+            __wrap_free(ptrs[slot]);
+            record(&free_, now() - t);
+            ptrs[slot] = NULL;
+        }
+    }
+
+    struct stat *stats[3] = {&malloc_, &free_, &realloc_};
+    for (int i = 0; i < 3; i++) {
+        printf("%%.1f %%llu ",
+            stats[i]->count
+                ? (double)stats[i]->total / stats[i]->count
+                : 0.0,
+            (unsigned long long)stats[i]->max);
+    }
+    printf("%%llu\\n", (unsigned long long)failed);
+    return 0;
+}
+"""
+
+ALLOCATORS = {
+    'linear': heap_glue.REPLACE_ME_HEAP,
+    'tlsf': heap_glue.TLSF_HEAP,
+}
+
+def bench(allocator, args, dir):
+    src = os.path.join(dir, '%s.c' % allocator)
+    exe = os.path.join(dir, allocator)
+    with open(src, 'w') as f:
+        f.write(PRELUDE % dict(
+            memory_size=(args.heap_size + 0xffff) & ~0xffff))
+        f.write(ALLOCATORS[allocator] % dict(
+            heap_size=args.heap_size,
+            heap_fl_count=max(1,
+                max(args.heap_size//4 - 2, 0).bit_length() - 2 + 1)))
+        f.write(DRIVER % dict(
+            live=args.live,
+            iterations=args.iterations))
+
+    subprocess.check_call([args.cc, '-O2', '-w', src, '-o', exe])
+    out = subprocess.check_output([exe]).decode().split()
+    return [float(x) for x in out]
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare wasm heap allocator latency on the host.")
+    parser.add_argument('--heap_size', type=lambda x: int(x, 0),
+        default=0x8000,
+        help="Size of the heap in bytes. Defaults to 0x8000.")
+    parser.add_argument('--live', type=int, default=128,
+        help="Maximum number of live allocations. Defaults to 128.")
+    parser.add_argument('-n', '--iterations', type=int, default=1000000,
+        help="Number of operations. Defaults to 1000000.")
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'),
+        help="Host C compiler. Defaults to $CC or cc.")
+    parser.add_argument('--allocator', action='append',
+        choices=list(ALLOCATORS),
+        help="Allocators to benchmark. Defaults to all.")
+    args = parser.parse_args()
+
+    print('%-8s %16s %16s %16s %8s' % (
+        'heap', 'malloc ns', 'free ns', 'realloc ns', 'failed'))
+    with tempfile.TemporaryDirectory() as dir:
+        for allocator in args.allocator or ALLOCATORS:
+            r = bench(allocator, args, dir)
+            print('%-8s %16s %16s %16s %8d' % (allocator,
+                '%.1f (max %d)' % (r[0], r[1]),
+                '%.1f (max %d)' % (r[2], r[3]),
+                '%.1f (max %d)' % (r[4], r[5]),
+                r[6]))
+
+if __name__ == "__main__":
+    main()
@@ -7,6 +7,8 @@
 
 import pytest
 import subprocess
+import json
+import shutil
 
 def test_sanity():
     subprocess.check_call(['bento'])
@@ -26,3 +28,119 @@ def test_outputs():
 def test_errors():
     subprocess.check_call(['bento', 'errors'])
 
+
+def test_bench(tmpdir):
+    path = str(tmpdir.join('bench.json'))
+    subprocess.check_call(['bento', 'bench', '-n', '1000',
+        '-i', 'lazy', '-i', 'trampoline', '-o', path])
+    with open(path) as f:
+        results = json.load(f)
+    for config in results['configs']:
+        assert 'error' not in config
+        for name in ['init_ns', 'empty_call_ns', 'queued_call_ns',
+                'printf_bytes_per_s']:
+            assert config['results'][name] > 0
+
+def test_bench_outer_longjmp(tmpdir):
+    path = str(tmpdir.join('bench.json'))
+    subprocess.check_call(['bento', 'bench', '-n', '1000',
+        '-r', 'host', '-J', '-o', path])
+    with open(path) as f:
+        results = json.load(f)
+    for config in results['configs']:
+        assert 'error' not in config
+        assert config['outer_longjmp']
+        assert config['results']['nested_call_ns'] > 0
+
+def test_bench_write_buffer(tmpdir):
+    path = str(tmpdir.join('bench.json'))
+    subprocess.check_call(['bento', 'bench', '-n', '1000',
+        '-r', 'host', '-B', '128', '-o', path])
+    with open(path) as f:
+        results = json.load(f)
+    for config in results['configs']:
+        assert 'error' not in config
+        assert config['write_buffer'] == 128
+        assert config['results']['printf_bytes_per_s'] > 0
+
+@pytest.mark.parametrize('loader', ['bd', 'fs',
+    pytest.param('glz', marks=pytest.mark.skipif(not shutil.which('glz'),
+        reason="needs the glz command-line tool"))])
+def test_bench_loaders(tmpdir, loader):
+    path = str(tmpdir.join('bench.json'))
+    subprocess.check_call(['bento', 'bench', '-n', '1000',
+        '-r', 'host', '-l', loader, '-o', path])
+    with open(path) as f:
+        results = json.load(f)
+    for config in results['configs']:
+        assert 'error' not in config
+        assert config['loader'] == loader
+        for name in ['init_ns', 'empty_call_ns']:
+            assert config['results'][name] > 0
+
+PROFILE_RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rw 0x20000000-0x2003ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c.path = 'bb.c'
+output.c.profile = true
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+export.sys_ping = 'fn(i32) -> i32'
+import.box1_ping = 'fn(i32) -> i32'
+
+[box.box1]
+runtime = 'host'
+memory.flash = 'rxp 0x2000'
+memory.ram = 'rw 0x2000'
+stack = 0x800
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+import.sys_ping = 'fn(i32) -> i32'
+export.box1_ping = 'fn(i32) -> i32'
+"""
+
+PROFILE_SYS = """
+#include "bb.h"
+
+int32_t sys_ping(int32_t a) {
+    return a + 1;
+}
+
+int main(void) {
+    for (int i = 0; i < 10; i++) {
+        box1_ping(i);
+    }
+    return __box_profile_dump();
+}
+"""
+
+PROFILE_BOX = """
+#include "bb.h"
+
+int32_t box1_ping(int32_t a) {
+    return sys_ping(a) + sys_ping(a);
+}
+"""
+
+def test_profile(tmpdir):
+    tmpdir.join('recipe.toml').write(PROFILE_RECIPE)
+    tmpdir.join('main.c').write(PROFILE_SYS)
+    tmpdir.mkdir('box1').join('main.c').write(PROFILE_BOX)
+    subprocess.check_call(['bento', 'build'], cwd=str(tmpdir))
+    subprocess.check_call(['make', '-s'], cwd=str(tmpdir))
+    dump = subprocess.check_output([str(tmpdir.join('sys.elf'))],
+        cwd=str(tmpdir), universal_newlines=True)
+    report = subprocess.check_output(['bento', 'profile'],
+        cwd=str(tmpdir), input=dump, universal_newlines=True)
+    calls = {line.split()[0]+line.split()[1]+line.split()[2]:
+            int(line.split()[3])
+        for line in report.splitlines()[1:]}
+    assert calls == {'sys->box1.box1_ping': 10, 'box1->sys.sys_ping': 20}
@@ -0,0 +1,40 @@
+#
+# Heap tests, these build the wasm heap allocators on the host
+#
+# Uses the same churn as tests/heap_bench.py, which checks the contents of
+# every allocation as it goes. The heaps also abort if they notice they are
+# corrupted, either way the churn exits with an error.
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import pytest
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(__file__))
+import heap_bench
+
+def churn(tmpdir, allocator, heap_size):
+    """
+    Run the churn against allocator, returning the number of
+    allocations that failed.
+    """
+    return heap_bench.bench(allocator, argparse.Namespace(
+            heap_size=heap_size,
+            live=128,
+            iterations=200000,
+            cc=os.environ.get('CC', 'cc')),
+        str(tmpdir))[-1]
+
+@pytest.mark.parametrize('allocator', list(heap_bench.ALLOCATORS))
+def test_heap(tmpdir, allocator):
+    # plenty of room, nothing should fail
+    assert churn(tmpdir, allocator, 0x8000) == 0
+
+@pytest.mark.parametrize('allocator', list(heap_bench.ALLOCATORS))
+def test_heap_exhausted(tmpdir, allocator):
+    # not enough room, allocations fail but the heap stays consistent
+    assert churn(tmpdir, allocator, 0x2000) > 0
@@ -0,0 +1,996 @@
+#
+# Loader tests, these build small host projects and run them
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import pytest
+import argparse
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+from bento.box import Box
+
+sys.path.insert(0, os.path.dirname(__file__))
+import glz_seek
+
+# the glz command-line tool, either on the PATH or built in extra/glz
+GLZ = shutil.which('glz') or next((path
+    for path in (os.path.abspath(os.path.join(os.path.dirname(__file__),
+        '..', 'extra', 'glz', 'target', build, 'glz'))
+        for build in ['release', 'debug'])
+    if os.access(path, os.X_OK)), None)
+
+def generate(path, recipe, srcs):
+    """
+    Generate a host project into path, srcs maps paths to the contents
+    of sources. Returns the sys box.
+    """
+    for name, src in dict(srcs, **{'recipe.toml': recipe}).items():
+        os.makedirs(os.path.dirname(os.path.join(path, name)), exist_ok=True)
+        with open(os.path.join(path, name), 'w') as f:
+            f.write(src.lstrip())
+
+    box = Box.scan(path=path)
+    box.box()
+    box.link()
+    box.build()
+
+    def outputwrite(box):
+        for output in box.outputs:
+            with open(output.path, 'w') as outf:
+                outf.write(output.getvalue())
+        for child in box.boxes:
+            outputwrite(child)
+    outputwrite(box)
+
+    subprocess.check_call(['make', '-C', path, '-j', '-s'],
+        stdout=subprocess.DEVNULL)
+    return box
+
+def segments(path):
+    """
+    Yield (addr, data) for each loadable segment in an ELF64 file.
+    """
+    with open(path, 'rb') as f:
+        elf = f.read()
+    phoff, = struct.unpack_from('<Q', elf, 0x20)
+    phentsize, phnum = struct.unpack_from('<HH', elf, 0x36)
+    for i in range(phnum):
+        type_, _, off, addr, _, filesz, _, _ = struct.unpack_from(
+            '<IIQQQQQQ', elf, phoff + i*phentsize)
+        if type_ == 1 and filesz:
+            yield addr, elf[off:off+filesz]
+
+def bdimage(box, elf, block_size):
+    """
+    Build a block device image for the bd loader, paged memories come
+    first in page order, followed by the multi-region image of the
+    writable memories.
+    """
+    memories = {}
+    for memory in box.memories:
+        memories[memory.name] = bytearray(memory.size)
+    for addr, data in segments(elf):
+        for memory in box.memories:
+            if addr >= memory.addr and addr < memory.addr + memory.size:
+                off = addr - memory.addr
+                memories[memory.name][off:off+len(data)] = data
+
+    paged = [memory for memory in box.memories if 'w' not in memory.mode]
+    loaded = [memory for memory in box.memoryslices if 'w' in memory.mode]
+    image = bytearray()
+    for memory in paged:
+        image += memories[memory.name]
+    image += struct.pack('<I', len(loaded))
+    for memory in loaded:
+        image += struct.pack('<I', memory.size)
+    for memory in loaded:
+        image += memories[memory.name]
+    # reads may be buffered up to the end of a block
+    image += bytes(-len(image) % block_size)
+    return image
+
+def run(path, *args):
+    """
+    Run the project's sys.elf, returning its output.
+    """
+    proc = subprocess.run([os.path.join(path, 'sys.elf')] + list(args),
+        stdout=subprocess.PIPE, universal_newlines=True)
+    assert proc.returncode == 0, "exited with %d:\n%s" % (
+        proc.returncode, proc.stdout)
+    return proc.stdout
+
+RELOAD_RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2007ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+export.__box_box1_bdread = 'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'
+
+import.box1_bump = 'fn() -> i32'
+import.box1_abort = 'fn() -> err'
+import.box1_add = 'queued fn(i32 n) -> void'
+import.box2_ping = 'fn() -> i32'
+
+[box.box1]
+runtime = 'host'
+loader.loader = 'bd'
+loader.bd.region = '0x00000000-0x000fffff'
+loader.bd.block_size = 512
+idempotent = true
+skip_reload = %(skip_reload)s
+roommates = ['box2']
+memory.text = 'rwx 0x4000'
+memory.ram = 'rw 0x4000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box1_bump = 'fn() -> i32'
+export.box1_abort = 'fn() -> err'
+export.box1_add = 'queued fn(i32 n) -> void'
+
+[box.box2]
+runtime = 'host'
+idempotent = true
+roommates = ['box1']
+memory.flash = 'rxp 0x4000'
+memory.ram = 'rw 0x4000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box2_ping = 'fn() -> i32'
+"""
+
+RELOAD_SYS = """
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bb.h"
+
+static uint8_t image[0x10000];
+static size_t image_size;
+static uint32_t reads;
+
+int __box_box1_bdread(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    size_t addr = (size_t)block*512 + off;
+    if (addr + size > image_size) {
+        return -EINVAL;
+    }
+
+    memcpy(buffer, &image[addr], size);
+    reads += 1;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    FILE *f = fopen(argv[1], "rb");
+    image_size = fread(image, 1, sizeof(image), f);
+    fclose(f);
+
+    printf("first %d\\n", box1_bump());
+
+    __box_box1_clobber();
+    __box_box1_init();
+    printf("clobber %d\\n", box1_bump());
+
+    if (box1_abort() >= 0) {
+        printf("abort didn't abort\\n");
+        return 1;
+    }
+    printf("abort %d\\n", box1_bump());
+
+    // queued calls don't survive a clobber, even if the box resumes
+    box1_add(100);
+    box2_ping();
+    uint32_t before = reads;
+    printf("roommate %d\\n", box1_bump());
+    printf("roommate reads %d\\n", reads - before);
+
+    // but the queue still works afterwards
+    box1_add(10);
+    __box_box1_drain();
+    printf("queued %d\\n", box1_bump());
+    return 0;
+}
+"""
+
+RELOAD_BOX1 = """
+#include <stdlib.h>
+#include "bb.h"
+
+int32_t counter = 5;
+
+int32_t box1_bump(void) {
+    return ++counter;
+}
+
+int box1_abort(void) {
+    counter = 100;
+    exit(-1);
+}
+
+void box1_add(int32_t n) {
+    counter += n;
+}
+"""
+
+RELOAD_BOX2 = """
+#include "bb.h"
+
+int32_t box2_ping(void) {
+    return 1;
+}
+"""
+
+@pytest.mark.parametrize('skip_reload', [False, True])
+def test_skip_reload(tmpdir, skip_reload):
+    path = str(tmpdir)
+    box = generate(path, RELOAD_RECIPE % dict(
+            skip_reload='true' if skip_reload else 'false'), {
+        'main.c': RELOAD_SYS,
+        'box1/main.c': RELOAD_BOX1,
+        'box2/main.c': RELOAD_BOX2})
+    box1 = next(child for child in box.boxes if child.name == 'box1')
+    with open(os.path.join(path, 'box1.img'), 'wb') as f:
+        f.write(bdimage(box1, os.path.join(path, 'box1', 'box1.elf'), 512))
+
+    stdout = run(path, os.path.join(path, 'box1.img'))
+    results = dict(line.rsplit(' ', 1) for line in stdout.splitlines())
+    # clobbers and aborts always start the box over
+    assert results['first'] == '6'
+    assert results['clobber'] == '6'
+    assert results['abort'] == '6'
+    # a roommate that doesn't load over the box lets it resume
+    if skip_reload:
+        assert results['roommate'] == '7'
+        assert results['roommate reads'] == '0'
+        assert results['queued'] == '18'
+    else:
+        assert results['roommate'] == '6'
+        assert int(results['roommate reads']) > 0
+        assert results['queued'] == '17'
+
+PAGE = 4096
+
+PAGING_RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2003ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+export.__box_box1_bdread = 'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'
+
+import.paging_call = 'fn(u32 i, u32 x) -> u32'
+
+[box.box1]
+runtime = '%(runtime)s'
+loader.loader = 'bd'
+loader.bd.region = '0x00000000-0x000fffff'
+loader.bd.block_size = 512
+loader.bd.page_size = %(page)d
+loader.bd.pages = %(frames)d
+memory.text = 'rx %(text_size)#x'
+memory.ram = 'rw 0x8000'
+stack = 0x1000
+heap = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.paging_call = 'fn(u32 i, u32 x) -> u32'
+"""
+
+PAGING_SYS = """
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bb.h"
+
+// simulated block device, backed by an image in memory, counts
+// bytes read
+static uint8_t *image;
+static size_t image_size;
+static uint32_t reads;
+
+int __box_box1_bdread(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    size_t addr = (size_t)block*512 + off;
+    if (addr + size > image_size) {
+        return -EINVAL;
+    }
+
+    memcpy(buffer, &image[addr], size);
+    reads += size;
+    return 0;
+}
+
+static uint32_t expected(uint32_t i, uint32_t x) {
+    return x*(i+1) + i;
+}
+
+static int phase(const char *name, const uint32_t *order, size_t count,
+        uint32_t repeat) {
+    uint32_t before = reads;
+    for (uint32_t r = 0; r < repeat; r++) {
+        for (size_t j = 0; j < count; j++) {
+            uint32_t x = r*count + j;
+            uint32_t y = paging_call(order[j], x);
+            if (y != expected(order[j], x)) {
+                printf("%%s: page%%u(%%u) = %%u, expected %%u\\n",
+                    name, order[j], x, y, expected(order[j], x));
+                return -1;
+            }
+        }
+    }
+    printf("reads %%s %%u\\n", name, reads - before);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    FILE *f = fopen(argv[1], "rb");
+    image = malloc(0x100000);
+    image_size = fread(image, 1, 0x100000, f);
+    fclose(f);
+
+    uint32_t before = reads;
+    int err = __box_box1_init();
+    if (err) {
+        printf("init failed %%d\\n", err);
+        return 1;
+    }
+    printf("reads init %%u\\n", reads - before);
+
+    uint32_t all[%(n)d];
+    for (uint32_t i = 0; i < %(n)d; i++) {
+        all[i] = i;
+    }
+    const uint32_t hot[2] = {0, 1};
+
+    if (phase("cold", all, %(n)d, 1) ||
+            phase("hot", hot, 2, 1000) ||
+            phase("sweep", all, %(n)d, 3)) {
+        return 1;
+    }
+
+    return 0;
+}
+"""
+
+PAGING_PAGE = """
+__attribute__((noinline, aligned(%(page)d)))
+static uint32_t page%(i)d(uint32_t x) {
+    return x*%(i)d + x + %(i)d;
+}
+"""
+
+PAGING_BOX = """
+uint32_t paging_call(uint32_t i, uint32_t x) {
+    switch (i) {
+%(cases)s
+        default: return 0;
+    }
+}
+"""
+
+@pytest.mark.parametrize('n, frames', [(12, 6), (12, 16)])
+def test_bd_paging(tmpdir, n, frames):
+    path = str(tmpdir)
+    box = generate(path, PAGING_RECIPE % dict(
+            runtime='host',
+            page=PAGE,
+            frames=frames,
+            text_size=(n+4)*PAGE), {
+        'main.c': PAGING_SYS % dict(n=n),
+        'box1/main.c': '#include "bb.h"\n'
+            + ''.join(PAGING_PAGE % dict(page=PAGE, i=i) for i in range(n))
+            + PAGING_BOX % dict(cases='\n'.join(
+                '        case %d: return page%d(x);' % (i, i)
+                for i in range(n)))})
+    with open(os.path.join(path, 'box1.img'), 'wb') as f:
+        f.write(bdimage(box.boxes[0],
+            os.path.join(path, 'box1', 'box1.elf'), 512))
+
+    stdout = run(path, os.path.join(path, 'box1.img'))
+    # after init all reads are page reads
+    reads = {m.group(1): int(m.group(2)) // PAGE
+        for m in re.finditer(r'^reads (\w+) (\d+)$', stdout, re.M)}
+    # every page is brought in at least once, the last page is shared
+    # with the box's entry points, so may already be resident
+    assert reads['cold'] >= n-1
+    # a working set that fits in the page cache stays resident, this
+    # is the two hot pages, the entry points, and the jumptable
+    assert reads['hot'] <= frames
+    # a working set that doesn't fit keeps evicting
+    if frames < n:
+        assert reads['sweep'] >= 3*(n - frames)
+    else:
+        assert reads['sweep'] == 0
+
+@pytest.mark.parametrize('runtime', ['host-mprotect', 'armv7m-mpu'])
+def test_bd_paging_needs_pageprotect(tmpdir, runtime):
+    path = str(tmpdir)
+    tmpdir.mkdir('box1')
+    with open(os.path.join(path, 'recipe.toml'), 'w') as f:
+        f.write(PAGING_RECIPE.lstrip() % dict(
+            runtime=runtime,
+            page=PAGE,
+            frames=4,
+            text_size=16*PAGE))
+
+    box = Box.scan(path=path)
+    with pytest.raises(AssertionError, match='pageprotect'):
+        box.box()
+
+PREFETCH_RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2007ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+export.__box_box2_bdread = 'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'
+%(bdread_async)s
+import.box1_work = 'fn(u32 x) -> u32'
+import.box2_sum = 'fn() -> u32'
+
+[box.box1]
+runtime = 'host'
+memory.flash = 'rxp 0x4000'
+memory.ram = 'rw 0x4000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box1_work = 'fn(u32 x) -> u32'
+
+[box.box2]
+runtime = 'host'
+loader.loader = 'bd'
+loader.bd.region = '0x00000000-0x000fffff'
+loader.bd.block_size = 512
+loader.bd.prefetch = true
+memory.text = 'rwx 0x4000'
+memory.ram = 'rw 0x4000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box2_sum = 'fn() -> u32'
+"""
+
+PREFETCH_ASYNC = """
+export.__box_box2_bdread_async = 'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'
+import.__box_box2_bdread_done = 'fn(err err) -> void'
+"""
+
+PREFETCH_SYS = """
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bb.h"
+
+// simulated block device, backed by an image in memory, counts
+// bytes read
+static uint8_t *image;
+static size_t image_size;
+static volatile uint32_t reads;
+
+static int bdread(uint32_t block, uint32_t off, void *buffer, size_t size) {
+    size_t addr = (size_t)block*512 + off;
+    if (addr + size > image_size) {
+        return -EINVAL;
+    }
+
+    memcpy(buffer, &image[addr], size);
+    reads += size;
+    return 0;
+}
+
+int __box_box2_bdread(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    return bdread(block, off, buffer, size);
+}
+
+#if %(bdread_async)d
+// asynchronous reads are served by a thread, standing in for DMA
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static struct {
+    bool busy;
+    uint32_t block;
+    uint32_t off;
+    void *buffer;
+    size_t size;
+} request;
+
+static void *bdthread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (!request.busy) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        pthread_mutex_unlock(&lock);
+
+        int err = bdread(request.block, request.off,
+                request.buffer, request.size);
+
+        pthread_mutex_lock(&lock);
+        request.busy = false;
+        pthread_mutex_unlock(&lock);
+        __box_box2_bdread_done(err);
+        pthread_mutex_lock(&lock);
+    }
+    return NULL;
+}
+
+int __box_box2_bdread_async(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    pthread_mutex_lock(&lock);
+    if (request.busy) {
+        pthread_mutex_unlock(&lock);
+        return -EBUSY;
+    }
+    request.block = block;
+    request.off = off;
+    request.buffer = buffer;
+    request.size = size;
+    request.busy = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+#endif
+
+static int sum(const char *name) {
+    uint32_t before = reads;
+    uint32_t sum = box2_sum();
+    if (sum != %(expected)uU) {
+        printf("%%s: sum = %%u, expected %%u\\n", name, sum, %(expected)uU);
+        return -1;
+    }
+    printf("reads %%s %%u\\n", name, reads - before);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    FILE *f = fopen(argv[1], "rb");
+    image = malloc(0x100000);
+    image_size = fread(image, 1, 0x100000, f);
+    fclose(f);
+
+#if %(bdread_async)d
+    pthread_t thread;
+    pthread_create(&thread, NULL, bdthread, NULL);
+#endif
+
+    int err = __box_box1_init();
+    if (err) {
+        printf("init failed %%d\\n", err);
+        return 1;
+    }
+
+    // load on demand
+    if (sum("demand") || __box_box2_clobber()) {
+        return 1;
+    }
+
+    // prefetch, polling between box1's work like an idle loop would
+    uint32_t before = reads;
+    err = __box_box2_prefetch();
+    if (err) {
+        printf("prefetch failed %%d\\n", err);
+        return 1;
+    }
+    uint32_t polls = 0;
+    while ((err = __box_box2_load_poll()) == -EAGAIN) {
+        box1_work(100);
+        polls += 1;
+    }
+    if (err) {
+        printf("load_poll failed %%d\\n", err);
+        return 1;
+    }
+    printf("reads prefetch %%u\\n", reads - before);
+    printf("polls %%u\\n", polls);
+
+    // already loaded, this shouldn't read anything
+    if (sum("prefetched")) {
+        return 1;
+    }
+
+    return 0;
+}
+"""
+
+PREFETCH_BOX1 = """
+#include "bb.h"
+
+uint32_t box1_work(uint32_t x) {
+    uint32_t h = 0;
+    for (uint32_t i = 0; i < x; i++) {
+        h = (h ^ i) * 0x01000193;
+        __asm__ volatile ("" : "+r"(h));
+    }
+    return h;
+}
+"""
+
+PREFETCH_BOX2 = """
+#include "bb.h"
+
+static const uint32_t table[%(n)d] = {
+%(table)s
+};
+
+uint32_t box2_sum(void) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < %(n)d; i++) {
+        sum += table[i];
+    }
+    return sum;
+}
+"""
+
+@pytest.mark.parametrize('bdread_async', [False, True])
+def test_bd_prefetch(tmpdir, bdread_async):
+    path = str(tmpdir)
+    # a table so there's something to load
+    table = [(i * 2654435761) & 0xffffffff for i in range(1024)]
+    box = generate(path, PREFETCH_RECIPE % dict(
+            bdread_async=PREFETCH_ASYNC if bdread_async else ''), {
+        'main.c': PREFETCH_SYS % dict(
+            bdread_async=bdread_async,
+            expected=sum(table) & 0xffffffff),
+        'box1/main.c': PREFETCH_BOX1,
+        'box2/main.c': PREFETCH_BOX2 % dict(
+            n=len(table),
+            table='\n'.join('    %#010x,' % x for x in table))})
+    box2 = next(child for child in box.boxes if child.name == 'box2')
+    with open(os.path.join(path, 'box2.img'), 'wb') as f:
+        f.write(bdimage(box2, os.path.join(path, 'box2', 'box2.elf'), 512))
+
+    stdout = run(path, os.path.join(path, 'box2.img'))
+    results = {m.group(1): int(m.group(2))
+        for m in re.finditer(r'^(\w+(?: \w+)?) (\d+)$', stdout, re.M)}
+    # prefetching loads the same thing, just earlier
+    assert results['reads demand'] >= len(table)*4
+    assert results['reads prefetch'] == results['reads demand']
+    # in steps, between box1's work
+    assert results['polls'] > 1
+    # and leaves nothing to load when the box is called
+    assert results['reads prefetched'] == 0
+
+XIP_RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.xip   = 'rxp 0x18000000-0x180fffff'
+memory.ram   = 'rwx 0x20000000-0x2007ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+%(sys_loader)s
+
+import.box1_sum = 'fn() -> u32'
+
+[box.box1]
+runtime = 'host'
+%(loader)s
+memory.flash = 'rxp 0x8000'
+memory.ram = 'rwx 0x8000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.box1_sum = 'fn() -> u32'
+"""
+
+XIP_LOADERS = {
+    'bd': dict(
+        sys_loader="export.__box_box1_bdread = "
+            "'fn(u32 block, u32 off, mut u8 *buffer, usize size) -> err'",
+        loader="loader.loader = 'bd'\n"
+            "loader.bd.region = '0x00000000-0x000fffff'\n"
+            "loader.bd.block_size = 4096"),
+    'xip': dict(
+        sys_loader="",
+        loader="loader.loader = 'xip'\n"
+            "loader.xip.memory = 'xip'\n"
+            "loader.xip.hash = true"),
+}
+
+XIP_BDREAD = """
+int __box_box1_bdread(uint32_t block, uint32_t off,
+        void *buffer, size_t size) {
+    // only the xip build is run
+    return -EIO;
+}
+"""
+
+XIP_SYS = """
+#include <stdio.h>
+#include "bb.h"
+%(bdread)s
+int main(void) {
+    int err = __box_box1_init();
+    if (err) {
+        printf("init failed %%d\\n", err);
+        return 1;
+    }
+
+    uint32_t sum = box1_sum();
+    if (sum != %(expected)uU) {
+        printf("sum = %%u, expected %%u\\n", sum, %(expected)uU);
+        return 1;
+    }
+
+    return 0;
+}
+"""
+
+XIP_BOX = """
+#include "bb.h"
+
+static const uint32_t table[%(n)d] = {
+%(table)s
+};
+
+// some data and bss to copy and zero
+static uint32_t bias = 1;
+static uint32_t scratch[%(n)d / 16];
+
+uint32_t box1_sum(void) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < %(n)d; i++) {
+        scratch[i %% (%(n)d / 16)] += table[i];
+        sum += table[i];
+    }
+    return sum + bias;
+}
+"""
+
+def sections(path):
+    """
+    Yield (name, addr, size) for each allocated section in an ELF64 file.
+    """
+    with open(path, 'rb') as f:
+        elf = f.read()
+    shoff, = struct.unpack_from('<Q', elf, 0x28)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x3a)
+    headers = [struct.unpack_from('<IIQQQQ', elf, shoff + i*shentsize)
+        for i in range(shnum)]
+    strtab = headers[shstrndx][4]
+    for name, _, flags, addr, _, size in headers:
+        # SHF_ALLOC
+        if flags & 0x2 and size:
+            name = elf[strtab+name:elf.index(b'\0', strtab+name)]
+            yield name.decode(), addr, size
+
+def corrupt(path, addr):
+    """
+    Flip a byte at the given address in an ELF64 file's loaded image.
+    """
+    with open(path, 'rb') as f:
+        elf = bytearray(f.read())
+    phoff, = struct.unpack_from('<Q', elf, 0x20)
+    phentsize, phnum = struct.unpack_from('<HH', elf, 0x36)
+    for i in range(phnum):
+        type_, _, off, vaddr, _, filesz, _, _ = struct.unpack_from(
+            '<IIQQQQQQ', elf, phoff + i*phentsize)
+        if type_ == 1 and addr >= vaddr and addr < vaddr + filesz:
+            elf[off + (addr - vaddr)] ^= 0xff
+            break
+    else:
+        assert False, "Address %#x not in %s?" % (addr, path)
+    with open(path, 'wb') as f:
+        f.write(elf)
+
+def test_xip(tmpdir):
+    # a table that takes up most of the box's text
+    table = [(i * 2654435761) & 0xffffffff for i in range(0x1800)]
+    used = {}
+    for loader in XIP_LOADERS:
+        path = os.path.join(str(tmpdir), loader)
+        box = generate(path, XIP_RECIPE % XIP_LOADERS[loader], {
+            'main.c': XIP_SYS % dict(
+                bdread=XIP_BDREAD if loader == 'bd' else '',
+                expected=(sum(table) + 1) & 0xffffffff),
+            'box1/main.c': XIP_BOX % dict(
+                n=len(table),
+                table='\n'.join('    %#010x,' % x for x in table))})
+        box1 = box.boxes[0]
+        used[loader] = {memory.name: 0 for memory in box1.memories}
+        for _, addr, size in sections(
+                os.path.join(path, 'box1', 'box1.elf')):
+            for memory in box1.memories:
+                if addr >= memory.addr and addr < memory.addr + memory.size:
+                    used[loader][memory.name] += size
+
+    # the box executes straight from the xip memory
+    run(path)
+
+    # xip only needs RAM for data and bss
+    assert used['xip']['ram'] < used['bd']['ram'] - len(table)*4
+
+    # and a corrupted image must not run
+    flash = next(memory for memory in box1.memories
+        if memory.name == 'flash')
+    corrupt(os.path.join(path, 'sys.elf'), flash.addr + 0x100)
+    proc = subprocess.run([os.path.join(path, 'sys.elf')],
+        stdout=subprocess.PIPE, universal_newlines=True)
+    assert 'init failed -84' in proc.stdout
+
+GLZ_BOXES = ['box1', 'box2', 'box3']
+
+GLZ_DICT_RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2007ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+"""
+
+GLZ_DICT_IMPORTS = """
+import.%(box)s_add2  = 'fn(i32, i32) -> err32'
+import.%(box)s_hello = 'fn() -> err'
+"""
+
+GLZ_DICT_BOX = """
+[box.%(box)s]
+runtime = 'host'
+loader.loader = 'glz'
+loader.glz.glz = '%(glz)s'
+loader.glz.glz_flags = ['-m %(mode)s']
+loader.glz.decoder = '%(decoder)s'
+loader.glz.dict = %(dict)s
+memory.flash = 'rp 0x4000'
+memory.ram   = 'rwx 0x4000'
+stack = 0x800
+heap = 0x800
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk = 'Makefile'
+
+export.%(box)s_add2 = 'fn(i32, i32) -> err32'
+export.%(box)s_hello = 'fn() -> err'
+"""
+
+GLZ_DICT_SYS = """
+#include <stdio.h>
+#include "bb.h"
+
+int main(void) {
+%(calls)s
+    return 0;
+}
+"""
+
+GLZ_DICT_CALL = """
+    if (%(box)s_hello() != 0) {
+        printf("%(box)s_hello failed\\n");
+        return 1;
+    }
+    if (%(box)s_add2(1, 2) != 3) {
+        printf("%(box)s_add2 failed\\n");
+        return 1;
+    }
+"""
+
+# same as examples/compression
+GLZ_DICT_MAIN = """
+#include "bb.h"
+#include <stdio.h>
+
+int32_t %(box)s_add2(int32_t a, int32_t b) {
+    return a + b;
+}
+
+int %(box)s_hello(void) {
+    printf("%(box)s says hello!\\n");
+    return 0;
+}
+"""
+
+@pytest.mark.skipif(not GLZ,
+    reason="needs the glz command-line tool, see extra/glz")
+@pytest.mark.parametrize('decoder, mode', [
+    ('bit', 'compact'), ('word', 'compact'), ('bit', 'fast')])
+def test_glz_dict(tmpdir, decoder, mode):
+    used = {}
+    for shared in [False, True]:
+        path = os.path.join(str(tmpdir), 'dict' if shared else 'alone')
+        generate(path, GLZ_DICT_RECIPE
+            + ''.join(GLZ_DICT_IMPORTS % dict(box=box) for box in GLZ_BOXES)
+            + ''.join(GLZ_DICT_BOX % dict(
+                    box=box,
+                    glz=GLZ,
+                    decoder=decoder,
+                    mode=mode,
+                    dict='true' if shared else 'false')
+                for box in GLZ_BOXES), dict(
+            {'main.c': GLZ_DICT_SYS % dict(calls=''.join(
+                GLZ_DICT_CALL % dict(box=box) for box in GLZ_BOXES))},
+            **{'%s/main.c' % box: GLZ_DICT_MAIN % dict(box=box)
+                for box in GLZ_BOXES}))
+
+        stdout = run(path)
+        for box in GLZ_BOXES:
+            assert '%s says hello!' % box in stdout
+
+        # compressed boxes end up in their own sections
+        used[shared] = sum(size
+            for section, _, size in sections(os.path.join(path, 'sys.elf'))
+            if section.startswith('.box.'))
+        if shared:
+            used[shared] += os.path.getsize(
+                os.path.join(path, 'glzdict.glz'))
+
+    # the dictionary pays for itself
+    assert used[True] < used[False]
+
+@pytest.mark.skipif(not GLZ,
+    reason="needs the glz command-line tool, see extra/glz")
+@pytest.mark.parametrize('decoder, mode', [
+    ('bit', 'compact'), ('word', 'compact'), ('bit', 'fast')])
+@pytest.mark.parametrize('seek', [64, 1024])
+def test_glz_seek(tmpdir, decoder, mode, seek):
+    # same as tests/glz_seek.py, the sys checks every read against
+    # the assets
+    path = str(tmpdir)
+    glz_seek.generate(path, seek, argparse.Namespace(
+        glz=GLZ,
+        mode=mode,
+        decoder=decoder,
+        size=0x2000,
+        read_size=64))
+    subprocess.check_call(['make', '-C', path, '-j', '-s'],
+        stdout=subprocess.DEVNULL)
+    assert run(path).endswith('ok\n')
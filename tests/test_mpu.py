@@ -0,0 +1,644 @@
+#
+# MPU runtime tests, these mock the MPU on the host
+#
+# Extracts the MPU implementation and delta tables from the generated
+# armv7m_mpu/armv8m_mpu parent C files, replays random call/return
+# sequences against a mocked MPU, and checks that the incremental
+# __box_mpu_switch leaves the MPU in the same state as rewriting every
+# region from the regions we expect for each box.
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import pytest
+import os
+import re
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+from bento.box import Box
+from bento.runtimes.armv7m_mpu import ARMv7MMPURuntime
+from bento.runtimes.armv8m_mpu import ARMv8MMPURuntime
+
+EXAMPLES_PATH = os.path.normpath(
+    os.path.join(
+        os.path.dirname(__file__),
+        '../examples'))
+EXAMPLES = []
+for name in sorted(os.listdir(EXAMPLES_PATH)):
+    path = os.path.join(EXAMPLES_PATH, name)
+    for dir, _, files in os.walk(path):
+        if 'recipe.toml' in files:
+            with open(os.path.join(dir, 'recipe.toml')) as f:
+                if re.search(r'armv[78]m-mpu', f.read()):
+                    EXAMPLES.append((name, path))
+                    break
+EXAMPLES_IDS = list(zip(*EXAMPLES))[0]
+
+# registers we mock, everything else is left alone
+REGISTERS = {
+    'SHCSR':    0xe000ed24,
+    'MPU_TYPE': 0xe000ed90,
+    'MPU_CTRL': 0xe000ed94,
+    'MPU_RNR':  0xe000ed98,
+    'MPU_RBAR': 0xe000ed9c,
+    'MPU_RASR': 0xe000eda0,
+    'MPU_RLAR': 0xe000eda0,
+    'MPU_MAIR0': 0xe000edc0,
+    'MPU_MAIR1': 0xe000edc4,
+}
+
+PRELUDE = """
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARMV8M %(armv8m)d
+#define MPUREGIONS %(mpuregions)d
+
+struct __mock_mpu {
+    uint32_t ctrl;
+    uint32_t rnr;
+    uint32_t control;
+    uint32_t regions[16][2];
+    uint32_t writes;
+};
+
+static struct __mock_mpu *__mock;
+#define __mock_control (__mock->control)
+
+uint32_t __box_callregion;
+
+static void __mock_write(uint32_t addr, uint32_t value) {
+    __mock->writes += 1;
+    switch (addr) {
+        case 0xe000ed94: __mock->ctrl = value; break;
+        case 0xe000ed98: __mock->rnr = value & 0xff; break;
+#if ARMV8M
+        case 0xe000ed9c: __mock->regions[__mock->rnr][0] = value; break;
+        case 0xe000eda0: __mock->regions[__mock->rnr][1] = value; break;
+#else
+        // RBAR/RASR and their A1-A3 aliases
+        case 0xe000ed9c: case 0xe000eda4:
+        case 0xe000edac: case 0xe000edb4:
+            if (value & 0x10) {
+                __mock->rnr = value & 0xf;
+            }
+            __mock->regions[__mock->rnr][0] = value & ~0x1f;
+            break;
+        case 0xe000eda0: case 0xe000eda8:
+        case 0xe000edb0: case 0xe000edb8:
+            __mock->regions[__mock->rnr][1] = value;
+            break;
+#endif
+        default: break;
+    }
+}
+
+static uint32_t __mock_read(uint32_t addr) {
+    switch (addr) {
+        case 0xe000ed90: return 16 << 8;
+        case 0xe000ed94: return __mock->ctrl;
+        default: return 0;
+    }
+}
+"""
+
+# rewrites every region on every switch
+REFERENCE = """
+static const uint32_t __ref_counts[__BOX_COUNT+1] = {
+%(counts)s
+};
+
+static const uint32_t __ref_regions[__BOX_COUNT+1][MPUREGIONS+1][2] = {
+%(regions)s
+};
+
+static void __ref_mpu_switch(uint32_t box) {
+    *MPU_CTRL = 0;
+    for (int i = 0; i < MPUREGIONS; i++) {
+#if ARMV8M
+        *MPU_RNR = i+1;
+        *MPU_RBAR = (i < __ref_counts[box]) ? __ref_regions[box][i][0] : 0;
+        *MPU_RLAR = (i < __ref_counts[box]) ? __ref_regions[box][i][1] : 0;
+#else
+        *MPU_RBAR = ((i < __ref_counts[box]) ? __ref_regions[box][i][0] : 0)
+            | 0x10 | (i+1);
+        *MPU_RASR = (i < __ref_counts[box]) ? __ref_regions[box][i][1] : 0;
+#endif
+    }
+    *MPU_CTRL = 5;
+    __mock_control = (~1 & __mock_control) | (box != 0);
+}
+"""
+
+DRIVER = """
+static uint32_t xorshift(uint32_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static struct __mock_mpu mpu, ref;
+
+static int check(uint32_t from, uint32_t to) {
+    for (int j = 0; j < MPUREGIONS+1; j++) {
+        if (mpu.regions[j][0] != ref.regions[j][0] ||
+                mpu.regions[j][1] != ref.regions[j][1]) {
+            printf("region %%d mismatch after %%d -> %%d: "
+                "%%08x %%08x != %%08x %%08x\\n",
+                j, from, to,
+                mpu.regions[j][0], mpu.regions[j][1],
+                ref.regions[j][0], ref.regions[j][1]);
+            return 1;
+        }
+    }
+
+    if (mpu.ctrl != ref.ctrl || mpu.control != ref.control) {
+        printf("ctrl/control mismatch after %%d -> %%d\\n", from, to);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(void) {
+    // start from garbage
+    uint32_t x = 0x2545f491;
+    for (int i = 0; i < 16; i++) {
+        mpu.regions[i][0] = ref.regions[i][0] = xorshift(&x);
+        mpu.regions[i][1] = ref.regions[i][1] = xorshift(&x);
+    }
+    mpu.ctrl = ref.ctrl = 0;
+    mpu.control = ref.control = 0;
+
+    __mock = &mpu;
+    __box_mpu_init();
+    __mock = &ref;
+    __box_mpu_init();
+    mpu.writes = 0;
+    ref.writes = 0;
+
+    // replay calls/returns, sys calls into boxes, and boxes call into
+    // sys or directly into other boxes, calls may nest
+    uint32_t stack[64] = {0};
+    uint32_t depth = 0;
+    for (long i = 0; i < %(iterations)d; i++) {
+        uint32_t from = stack[depth];
+        if (depth == 0 || (depth < 63 && xorshift(&x) %% 2)) {
+            uint32_t to = (from + 1 + xorshift(&x) %% __BOX_COUNT)
+                %% (__BOX_COUNT+1);
+            stack[++depth] = to;
+        } else {
+            depth -= 1;
+        }
+        uint32_t to = stack[depth];
+
+        __mock = &mpu;
+        __box_mpu_switch(__box_mpudeltas[from][to]);
+        __mock = &ref;
+        __ref_mpu_switch(to);
+        if (check(from, to)) {
+            return 1;
+        }
+    }
+
+    printf("%%u %%u\\n", mpu.writes, ref.writes);
+    return 0;
+}
+"""
+
+def mpuparents(box):
+    """
+    Yield (parent, runtime, boxes) for each box with children in an MPU
+    runtime, and the children in the order of the MPU tables.
+    """
+    boxes = [child for child in box.boxes
+        if isinstance(child.runtime, ARMv7MMPURuntime)]
+    if boxes:
+        yield box, boxes[0].runtime, [child for child in box.boxes
+            if child.runtime == boxes[0].runtime]
+    for child in box.boxes:
+        yield from mpuparents(child)
+
+def mock(code, parent, runtime, boxes):
+    """
+    Build the mock from the parent's generated C code, redirecting
+    register accesses to a mocked MPU, and the regions we expect each
+    box to have.
+    """
+    armv8m = isinstance(runtime, ARMv8MMPURuntime)
+    boxcount = re.search(r'^#define __BOX_COUNT \d+$', code, re.M).group(0)
+
+    # MPU implementation, up to the end of __box_mpu_switch
+    start = code.index('#define SHCSR')
+    end = code.index('\n}\n', code.index('static void __box_mpu_switch')) + 3
+    impl = code[start:end]
+    # delta tables
+    tables = re.findall(
+        r'^const struct __box_mpudelta .*?^};$', code, re.M | re.S)
+
+    # and what we expect, from the regions we give each box
+    regions = [[]] + [runtime._box_mpu_regions(box) for box in boxes]
+    reference = REFERENCE % dict(
+        counts=',\n'.join('    %d' % len(r) for r in regions),
+        regions=',\n'.join('    {%s}' % ', '.join(
+                '{%#010x, %#010x}' % region for region in r)
+            for r in regions))
+
+    # drop register definitions, redirect register accesses to our mock
+    impl = re.sub(r'^#define (SHCSR|MPU_\w+) .*$', '', impl, flags=re.M)
+    mocked = []
+    for src in [impl, reference]:
+        for name, addr in REGISTERS.items():
+            src = re.sub(r'\*%s = (.*?);' % name,
+                r'__mock_write(%#x, \1);' % addr, src, flags=re.S)
+            src = re.sub(r'%s\[(\d+)\] = (.*?);' % name,
+                r'__mock_write(%#x + 4*\1, \2);' % addr, src)
+            src = re.sub(r'\*%s\b' % name,
+                r'__mock_read(%#x)' % addr, src)
+        mocked.append(src)
+    impl, reference = mocked
+    # and CONTROL
+    impl = impl.replace(
+        '__asm__ volatile ("mrs %0, control" : "=r"(control));',
+        'control = __mock_control;')
+    impl = impl.replace(
+        '__asm__ volatile ("msr control, %0" :: "r"(control));',
+        '__mock_control = control;')
+    impl = impl.replace('(uint32_t)&__box_callregion',
+        '(uint32_t)(uintptr_t)&__box_callregion')
+
+    return '\n'.join([
+        PRELUDE % dict(armv8m=armv8m, mpuregions=runtime._mpu_regions),
+        boxcount, impl, reference] + tables)
+
+def run(tmpdir, box, driver=DRIVER, **args):
+    """
+    Mock each MPU parent in box, and run driver against it.
+    """
+    ran = 0
+    for parent, runtime, boxes in mpuparents(box):
+        code = next(output for output in parent.outputs
+            if output.__argname__ == 'c').getvalue()
+        src = str(tmpdir.join('mpu_mock.c'))
+        exe = str(tmpdir.join('mpu_mock'))
+        with open(src, 'w') as f:
+            f.write(mock(code, parent, runtime, boxes))
+            f.write(driver % args)
+
+        subprocess.check_call(['cc', '-O1', '-w', src, '-o', exe])
+        proc = subprocess.run([exe], stdout=subprocess.PIPE,
+            universal_newlines=True)
+        assert proc.returncode == 0, "%s: exited with %d:\n%s" % (
+            parent.name, proc.returncode, proc.stdout)
+        ran += 1
+    assert ran > 0, "no MPU boxes found"
+
+def build(path, recipe=None):
+    if recipe is not None:
+        with open(os.path.join(path, 'recipe.toml'), 'w') as f:
+            f.write(recipe.lstrip())
+    box = Box.scan(path=path)
+    box.box()
+    box.link()
+    box.build()
+    return box
+
+@pytest.mark.parametrize('name, path', EXAMPLES, ids=EXAMPLES_IDS)
+def test_mpu_switch(tmpdir, name, path):
+    run(tmpdir, build(path), iterations=100000)
+
+SHARED_RECIPE = """
+memory.flash = 'rxp 0x00000000-0x000fffff'
+memory.ram   = 'rw 0x20000000-0x2003ffff'
+stack = 0x800
+
+runtime = 'armv7m-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+
+shared.frames.memory = 'rw %(size)s'
+
+import.box1_ping = 'fn(i32) -> err32'
+import.box2_ping = 'fn(i32) -> err32'
+
+[box.box1]
+runtime = '%(runtime)s'
+memory.flash = 'rxp 0x2000'
+memory.ram = 'rw 0x2000'
+stack = 0x800
+export.box1_ping = 'fn(i32) -> err32'
+
+[box.box2]
+runtime = '%(runtime)s'
+memory.flash = 'rxp 0x2000'
+memory.ram = 'rw 0x2000'
+stack = 0x800
+export.box2_ping = 'fn(i32) -> err32'
+"""
+
+@pytest.mark.parametrize('runtime', ['armv7m-mpu', 'armv8m-mpu'])
+@pytest.mark.parametrize('size', ['0x800', '0x1000'])
+def test_mpu_shared(tmpdir, runtime, size):
+    for name in ['box1', 'box2']:
+        tmpdir.mkdir(name)
+    box = build(str(tmpdir), SHARED_RECIPE % dict(
+        runtime=runtime, size=size))
+    # shared memory gets its own MPU region in each box
+    for child in box.boxes:
+        assert [shared.name for shared in child.sharedmemories] == ['frames']
+        assert len(child.runtime._box_mpu_regions(child)) == 3
+    run(tmpdir, box, iterations=100000)
+
+SIBLING_RECIPE = """
+memory.flash = 'rxp 0x00000000-0x000fffff'
+memory.ram   = 'rw 0x20000000-0x2003ffff'
+stack = 0x800
+
+runtime = 'armv7m-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.ld = 'bb.ld'
+
+import.box1_ping = 'fn(i32) -> err32'
+import.box2_ping = 'fn(i32) -> err32'
+
+[box.box1]
+runtime = '%(runtime)s'
+memory.flash = 'rxp 0x2000'
+memory.ram = 'rw 0x2000'
+stack = 0x800
+output.ld = 'bb.ld'
+export.box1_ping = 'fn(i32) -> err32'
+import.box2_ping = 'fn(i32) -> err32'
+
+[box.box2]
+runtime = '%(runtime)s'
+memory.flash = 'rxp 0x2000'
+memory.ram = 'rw 0x2000'
+stack = 0x800
+output.ld = 'bb.ld'
+export.box2_ping = 'fn(i32) -> err32'
+import.box1_ping = 'fn(i32) -> err32'
+"""
+
+# replays calls between sys and boxes that call each other directly,
+# going through __box_callsetup/__box_returnsetup as the MPU handler would
+SIBLING_DRIVER = """
+static uint32_t xorshift(uint32_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static struct __mock_mpu mpu, ref;
+static uint32_t __mock_stacks[__BOX_COUNT+1][1024];
+static uint32_t *__mock_sp = &__mock_stacks[0][1024];
+static uint32_t __mock_postinits[__BOX_COUNT+1];
+
+static int32_t __mock_run(uint32_t pc, const uint32_t *args);
+
+// trap into __box_callsetup, run the target, and trap into
+// __box_returnsetup, as the MPU handler does
+static int32_t __mock_call(uint32_t op, uint32_t a0) {
+    // exception frame, followed by saved registers and our frame
+    uint32_t *fp = __mock_sp - 8;
+    fp[0] = a0;
+    fp[5] = 0xdeadbeef;
+    fp[6] = (uint32_t)(uintptr_t)&__box_callregion + op;
+    uint32_t *sp = fp - 16;
+    uint64_t ret = __box_callsetup(0xfffffffd, sp, op, fp);
+    uint32_t *targetsp = (uint32_t*)(uintptr_t)(ret >> 32);
+    if (targetsp == fp) {
+        // returned an error without calling
+        return fp[0];
+    }
+
+    // are we in the right box?
+    uint32_t pc = targetsp[6];
+    if (__box_active != pc/16) {
+        printf("called %%#x in box %%d\\n", pc, __box_active);
+        exit(1);
+    }
+    struct __mock_mpu *mock = __mock;
+    __mock = &ref;
+    __ref_mpu_switch(__box_active);
+    __mock = mock;
+    for (int j = 0; j < MPUREGIONS+1; j++) {
+        if (mpu.regions[j][0] != ref.regions[j][0] ||
+                mpu.regions[j][1] != ref.regions[j][1]) {
+            printf("region %%d mismatch in box %%d\\n", j, __box_active);
+            exit(1);
+        }
+    }
+
+    // run the box on its own stack
+    uint32_t *callersp = __mock_sp;
+    __mock_sp = targetsp + 8;
+    int32_t res = __mock_run(pc, targetsp);
+
+    // and return through __box_return
+    uint32_t *rfp = __mock_sp - 8;
+    rfp[0] = res;
+    ret = __box_returnsetup(0xfffffffd, rfp - 16, 0, rfp);
+    __mock_sp = callersp;
+    if ((uint32_t*)(uintptr_t)(ret >> 32) != sp) {
+        printf("returned to the wrong frame\\n");
+        exit(1);
+    }
+    return fp[0];
+}
+
+// box1 and box2 ping each other until n runs out
+static int32_t __mock_run(uint32_t pc, const uint32_t *args) {
+    uint32_t box = pc/16;
+    if (pc %% 16 == 1) {
+        __mock_postinits[box] += 1;
+        // box2 is first initialized from inside box1's init, box1
+        // isn't ready yet and shouldn't say otherwise
+        if (box == 2 && __mock_postinits[box] == 1) {
+            int err = __box_box1_init();
+            if (err != -EAGAIN) {
+                printf("__box_box1_init() in box2 postinit = %%d\\n", err);
+                exit(1);
+            }
+        }
+        return 0;
+    }
+
+    int32_t n = args[0];
+    if (n <= 0) {
+        return box;
+    }
+
+    int32_t res = __mock_call(
+        box == 1 ? __mock_op_box1_box2_ping : __mock_op_box2_box1_ping,
+        n-1);
+    if (res < 0) {
+        return res;
+    }
+    return 10*res + box;
+}
+
+int32_t __box_import_box1_ping(int32_t a0) {
+    return __mock_call(__mock_op___box_import_box1_ping, a0);
+}
+
+int32_t __box_import_box2_ping(int32_t a0) {
+    return __mock_call(__mock_op___box_import_box2_ping, a0);
+}
+
+int __box_box1_postinit(void) {
+    return __mock_call(__mock_op___box_box1_postinit, 0);
+}
+
+int __box_box2_postinit(void) {
+    return __mock_call(__mock_op___box_box2_postinit, 0);
+}
+
+void __box_abort(int err) {
+    printf("abort %%d\\n", err);
+    exit(1);
+}
+
+void __box_faulthandler(int32_t err) {
+    printf("fault %%d\\n", err);
+    exit(1);
+}
+
+void __box_return(void) {}
+uint8_t __box_box1_ram_start, __box_box1_ram_end;
+uint8_t __box_box2_ram_start, __box_box2_ram_end;
+uint32_t __box_box1_jumptable[3];
+uint32_t __box_box2_jumptable[3];
+
+int main(void) {
+    // start from garbage
+    uint32_t x = 0x2545f491;
+    for (int i = 0; i < 16; i++) {
+        mpu.regions[i][0] = ref.regions[i][0] = xorshift(&x);
+        mpu.regions[i][1] = ref.regions[i][1] = xorshift(&x);
+    }
+    __mock = &ref;
+    __box_mpu_init();
+    __mock = &mpu;
+
+    // stack, postinit, and ping, pcs encode the box
+    __box_box1_jumptable[0] = (uint32_t)(uintptr_t)&__mock_stacks[1][1024];
+    __box_box1_jumptable[1] = 0x11;
+    __box_box1_jumptable[2] = 0x13;
+    __box_box2_jumptable[0] = (uint32_t)(uintptr_t)&__mock_stacks[2][1024];
+    __box_box2_jumptable[1] = 0x21;
+    __box_box2_jumptable[2] = 0x23;
+
+    // initializing either box initializes the other
+    int32_t res = box1_ping(4);
+    if (res != 12121) {
+        printf("box1_ping(4) = %%d\\n", res);
+        return 1;
+    }
+    res = box2_ping(3);
+    if (res != 1212) {
+        printf("box2_ping(3) = %%d\\n", res);
+        return 1;
+    }
+    if (__mock_postinits[1] != 1 || __mock_postinits[2] != 1) {
+        printf("postinits %%d %%d\\n",
+            __mock_postinits[1], __mock_postinits[2]);
+        return 1;
+    }
+
+    // boxes can't initialize other boxes
+    __box_box2_clobber();
+    res = box1_ping(1);
+    if (res != -EAGAIN) {
+        printf("box1_ping(1) after clobber = %%d\\n", res);
+        return 1;
+    }
+    res = box2_ping(2);
+    if (res != 212) {
+        printf("box2_ping(2) = %%d\\n", res);
+        return 1;
+    }
+
+    for (long i = 0; i < %(iterations)d; i++) {
+        uint32_t n = xorshift(&x) %% 8;
+        res = (xorshift(&x) %% 2) ? box1_ping(n) : box2_ping(n);
+        if (res < 0) {
+            printf("ping(%%d) = %%d\\n", n, res);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+"""
+
+def mockcalls(code, parent, runtime, boxes):
+    """
+    Extend the mock with the parent's box state, init, and the C side of
+    the call/return handlers, the naked handlers themselves are left out.
+    """
+    header = code[:code.index('\n};\n', code.index('enum box_errors'))+4]
+    state = '\n'.join(re.findall(r'^uint32_t __box_active = 0;$'
+        r'|^extern void __box_return\(void\);$'
+        r'|^struct __box_state \{.*?^\};$', code, re.M | re.S))
+    start = re.search(r'^//// %s ' % boxes[0].name, code, re.M).start()
+    end = re.search(r'^const struct __box_mpudelta ', code, re.M).start()
+    decls = code[start:end]
+    decls += code[code.index('const uint32_t *const __box_jumptables'):]
+    # leave out the naked handlers, these are asm
+    decls = re.sub(r'^__attribute__\(\(naked[^\n]*\n([^\n]*) \{\n.*?^\}\n',
+        r'\1;\n', decls, flags=re.M | re.S)
+    decls = re.sub(r'^__attribute__\(\(alias[^\n]*\n[^\n]*;\n',
+        '', decls, flags=re.M)
+    # our sys functions don't fit in 32-bits, boxes only call each other
+    decls = re.sub(r'^(\s*)\(uint32_t\)\w+,$', r'\g<1>1,', decls,
+        flags=re.M)
+    decls = decls.replace('(uint32_t)&__box_return',
+        '(uint32_t)(uintptr_t)&__box_return')
+    decls = decls.replace('(uint32_t)fp', '(uint32_t)(uintptr_t)fp')
+    decls = decls.replace('(uint32_t)targetsp',
+        '(uint32_t)(uintptr_t)targetsp')
+
+    # call ops, from where the linker scripts put each call
+    ops = []
+    for box in [parent] + boxes:
+        ld = next(output for output in box.outputs
+            if output.__argname__ == 'ld').getvalue()
+        for name, expr in re.findall(
+                r'^(\w+)\s*= __box_callregion \+ (.*);$', ld, re.M):
+            ops.append('#define __mock_op_%s%s %d' % (
+                '' if box == parent else box.name + '_',
+                name, eval(expr) & ~1))
+
+    return '\n'.join([header, state] + ops + [
+        mock(code, parent, runtime, boxes), decls])
+
+@pytest.mark.parametrize('runtime', ['armv7m-mpu', 'armv8m-mpu'])
+def test_mpu_sibling_calls(tmpdir, runtime):
+    for name in ['box1', 'box2']:
+        tmpdir.mkdir(name)
+    box = build(str(tmpdir), SIBLING_RECIPE % dict(runtime=runtime))
+    parent, runtime, boxes = next(mpuparents(box))
+    code = next(output for output in parent.outputs
+        if output.__argname__ == 'c').getvalue()
+    src = str(tmpdir.join('mpu_mock.c'))
+    exe = str(tmpdir.join('mpu_mock'))
+    with open(src, 'w') as f:
+        f.write(mockcalls(code, parent, runtime, boxes))
+        f.write(SIBLING_DRIVER % dict(iterations=10000))
+
+    # our stacks and jumptables need to fit in 32-bits
+    subprocess.check_call(['cc', '-O1', '-w', '-no-pie', src, '-o', exe])
+    proc = subprocess.run([exe], stdout=subprocess.PIPE,
+        universal_newlines=True)
+    assert proc.returncode == 0, "exited with %d:\n%s" % (
+        proc.returncode, proc.stdout)
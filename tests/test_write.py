@@ -0,0 +1,151 @@
+#
+# Write glue tests, these build small host projects and run them
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import pytest
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(__file__))
+from test_loaders import generate, run
+
+RECIPE = """
+memory.flash = 'rxp 0x10000000-0x1003ffff'
+memory.ram   = 'rwx 0x20000000-0x2003ffff'
+
+runtime = 'host-sys'
+output.h = 'bb.h'
+output.c = 'bb.c'
+output.mk.path = 'Makefile'
+all.output.mk.cpu = 'host'
+
+export.__box_write = 'fn(i32, const u8[size], usize size) -> errsize'
+
+import.box1_order = 'fn() -> err'
+import.box1_abort = 'fn() -> err'
+import.box1_exit = 'fn() -> err'
+import.box1_assert = 'fn() -> err'
+
+[box.box1]
+runtime = 'host'
+memory.flash = 'rxp 0x4000'
+memory.ram = 'rw 0x4000'
+stack = 0x1000
+
+output.ld = 'bb.ld'
+output.h = 'bb.h'
+output.c.path = 'bb.c'
+output.c.write_buffer = %(write_buffer)d
+output.mk = 'Makefile'
+
+export.box1_order = 'fn() -> err'
+export.box1_abort = 'fn() -> err'
+export.box1_exit = 'fn() -> err'
+export.box1_assert = 'fn() -> err'
+"""
+
+SYS = """
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "bb.h"
+
+// while calling into the box, each write shows up in brackets in a log
+static bool capture = false;
+static char log_[256];
+static size_t log_size = 0;
+
+ssize_t __box_write(int32_t fd, const void *buffer, size_t size) {
+    if (!capture) {
+        return write(fd, buffer, size);
+    }
+
+    if (log_size + size + 2 > sizeof(log_)) {
+        return -ENOMEM;
+    }
+    log_[log_size++] = '[';
+    memcpy(&log_[log_size], buffer, size);
+    log_size += size;
+    log_[log_size++] = ']';
+    return size;
+}
+
+static void call(const char *name, int (*fn)(void)) {
+    log_size = 0;
+    capture = true;
+    int err = fn();
+    capture = false;
+    write(1, log_, log_size);
+    printf("%s %d\\n", name, err);
+}
+
+int main(void) {
+    call("order", box1_order);
+    call("abort", box1_abort);
+    call("exit", box1_exit);
+    call("assert", box1_assert);
+    return 0;
+}
+"""
+
+BOX = """
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bb.h"
+
+// where newlib's puts and fwrite end up
+int _write(int handle, const char *buffer, int size);
+
+int box1_order(void) {
+    printf("a%d", 1);
+    _write(1, "b", 1);
+    printf("c%d\\n", 2);
+    return 0;
+}
+
+int box1_abort(void) {
+    printf("abort%d", 1);
+    __box_abort(-5);
+}
+
+int box1_exit(void) {
+    printf("exit%d", 1);
+    exit(6);
+}
+
+int box1_assert(void) {
+    printf("assert%d", 1);
+    assert(false);
+    return 0;
+}
+"""
+
+@pytest.mark.parametrize('write_buffer', [0, 64])
+def test_write_buffer(tmpdir, write_buffer):
+    path = str(tmpdir)
+    generate(path, RECIPE % dict(write_buffer=write_buffer), {
+        'main.c': SYS,
+        'box1/main.c': BOX})
+    stdout = run(path)
+    results = {m.group(2): (m.group(1), int(m.group(3)))
+        for m in re.finditer(r'((?:\[[^]]*\])*)(\w+) (-?\d+)\n', stdout)}
+
+    # output comes out in order, whether it goes through printf or _write
+    writes, err = results['order']
+    assert ''.join(re.findall(r'\[([^]]*)\]', writes)) == 'a1bc2\n'
+    assert err == 0
+    if write_buffer:
+        # and a line is a single write
+        assert writes == '[a1bc2\n]'
+
+    # output isn't lost when the box aborts
+    for name, code in [('abort', -5), ('exit', -6), ('assert', -1)]:
+        writes, err = results[name]
+        assert ''.join(re.findall(r'\[([^]]*)\]', writes)).startswith(
+            '%s1' % name)
+        assert err == code
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+#
+# Host benchmark for calls into wamr boxes
+#
+# Builds Wamr's interpreter from extra/wamr-modified on the host, loads a
+# small hand-assembled wasm module, and measures the latency of calling
+# an exported add2, both the way the generated wrappers used to, looking
+# up the export by name on every call, and the way they do now, through
+# the handle resolved in __box_<box>_init. A plain indirect call, which
+# is what a jumptable box costs, is measured for comparison. Needs no
+# wasm toolchain. Run directly:
+#
+#   python3 tests/wamr_bench.py
+#
+# Copyright (c) 2020, Arm Limited. All rights reserved.
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import argparse
+import glob
+import os
+import subprocess
+import tempfile
+
+WAMR = os.path.join(os.path.dirname(__file__), '..', 'extra', 'wamr-modified')
+
+DRIVER = """
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "wasm_export.h"
+
+// no natives are registered, so nothing calls into native code
+bool invokeNative(void (*native_code)(), uint32_t argv[], uint32_t argc) {
+    return false;
+}
+
+static const uint8_t module_image[] = {
+%(module)s
+};
+
+static uint64_t now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+}
+
+__attribute__((noinline))
+static int32_t add2(int32_t a, int32_t b) {
+    return a + b;
+}
+
+int main(void) {
+    char error[128];
+    // wamr rewrites the module as it loads it
+    static uint8_t image[sizeof(module_image)];
+    memcpy(image, module_image, sizeof(module_image));
+
+    if (!wasm_runtime_init()) {
+        printf("wasm_runtime_init failed\\n");
+        return 1;
+    }
+    wasm_module_t module = wasm_runtime_load(image, sizeof(image),
+            error, sizeof(error));
+    if (!module) {
+        printf("wasm_runtime_load failed: %%s\\n", error);
+        return 1;
+    }
+    wasm_module_inst_t module_inst = wasm_runtime_instantiate(module,
+            0x1000, 0, error, sizeof(error));
+    if (!module_inst) {
+        printf("wasm_runtime_instantiate failed: %%s\\n", error);
+        return 1;
+    }
+    wasm_exec_env_t exec_env = wasm_runtime_create_exec_env(
+            module_inst, 0x1000);
+    if (!exec_env) {
+        printf("wasm_runtime_create_exec_env failed\\n");
+        return 1;
+    }
+
+    // jumptable, a plain indirect call
+    int32_t (*volatile fn)(int32_t, int32_t) = add2;
+    uint64_t start = now();
+    for (uint32_t i = 0; i < %(iterations)d; i++) {
+        if (fn(i, 1) != (int32_t)(i + 1)) {
+            printf("add2(%%u, 1) failed\\n", i);
+            return 1;
+        }
+    }
+    uint64_t jumptable = now() - start;
+
+    // look up the export on every call
+    start = now();
+    for (uint32_t i = 0; i < %(iterations)d; i++) {
+        wasm_function_inst_t f = wasm_runtime_lookup_function(
+                module_inst, "box1_add2", "(ii)i");
+        uint32_t frame[2] = {i, 1};
+        if (!f || !wasm_runtime_call_wasm(exec_env, f, 2, frame)
+                || frame[0] != i + 1) {
+            printf("box1_add2(%%u, 1) failed\\n", i);
+            return 1;
+        }
+    }
+    uint64_t lookup = now() - start;
+
+    // look up the export once, as __box_<box>_init does
+    wasm_function_inst_t f = wasm_runtime_lookup_function(
+            module_inst, "box1_add2", "(ii)i");
+    start = now();
+    for (uint32_t i = 0; i < %(iterations)d; i++) {
+        uint32_t frame[2] = {i, 1};
+        if (!wasm_runtime_call_wasm(exec_env, f, 2, frame)
+                || frame[0] != i + 1) {
+            printf("box1_add2(%%u, 1) failed\\n", i);
+            return 1;
+        }
+    }
+    uint64_t cached = now() - start;
+
+    printf("%%.1f %%.1f %%.1f\\n",
+        (double)jumptable / %(iterations)d,
+        (double)lookup / %(iterations)d,
+        (double)cached / %(iterations)d);
+    return 0;
+}
+"""
+
+def leb128(x):
+    """
+    Encode an unsigned LEB128 integer.
+    """
+    data = bytearray()
+    while True:
+        byte = x & 0x7f
+        x >>= 7
+        if x:
+            data.append(byte | 0x80)
+        else:
+            data.append(byte)
+            return bytes(data)
+
+def section(id, *entries):
+    """
+    Encode a wasm section made of a vector of entries.
+    """
+    data = leb128(len(entries)) + b''.join(entries)
+    return bytes([id]) + leb128(len(data)) + data
+
+def name(s):
+    return leb128(len(s)) + s.encode()
+
+def module(exports):
+    """
+    Assemble a wasm module with the given number of (i32, i32) -> i32
+    exports, box1_add2 is exported last so lookups scan every export
+    before finding it.
+    """
+    names = ['box1_export%d' % i for i in range(exports-1)] + ['box1_add2']
+    return (b'\0asm' + bytes([1, 0, 0, 0])
+        # type (i32, i32) -> i32
+        + section(1, bytes([0x60, 2, 0x7f, 0x7f, 1, 0x7f]))
+        # functions
+        + section(3, *[leb128(0) for _ in names])
+        # memory, 1 page, boxes always have one
+        + section(5, bytes([0, 1]))
+        # exports
+        + section(7, *[name(n) + bytes([0]) + leb128(i)
+            for i, n in enumerate(names)])
+        # code, local.get 0, local.get 1, i32.add
+        + section(10, *[bytes([7, 0, 0x20, 0, 0x20, 1, 0x6a, 0x0b])
+            for _ in names]))
+
+def bench(args, dir):
+    src = os.path.join(dir, 'main.c')
+    exe = os.path.join(dir, 'wamr')
+    image = module(args.exports)
+    with open(src, 'w') as f:
+        f.write(DRIVER % dict(
+            module='\n'.join('    %s' % ' '.join(
+                    '%#04x,' % x for x in image[i:i+8])
+                for i in range(0, len(image), 8)),
+            iterations=args.iterations))
+
+    subprocess.check_call([args.cc, '-O2', '-w',
+            '-include', 'stddef.h',
+            '-include', os.path.join(WAMR, 'wasm_config.h'),
+            '-D__BOX_WAMR_INTERP=1']
+        + ['-I%s' % os.path.join(WAMR, inc) for inc in
+            ['', 'include', 'utils', 'common', 'interpreter']]
+        + [src]
+        + sorted(glob.glob(os.path.join(WAMR, 'utils', '*.c')))
+        + sorted(glob.glob(os.path.join(WAMR, 'common', '*.c')))
+        + sorted(glob.glob(os.path.join(WAMR, 'interpreter', '*.c')))
+        + ['-lm', '-o', exe])
+    out = subprocess.check_output([exe]).decode().split()
+    return [float(x) for x in out]
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare wamr export call latency on the host.")
+    parser.add_argument('--exports', type=int, default=16,
+        help="Number of exports in the module, the called export is "
+            "last. Defaults to 16.")
+    parser.add_argument('-n', '--iterations', type=int, default=1000000,
+        help="Number of calls. Defaults to 1000000.")
+    parser.add_argument('--cc', default=os.environ.get('CC', 'cc'),
+        help="Host C compiler. Defaults to $CC or cc.")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as dir:
+        jumptable, lookup, cached = bench(args, dir)
+    print('%-16s %10s' % ('call', 'ns'))
+    print('%-16s %10.1f' % ('jumptable', jumptable))
+    print('%-16s %10.1f' % ('wamr lookup', lookup))
+    print('%-16s %10.1f' % ('wamr cached', cached))
+
+if __name__ == "__main__":
+    main()